@@ -0,0 +1,871 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_bench.c
+ * @brief:	Native host benchmark for the USB wallet stack.
+ *			It drives twi_usb_wallet_if the same way crypto_guard_if.c does from the browser (send status and
+ *			connection notifications are deferred to the dispatch loop, which only runs when woken up) but the
+ *			JS/WebHID side is replaced by a native transport (twi_transport.h), by default the in-process simulated
+ *			firmware, so ops/sec and per-layer latency can be measured without a device.
+ *
+ *			usage: twi_bench [xpub|sign_tx|sign_msg|xpubs|all|serve] [iterations] [tx_len] [batch|single|<window>] [session|reopen] [loss_period] [jumbo_reports]
+ *							 [lz|plain|nocoalesce|legacy] [tx_corpus|-] [transport]
+ *
+ *			lz compresses the APDUs, plain only frames them, nocoalesce simulates the firmware that doesn't pack small link messages
+ *			in one report and legacy the firmware that advertises neither.
+ *			tx_corpus is a file of hex encoded transactions, one per line, that sign_tx cycles through instead of the tx_len pattern.
+ *			transport is loopback (the default), unix:<path>, pipe:<read fd>,<write fd> or hidraw:<path>. serve runs the simulated
+ *			firmware behind a unix or pipe transport instead, e.g. "twi_bench serve 1 1 batch session 0 8 lz - unix:/tmp/twi.sock"
+ *			then "twi_bench all 100 256 batch session 0 8 lz - unix:/tmp/twi.sock" measures the stack across the socket.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "twi_usb_wallet_if.h"
+#include "twi_sim_wallet.h"
+#include "twi_transport.h"
+
+/*---------------------------------------------------------*/
+/*- MODULE LOCAL MACROS DEFINITION-------------------------*/
+/*---------------------------------------------------------*/
+#define BENCH_CONNECTING				(0)
+#define BENCH_CONNECTED					(1)
+#define BENCH_DISCONNECTING				(2)
+#define BENCH_DISCONNECTED				(3)
+
+#define BENCH_DEFAULT_ITERATIONS		(1000)
+#define BENCH_DEFAULT_TX_LEN			(256)
+#define BENCH_MSG_LEN					(128)
+#define BENCH_XPUB_BATCH_PATHS			(20)		/*Account discovery window, one xpubs op fetches that many consecutive addresses.*/
+#define BENCH_MAX_LOOPS_PER_OP			(100000)	/*Stall guard, a healthy op needs a few hundred loops at most.*/
+#define BENCH_CORPUS_MAX_TXS			(256)
+#define BENCH_RECORD_MAX_SZ				(16)		/*Largest record the stack keeps for the simulated device, the agreed stack specs.*/
+#define BENCH_IDLE_WAIT_MS				(100)		/*Longest wait for a device report while the stack has nothing to do, a due stack timer cuts it short.*/
+#define BENCH_NO_CORPUS					"-"
+#define BENCH_DEFAULT_TRANSPORT			"loopback"
+
+#define BENCH_NSEC_PER_SEC				(1000000000ULL)
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	BENCH_OP_XPUB = 0,
+	BENCH_OP_SIGN_TX,
+	BENCH_OP_SIGN_MSG,
+	BENCH_OP_XPUB_BATCH,
+	BENCH_OP_INVALID,
+
+}tenu_bench_op;
+
+typedef enum
+{
+	BENCH_STAT_OP = 0,				/*End to end: API call until the result callback.*/
+	BENCH_STAT_RX_PATH,				/*twi_usb_if_notify_data_received: link -> network -> security -> wallet IF.*/
+	BENCH_STAT_DISPATCH,			/*twi_usb_if_dispatch: stack dispatcher, APDU composing and fragment TX.*/
+	BENCH_STAT_TX_STATUS,			/*twi_usb_if_notify_send_status: TX_DONE handling down the stack.*/
+	BENCH_STAT_TRANSPORT,			/*Report write: on the loopback the simulated firmware reassembly, CRC, APDU handling and response fragmentation.*/
+	BENCH_STAT_INVALID,
+
+}tenu_bench_stat;
+
+typedef struct
+{
+	twi_u64	u64_min_ns;
+	twi_u64	u64_max_ns;
+	twi_u64	u64_total_ns;
+	twi_u64	u64_cnt;
+
+}tstr_bench_stat;
+
+/*---------------------------------------------------------*/
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+/*---------------------------------------------------------*/
+static const char* gapc_op_names[BENCH_OP_INVALID] = {"xpub", "sign_tx", "sign_msg", "xpubs"};
+static const char* gapc_stat_names[BENCH_STAT_INVALID] = {"op", "rx path", "dispatch", "tx status", "transport"};
+
+static tstr_sim_wallet 		gstr_sim;
+static tstr_twi_transport 	gstr_transport;
+static tstr_twi_transport_peer gstr_sim_peer;
+static tstr_usb_if_context* gp_ctx 							= NULL;
+static twi_u8 				gu8_conn_state 					= BENCH_DISCONNECTED;
+static twi_u8 				gau8_tx_report[SIM_WALLET_REPORT_SZ];
+static twi_u8 				gau8_rx_report[SIM_WALLET_REPORT_SZ];
+static twi_u8* 				gpu8_tx_batch 					= NULL;
+static twi_u32 				gu32_tx_batch_num 				= 0;
+static twi_bool 			gb_tx_pending 					= TWI_FALSE;
+static twi_bool 			gb_notify_send_status_in_dispatch = TWI_FALSE;
+static twi_s32 				gs32_send_status 				= TWI_SUCCESS;
+static twi_bool 			gb_dispatch_requested 			= TWI_FALSE;
+static twi_bool 			gb_op_done 						= TWI_FALSE;
+static twi_s32 				gs32_op_err 					= TWI_ERROR;
+static tstr_bench_stat 		gastr_stats[BENCH_STAT_INVALID];
+static twi_u32 				gu32_host_reports 				= 0;
+static twi_u8 				gaau8_corpus[BENCH_CORPUS_MAX_TXS][USB_WALLET_SIGNING_TX_MAX_LEN];
+static twi_u16 				gau16_corpus_len[BENCH_CORPUS_MAX_TXS];
+static twi_u32 				gu32_corpus_num 				= 0;
+static twi_u32 				gu32_corpus_idx 				= 0;
+static twi_u16 				gu16_record_id 					= 0;
+static twi_u32 				gu32_record_sz 					= 0;
+static twi_u8 				gau8_record[BENCH_RECORD_MAX_SZ];
+
+/*---------------------------------------------------------*/
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+/*---------------------------------------------------------*/
+static twi_u64 bench_now_ns(void)
+{
+	struct timespec str_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &str_ts);
+	return ((twi_u64)str_ts.tv_sec * BENCH_NSEC_PER_SEC) + (twi_u64)str_ts.tv_nsec;
+}
+
+static void bench_stat_add(tenu_bench_stat enu_stat, twi_u64 u64_ns)
+{
+	tstr_bench_stat* pstr_stat = &gastr_stats[enu_stat];
+
+	if((0 == pstr_stat->u64_cnt) || (u64_ns < pstr_stat->u64_min_ns))
+	{
+		pstr_stat->u64_min_ns = u64_ns;
+	}
+	if(u64_ns > pstr_stat->u64_max_ns)
+	{
+		pstr_stat->u64_max_ns = u64_ns;
+	}
+	pstr_stat->u64_total_ns += u64_ns;
+	pstr_stat->u64_cnt++;
+}
+
+/*Returns the upper bound of the histogram bucket that holds the given percentile of the samples.*/
+static twi_u32 bench_hist_percentile(const tstr_twi_hist* pstr_hist, twi_u32 u32_percent)
+{
+	twi_u32 u32_rank 	= ((pstr_hist->u32_samples_cnt * u32_percent) + 99) / 100;
+	twi_u32 u32_cnt 	= 0;
+	twi_u8	u8_bucket;
+
+	for(u8_bucket = 0; u8_bucket < (TWI_HIST_BUCKETS_NUM - 1); u8_bucket++)
+	{
+		u32_cnt += pstr_hist->au32_buckets[u8_bucket];
+		if(u32_cnt >= u32_rank)
+		{
+			break;
+		}
+	}
+	return (0 == u8_bucket) ? 0 : (((twi_u32)1 << u8_bucket) - 1);
+}
+
+static void bench_hist_print(const char* pc_name, const tstr_twi_hist* pstr_hist)
+{
+	if(0 != pstr_hist->u32_samples_cnt)
+	{
+		printf("%-22s %8u  avg %6.1f ms  p50 <= %5u ms  p99 <= %5u ms  max %5u ms\r\n", pc_name, pstr_hist->u32_samples_cnt,
+				(double)pstr_hist->u32_sum_ms / (double)pstr_hist->u32_samples_cnt, bench_hist_percentile(pstr_hist, 50),
+				bench_hist_percentile(pstr_hist, 99), pstr_hist->u32_max_ms);
+	}
+}
+
+static void bench_stack_stats_print(void)
+{
+	static const char* apc_state_events[USB_IF_STATS_STATE_EVENTS_NUM] = {
+		[USB_WALLET_OP_STATE_CONNECTION_EVENT] 			= "wait connection",
+		[USB_WALLET_OP_STATE_CONNECTION_FAILED_EVENT] 	= "wait connection fail",
+		[USB_WALLET_OP_STATE_DISCONNECTION_EVENT] 		= "wait disconnection",
+		[USB_WALLET_OP_STATE_DATA_RCVD_EVENT] 			= "wait data",
+		[USB_WALLET_OP_STATE_SEND_FAILED_EVENT] 		= "wait send fail",
+		[USB_WALLET_OP_STATE_TIMER_FIRED_EVENT] 		= "wait timer",
+		[USB_WALLET_OP_STATE_USER_CONFIRMATION_EVENT] 	= "wait user"};
+	tstr_usb_if_stats 	str_stats;
+	twi_u8 				u8_idx;
+
+	twi_usb_if_get_stats(gp_ctx, &str_stats);
+	printf("link layer: %u reports sent, %u received, %u dropped, %u send fails, %u send timeouts\r\n", str_stats.str_ll.u32_tx_reports_cnt,
+			str_stats.str_ll.u32_rx_reports_cnt, str_stats.str_ll.u32_rx_dropped_cnt, str_stats.str_ll.u32_tx_fails_cnt, str_stats.str_ll.u32_tx_timeouts_cnt);
+	printf("link layer: %u reports saved by coalescing, %u messages received coalesced\r\n", str_stats.str_ll.u32_tx_saved_reports_cnt,
+			str_stats.str_ll.u32_rx_coalesced_msgs_cnt);
+	printf("network layer: %u packets sent (%u failed) in %u fragments with %u retries, %u packets received in %u fragments\r\n",
+			str_stats.str_nl.u32_tx_pkts_cnt, str_stats.str_nl.u32_tx_failed_pkts_cnt, str_stats.str_nl.u32_tx_frgmts_cnt, str_stats.str_nl.u32_tx_retries_cnt,
+			str_stats.str_nl.u32_rx_pkts_cnt, str_stats.str_nl.u32_rx_frgmts_cnt);
+	printf("network layer: %u CRC errors, %u out of order, %u duplicates, %u other drops, %u NACKs sent, %u ack timeouts\r\n", str_stats.str_nl.u32_rx_crc_errors_cnt,
+			str_stats.str_nl.u32_rx_out_of_order_cnt, str_stats.str_nl.u32_rx_duplicates_cnt, str_stats.str_nl.u32_rx_errors_cnt, str_stats.str_nl.u32_nacks_sent_cnt,
+			str_stats.str_nl.u32_tx_ack_timeouts_cnt);
+	printf("%u APDUs sent (%u awaited the user confirmation), %u responses, %u response timeouts, %u session app reopens\r\n", str_stats.u32_apdus_cnt,
+			str_stats.u32_apdu_confirmations_cnt, str_stats.u32_responses_cnt, str_stats.u32_apdu_timeouts_cnt, str_stats.u32_app_reopens_cnt);
+	bench_hist_print("link send -> tx done", &str_stats.str_ll.str_tx_hist);
+	bench_hist_print("packet send -> status", &str_stats.str_nl.str_tx_hist);
+	bench_hist_print("APDU -> response", &str_stats.str_apdu_hist);
+	for(u8_idx = 0; u8_idx < USB_IF_STATS_STATE_EVENTS_NUM; u8_idx++)
+	{
+		bench_hist_print((NULL != apc_state_events[u8_idx]) ? apc_state_events[u8_idx] : "wait other", &str_stats.astr_state_hist[u8_idx]);
+	}
+}
+
+/*The loopback transport reaches the simulated firmware through these.*/
+static void bench_sim_host_report(void* pv_peer, const twi_u8* pu8_report, twi_u32 u32_report_len)
+{
+	twi_sim_wallet_host_report((tstr_sim_wallet*)pv_peer, pu8_report, u32_report_len);
+}
+
+static twi_bool bench_sim_pop_report(void* pv_peer, twi_u8* pu8_report)
+{
+	return twi_sim_wallet_pop_report((tstr_sim_wallet*)pv_peer, pu8_report);
+}
+
+/*Stands in for usbSend()/usbSendBatch() + the WebHID sendReport() promises: the report(s) are written to the transport and a
+  single send status is delivered to the stack on the next dispatch, like CRYPTO_GUARD_IF_SEND_STATUS_EVT.*/
+static void bench_deliver_tx(void)
+{
+	twi_u64 u64_start;
+
+	gb_tx_pending = TWI_FALSE;
+	u64_start = bench_now_ns();
+	if(NULL != gpu8_tx_batch)
+	{
+		gs32_send_status 	= twi_transport_write(&gstr_transport, gpu8_tx_batch, gu32_tx_batch_num);
+		gu32_host_reports 	+= gu32_tx_batch_num;
+		gpu8_tx_batch 		= NULL;
+		gu32_tx_batch_num 	= 0;
+	}
+	else
+	{
+		gs32_send_status = twi_transport_write(&gstr_transport, gau8_tx_report, 1);
+		gu32_host_reports++;
+	}
+	bench_stat_add(BENCH_STAT_TRANSPORT, bench_now_ns() - u64_start);
+
+	TWI_ASSERT(TWI_TRUE != gb_notify_send_status_in_dispatch);
+	gb_notify_send_status_in_dispatch = TWI_TRUE;
+}
+
+static void bench_dispatch(void)
+{
+	twi_u64 u64_start;
+
+	gb_dispatch_requested = TWI_FALSE;
+	u64_start = bench_now_ns();
+	twi_usb_if_dispatch(gp_ctx);
+	bench_stat_add(BENCH_STAT_DISPATCH, bench_now_ns() - u64_start);
+
+	if(TWI_TRUE == gb_notify_send_status_in_dispatch)
+	{
+		gb_notify_send_status_in_dispatch = TWI_FALSE;
+		if(BENCH_CONNECTING == gu8_conn_state)
+		{
+			gu8_conn_state = (TWI_SUCCESS == gs32_send_status) ? BENCH_CONNECTED : BENCH_DISCONNECTED;
+			twi_usb_if_notify_connected(gp_ctx, gs32_send_status);
+		}
+		else if(BENCH_CONNECTED == gu8_conn_state)
+		{
+			u64_start = bench_now_ns();
+			twi_usb_if_notify_send_status(gp_ctx, gs32_send_status);
+			bench_stat_add(BENCH_STAT_TX_STATUS, bench_now_ns() - u64_start);
+		}
+		else if(BENCH_DISCONNECTING == gu8_conn_state)
+		{
+			gu8_conn_state = BENCH_DISCONNECTED;
+			twi_usb_if_notify_disconnected(gp_ctx, 0, TWI_SUCCESS);
+		}
+		else
+		{
+			TWI_ASSERT(TWI_FALSE);
+		}
+	}
+}
+
+static twi_bool bench_run_loop(void)
+{
+	twi_u32 u32_loops;
+	twi_u64 u64_start;
+	twi_u32 u32_wait_ms;
+	twi_bool b_is_read;
+
+	for(u32_loops = 0; (u32_loops < BENCH_MAX_LOOPS_PER_OP) && (TWI_FALSE == gb_op_done); u32_loops++)
+	{
+		if(TWI_TRUE == gb_tx_pending)
+		{
+			bench_deliver_tx();
+		}
+
+		/*The sendReport() promise settles before the next input report event, the send status goes first.*/
+		if((BENCH_CONNECTED == gu8_conn_state) && (TWI_FALSE == gb_notify_send_status_in_dispatch))
+		{
+			/*Only wait for the device when the stack has nothing else to do, and not past its next timer.*/
+			u32_wait_ms = 0;
+			if((TWI_FALSE == gb_dispatch_requested) && (TWI_FALSE == gb_tx_pending))
+			{
+				u32_wait_ms = BENCH_IDLE_WAIT_MS;
+				if((TWI_TRUE == twi_usb_if_get_next_timeout(gp_ctx, &u32_wait_ms)) && (u32_wait_ms > BENCH_IDLE_WAIT_MS))
+				{
+					u32_wait_ms = BENCH_IDLE_WAIT_MS;
+				}
+			}
+
+			if(TWI_SUCCESS != twi_transport_read(&gstr_transport, gau8_rx_report, u32_wait_ms, &b_is_read))
+			{
+				printf("transport read failed, the device is gone\r\n");
+				break;
+			}
+			if(TWI_TRUE == b_is_read)
+			{
+				u64_start = bench_now_ns();
+				twi_usb_if_notify_data_received(gp_ctx, gau8_rx_report, SIM_WALLET_REPORT_SZ, TWI_SUCCESS);
+				bench_stat_add(BENCH_STAT_RX_PATH, bench_now_ns() - u64_start);
+				gb_dispatch_requested = TWI_TRUE;
+			}
+			else if((TWI_TRUE == twi_usb_if_get_next_timeout(gp_ctx, &u32_wait_ms)) && (0 == u32_wait_ms))
+			{
+				/*The dispatch fires the expired stack timers.*/
+				gb_dispatch_requested = TWI_TRUE;
+			}
+		}
+
+		/*Like the bridge, only dispatch when the stack or a notification asked for it.*/
+		if((TWI_TRUE == gb_dispatch_requested) || (TWI_TRUE == gb_notify_send_status_in_dispatch))
+		{
+			bench_dispatch();
+		}
+	}
+
+	return gb_op_done;
+}
+
+/*---------------------------------------------------------*/
+/*- USB WALLET IF CALLBACKS -------------------------------*/
+/*---------------------------------------------------------*/
+static void usb_scan_and_connect_cb(void* const pv_device, twi_u8* pu8_dvc_id, twi_u8 u8_dvc_id_len, twi_u16 u16_vid, twi_u16 u16_pid, twi_u32 u32_scan_time_out_msec, twi_u32 u32_mtu_sz)
+{
+	/*Device is always present, open the port like CRYPTO_GUARD_IF_CONNECTED_EVT does.*/
+	gu8_conn_state = BENCH_CONNECTING;
+	TWI_MEMSET(gau8_tx_report, 0, SIM_WALLET_REPORT_SZ);
+	gau8_tx_report[0] = SIM_WALLET_OPEN_PORT_CODE;
+	gb_tx_pending = TWI_TRUE;
+}
+
+static void usb_disconnect_cb(void* const pv_device)
+{
+	gu8_conn_state = BENCH_DISCONNECTING;
+	TWI_MEMSET(gau8_tx_report, 0, SIM_WALLET_REPORT_SZ);
+	gau8_tx_report[0] = SIM_WALLET_CLOSE_PORT_CODE;
+	gb_tx_pending = TWI_TRUE;
+}
+
+static void usb_receive_cb(void* const pv_device, void *p_rx_buf, twi_u32* pu32_length)
+{
+	*pu32_length = gau8_rx_report[0];
+	TWI_MEMCPY(p_rx_buf, &gau8_rx_report[1], *pu32_length);
+}
+
+static void usb_stop_cb(void* const pv_device)
+{
+}
+
+static void usb_disable_cb(void* const pv_device)
+{
+}
+
+static void usb_dispatch_cb(void* const pv_device)
+{
+}
+
+static void usb_wake_cb(void* const pv_device)
+{
+	gb_dispatch_requested = TWI_TRUE;
+}
+
+static void usb_send_cb(void* const pv_device, twi_u8* const pu8_data, twi_u32 u32_data_sz)
+{
+	TWI_ASSERT((TWI_FALSE == gb_tx_pending) && (u32_data_sz < SIM_WALLET_REPORT_SZ));
+	TWI_MEMSET(gau8_tx_report, 0, SIM_WALLET_REPORT_SZ);
+	gau8_tx_report[0] = u32_data_sz & 0x3f;
+	TWI_MEMCPY(&gau8_tx_report[1], pu8_data, u32_data_sz);
+	gb_tx_pending = TWI_TRUE;
+}
+
+static void usb_send_batch_cb(void* const pv_device, twi_u8* const pu8_reports, twi_u32 u32_reports_num)
+{
+	/*The reports stay in the link layer buffer until the send status is delivered.*/
+	TWI_ASSERT((TWI_FALSE == gb_tx_pending) && (NULL != pu8_reports) && (0 != u32_reports_num));
+	gpu8_tx_batch 		= pu8_reports;
+	gu32_tx_batch_num 	= u32_reports_num;
+	gb_tx_pending 		= TWI_TRUE;
+}
+
+static void usb_Start_Timer_cb(void* const pv_device, twi_u32 u32_idx, twi_u32 u32_dur_msec)
+{
+}
+
+static void usb_Stop_Timer_cb(void* const pv_device, twi_u32 u32_idx)
+{
+}
+
+static void usb_send_to_cloud_cb(void* const pv_device, twi_u8* const pu8_data, twi_u32 u32_data_sz)
+{
+}
+
+static void usb_onUserConfirmationRequested_cb(void* const pv_device, twi_u32 u32_conf_type)
+{
+}
+
+static void usb_onUserConfirmationObtained_cb(void* const pv_device, twi_u32 u32_conf_type)
+{
+}
+
+static void usb_onGetExtendedPubKeyResult_cb(void* const pv_device, twi_u8* const pu8_pub_key, twi_u32 u32_pub_key_sz, twi_s32 s32_err)
+{
+	gs32_op_err = s32_err;
+	gb_op_done 	= TWI_TRUE;
+}
+
+static void usb_onGetExtendedPubKeysResult_cb(void* const pv_device, twi_u8* const pu8_pub_keys, twi_u32 u32_pub_keys_sz, twi_u8 u8_pub_keys_num, twi_s32 s32_err)
+{
+	gs32_op_err = ((TWI_SUCCESS == s32_err) && (BENCH_XPUB_BATCH_PATHS != u8_pub_keys_num)) ? TWI_ERROR : s32_err;
+	gb_op_done 	= TWI_TRUE;
+}
+
+static void usb_onSignTransactionResult_cb(void* const pv_device, void* pstr_signed_tx, twi_s32 s32_err)
+{
+	gs32_op_err = s32_err;
+	gb_op_done 	= TWI_TRUE;
+}
+
+static void usb_onSignMessageResult_cb(void* const pv_device, void* pstr_signed_msg, twi_s32 s32_err)
+{
+	gs32_op_err = s32_err;
+	gb_op_done 	= TWI_TRUE;
+}
+
+static void usb_onGetWalletIDResult_cb(void* const pv_device, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_s32 s32_err)
+{
+}
+
+/*There is one simulated device and the stack keeps one record for it, an empty record drops it.*/
+static void usb_save_cb(void* const pv_device, twi_u16 id,  twi_u8* pu8_data, twi_u32 u32_data_sz)
+{
+	gu32_record_sz = 0;
+	if((NULL != pu8_data) && (0 != u32_data_sz) && (u32_data_sz <= BENCH_RECORD_MAX_SZ))
+	{
+		gu16_record_id = id;
+		gu32_record_sz = u32_data_sz;
+		TWI_MEMCPY(gau8_record, pu8_data, u32_data_sz);
+	}
+}
+
+static void usb_load_cb(void* const pv_device, twi_u16 id, twi_u8* pu8_data, twi_u32* pu32_data_sz)
+{
+	if((0 != gu32_record_sz) && (id == gu16_record_id) && (gu32_record_sz <= *pu32_data_sz))
+	{
+		TWI_MEMCPY(pu8_data, gau8_record, gu32_record_sz);
+		*pu32_data_sz = gu32_record_sz;
+	}
+	else
+	{
+		*pu32_data_sz = 0;
+	}
+}
+
+static void usb_onConnectionDone_cb(void* const pv_device)
+{
+}
+
+static twi_u32 usb_get_time_ms_cb(void* const pv_device)
+{
+	return (twi_u32)(bench_now_ns() / 1000000);
+}
+
+/*---------------------------------------------------------*/
+/*- BENCH OPERATIONS --------------------------------------*/
+/*---------------------------------------------------------*/
+static void bench_start_op(tenu_bench_op enu_op, twi_u32 u32_tx_len)
+{
+	static tstr_usb_ethereum_tx 	str_eth_tx;
+	static tstr_usb_ethereum_msg 	str_eth_msg;
+	static tstr_usb_crypto_path 	astr_paths[BENCH_XPUB_BATCH_PATHS];
+	tstr_usb_crypto_path 			str_path;
+	twi_u32 						au32_path[] = {0x8000002C, 0x8000003C, 0x80000000, 0x00000000, 0x00000000};
+	twi_u32 						u32_idx;
+
+	TWI_MEMSET(&str_path, 0, sizeof(tstr_usb_crypto_path));
+	str_path.u8_steps_num = sizeof(au32_path)/sizeof(twi_u32);
+	TWI_MEMCPY(str_path.au32_path_steps, au32_path, sizeof(au32_path));
+
+	gb_op_done 				= TWI_FALSE;
+	gs32_op_err 			= TWI_ERROR;
+	gb_dispatch_requested 	= TWI_TRUE;
+
+	switch(enu_op)
+	{
+		case BENCH_OP_XPUB:
+		{
+			twi_usb_if_get_ext_pub_key(gp_ctx, USB_WALLET_COIN_ETHEREUM, &str_path, NULL, 0, TWI_FALSE);
+			break;
+		}
+
+		case BENCH_OP_SIGN_TX:
+		{
+			if(0 != gu32_corpus_num)
+			{
+				str_eth_tx.u16_signing_tx_len = gau16_corpus_len[gu32_corpus_idx];
+				TWI_MEMCPY(str_eth_tx.au8_signing_tx, gaau8_corpus[gu32_corpus_idx], str_eth_tx.u16_signing_tx_len);
+				gu32_corpus_idx = (gu32_corpus_idx + 1) % gu32_corpus_num;
+			}
+			else
+			{
+				str_eth_tx.u16_signing_tx_len = (twi_u16)u32_tx_len;
+				for(u32_idx = 0; u32_idx < u32_tx_len; u32_idx++)
+				{
+					str_eth_tx.au8_signing_tx[u32_idx] = (twi_u8)u32_idx;
+				}
+			}
+			TWI_MEMCPY(&str_eth_tx.str_signing_key_path, &str_path, sizeof(tstr_usb_crypto_path));
+			twi_usb_if_sign_tx(gp_ctx, USB_WALLET_COIN_ETHEREUM, &str_eth_tx, NULL, 0, TWI_FALSE);
+			break;
+		}
+
+		case BENCH_OP_SIGN_MSG:
+		{
+			str_eth_msg.u32_msg_len = BENCH_MSG_LEN;
+			for(u32_idx = 0; u32_idx < BENCH_MSG_LEN; u32_idx++)
+			{
+				str_eth_msg.au8_msg_buf[u32_idx] = (twi_u8)('a' + (u32_idx % 26));
+			}
+			TWI_MEMSET(str_eth_msg.au8_msg_sha_256_hash, 0xA5, sizeof(str_eth_msg.au8_msg_sha_256_hash));
+			TWI_MEMCPY(&str_eth_msg.str_sign_key_path, &str_path, sizeof(tstr_usb_crypto_path));
+			twi_usb_if_sign_msg(gp_ctx, USB_WALLET_COIN_ETHEREUM, &str_eth_msg, NULL, 0, TWI_FALSE);
+			break;
+		}
+
+		case BENCH_OP_XPUB_BATCH:
+		{
+			for(u32_idx = 0; u32_idx < BENCH_XPUB_BATCH_PATHS; u32_idx++)
+			{
+				TWI_MEMCPY(&astr_paths[u32_idx], &str_path, sizeof(tstr_usb_crypto_path));
+				astr_paths[u32_idx].au32_path_steps[str_path.u8_steps_num - 1] = u32_idx;
+			}
+			twi_usb_if_get_ext_pub_keys(gp_ctx, USB_WALLET_COIN_ETHEREUM, astr_paths, BENCH_XPUB_BATCH_PATHS, NULL, 0, TWI_FALSE);
+			break;
+		}
+
+		default:
+		{
+			TWI_ASSERT(TWI_FALSE);
+			break;
+		}
+	}
+}
+
+/*Reads one hex encoded transaction per line, with or without the 0x prefix. Empty lines are skipped and longer transactions are cut.*/
+static twi_u32 bench_load_corpus(const char* pc_path)
+{
+	static char ac_line[(2 * USB_WALLET_SIGNING_TX_MAX_LEN) + 8];
+	FILE* 		pf_corpus = fopen(pc_path, "r");
+	unsigned 	u_byte;
+
+	if(NULL != pf_corpus)
+	{
+		while((gu32_corpus_num < BENCH_CORPUS_MAX_TXS) && (NULL != fgets(ac_line, sizeof(ac_line), pf_corpus)))
+		{
+			char* 	pc_hex 	= ac_line;
+			twi_u16 u16_len = 0;
+
+			if(('0' == pc_hex[0]) && (('x' == pc_hex[1]) || ('X' == pc_hex[1])))
+			{
+				pc_hex += 2;
+			}
+			while((u16_len < USB_WALLET_SIGNING_TX_MAX_LEN) && (1 == sscanf(pc_hex, "%2x", &u_byte)))
+			{
+				gaau8_corpus[gu32_corpus_num][u16_len++] = (twi_u8)u_byte;
+				pc_hex += 2;
+			}
+			if(0 != u16_len)
+			{
+				gau16_corpus_len[gu32_corpus_num++] = u16_len;
+			}
+		}
+		fclose(pf_corpus);
+	}
+	return gu32_corpus_num;
+}
+
+static void bench_print_stats(void)
+{
+	tenu_bench_stat enu_stat;
+
+	printf("  %-10s %10s %12s %12s %12s\r\n", "layer", "samples", "min(us)", "avg(us)", "max(us)");
+	for(enu_stat = BENCH_STAT_OP; enu_stat < BENCH_STAT_INVALID; enu_stat++)
+	{
+		tstr_bench_stat* pstr_stat = &gastr_stats[enu_stat];
+
+		if(0 != pstr_stat->u64_cnt)
+		{
+			printf("  %-10s %10llu %12.3f %12.3f %12.3f\r\n", gapc_stat_names[enu_stat], (unsigned long long)pstr_stat->u64_cnt,
+					pstr_stat->u64_min_ns / 1000.0, (pstr_stat->u64_total_ns / (double)pstr_stat->u64_cnt) / 1000.0, pstr_stat->u64_max_ns / 1000.0);
+		}
+	}
+}
+
+static twi_s32 bench_run(tenu_bench_op enu_op, twi_u32 u32_iterations, twi_u32 u32_tx_len)
+{
+	twi_s32 s32_retval = TWI_SUCCESS;
+	twi_u32 u32_iter;
+	twi_u32 u32_apdus_start;
+	twi_u64 u64_op_start;
+	twi_u64 u64_run_start;
+	twi_u64 u64_run_ns;
+
+	TWI_MEMSET(gastr_stats, 0, sizeof(gastr_stats));
+
+	/*Warm up: the first op pays for the port open, the stack specs exchange and opening the Ethereum app.*/
+	bench_start_op(enu_op, u32_tx_len);
+	if((TWI_TRUE != bench_run_loop()) || (TWI_SUCCESS != gs32_op_err))
+	{
+		printf("%s: warm up failed, err = %d\r\n", gapc_op_names[enu_op], gs32_op_err);
+		s32_retval = TWI_ERROR;
+	}
+	else
+	{
+		TWI_MEMSET(gastr_stats, 0, sizeof(gastr_stats));
+		u32_apdus_start = gstr_sim.u32_apdus_cnt;
+		gu32_host_reports = 0;
+		u64_run_start 	= bench_now_ns();
+
+		for(u32_iter = 0; (u32_iter < u32_iterations) && (TWI_SUCCESS == s32_retval); u32_iter++)
+		{
+			u64_op_start = bench_now_ns();
+			bench_start_op(enu_op, u32_tx_len);
+			if((TWI_TRUE != bench_run_loop()) || (TWI_SUCCESS != gs32_op_err))
+			{
+				printf("%s: iteration %u failed, err = %d\r\n", gapc_op_names[enu_op], u32_iter, gs32_op_err);
+				s32_retval = TWI_ERROR;
+			}
+			else
+			{
+				bench_stat_add(BENCH_STAT_OP, bench_now_ns() - u64_op_start);
+			}
+		}
+
+		u64_run_ns = bench_now_ns() - u64_run_start;
+		printf("%s: %u ops in %.3f ms, %.1f ops/sec, %.1f APDUs/op, %.1f host reports/op\r\n", gapc_op_names[enu_op], u32_iter, u64_run_ns / 1e6,
+				(u32_iter * (double)BENCH_NSEC_PER_SEC) / (double)u64_run_ns, (gstr_sim.u32_apdus_cnt - u32_apdus_start) / (double)u32_iter,
+				gu32_host_reports / (double)u32_iter);
+		bench_print_stats();
+	}
+
+	return s32_retval;
+}
+
+/*The simulated firmware behind a transport, for a host bench or stack running in another process. The host closing its side ends it.*/
+static twi_s32 bench_serve(const char* pc_spec)
+{
+	twi_u8 		au8_report[TWI_TRANSPORT_REPORT_SZ];
+	twi_bool 	b_is_read;
+	twi_s32 	s32_retval = twi_transport_listen(&gstr_transport, pc_spec);
+
+	if(TWI_SUCCESS != s32_retval)
+	{
+		printf("can't serve on %s, err = %d\r\n", pc_spec, s32_retval);
+	}
+	else
+	{
+		while(TWI_SUCCESS == s32_retval)
+		{
+			s32_retval = twi_transport_read(&gstr_transport, au8_report, BENCH_IDLE_WAIT_MS, &b_is_read);
+			if((TWI_SUCCESS == s32_retval) && (TWI_TRUE == b_is_read))
+			{
+				twi_sim_wallet_host_report(&gstr_sim, au8_report, TWI_TRANSPORT_REPORT_SZ);
+				while((TWI_SUCCESS == s32_retval) && (TWI_TRUE == twi_sim_wallet_pop_report(&gstr_sim, au8_report)))
+				{
+					s32_retval = twi_transport_write(&gstr_transport, au8_report, 1);
+				}
+			}
+		}
+		twi_transport_close(&gstr_transport);
+		printf("served %u APDUs, %u CRC errors\r\n", gstr_sim.u32_apdus_cnt, gstr_sim.u32_crc_errors_cnt);
+		s32_retval = (0 == gstr_sim.u32_crc_errors_cnt) ? TWI_SUCCESS : TWI_ERROR;
+	}
+
+	return s32_retval;
+}
+
+/*---------------------------------------------------------*/
+/*- MAIN --------------------------------------------------*/
+/*---------------------------------------------------------*/
+int main(int argc, char** argv)
+{
+	twi_s32 		s32_retval 		= TWI_SUCCESS;
+	tenu_bench_op 	enu_first_op 	= BENCH_OP_XPUB;
+	tenu_bench_op 	enu_last_op 	= BENCH_OP_XPUB_BATCH;
+	twi_u32 		u32_iterations 	= BENCH_DEFAULT_ITERATIONS;
+	twi_u32 		u32_tx_len 		= BENCH_DEFAULT_TX_LEN;
+	usb_send_batch 	pf_usb_send_batch = usb_send_batch_cb;
+	twi_bool 		b_app_session 	= TWI_TRUE;
+	twi_u8 			u8_snd_wnd_sz 	= 0;
+	twi_u32 		u32_loss_period = 0;
+	twi_u32 		u32_jumbo_reports = SIM_WALLET_MAX_JUMBO_REPORTS;
+	twi_bool 		b_compression 	= TWI_TRUE;
+	twi_u8 			u8_sim_caps 	= SIM_WALLET_CAPABILITIES;
+	twi_bool 		b_args_valid 	= TWI_TRUE;
+	twi_bool 		b_serve 		= TWI_FALSE;
+	const char* 	pc_transport 	= BENCH_DEFAULT_TRANSPORT;
+	tenu_bench_op 	enu_op;
+
+	gstr_sim_peer.pf_host_report 	= bench_sim_host_report;
+	gstr_sim_peer.pf_pop_report 	= bench_sim_pop_report;
+	gstr_sim_peer.pv_peer 			= &gstr_sim;
+
+	if((argc > 1) && (0 == strcmp(argv[1], "serve")))
+	{
+		b_serve = TWI_TRUE;
+	}
+	else if((argc > 1) && (0 != strcmp(argv[1], "all")))
+	{
+		for(enu_op = BENCH_OP_XPUB; (enu_op < BENCH_OP_INVALID) && (0 != strcmp(argv[1], gapc_op_names[enu_op])); enu_op++);
+		enu_first_op 	= enu_op;
+		enu_last_op 	= enu_op;
+	}
+	if(argc > 2)
+	{
+		u32_iterations = (twi_u32)strtoul(argv[2], NULL, 0);
+	}
+	if(argc > 3)
+	{
+		u32_tx_len = (twi_u32)strtoul(argv[3], NULL, 0);
+	}
+	if((argc > 4) && (0 == strcmp(argv[4], "single")))
+	{
+		/*The link layer still queues the whole window, the host takes one report per call*/
+		pf_usb_send_batch = NULL;
+	}
+	else if(argc > 4)
+	{
+		/*"batch" keeps the whole batch capacity as the send window, a number limits it*/
+		u8_snd_wnd_sz = (twi_u8)strtoul(argv[4], NULL, 0);
+	}
+	if((argc > 5) && (0 == strcmp(argv[5], "reopen")))
+	{
+		b_app_session = TWI_FALSE;
+	}
+	if(argc > 6)
+	{
+		u32_loss_period = (twi_u32)strtoul(argv[6], NULL, 0);
+	}
+	if(argc > 7)
+	{
+		u32_jumbo_reports = (twi_u32)strtoul(argv[7], NULL, 0);
+	}
+	if((argc > 8) && (0 == strcmp(argv[8], "plain")))
+	{
+		b_compression = TWI_FALSE;
+	}
+	else if((argc > 8) && (0 == strcmp(argv[8], "nocoalesce")))
+	{
+		u8_sim_caps = TWI_LL_CAP_LZ_COMPRESSION;
+	}
+	else if((argc > 8) && (0 == strcmp(argv[8], "legacy")))
+	{
+		u8_sim_caps = 0;
+	}
+	if((argc > 9) && (0 != strcmp(argv[9], BENCH_NO_CORPUS)) && (0 == bench_load_corpus(argv[9])))
+	{
+		printf("no transactions read from %s\r\n", argv[9]);
+		b_args_valid = TWI_FALSE;
+	}
+	if(argc > 10)
+	{
+		pc_transport = argv[10];
+	}
+
+	if((TWI_TRUE != b_args_valid) || (BENCH_OP_INVALID == enu_first_op) || (0 == u32_iterations) || (0 == u32_tx_len) || (u32_tx_len > USB_WALLET_SIGNING_TX_MAX_LEN) ||
+		(0 == u32_jumbo_reports) || (u32_jumbo_reports > SIM_WALLET_MAX_JUMBO_REPORTS))
+	{
+		printf("usage: %s [xpub|sign_tx|sign_msg|xpubs|all|serve] [iterations] [tx_len <= %d] [batch|single|<window>] [session|reopen] [loss_period] [jumbo_reports] [lz|plain|nocoalesce|legacy] [tx_corpus|-] [transport]\r\n", argv[0], USB_WALLET_SIGNING_TX_MAX_LEN);
+		s32_retval = TWI_ERROR;
+	}
+	else if(TWI_TRUE == b_serve)
+	{
+		twi_sim_wallet_init(&gstr_sim);
+		twi_sim_wallet_set_tx_loss(&gstr_sim, u32_loss_period);
+		twi_sim_wallet_set_max_jumbo_reports(&gstr_sim, (twi_u8)u32_jumbo_reports);
+		twi_sim_wallet_set_capabilities(&gstr_sim, u8_sim_caps);
+		s32_retval = bench_serve(pc_transport);
+	}
+	else if(TWI_SUCCESS != twi_transport_open(&gstr_transport, pc_transport, &gstr_sim_peer))
+	{
+		printf("can't open the %s transport\r\n", pc_transport);
+		s32_retval = TWI_ERROR;
+	}
+	else
+	{
+		twi_sim_wallet_init(&gstr_sim);
+		twi_sim_wallet_set_tx_loss(&gstr_sim, u32_loss_period);
+		twi_sim_wallet_set_max_jumbo_reports(&gstr_sim, (twi_u8)u32_jumbo_reports);
+		twi_sim_wallet_set_capabilities(&gstr_sim, u8_sim_caps);
+		gp_ctx = twi_usb_if_new();
+		TWI_ASSERT(NULL != gp_ctx);
+		twi_usb_if_set_clock(gp_ctx, usb_get_time_ms_cb);
+		twi_usb_if_set_callbacks(	gp_ctx,
+									usb_scan_and_connect_cb            ,
+									usb_disconnect_cb                  ,
+									usb_receive_cb                     ,
+									usb_stop_cb                        ,
+									usb_disable_cb                     ,
+									usb_dispatch_cb                    ,
+									usb_wake_cb                        ,
+									usb_send_cb                        ,
+									pf_usb_send_batch                  ,
+									usb_Start_Timer_cb                 ,
+									usb_Stop_Timer_cb                  ,
+									usb_send_to_cloud_cb               ,
+									usb_onUserConfirmationRequested_cb ,
+									usb_onUserConfirmationObtained_cb  ,
+									usb_onGetExtendedPubKeyResult_cb   ,
+									usb_onGetExtendedPubKeysResult_cb  ,
+									usb_onSignTransactionResult_cb     ,
+									usb_onSignMessageResult_cb         ,
+									usb_onGetWalletIDResult_cb         ,
+									usb_save_cb                        ,
+									usb_load_cb                        ,
+									usb_onConnectionDone_cb            );
+		twi_usb_if_set_device_info(gp_ctx, &gstr_sim);
+		twi_usb_if_set_app_session(gp_ctx, b_app_session);
+		twi_usb_if_set_send_window(gp_ctx, u8_snd_wnd_sz);
+		twi_usb_if_set_compression(gp_ctx, b_compression);
+
+		for(enu_op = enu_first_op; (enu_op <= enu_last_op) && (TWI_SUCCESS == s32_retval); enu_op++)
+		{
+			s32_retval = bench_run(enu_op, u32_iterations, u32_tx_len);
+		}
+
+		if(0 != gstr_sim.u32_crc_errors_cnt)
+		{
+			printf("simulated firmware saw %u CRC errors\r\n", gstr_sim.u32_crc_errors_cnt);
+			s32_retval = TWI_ERROR;
+		}
+		if(0 != gstr_sim.u32_tx_lost_cnt)
+		{
+			printf("simulated firmware lost %u fragments, resent after %u NACKs\r\n", gstr_sim.u32_tx_lost_cnt, gstr_sim.u32_nacks_cnt);
+		}
+		{
+			twi_u32 u32_srtt_ms;
+			twi_u32 u32_apdu_rto_ms = twi_usb_if_get_apdu_timeout(gp_ctx, &u32_srtt_ms);
+
+			printf("APDU response time %u ms, timeout %u ms\r\n", u32_srtt_ms, u32_apdu_rto_ms);
+		}
+		bench_stack_stats_print();
+		if(0 != gstr_sim.u32_rx_apdus_bytes)
+		{
+			printf("host -> device APDUs: %u bytes sent as %u bytes, %.1f%% saved\r\n", gstr_sim.u32_rx_apdus_bytes, gstr_sim.u32_rx_msgs_bytes,
+					100.0 * ((double)gstr_sim.u32_rx_apdus_bytes - (double)gstr_sim.u32_rx_msgs_bytes) / (double)gstr_sim.u32_rx_apdus_bytes);
+		}
+
+		twi_usb_if_free(gp_ctx);
+		gp_ctx = NULL;
+		twi_transport_close(&gstr_transport);
+	}
+
+	return (TWI_SUCCESS == s32_retval) ? 0 : 1;
+}
@@ -0,0 +1,786 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_sim_wallet.c
+ * @brief:	In-process simulated wallet firmware used by the native twi_bench target.
+ */
+
+#include "twi_sim_wallet.h"
+#include "twi_stack.h"
+#include "twi_usb_wallet_if.h"
+#include "twi_apdu_parser_composer.h"
+#include "crc_16.h"
+#include "twi_lz.h"
+
+/*---------------------------------------------------------*/
+/*- MODULE LOCAL MACROS DEFINITION-------------------------*/
+/*---------------------------------------------------------*/
+#define SIM_CONTROL_MESSAGE_MARKER				(1)
+#define SIM_DATA_MESSAGE_MARKER					(0)
+#define SIM_JUMBO_MESSAGE_MARKER				(2)
+#define SIM_JUMBO_CONTINUATION_MARKER			(3)
+#define SIM_COALESCED_MESSAGE_MARKER			(4)
+#define SIM_JUMBO_MESSAGE_LENGTH_SIZE			(2)
+#define SIM_COALESCED_RECORD_LENGTH_SIZE		(1)
+
+#define SIM_REPORT_LEN_INDEX					(0)
+#define SIM_REPORT_MARKER_INDEX					(1)
+#define SIM_REPORT_ERR_CODE_INDEX				(2)
+#define SIM_REPORT_DATA_INDEX					(2)
+#define SIM_REPORT_ERR_DATA_INDEX				(3)
+
+#define SIM_FRAGMENT_HEADER_LEN					((twi_u8) sizeof(tstr_fragment_header))
+#define SIM_REPORT_MESSAGE_SZ					(SIM_WALLET_REPORT_SZ - 3)		/*Length byte, Message marker and the HID report id the host reserves.*/
+#define SIM_FRAGMENT_PAYLOAD_SZ(SIM)			(sim_get_mtu(SIM) - SIM_FRAGMENT_HEADER_LEN)
+
+#define SIM_STACK_SPECS_MAJOR_VER				(2)
+#define SIM_STACK_SPECS_MINOR_VER				(0)
+#define SIM_STACK_SPECS_DATA_SIZE				(6)
+#define SIM_STACK_SPECS_EXT_DATA_SIZE			(7)		/*The host appends the max reports of one data message when it supports jumbo data messages*/
+#define SIM_STACK_SPECS_CAPS_DATA_SIZE			(8)		/*Then the capabilities bitmap when it supports some of them*/
+
+/*Message header of every message once both sides agreed on TWI_LL_CAP_LZ_COMPRESSION, it shall match twi_no_security_layer.c*/
+#define SIM_MSG_HDR_LEN							(1)
+#define SIM_MSG_HDR_PLAIN						(0x00)
+#define SIM_MSG_HDR_LZ							(0x01)
+#define SIM_LZ_MIN_LEN							(32)
+
+/*Firmware side view of the APDU set, it shall match the host side defines in twi_usb_wallet_if.c*/
+#define SIM_INTERNAL_COMMANDS_CLASS				(0xFF)
+#define SIM_REQUEST_OPEN_APP_INS				(0x04)
+#define SIM_CONFIRM_OPEN_APP_INS				(0x05)
+#define SIM_GET_WALLET_ID_INS					(0x0C)
+
+#define SIM_ETHEREUM_APP_COMMANDS_CLASS			(0x01)
+#define SIM_ETHEREUM_GET_EXTENDED_PUBKEY_INS	(0x00)
+#define SIM_ETHEREUM_REQUEST_SIGN_TX_INS		(0x01)
+#define SIM_ETHEREUM_CONFIRM_SIGN_TX_INS		(0x02)
+#define SIM_ETHEREUM_FINISH_SIGN_TX_INS			(0x03)
+#define SIM_ETHEREUM_START_SIGN_MSG_INS			(0x04)
+#define SIM_ETHEREUM_CONTINUE_SIGN_MSG_INS		(0x05)
+#define SIM_ETHEREUM_REQUEST_SIGN_MSG_INS		(0x06)
+#define SIM_ETHEREUM_FINISH_SIGN_MSG_INS		(0x07)
+
+#define SIM_APDU_RESP_INS_NOT_SUPPORTED			(0x6D00)
+#define SIM_APDU_RESP_CLA_NOT_SUPPORTED			(0x6E00)
+
+#define SIM_XPUB_LEN							(78)		/*4 Version, 1 Depth, 4 Fingerprint, 4 Child Number, 32 Chain Code, 33 Compressed Key*/
+#define SIM_SIGNATURE_LEN						(65)		/*1 V, 32 R, 32 S*/
+#define SIM_WALLET_ID_LEN						(4)
+
+/*---------------------------------------------------------*/
+/*- GLOBAL CONST VARIABLES --------------------------------*/
+/*---------------------------------------------------------*/
+static const twi_u8 gau8_sim_wallet_id[SIM_WALLET_ID_LEN] = {0x54, 0x57, 0x49, 0x01};
+
+/*---------------------------------------------------------*/
+/*- LOCAL FUNCTIONS PROTOTYPES ----------------------------*/
+/*---------------------------------------------------------*/
+static twi_u8* sim_report_push(tstr_sim_wallet* pstr_sim);
+static void sim_reset_session(tstr_sim_wallet* pstr_sim);
+static void sim_send_stack_specs(tstr_sim_wallet* pstr_sim, twi_bool b_is_ext, twi_bool b_is_caps);
+static twi_u16 sim_get_mtu(tstr_sim_wallet* pstr_sim);
+static twi_bool sim_coalesce_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len);
+static void sim_push_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len);
+static void sim_rcv_jumbo(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len);
+static void sim_send_packet(tstr_sim_wallet* pstr_sim, twi_u16 u16_pkt_len);
+static void sim_send_fragment(tstr_sim_wallet* pstr_sim, tstr_fragment_header str_hdr, twi_u16 u16_crc);
+static void sim_resend_missing(tstr_sim_wallet* pstr_sim, twi_u8* pu8_nack, twi_u16 u16_nack_len);
+static void sim_send_reassembly_ack(tstr_sim_wallet* pstr_sim, tstr_fragment_header str_hdr);
+static void sim_fill_pattern(twi_u8* pu8_buf, twi_u16 u16_len, twi_u16 u16_seed);
+static void sim_handle_apdu(tstr_sim_wallet* pstr_sim, twi_u8* pu8_apdu, twi_u16 u16_apdu_len);
+static void sim_handle_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len);
+static void sim_handle_fragment(tstr_sim_wallet* pstr_sim, twi_u8* pu8_frgmt, twi_u16 u16_frgmt_len);
+static void sim_handle_report_msg(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len);
+static void sim_rcv_coalesced(tstr_sim_wallet* pstr_sim, twi_u8* pu8_records, twi_u16 u16_records_len);
+
+/*---------------------------------------------------------*/
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+/*---------------------------------------------------------*/
+static twi_u8* sim_report_push(tstr_sim_wallet* pstr_sim)
+{
+	twi_u8* pu8_report;
+
+	TWI_ASSERT(pstr_sim->u16_reports_cnt < SIM_WALLET_REPORTS_QUEUE_LEN);
+	pu8_report = pstr_sim->aau8_reports[pstr_sim->u16_reports_tail];
+	pstr_sim->u16_reports_tail = (pstr_sim->u16_reports_tail + 1) % SIM_WALLET_REPORTS_QUEUE_LEN;
+	pstr_sim->u16_reports_cnt++;
+	TWI_MEMSET(pu8_report, 0, SIM_WALLET_REPORT_SZ);
+
+	return pu8_report;
+}
+
+static void sim_reset_session(tstr_sim_wallet* pstr_sim)
+{
+	pstr_sim->b_is_specs_exchanged 	= TWI_FALSE;
+	pstr_sim->b_is_app_opened 		= TWI_FALSE;
+	pstr_sim->u16_rx_idx 			= 0;
+	TWI_MEMSET(&pstr_sim->str_rx_expected_hdr, 0, SIM_FRAGMENT_HEADER_LEN);
+	TWI_MEMSET(&pstr_sim->str_tx_hdr, 0, SIM_FRAGMENT_HEADER_LEN);
+	pstr_sim->u16_tx_pkt_len 		= 0;
+	pstr_sim->u8_jumbo_reports 		= 1;
+	pstr_sim->u16_jumbo_rx_len 		= 0;
+	pstr_sim->u8_capabilities 		= 0;
+}
+
+static void sim_send_stack_specs(tstr_sim_wallet* pstr_sim, twi_bool b_is_ext, twi_bool b_is_caps)
+{
+	twi_u8* pu8_report 	= sim_report_push(pstr_sim);
+	twi_u8	u8_idx 		= SIM_REPORT_MARKER_INDEX;
+	twi_u8	u8_byte;
+
+	pu8_report[u8_idx++] = SIM_CONTROL_MESSAGE_MARKER;
+	pu8_report[u8_idx++] = TWI_STACK_SPECS_CMD_ERR_CODE;
+	pu8_report[u8_idx++] = SIM_STACK_SPECS_MAJOR_VER;
+	pu8_report[u8_idx++] = SIM_STACK_SPECS_MINOR_VER;
+	for(u8_byte = 0; u8_byte < sizeof(twi_u32); u8_byte++)
+	{
+		pu8_report[u8_idx++] = (twi_u8)(SIM_WALLET_MAX_CTU >> (8 * u8_byte));
+	}
+	if(TWI_TRUE == b_is_ext)
+	{
+		pu8_report[u8_idx++] = pstr_sim->u8_jumbo_reports;
+		if(TWI_TRUE == b_is_caps)
+		{
+			pu8_report[u8_idx++] = pstr_sim->u8_capabilities;
+		}
+	}
+	pu8_report[SIM_REPORT_LEN_INDEX] = u8_idx - 1;
+}
+
+/*Same as twi_usb_ll_get_mtu_size: one report unless both sides agreed on jumbo data messages.*/
+static twi_u16 sim_get_mtu(tstr_sim_wallet* pstr_sim)
+{
+	twi_u16 u16_retval = SIM_REPORT_MESSAGE_SZ;
+
+	if(pstr_sim->u8_jumbo_reports > 1)
+	{
+		u16_retval = (pstr_sim->u8_jumbo_reports * SIM_REPORT_MESSAGE_SZ) - SIM_JUMBO_MESSAGE_LENGTH_SIZE;
+	}
+	return u16_retval;
+}
+
+/*Packs a single report data message with the newest report the host didn't fetch yet, as the firmware does with its queued reports.*/
+static twi_bool sim_coalesce_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len)
+{
+	twi_u8* pu8_report;
+	twi_u8* pu8_record;
+	twi_u16 u16_records_len;
+	twi_bool b_retval = TWI_FALSE;
+
+	if((0 != (pstr_sim->u8_capabilities & TWI_LL_CAP_COALESCING)) && (pstr_sim->u16_reports_cnt > 0))
+	{
+		pu8_report = pstr_sim->aau8_reports[(pstr_sim->u16_reports_tail + SIM_WALLET_REPORTS_QUEUE_LEN - 1) % SIM_WALLET_REPORTS_QUEUE_LEN];
+		/*A data report becomes the first record of the coalesced report.*/
+		u16_records_len = (SIM_DATA_MESSAGE_MARKER == pu8_report[SIM_REPORT_MARKER_INDEX]) ? (SIM_COALESCED_RECORD_LENGTH_SIZE + pu8_report[SIM_REPORT_LEN_INDEX]) : (pu8_report[SIM_REPORT_LEN_INDEX] - 1);
+
+		if(((SIM_DATA_MESSAGE_MARKER == pu8_report[SIM_REPORT_MARKER_INDEX]) || (SIM_COALESCED_MESSAGE_MARKER == pu8_report[SIM_REPORT_MARKER_INDEX])) &&
+		   ((u16_records_len + SIM_COALESCED_RECORD_LENGTH_SIZE + 1 + u16_msg_len) <= SIM_REPORT_MESSAGE_SZ))
+		{
+			if(SIM_DATA_MESSAGE_MARKER == pu8_report[SIM_REPORT_MARKER_INDEX])
+			{
+				memmove(&pu8_report[SIM_REPORT_DATA_INDEX + SIM_COALESCED_RECORD_LENGTH_SIZE], &pu8_report[SIM_REPORT_MARKER_INDEX], pu8_report[SIM_REPORT_LEN_INDEX]);
+				pu8_report[SIM_REPORT_DATA_INDEX] 	= pu8_report[SIM_REPORT_LEN_INDEX];
+				pu8_report[SIM_REPORT_MARKER_INDEX] = SIM_COALESCED_MESSAGE_MARKER;
+			}
+			pu8_record 		= &pu8_report[SIM_REPORT_DATA_INDEX + u16_records_len];
+			pu8_record[0] 	= (twi_u8)(1 + u16_msg_len);
+			pu8_record[1] 	= SIM_DATA_MESSAGE_MARKER;
+			TWI_MEMCPY(&pu8_record[2], pu8_msg, u16_msg_len);
+			pu8_report[SIM_REPORT_LEN_INDEX] = (twi_u8)(1 + u16_records_len + SIM_COALESCED_RECORD_LENGTH_SIZE + 1 + u16_msg_len);
+			b_retval = TWI_TRUE;
+		}
+	}
+
+	return b_retval;
+}
+
+/*Queues one data message, spread over several reports as a jumbo data message if it doesn't fit in one.*/
+static void sim_push_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len)
+{
+	twi_u8* pu8_report;
+	twi_u16 u16_sent = 0;
+	twi_u16 u16_hdr_len;
+	twi_u16 u16_chunk;
+
+	TWI_ASSERT(u16_msg_len <= sim_get_mtu(pstr_sim));
+	if((u16_msg_len > SIM_REPORT_MESSAGE_SZ) || (TWI_FALSE == sim_coalesce_message(pstr_sim, pu8_msg, u16_msg_len)))
+	{
+		do
+		{
+			pu8_report 	= sim_report_push(pstr_sim);
+			u16_hdr_len = 0;
+			if(u16_msg_len <= SIM_REPORT_MESSAGE_SZ)
+			{
+				pu8_report[SIM_REPORT_MARKER_INDEX] = SIM_DATA_MESSAGE_MARKER;
+			}
+			else if(0 == u16_sent)
+			{
+				pu8_report[SIM_REPORT_MARKER_INDEX] 	= SIM_JUMBO_MESSAGE_MARKER;
+				pu8_report[SIM_REPORT_DATA_INDEX] 		= (twi_u8)(u16_msg_len);
+				pu8_report[SIM_REPORT_DATA_INDEX + 1] 	= (twi_u8)(u16_msg_len >> 8);
+				u16_hdr_len 							= SIM_JUMBO_MESSAGE_LENGTH_SIZE;
+			}
+			else
+			{
+				pu8_report[SIM_REPORT_MARKER_INDEX] = SIM_JUMBO_CONTINUATION_MARKER;
+			}
+
+			u16_chunk = u16_msg_len - u16_sent;
+			u16_chunk = (u16_chunk > (SIM_REPORT_MESSAGE_SZ - u16_hdr_len)) ? (SIM_REPORT_MESSAGE_SZ - u16_hdr_len) : u16_chunk;
+			TWI_MEMCPY(&pu8_report[SIM_REPORT_DATA_INDEX + u16_hdr_len], &pu8_msg[u16_sent], u16_chunk);
+			u16_sent += u16_chunk;
+			pu8_report[SIM_REPORT_LEN_INDEX] = (twi_u8)(1 + u16_hdr_len + u16_chunk);
+		}while(u16_sent < u16_msg_len);
+	}
+}
+
+/*Reassembles the reports of a jumbo data message then handles it as one fragment.*/
+static void sim_rcv_jumbo(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len)
+{
+	twi_u16 u16_data_len;
+
+	if(SIM_JUMBO_MESSAGE_MARKER == pu8_msg[0])
+	{
+		pstr_sim->u16_jumbo_rx_len = (twi_u16)(pu8_msg[1] | (pu8_msg[2] << 8));
+		pstr_sim->u16_jumbo_rx_idx = 0;
+		pu8_msg 		+= 1 + SIM_JUMBO_MESSAGE_LENGTH_SIZE;
+		u16_data_len 	 = u16_msg_len - (1 + SIM_JUMBO_MESSAGE_LENGTH_SIZE);
+	}
+	else
+	{
+		pu8_msg 		+= 1;
+		u16_data_len 	 = u16_msg_len - 1;
+	}
+
+	if((pstr_sim->u8_jumbo_reports > 1) && (pstr_sim->u16_jumbo_rx_len <= sizeof(pstr_sim->au8_jumbo_rx)) &&
+		((pstr_sim->u16_jumbo_rx_idx + u16_data_len) <= pstr_sim->u16_jumbo_rx_len))
+	{
+		TWI_MEMCPY(&pstr_sim->au8_jumbo_rx[pstr_sim->u16_jumbo_rx_idx], pu8_msg, u16_data_len);
+		pstr_sim->u16_jumbo_rx_idx += u16_data_len;
+		if((0 != pstr_sim->u16_jumbo_rx_len) && (pstr_sim->u16_jumbo_rx_idx == pstr_sim->u16_jumbo_rx_len))
+		{
+			pstr_sim->u16_jumbo_rx_len = 0;
+			sim_handle_fragment(pstr_sim, pstr_sim->au8_jumbo_rx, pstr_sim->u16_jumbo_rx_idx);
+		}
+	}
+	else
+	{
+		pstr_sim->u16_jumbo_rx_len = 0;
+	}
+}
+
+/*Fragments au8_tx_pkt the same way twi_nl_snd_fgmnts_window does: full payload fragments then the remaining data and the packet CRC.
+  The packet is kept until the next one so the fragments NACKed by the host can be resent.*/
+static void sim_send_packet(tstr_sim_wallet* pstr_sim, twi_u16 u16_pkt_len)
+{
+	twi_u16 u16_frgmts_num 	= CEIL((u16_pkt_len + CRC_SZ), SIM_FRAGMENT_PAYLOAD_SZ(pstr_sim));
+	twi_u16 u16_crc 		= twi_crc16_compute_checksum(0, pstr_sim->au8_tx_pkt, u16_pkt_len);
+	twi_u16 u16_frgmt;
+
+	pstr_sim->u16_tx_pkt_len 	= u16_pkt_len;
+	pstr_sim->u16_tx_crc 		= u16_crc;
+	pstr_sim->str_tx_last_hdr 	= pstr_sim->str_tx_hdr;
+
+	for(u16_frgmt = 0; u16_frgmt < u16_frgmts_num; u16_frgmt++)
+	{
+		pstr_sim->str_tx_hdr.u8_fragment_index 		= u16_frgmt;
+		pstr_sim->str_tx_hdr.u8_last_fragment_flag 	= (u16_frgmt == (u16_frgmts_num - 1)) ? 1 : 0;
+
+		/*Lose every Nth first transmission of a non last fragment, the host NACK brings it back*/
+		pstr_sim->u32_tx_frgmts_cnt++;
+		if((0 != pstr_sim->u32_tx_loss_period) && (0 == pstr_sim->str_tx_hdr.u8_last_fragment_flag) &&
+			(0 == (pstr_sim->u32_tx_frgmts_cnt % pstr_sim->u32_tx_loss_period)))
+		{
+			pstr_sim->u32_tx_lost_cnt++;
+		}
+		else
+		{
+			sim_send_fragment(pstr_sim, pstr_sim->str_tx_hdr, u16_crc);
+		}
+	}
+
+	pstr_sim->str_tx_hdr.u8_fragment_index 			= 0;
+	pstr_sim->str_tx_hdr.u8_last_fragment_flag 		= 0;
+	pstr_sim->str_tx_hdr.u8_packet_sequence_number 	= ~(pstr_sim->str_tx_hdr.u8_packet_sequence_number);
+}
+
+/*Queues the data message of one fragment of au8_tx_pkt, the last fragment carries the packet CRC.*/
+static void sim_send_fragment(tstr_sim_wallet* pstr_sim, tstr_fragment_header str_hdr, twi_u16 u16_crc)
+{
+	twi_u8	au8_msg[SIM_WALLET_MAX_JUMBO_REPORTS * SIM_REPORT_MESSAGE_SZ];
+	twi_u16 u16_sent 	= str_hdr.u8_fragment_index * SIM_FRAGMENT_PAYLOAD_SZ(pstr_sim);
+	twi_u16 u16_chunk 	= (u16_sent < pstr_sim->u16_tx_pkt_len) ? (pstr_sim->u16_tx_pkt_len - u16_sent) : 0;
+	twi_u16 u16_idx 	= SIM_FRAGMENT_HEADER_LEN;
+
+	if(0 == str_hdr.u8_last_fragment_flag)
+	{
+		u16_chunk = (u16_chunk > SIM_FRAGMENT_PAYLOAD_SZ(pstr_sim)) ? SIM_FRAGMENT_PAYLOAD_SZ(pstr_sim) : u16_chunk;
+	}
+
+	TWI_MEMCPY(au8_msg, &str_hdr, SIM_FRAGMENT_HEADER_LEN);
+	TWI_MEMCPY(&au8_msg[u16_idx], &pstr_sim->au8_tx_pkt[u16_sent], u16_chunk);
+	u16_idx += u16_chunk;
+
+	if(1 == str_hdr.u8_last_fragment_flag)
+	{
+		TWI_MEMCPY(&au8_msg[u16_idx], &u16_crc, CRC_SZ);
+		u16_idx += CRC_SZ;
+	}
+
+	sim_push_message(pstr_sim, au8_msg, u16_idx);
+}
+
+/*Resends the fragments of the last packet listed in a TWI_NL_ERR_FRGMNTS_MISSING bitmap, in index order.*/
+static void sim_resend_missing(tstr_sim_wallet* pstr_sim, twi_u8* pu8_nack, twi_u16 u16_nack_len)
+{
+	tstr_fragment_header str_hdr;
+	twi_u16 u16_frgmts_num 	= CEIL((pstr_sim->u16_tx_pkt_len + CRC_SZ), SIM_FRAGMENT_PAYLOAD_SZ(pstr_sim));
+	twi_u16 u16_frgmt;
+
+	TWI_MEMCPY(&str_hdr, pu8_nack, SIM_FRAGMENT_HEADER_LEN);
+	if((u16_nack_len > SIM_FRAGMENT_HEADER_LEN) && (0 != pstr_sim->u16_tx_pkt_len) &&
+		(str_hdr.u8_packet_sequence_number == pstr_sim->str_tx_last_hdr.u8_packet_sequence_number))
+	{
+		pstr_sim->u32_nacks_cnt++;
+		for(u16_frgmt = 0; (u16_frgmt < u16_frgmts_num) && ((u16_frgmt >> 3) < (u16_nack_len - SIM_FRAGMENT_HEADER_LEN)); u16_frgmt++)
+		{
+			if(0 != (pu8_nack[SIM_FRAGMENT_HEADER_LEN + (u16_frgmt >> 3)] & (1 << (u16_frgmt & 0x07))))
+			{
+				str_hdr.u8_fragment_index 		= u16_frgmt;
+				str_hdr.u8_last_fragment_flag 	= (u16_frgmt == (u16_frgmts_num - 1)) ? 1 : 0;
+				sim_send_fragment(pstr_sim, str_hdr, pstr_sim->u16_tx_crc);
+			}
+		}
+	}
+}
+
+/*Acknowledges a reassembled host packet once both sides agreed on TWI_LL_CAP_REASSEMBLY_ACK, the host holds the packet till then.*/
+static void sim_send_reassembly_ack(tstr_sim_wallet* pstr_sim, tstr_fragment_header str_hdr)
+{
+	twi_u8* pu8_report;
+
+	if(0 != (pstr_sim->u8_capabilities & TWI_LL_CAP_REASSEMBLY_ACK))
+	{
+		pu8_report = sim_report_push(pstr_sim);
+		pu8_report[SIM_REPORT_MARKER_INDEX] 	= SIM_CONTROL_MESSAGE_MARKER;
+		pu8_report[SIM_REPORT_ERR_CODE_INDEX] 	= TWI_NL_PKT_REASSEMBLED;
+		TWI_MEMCPY(&pu8_report[SIM_REPORT_ERR_DATA_INDEX], &str_hdr, SIM_FRAGMENT_HEADER_LEN);
+		pu8_report[SIM_REPORT_LEN_INDEX] 		= SIM_REPORT_ERR_DATA_INDEX - 1 + SIM_FRAGMENT_HEADER_LEN;
+	}
+}
+
+/*Deterministic stand-in for keys and signatures, so runs are reproducible and the host can sanity check lengths.*/
+static void sim_fill_pattern(twi_u8* pu8_buf, twi_u16 u16_len, twi_u16 u16_seed)
+{
+	twi_u16 u16_idx;
+
+	for(u16_idx = 0; u16_idx < u16_len; u16_idx++)
+	{
+		u16_seed 		= (twi_u16)((u16_seed * 25173) + 13849);
+		pu8_buf[u16_idx] = (twi_u8)(u16_seed >> 8);
+	}
+}
+
+static void sim_handle_apdu(tstr_sim_wallet* pstr_sim, twi_u8* pu8_apdu, twi_u16 u16_apdu_len)
+{
+	tstr_twi_apdu_command 	str_cmd;
+	tstr_twi_apdu_response 	str_rsp;
+	twi_u8 					au8_rsp_data[SIM_XPUB_LEN];
+	twi_u32 				u32_rsp_len 	= sizeof(pstr_sim->au8_tx_pkt) - SIM_MSG_HDR_LEN;
+	twi_u16 				u16_seed 		= twi_crc16_compute_checksum(0, pu8_apdu, u16_apdu_len);
+
+	twi_u16 				u16_hdr_len 	= (0 != (pstr_sim->u8_capabilities & TWI_LL_CAP_LZ_COMPRESSION)) ? SIM_MSG_HDR_LEN : 0;
+
+	TWI_MEMSET(&str_rsp, 0, sizeof(tstr_twi_apdu_response));
+	str_rsp.u16_sw = APDU_RESP_SUCCESS;
+	pstr_sim->u32_apdus_cnt++;
+
+	if(TWI_SUCCESS == twi_apdu_parse_cmd(pu8_apdu, u16_apdu_len, &str_cmd))
+	{
+		if(SIM_INTERNAL_COMMANDS_CLASS == str_cmd.u8_cla)
+		{
+			switch(str_cmd.u8_ins)
+			{
+				case SIM_GET_WALLET_ID_INS:
+				{
+					TWI_MEMCPY(au8_rsp_data, gau8_sim_wallet_id, SIM_WALLET_ID_LEN);
+					str_rsp.pu8_rsp_data 		= au8_rsp_data;
+					str_rsp.u32_rsp_data_len 	= SIM_WALLET_ID_LEN;
+					break;
+				}
+
+				case SIM_REQUEST_OPEN_APP_INS:
+				{
+					if(TWI_TRUE == pstr_sim->b_is_app_opened)
+					{
+						str_rsp.u16_sw = APDU_RESP_ALREADY_OPENED;
+					}
+					break;
+				}
+
+				case SIM_CONFIRM_OPEN_APP_INS:
+				{
+					pstr_sim->b_is_app_opened = TWI_TRUE;
+					break;
+				}
+
+				default:
+				{
+					str_rsp.u16_sw = SIM_APDU_RESP_INS_NOT_SUPPORTED;
+					break;
+				}
+			}
+		}
+		else if(TWI_FALSE == pstr_sim->b_is_app_opened)
+		{
+			/*Like the wallet dashboard, no app handles the coin class till one is opened.*/
+			str_rsp.u16_sw = SIM_APDU_RESP_CLA_NOT_SUPPORTED;
+		}
+		else if(SIM_ETHEREUM_APP_COMMANDS_CLASS == str_cmd.u8_cla)
+		{
+			switch(str_cmd.u8_ins)
+			{
+				case SIM_ETHEREUM_GET_EXTENDED_PUBKEY_INS:
+				{
+					sim_fill_pattern(au8_rsp_data, SIM_XPUB_LEN, u16_seed);
+					str_rsp.pu8_rsp_data 		= au8_rsp_data;
+					str_rsp.u32_rsp_data_len 	= SIM_XPUB_LEN;
+					break;
+				}
+
+				case SIM_ETHEREUM_FINISH_SIGN_TX_INS:
+				case SIM_ETHEREUM_FINISH_SIGN_MSG_INS:
+				{
+					sim_fill_pattern(au8_rsp_data, SIM_SIGNATURE_LEN, u16_seed);
+					str_rsp.pu8_rsp_data 		= au8_rsp_data;
+					str_rsp.u32_rsp_data_len 	= SIM_SIGNATURE_LEN;
+					break;
+				}
+
+				case SIM_ETHEREUM_REQUEST_SIGN_TX_INS:
+				case SIM_ETHEREUM_CONFIRM_SIGN_TX_INS:
+				case SIM_ETHEREUM_START_SIGN_MSG_INS:
+				case SIM_ETHEREUM_CONTINUE_SIGN_MSG_INS:
+				case SIM_ETHEREUM_REQUEST_SIGN_MSG_INS:
+				{
+					/*User confirmation is granted immediately by the simulator.*/
+					break;
+				}
+
+				default:
+				{
+					str_rsp.u16_sw = SIM_APDU_RESP_INS_NOT_SUPPORTED;
+					break;
+				}
+			}
+		}
+		else
+		{
+			str_rsp.u16_sw = SIM_APDU_RESP_INS_NOT_SUPPORTED;
+		}
+	}
+	else
+	{
+		str_rsp.u16_sw = SIM_APDU_RESP_INS_NOT_SUPPORTED;
+	}
+
+	TWI_ASSERT(TWI_SUCCESS == twi_apdu_compose_rsp(&str_rsp, &u32_rsp_len, &pstr_sim->au8_tx_pkt[u16_hdr_len]));
+
+	/*Compress the response like the host does, only when it gets shorter*/
+	if(0 != u16_hdr_len)
+	{
+		twi_u8	au8_lz_rsp[SIM_WALLET_MAX_PKT_SZ];
+		twi_u16 u16_lz_len = 0;
+
+		if(u32_rsp_len >= SIM_LZ_MIN_LEN)
+		{
+			u16_lz_len = twi_lz_compress(&pstr_sim->au8_tx_pkt[u16_hdr_len], (twi_u16)u32_rsp_len, au8_lz_rsp, (twi_u16)(u32_rsp_len - SIM_MSG_HDR_LEN));
+		}
+		if(0 != u16_lz_len)
+		{
+			pstr_sim->au8_tx_pkt[0] = SIM_MSG_HDR_LZ;
+			TWI_MEMCPY(&pstr_sim->au8_tx_pkt[u16_hdr_len], au8_lz_rsp, u16_lz_len);
+			u32_rsp_len = u16_lz_len;
+		}
+		else
+		{
+			pstr_sim->au8_tx_pkt[0] = SIM_MSG_HDR_PLAIN;
+		}
+	}
+	sim_send_packet(pstr_sim, (twi_u16)(u16_hdr_len + u32_rsp_len));
+}
+
+/*Strips the message header and decompresses the message once both sides agreed on TWI_LL_CAP_LZ_COMPRESSION.*/
+static void sim_handle_message(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len)
+{
+	twi_u16 u16_apdu_len = 0;
+
+	pstr_sim->u32_rx_msgs_bytes += u16_msg_len;
+	if(0 == (pstr_sim->u8_capabilities & TWI_LL_CAP_LZ_COMPRESSION))
+	{
+		pstr_sim->u32_rx_apdus_bytes += u16_msg_len;
+		sim_handle_apdu(pstr_sim, pu8_msg, u16_msg_len);
+	}
+	else if((u16_msg_len > SIM_MSG_HDR_LEN) && (SIM_MSG_HDR_PLAIN == pu8_msg[0]))
+	{
+		pstr_sim->u32_rx_apdus_bytes += u16_msg_len - SIM_MSG_HDR_LEN;
+		sim_handle_apdu(pstr_sim, &pu8_msg[SIM_MSG_HDR_LEN], u16_msg_len - SIM_MSG_HDR_LEN);
+	}
+	else if((u16_msg_len > SIM_MSG_HDR_LEN) && (SIM_MSG_HDR_LZ == pu8_msg[0]))
+	{
+		u16_apdu_len = twi_lz_decompress(&pu8_msg[SIM_MSG_HDR_LEN], u16_msg_len - SIM_MSG_HDR_LEN, pstr_sim->au8_lz_pkt, sizeof(pstr_sim->au8_lz_pkt));
+		/*A malformed message is counted like a CRC error, the host gives up on it when the response doesn't come*/
+		if(0 != u16_apdu_len)
+		{
+			pstr_sim->u32_rx_apdus_bytes += u16_apdu_len;
+			sim_handle_apdu(pstr_sim, pstr_sim->au8_lz_pkt, u16_apdu_len);
+		}
+		else
+		{
+			pstr_sim->u32_crc_errors_cnt++;
+		}
+	}
+	else
+	{
+		pstr_sim->u32_crc_errors_cnt++;
+	}
+}
+
+static void sim_handle_fragment(tstr_sim_wallet* pstr_sim, twi_u8* pu8_frgmt, twi_u16 u16_frgmt_len)
+{
+	tstr_fragment_header str_hdr;
+	twi_u16 u16_payload_len;
+
+	TWI_MEMCPY(&str_hdr, pu8_frgmt, SIM_FRAGMENT_HEADER_LEN);
+
+	if((u16_frgmt_len > SIM_FRAGMENT_HEADER_LEN) &&
+		(str_hdr.u8_fragment_index == pstr_sim->str_rx_expected_hdr.u8_fragment_index) &&
+		(str_hdr.u8_packet_sequence_number == pstr_sim->str_rx_expected_hdr.u8_packet_sequence_number))
+	{
+		u16_payload_len = u16_frgmt_len - SIM_FRAGMENT_HEADER_LEN;
+		TWI_ASSERT((pstr_sim->u16_rx_idx + u16_payload_len) <= SIM_WALLET_MAX_PKT_SZ);
+		TWI_MEMCPY(&pstr_sim->au8_rx_pkt[pstr_sim->u16_rx_idx], &pu8_frgmt[SIM_FRAGMENT_HEADER_LEN], u16_payload_len);
+		pstr_sim->u16_rx_idx += u16_payload_len;
+		pstr_sim->str_rx_expected_hdr.u8_fragment_index++;
+
+		if(1 == str_hdr.u8_last_fragment_flag)
+		{
+			twi_u16 u16_pkt_len = pstr_sim->u16_rx_idx - CRC_SZ;
+			twi_u16 u16_crc;
+
+			TWI_MEMCPY(&u16_crc, &pstr_sim->au8_rx_pkt[u16_pkt_len], CRC_SZ);
+
+			pstr_sim->u16_rx_idx 								= 0;
+			pstr_sim->str_rx_expected_hdr.u8_fragment_index 	= 0;
+			pstr_sim->str_rx_expected_hdr.u8_packet_sequence_number = ~(pstr_sim->str_rx_expected_hdr.u8_packet_sequence_number);
+
+			if(u16_crc == twi_crc16_compute_checksum(0, pstr_sim->au8_rx_pkt, u16_pkt_len))
+			{
+				sim_send_reassembly_ack(pstr_sim, str_hdr);
+				sim_handle_message(pstr_sim, pstr_sim->au8_rx_pkt, u16_pkt_len);
+			}
+			else
+			{
+				pstr_sim->u32_crc_errors_cnt++;
+			}
+		}
+	}
+	else if((1 == str_hdr.u8_last_fragment_flag) && (0 == pstr_sim->u16_rx_idx) &&
+			(str_hdr.u8_packet_sequence_number != pstr_sim->str_rx_expected_hdr.u8_packet_sequence_number))
+	{
+		/*The host missed the acknowledgement of the packet handled already and resent its last fragment.*/
+		sim_send_reassembly_ack(pstr_sim, str_hdr);
+	}
+	else
+	{
+		/*Out of order or duplicated fragment, drop the partial packet like the firmware does.*/
+		pstr_sim->u16_rx_idx 							= 0;
+		pstr_sim->str_rx_expected_hdr.u8_fragment_index = 0;
+	}
+}
+
+/*Handles one message after the stack specs reply, the message starts with its marker.*/
+static void sim_handle_report_msg(tstr_sim_wallet* pstr_sim, twi_u8* pu8_msg, twi_u16 u16_msg_len)
+{
+	if(TWI_TRUE == pstr_sim->b_is_specs_exchanged)
+	{
+		if(SIM_CONTROL_MESSAGE_MARKER == pu8_msg[0])
+		{
+			if(TWI_NL_ERR_FRGMNTS_MISSING == pu8_msg[1])
+			{
+				sim_resend_missing(pstr_sim, &pu8_msg[2], u16_msg_len - 2);
+			}
+		}
+		else if(SIM_DATA_MESSAGE_MARKER == pu8_msg[0])
+		{
+			sim_handle_fragment(pstr_sim, &pu8_msg[1], u16_msg_len - 1);
+		}
+		else if((SIM_JUMBO_MESSAGE_MARKER == pu8_msg[0]) || (SIM_JUMBO_CONTINUATION_MARKER == pu8_msg[0]))
+		{
+			sim_rcv_jumbo(pstr_sim, pu8_msg, u16_msg_len);
+		}
+	}
+}
+
+/*Same as twi_usb_ll_rcv_coalesced: walks the [length][marker][data] records, a zero length ends them and a bad record drops the rest.*/
+static void sim_rcv_coalesced(tstr_sim_wallet* pstr_sim, twi_u8* pu8_records, twi_u16 u16_records_len)
+{
+	twi_u16 u16_idx = 0;
+	twi_u16 u16_rec_len;
+
+	while((u16_idx + SIM_COALESCED_RECORD_LENGTH_SIZE) < u16_records_len)
+	{
+		u16_rec_len = pu8_records[u16_idx];
+		u16_idx 	+= SIM_COALESCED_RECORD_LENGTH_SIZE;
+		if((u16_rec_len < 2) || ((u16_idx + u16_rec_len) > u16_records_len) ||
+		   ((SIM_DATA_MESSAGE_MARKER != pu8_records[u16_idx]) && (SIM_CONTROL_MESSAGE_MARKER != pu8_records[u16_idx])))
+		{
+			break;
+		}
+		sim_handle_report_msg(pstr_sim, &pu8_records[u16_idx], u16_rec_len);
+		u16_idx += u16_rec_len;
+	}
+}
+
+/*---------------------------------------------------------*/
+/*- APIs IMPLEMENTATION -----------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+*	@brief		Resets the simulated firmware to the unplugged state.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*/
+void twi_sim_wallet_init(tstr_sim_wallet* pstr_sim)
+{
+	TWI_ASSERT(NULL != pstr_sim);
+	TWI_MEMSET(pstr_sim, 0, sizeof(tstr_sim_wallet));
+	pstr_sim->u8_max_jumbo_reports = SIM_WALLET_MAX_JUMBO_REPORTS;
+	pstr_sim->u8_max_capabilities 	= SIM_WALLET_CAPABILITIES;
+	sim_reset_session(pstr_sim);
+}
+
+/**
+*	@brief		Passes one host -> device HID report to the simulated firmware.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*	@param [in]	pu8_report		Pointer to the report, laid out as built by the host usb_send callback.
+*	@param [in]	u32_report_len	Report length.
+*/
+void twi_sim_wallet_host_report(tstr_sim_wallet* pstr_sim, const twi_u8* pu8_report, twi_u32 u32_report_len)
+{
+	twi_u8 au8_report[SIM_WALLET_REPORT_SZ];
+	twi_u8 u8_len;
+
+	TWI_ASSERT((NULL != pstr_sim) && (NULL != pu8_report) && (u32_report_len <= SIM_WALLET_REPORT_SZ));
+	TWI_MEMSET(au8_report, 0, sizeof(au8_report));
+	TWI_MEMCPY(au8_report, pu8_report, u32_report_len);
+
+	if(SIM_WALLET_OPEN_PORT_CODE == au8_report[SIM_REPORT_LEN_INDEX])
+	{
+		pstr_sim->b_is_port_open = TWI_TRUE;
+		sim_reset_session(pstr_sim);
+	}
+	else if(SIM_WALLET_CLOSE_PORT_CODE == au8_report[SIM_REPORT_LEN_INDEX])
+	{
+		pstr_sim->b_is_port_open = TWI_FALSE;
+		sim_reset_session(pstr_sim);
+	}
+	else if(TWI_TRUE == pstr_sim->b_is_port_open)
+	{
+		u8_len = au8_report[SIM_REPORT_LEN_INDEX];
+
+		if((u8_len > 1) && (u8_len < SIM_WALLET_REPORT_SZ))
+		{
+			if((SIM_CONTROL_MESSAGE_MARKER == au8_report[SIM_REPORT_MARKER_INDEX]) && (TWI_STACK_SPECS_CMD_ERR_CODE == au8_report[SIM_REPORT_ERR_CODE_INDEX]))
+			{
+				if(TWI_FALSE == pstr_sim->b_is_specs_exchanged)
+				{
+					/*Only the firmware that supports jumbo data messages or some capabilities answers with the max reports of one data message,
+					  and only the firmware that supports some capabilities answers with them*/
+					twi_bool b_is_caps = ((u8_len >= (2 + SIM_STACK_SPECS_CAPS_DATA_SIZE)) && (0 != pstr_sim->u8_max_capabilities)) ? TWI_TRUE : TWI_FALSE;
+					twi_bool b_is_ext = ((u8_len >= (2 + SIM_STACK_SPECS_EXT_DATA_SIZE)) && ((pstr_sim->u8_max_jumbo_reports > 1) || (TWI_TRUE == b_is_caps))) ? TWI_TRUE : TWI_FALSE;
+
+					pstr_sim->b_is_specs_exchanged 	= TWI_TRUE;
+					pstr_sim->u8_jumbo_reports 		= 1;
+					pstr_sim->u8_capabilities 		= 0;
+					if(TWI_TRUE == b_is_ext)
+					{
+						pstr_sim->u8_jumbo_reports = au8_report[SIM_REPORT_ERR_DATA_INDEX + SIM_STACK_SPECS_DATA_SIZE];
+						pstr_sim->u8_jumbo_reports = (pstr_sim->u8_jumbo_reports < pstr_sim->u8_max_jumbo_reports) ? pstr_sim->u8_jumbo_reports : pstr_sim->u8_max_jumbo_reports;
+						pstr_sim->u8_jumbo_reports = (0 == pstr_sim->u8_jumbo_reports) ? 1 : pstr_sim->u8_jumbo_reports;
+					}
+					if(TWI_TRUE == b_is_caps)
+					{
+						pstr_sim->u8_capabilities = au8_report[SIM_REPORT_ERR_DATA_INDEX + SIM_STACK_SPECS_EXT_DATA_SIZE] & pstr_sim->u8_max_capabilities;
+					}
+					sim_send_stack_specs(pstr_sim, b_is_ext, b_is_caps);
+				}
+			}
+			else if((SIM_COALESCED_MESSAGE_MARKER == au8_report[SIM_REPORT_MARKER_INDEX]) && (0 != (pstr_sim->u8_capabilities & TWI_LL_CAP_COALESCING)))
+			{
+				sim_rcv_coalesced(pstr_sim, &au8_report[SIM_REPORT_DATA_INDEX], u8_len - 1);
+			}
+			else
+			{
+				sim_handle_report_msg(pstr_sim, &au8_report[SIM_REPORT_MARKER_INDEX], u8_len);
+			}
+		}
+	}
+}
+
+/**
+*	@brief		Makes the simulated firmware lose some device -> host fragments, to exercise the host NACKs.
+*	@param [in]	pstr_sim			Pointer to the simulator context.
+*	@param [in]	u32_loss_period		Every Nth first transmission of a non last fragment is lost, 0 loses nothing.
+*/
+void twi_sim_wallet_set_tx_loss(tstr_sim_wallet* pstr_sim, twi_u32 u32_loss_period)
+{
+	TWI_ASSERT(NULL != pstr_sim);
+	pstr_sim->u32_tx_loss_period = u32_loss_period;
+}
+
+/**
+*	@brief		Sets how many reports one data message can span on the firmware side.
+*	@param [in]	pstr_sim				Pointer to the simulator context.
+*	@param [in]	u8_max_jumbo_reports	Reports per data message, 1 behaves like the firmware that doesn't support jumbo data messages.
+*/
+void twi_sim_wallet_set_max_jumbo_reports(tstr_sim_wallet* pstr_sim, twi_u8 u8_max_jumbo_reports)
+{
+	TWI_ASSERT((NULL != pstr_sim) && (0 != u8_max_jumbo_reports) && (u8_max_jumbo_reports <= SIM_WALLET_MAX_JUMBO_REPORTS));
+	pstr_sim->u8_max_jumbo_reports = u8_max_jumbo_reports;
+}
+
+/**
+*	@brief		Sets the capabilities the firmware advertises in the stack specs reply.
+*	@param [in]	pstr_sim				Pointer to the simulator context.
+*	@param [in]	u8_max_capabilities		Capabilities bitmap, 0 behaves like the firmware that doesn't know the compressed or coalesced messages.
+*/
+void twi_sim_wallet_set_capabilities(tstr_sim_wallet* pstr_sim, twi_u8 u8_max_capabilities)
+{
+	TWI_ASSERT(NULL != pstr_sim);
+	pstr_sim->u8_max_capabilities = u8_max_capabilities;
+}
+
+/**
+*	@brief		Fetches the oldest pending device -> host HID report.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*	@param [out] pu8_report		Buffer of at least SIM_WALLET_REPORT_SZ bytes.
+*	@return		TWI_TRUE if a report was copied, TWI_FALSE if the queue is empty.
+*/
+twi_bool twi_sim_wallet_pop_report(tstr_sim_wallet* pstr_sim, twi_u8* pu8_report)
+{
+	twi_bool b_retval = TWI_FALSE;
+
+	TWI_ASSERT((NULL != pstr_sim) && (NULL != pu8_report));
+	if(pstr_sim->u16_reports_cnt > 0)
+	{
+		TWI_MEMCPY(pu8_report, pstr_sim->aau8_reports[pstr_sim->u16_reports_head], SIM_WALLET_REPORT_SZ);
+		pstr_sim->u16_reports_head = (pstr_sim->u16_reports_head + 1) % SIM_WALLET_REPORTS_QUEUE_LEN;
+		pstr_sim->u16_reports_cnt--;
+		b_retval = TWI_TRUE;
+	}
+
+	return b_retval;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_sim_wallet.h
+ * @brief:	In-process simulated wallet firmware used by the native twi_bench target.
+ *			It speaks the same HID report framing as the hardware: the USB link layer markers, the stack
+ *			specs handshake, the network layer fragmentation/CRC, the compressed messages and the Ethereum APDU set.
+ */
+
+#ifndef TWI_SIM_WALLET_H_
+#define TWI_SIM_WALLET_H_
+
+#include "twi_common.h"
+#include "twi_network_layer.h"
+
+/*---------------------------------------------------------*/
+/*- MODULE MACROS DEFINITION-------------------------------*/
+/*---------------------------------------------------------*/
+#define SIM_WALLET_REPORT_SZ					(64)		/** @brief: HID report size. [0] carries the payload length or the port control code.*/
+#define SIM_WALLET_REPORTS_QUEUE_LEN			(128)		/** @brief: Number of device -> host reports that can be pending at once.*/
+#define SIM_WALLET_MAX_PKT_SZ					(8192)		/** @brief: Largest reassembled APDU the simulated firmware accepts.*/
+#define SIM_WALLET_MAX_CTU						(8192)		/** @brief: CTU the simulated firmware advertises in the stack specs reply.*/
+#define SIM_WALLET_MAX_JUMBO_REPORTS			(8)			/** @brief: Reports one data message can span on the simulated firmware side.*/
+#define SIM_WALLET_CAPABILITIES					(TWI_LL_CAP_LZ_COMPRESSION | TWI_LL_CAP_COALESCING | TWI_LL_CAP_REASSEMBLY_ACK)	/** @brief: Capabilities the simulated firmware advertises in the stack specs reply.*/
+
+#define SIM_WALLET_OPEN_PORT_CODE				(0x40)
+#define SIM_WALLET_CLOSE_PORT_CODE				(0x80)
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef struct
+{
+	twi_bool	b_is_port_open;
+	twi_bool	b_is_specs_exchanged;
+	twi_bool	b_is_app_opened;
+	tstr_fragment_header	str_rx_expected_hdr;
+	tstr_fragment_header	str_tx_hdr;
+	twi_u16		u16_rx_idx;
+	twi_u8		au8_rx_pkt[SIM_WALLET_MAX_PKT_SZ];
+	twi_u8		au8_tx_pkt[SIM_WALLET_MAX_PKT_SZ];
+	tstr_fragment_header	str_tx_last_hdr;		/*Header of the last sent packet, it carries the sequence number the host NACKs.*/
+	twi_u16		u16_tx_pkt_len;
+	twi_u16		u16_tx_crc;
+
+	twi_u8		u8_max_jumbo_reports;
+	twi_u8		u8_jumbo_reports;		/*Agreed in the stack specs exchange.*/
+	twi_u16		u16_jumbo_rx_len;
+	twi_u16		u16_jumbo_rx_idx;
+	twi_u8		au8_jumbo_rx[SIM_WALLET_MAX_JUMBO_REPORTS * (SIM_WALLET_REPORT_SZ - 3)];
+
+	twi_u8		u8_max_capabilities;
+	twi_u8		u8_capabilities;		/*Agreed in the stack specs exchange.*/
+	twi_u8		au8_lz_pkt[SIM_WALLET_MAX_PKT_SZ];
+
+	twi_u8		aau8_reports[SIM_WALLET_REPORTS_QUEUE_LEN][SIM_WALLET_REPORT_SZ];
+	twi_u16		u16_reports_head;
+	twi_u16		u16_reports_tail;
+	twi_u16		u16_reports_cnt;
+
+	twi_u32		u32_apdus_cnt;
+	twi_u32		u32_crc_errors_cnt;
+	twi_u32		u32_tx_loss_period;
+	twi_u32		u32_tx_frgmts_cnt;
+	twi_u32		u32_tx_lost_cnt;
+	twi_u32		u32_nacks_cnt;
+	twi_u32		u32_rx_msgs_bytes;		/*Host -> device messages as they crossed the link, before decompression.*/
+	twi_u32		u32_rx_apdus_bytes;		/*The same messages after decompression.*/
+
+}tstr_sim_wallet;
+
+/*---------------------------------------------------------*/
+/*- APIs PROTOTYPES ---------------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+*	@brief		Resets the simulated firmware to the unplugged state.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*/
+void twi_sim_wallet_init(tstr_sim_wallet* pstr_sim);
+
+/**
+*	@brief		Passes one host -> device HID report to the simulated firmware.
+*				Any response is queued and can be fetched with @ref twi_sim_wallet_pop_report.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*	@param [in]	pu8_report		Pointer to the report, laid out as built by the host usb_send callback.
+*	@param [in]	u32_report_len	Report length.
+*/
+void twi_sim_wallet_host_report(tstr_sim_wallet* pstr_sim, const twi_u8* pu8_report, twi_u32 u32_report_len);
+
+/**
+*	@brief		Makes the simulated firmware lose some device -> host fragments, to exercise the host NACKs.
+*	@param [in]	pstr_sim			Pointer to the simulator context.
+*	@param [in]	u32_loss_period		Every Nth first transmission of a non last fragment is lost, 0 loses nothing.
+*/
+void twi_sim_wallet_set_tx_loss(tstr_sim_wallet* pstr_sim, twi_u32 u32_loss_period);
+
+/**
+*	@brief		Sets how many reports one data message can span on the firmware side.
+*	@param [in]	pstr_sim				Pointer to the simulator context.
+*	@param [in]	u8_max_jumbo_reports	Reports per data message, 1 behaves like the firmware that doesn't support jumbo data messages.
+*/
+void twi_sim_wallet_set_max_jumbo_reports(tstr_sim_wallet* pstr_sim, twi_u8 u8_max_jumbo_reports);
+
+/**
+*	@brief		Sets the capabilities the firmware advertises in the stack specs reply.
+*	@param [in]	pstr_sim				Pointer to the simulator context.
+*	@param [in]	u8_max_capabilities		Capabilities bitmap, 0 behaves like the firmware that doesn't know the compressed or coalesced messages.
+*/
+void twi_sim_wallet_set_capabilities(tstr_sim_wallet* pstr_sim, twi_u8 u8_max_capabilities);
+
+/**
+*	@brief		Fetches the oldest pending device -> host HID report.
+*	@param [in]	pstr_sim		Pointer to the simulator context.
+*	@param [out] pu8_report		Buffer of at least SIM_WALLET_REPORT_SZ bytes.
+*	@return		TWI_TRUE if a report was copied, TWI_FALSE if the queue is empty.
+*/
+twi_bool twi_sim_wallet_pop_report(tstr_sim_wallet* pstr_sim, twi_u8* pu8_report);
+
+#endif /* TWI_SIM_WALLET_H_ */
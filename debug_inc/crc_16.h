@@ -0,0 +1,29 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+/**
+@file		crc_16.h
+@brief		this file declares the necessary functions needed to implement crc_16_CCITT
+*/
+
+#ifndef __CRC_16_H__
+#define __CRC_16_H__
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include "twi_types.h"
+
+//***********************************************************
+/*- APIs --------------------------------------------------*/
+//***********************************************************
+/*
+ * @brief		computes the CRC16 CCITT of a buffer starting from a seed, so it can be carried over several pieces.
+ * @param[in]	u16_crc_seed:	the seed (or the CRC of the previous pieces).
+ * @param[in]	pu8_data:		pointer to data buffer.
+ * @param[in]	u32_length:		length of data buffer.
+ * @return		the CRC.
+ */
+twi_u16 twi_crc16_compute_checksum( twi_u16 u16_crc_seed, const twi_u8* pu8_data, twi_u32 u32_length);
+
+#endif /* __CRC_16_H__ */
@@ -0,0 +1,59 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ ** @file		timer_mgmt.h
+ ** @brief		This file declares the timers management module types.
+ */
+
+#ifndef __TIMER_MGMT_H__
+#define __TIMER_MGMT_H__
+
+/*-*********************************************************/
+/*- INCLUDES ----------------------------------------------*/
+/*-*********************************************************/
+#include "twi_types.h"
+
+/*-*********************************************************/
+/*- TYPEDEFS ----------------------------------------------*/
+/*-*********************************************************/
+
+/**
+ * @brief	Timer expiry callback , it gets the user data given when the timer was started.
+ */
+typedef void (*tpf_twi_timer_mgmt_cb)(void* pv_user_data);
+
+/**
+ * @brief	Timer modes.
+ */
+typedef enum
+{
+	TWI_TIMER_TYPE_ONE_SHOT = 0,
+	TWI_TIMER_TYPE_PERIODIC
+}tenu_mgmt_timer_mode;
+
+struct _tstr_timer_mgmt_timer
+{
+	twi_bool b_is_active;
+	twi_u8 u8_mode;
+	twi_s8* ps8_name;
+	void* pv_user_data;
+	twi_u32 u32_reload_ms;
+	twi_u32 u32_reload_ticks;
+	tpf_twi_timer_mgmt_cb pf_timer_mgmt_cb;
+	struct _tstr_timer_mgmt_timer* prev;
+	struct _tstr_timer_mgmt_timer* next;
+	twi_u64 u64_threshold_ticks;
+};
+
+typedef struct _tstr_timer_mgmt_timer tstr_timer_mgmt_timer;
+
+/*-*********************************************************/
+/*- APIs --------------------------------------------------*/
+/*-*********************************************************/
+void timer_mgmt_init(void);
+twi_s32 start_timer(tstr_timer_mgmt_timer* pstr_timer, twi_s8* ps8_name, tenu_mgmt_timer_mode enu_mode, twi_u32 u32_period_ms, tpf_twi_timer_mgmt_cb pf_cb, void* pv_user_data);
+twi_s32 stop_timer(tstr_timer_mgmt_timer* pstr_timer);
+
+#endif /* __TIMER_MGMT_H__ */
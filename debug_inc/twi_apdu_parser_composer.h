@@ -0,0 +1,65 @@
+/****************************************************************************/
+/* Copyright (c) 2021 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/*
+ * twi_apdu_parser_composer.h
+ */
+
+#ifndef __TWI_APDU_PARSER_COMPOSER_H__
+#define __TWI_APDU_PARSER_COMPOSER_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_types.h"
+
+/*---------------------------------------------------------*/
+/*- CONSTANTS ---------------------------------------------*/
+/*---------------------------------------------------------*/
+#define TWI_APDU_CMD_HEADER_LEN		(4)		/* CLA , INS , P1 and P2 */
+#define TWI_APDU_SW_LEN				(2)
+
+/* Status words */
+#define APDU_RESP_SUCCESS					(0x9000)
+#define APDU_RESP_ALREADY_OPENED			(0x6901)		/** @brief: The requested app is already the open one. */
+#define APDU_RESP_INS_NOT_SUPPORTED			(0x6D00)
+#define APDU_RESP_CLA_NOT_SUPPORTED			(0x6E00)		/** @brief: No open app handles the command class. */
+
+/*---------------------------------------------------------*/
+/*- TYPEDEFS ----------------------------------------------*/
+/*---------------------------------------------------------*/
+typedef struct
+{
+	twi_u8 u8_cla;
+	twi_u8 u8_ins;
+	union
+	{
+		twi_u16 u16_p1_p2;
+		struct
+		{
+			twi_u8 u8_p2;
+			twi_u8 u8_p1;
+		}str_p1_p2;
+	}uni_params;
+	twi_u16 u16_cmd_data_len;
+	twi_u8* pu8_cmd_data;
+	twi_u32 u32_max_rsp_data_len;
+}tstr_twi_apdu_command;
+
+typedef struct
+{
+	twi_u8* pu8_rsp_data;
+	twi_u32 u32_rsp_data_len;
+	twi_u16 u16_sw;
+}tstr_twi_apdu_response;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_apdu_parse_cmd(twi_u8* pu8_apdu_buf, twi_u32 u32_apdu_len, tstr_twi_apdu_command* pstr_command);
+twi_s32 twi_apdu_parse_rsp(twi_u8* pu8_apdu_buf, twi_u32 u32_apdu_len, tstr_twi_apdu_response* pstr_response);
+twi_s32 twi_apdu_compose_cmd(tstr_twi_apdu_command* pstr_command, twi_u32* pu32_apdu_len, twi_u8* pu8_apdu_buf);
+twi_s32 twi_apdu_compose_rsp(tstr_twi_apdu_response* pstr_response, twi_u32* pu32_apdu_len, twi_u8* pu8_apdu_buf);
+
+#endif /* __TWI_APDU_PARSER_COMPOSER_H__ */
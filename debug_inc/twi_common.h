@@ -0,0 +1,116 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. */
+
+/****************************************************************************/
+/**
+ ** @file					twi_common.h
+ ** @brief					This file declares the common functions/MACROS.
+ **
+ */
+
+#ifndef __TWI_COMMON_H__
+#define __TWI_COMMON_H__
+
+/*-*********************************************************/
+/*- INCLUDES ----------------------------------------------*/
+/*-*********************************************************/
+#include <string.h>
+#include "twi_types.h"
+#include "twi_retval.h"
+#include "twi_debug.h"
+
+/*-*********************************************************/
+/*- MACROS ------------------------------------------------*/
+/*-*********************************************************/
+#define TWI_STATIC_FN						static
+
+#define TWI_ASSERT(COND)					twi_assert((twi_bool)(COND), __FUNCTION__, __LINE__)
+
+#define TWI_MEMCPY(DST, SRC, SZ)			memcpy((DST), (SRC), (SZ))
+#define TWI_MEMSET(DST, VAL, SZ)			memset((DST), (VAL), (SZ))
+#define TWI_MEMCMP(B1, B2, SZ)				memcmp((B1), (B2), (SZ))
+
+#define MUL1000(X)							((X) * 1000)
+#define MUL10_64(X)							((twi_s64)(X) * 10)
+#define CEIL(X, Y)							( ( (X) + (Y) - 1 ) / (Y) )
+
+#define IS_NUMBER(C)						( ( (C) >= '0' ) && ( (C) <= '9' ) )
+
+#define LEAST_SIG_BYTE(U16)					( (U16) & 0xFF )
+#define MOST_SIG_BYTE(U16)					( ( (U16) >> 8 ) & 0xFF )
+#define GET_BYTE_STATUS(U32, BYTE_IDX)		( (twi_u8)( ( (U32) >> ( 8 * (BYTE_IDX) ) ) & 0xFF ) )
+#define TWO_BYTE_CONCAT(MSB, LSB)			( (twi_u16)( ( (twi_u16)(MSB) << 8 ) | (twi_u16)(LSB) ) )
+#define TWO_16BITS_CONCAT(MSW, LSW)			( (twi_u32)( ( (twi_u32)(MSW) << 16 ) | (twi_u32)(LSW) ) )
+
+/* Big endian stores of a 16 / 32 bits value at an index of a byte buffer. */
+#define SETU16B(BUF, IDX, U16)				do{														\
+												(BUF)[(IDX)]		= (twi_u8)((U16) >> 8);			\
+												(BUF)[(IDX) + 1]	= (twi_u8)(U16);				\
+											}while(0)
+#define SETU32B(BUF, IDX, U32)				do{														\
+												(BUF)[(IDX)]		= (twi_u8)((U32) >> 24);		\
+												(BUF)[(IDX) + 1]	= (twi_u8)((U32) >> 16);		\
+												(BUF)[(IDX) + 2]	= (twi_u8)((U32) >> 8);			\
+												(BUF)[(IDX) + 3]	= (twi_u8)(U32);				\
+											}while(0)
+
+#define TWI_HIST_BUCKETS_NUM				(16)			/** @brief: Number of the log2 millisecond buckets of a latency histogram. */
+
+/*-*********************************************************/
+/*- STRUCTS AND UNIONS ------------------------------------*/
+/*-*********************************************************/
+
+/**
+ * @brief	Round trip time estimator, the smoothed RTT is kept multiplied by 8 and its variance by 4.
+ */
+typedef struct
+{
+	twi_u32 u32_srtt_x8;
+	twi_u32 u32_rttvar_x4;
+	twi_u32 u32_rto_ms;
+	twi_u32 u32_min_rto_ms;
+	twi_u32 u32_max_rto_ms;
+	twi_u32 u32_samples_cnt;
+}tstr_twi_rtt;
+
+/**
+ * @brief	Latency histogram of log2 millisecond buckets.
+ */
+typedef struct
+{
+	twi_u32 au32_buckets[TWI_HIST_BUCKETS_NUM];
+	twi_u32 u32_samples_cnt;
+	twi_u32 u32_sum_ms;
+	twi_u32 u32_max_ms;
+}tstr_twi_hist;
+
+/*-*********************************************************/
+/*- APIs --------------------------------------------------*/
+/*-*********************************************************/
+void twi_mem_cpy(twi_u8 * pu8_dst, twi_u8 * pu8_src, twi_u32  u32_sz);
+void twi_invert_add(twi_u8* pu8_des_add,twi_u8* pu8_src_add,twi_u32  u32_sz);
+void twi_mem_set(twi_u8 * pu8_dst, twi_u8  u8_val,  twi_u32  u32_sz);
+twi_s32 twi_mem_cmp( twi_u8 * pu8_b1,  twi_u8 * pu8_b2,  twi_u32  u32_sz);
+void twi_reverse(twi_u8 *pu8_str, twi_u16 u16_len);
+twi_u16 twi_atos64(const twi_u8* pu8_str, twi_u16 u16_len, twi_s64 *ps64_result);
+twi_s16 twi_s64toa(twi_s64 s64_num, twi_u16 u16_str_len, twi_u8 * pu8_str);
+twi_s16 twi_u64toa_hex(twi_u64 u64_num, twi_u16 u16_str_len, twi_u8 * pu8_str);
+twi_u16 twi_strlen(twi_u8 * pu8_str);
+twi_s32 twi_str_contains(const twi_u8 * pu8_str, twi_u16 u16_len, twi_u8 u8_search);
+twi_s32 twi_lowercase(twi_u8 *pu8_str, twi_u32 u32_len);
+twi_s32 twi_uppercase(twi_u8 *pu8_str, twi_u32 u32_len);
+twi_u32 twi_sqrt(twi_u64 u64_num);
+twi_s16 twi_arctan(twi_s32 s32_numerator, twi_u32 u32_denominator);
+void twi_next_circular_index(twi_u8* pu8_index, twi_u8 u8_queue_len);
+
+void twi_rtt_init(tstr_twi_rtt* pstr_rtt, twi_u32 u32_init_rto_ms, twi_u32 u32_min_rto_ms, twi_u32 u32_max_rto_ms);
+void twi_rtt_sample(tstr_twi_rtt* pstr_rtt, twi_u32 u32_sample_ms);
+void twi_rtt_backoff(tstr_twi_rtt* pstr_rtt);
+twi_u32 twi_rtt_get_rto(const tstr_twi_rtt* pstr_rtt);
+
+void twi_hist_reset(tstr_twi_hist* pstr_hist);
+void twi_hist_add(tstr_twi_hist* pstr_hist, twi_u32 u32_sample_ms);
+
+void twi_assert(twi_bool b_cond, const char* func_name, unsigned int line_number);
+
+#endif /* __TWI_COMMON_H__ */
@@ -0,0 +1,89 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. */
+
+/****************************************************************************/
+/**
+ ** @file					twi_debug.h
+ ** @brief					This file declares the LOGGER module.
+ **							Without DEBUGGING_ENABLE every logger macro expands to nothing.
+ **
+ */
+
+#ifndef __TWI_DEBUG_H__
+#define __TWI_DEBUG_H__
+
+/*-*********************************************************/
+/*- INCLUDES ----------------------------------------------*/
+/*-*********************************************************/
+#include "twi_types.h"
+
+#ifdef DEBUGGING_ENABLE
+	#include <stdarg.h>
+	#if defined(WEB) || defined(STDLIB) || defined(TWI_CEEDLING_TEST)
+		#include <stdio.h>
+	#endif
+#endif
+
+/*-*********************************************************/
+/*- MACROS ------------------------------------------------*/
+/*-*********************************************************/
+#ifdef DEBUGGING_ENABLE
+
+	#if defined(WEB) || defined(STDLIB) || defined(TWI_CEEDLING_TEST)
+		#define TWI_LOG(...)						printf((const char*)__VA_ARGS__)
+		#define TWI_LOG_PRINT(...)					printf(__VA_ARGS__)
+	#else
+		#define TWI_LOG(...)						twi_logger(__VA_ARGS__)
+		#define TWI_LOG_PRINT(...)					twi_logger((const twi_u8*)__VA_ARGS__)
+	#endif
+
+	#ifdef DEBUG_TIME_ENABLE
+		#define TWI_LOG_TIME						TWI_LOG_PRINT("[%08lu]", (unsigned long)gu32_Jiff)
+	#else
+		#define TWI_LOG_TIME
+	#endif
+
+	#define TWI_LOGGER(...)							twi_logger_debug((const twi_u8*)__VA_ARGS__)
+	#define TWI_LOGGER_INFO(...)					twi_logger_info((const twi_u8*)__VA_ARGS__)
+	#define TWI_LOGGER_ERR(...)						twi_logger_err((const twi_u8*)__FILE__, (twi_u32)__LINE__, (const twi_u8*)__VA_ARGS__)
+	#define TWI_DUMP_BUF(NAME, BUF, SZ)				twi_logger_dump_buf((const twi_u8*)(NAME), (const twi_u8*)(BUF), (twi_u32)(SZ))
+	#define TWI_DUMP_HEX(BUF, SZ)					twi_logger_dump_hex((const twi_u8*)(BUF), (twi_u32)(SZ))
+	#define TWI_DUMP_BUFC(NAME, BUF, SZ)			twi_logger_dump_bufc((const twi_u8*)(NAME), (const twi_u8*)(BUF), (twi_u32)(SZ))
+	#define FUN_IN									TWI_LOGGER("FUN_IN >>> %s %d\r\n", __FUNCTION__, __LINE__)
+
+#else
+
+	#define TWI_LOG(...)
+	#define TWI_LOG_PRINT(...)
+	#define TWI_LOG_TIME
+	#define TWI_LOGGER(...)
+	#define TWI_LOGGER_INFO(...)
+	#define TWI_LOGGER_ERR(...)
+	#define TWI_DUMP_BUF(NAME, BUF, SZ)
+	#define TWI_DUMP_HEX(BUF, SZ)
+	#define TWI_DUMP_BUFC(NAME, BUF, SZ)
+	#define FUN_IN
+
+#endif
+
+/*-*********************************************************/
+/*- APIs --------------------------------------------------*/
+/*-*********************************************************/
+#ifdef DEBUGGING_ENABLE
+	#ifdef DEBUG_TIME_ENABLE
+extern volatile twi_u32 gu32_Jiff;
+	#endif
+
+void twi_logger_init(void *uart_rx_cb);
+void twi_logger_deinit(void);
+void twi_logger_var(const char* pu8_prnt_msg, va_list argp,int u8_strlen);
+void twi_logger(const twi_u8* pu8_prnt_msg, ...);
+void twi_logger_debug(const twi_u8* pu8_prnt_msg,...);
+void twi_logger_info(const twi_u8* pu8_prnt_msg,...);
+void twi_logger_err(const twi_u8* pu8_file_name, const twi_u32 u32_line, const twi_u8* pu8_prnt_msg,...);
+void twi_logger_dump_buf(const twi_u8* name, const twi_u8* Buffer, const twi_u32 size);
+void twi_logger_dump_hex(const twi_u8* Buffer, const twi_u32 size);
+void twi_logger_dump_bufc(const twi_u8* name, const twi_u8* Buffer, const twi_u32 size);
+#endif
+
+#endif /* __TWI_DEBUG_H__ */
@@ -0,0 +1,63 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_link_layer.h
+ * @brief:	This file declares the link layer interface in the communication stack.
+ */
+
+#ifndef __TWI_LINK_LAYER_H__
+#define __TWI_LINK_LAYER_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_stack_common.h"
+#if defined (TWI_USB_STACK_ENABLED)
+#include "twi_usb_link_layer.h"
+#endif
+#if defined (TWI_BLE_STACK_ENABLED)
+#include "twi_ble_link_layer.h"
+#endif
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+union twi_link_layer
+{
+#if defined (TWI_USB_STACK_ENABLED)
+	tstr_usb_ll_ctx str_usb;
+#endif
+#if defined (TWI_BLE_STACK_ENABLED)
+	tstr_ble_ll_ctx str_ble;
+#endif
+};
+
+typedef union twi_link_layer tuni_ll_ctx;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_ll_init(	tenu_twi_ll_type enu_ll_type,
+						tuni_ll_ctx * puni_ctx,
+						void * pv_args,
+						tpf_ll_cb pf_evt_cb,
+						tstr_stack_helpers * pstr_helpers, void* pv_helpers);
+void twi_ll_handle_evt(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, void* pstr_evt);
+twi_s32 twi_ll_send_data(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+twi_s32 twi_ll_send_data_iov(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num, void* pv_arg);
+twi_s32 twi_ll_send_error(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len);
+void twi_ll_dispatcher(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+twi_u16 twi_ll_get_mtu_size(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+twi_u32 twi_ll_get_ctu_size(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+twi_u8 twi_ll_get_capabilities(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+twi_s32 twi_ll_add_batch_data(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+twi_s32 twi_ll_send_batch(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, void* pv_arg);
+twi_u16 twi_ll_iov_gather(twi_u8* pu8_dst, twi_u16 u16_dst_len, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+twi_u16 twi_ll_get_batch_capacity(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+void twi_ll_get_stats(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, tstr_twi_ll_stats* pstr_stats);
+void twi_ll_is_ready_to_send(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, twi_bool* pb_is_ready);
+twi_bool twi_ll_is_idle(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx);
+
+#endif /* __TWI_LINK_LAYER_H__ */
@@ -0,0 +1,24 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_lz.h
+@brief		this file declares a small LZ77 codec with a bounded window, used to compress the stack messages.
+*/
+
+#ifndef __TWI_LZ_H__
+#define __TWI_LZ_H__
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include "twi_common.h"
+
+//***********************************************************
+/*- APIs --------------------------------------------------*/
+//***********************************************************
+twi_u16 twi_lz_compress(const twi_u8* pu8_src, twi_u16 u16_src_len, twi_u8* pu8_dst, twi_u16 u16_dst_cap);
+twi_u16 twi_lz_decompress(const twi_u8* pu8_src, twi_u16 u16_src_len, twi_u8* pu8_dst, twi_u16 u16_dst_cap);
+
+#endif /* __TWI_LZ_H__ */
@@ -0,0 +1,199 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_network_layer.h
+ * @brief:	This file declares the network layer interface in the communication stack.
+ */
+
+#ifndef __TWI_NETWORK_LAYER_H__
+#define __TWI_NETWORK_LAYER_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_stack_common.h"
+#include "twi_link_layer.h"
+
+/*---------------------------------------------------------*/
+/*- CONSTANTS ---------------------------------------------*/
+/*---------------------------------------------------------*/
+#define CRC_SZ									(2)				/** @brief: Size of the packet CRC16 sent after the last fragment data. */
+#define TWI_NL_FRGMTS_BITMAP_SZ					(32)			/** @brief: Bytes of a fragments bitmap. */
+#define TWI_NL_RCV_BUFS_NUM						(2)				/** @brief: Reassembly buffers handed to the upper layer. */
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	TWI_NL_SEND_STATUS_EVT = 0,
+	TWI_NL_RCV_DATA_EVT,
+	TWI_NL_RCV_ERROR_EVT,
+	TWI_NL_INVALID_EVT
+}tenu_twi_nl_evnt;
+
+typedef struct
+{
+	tenu_twi_nl_evnt enu_event;
+	void* pv_args;
+	union
+	{
+		struct
+		{
+			twi_bool b_is_success;
+			void* pv_user_arg;
+		}str_send_stts_evt;
+		struct
+		{
+			twi_u8* pu8_data;
+			twi_u16 u16_data_len;
+		}str_rcv_data_evt;
+		struct
+		{
+			tenu_stack_err_code enu_err_code;
+			twi_u8* pu8_err_data;
+			twi_u16 u16_err_data_len;
+		}str_rcv_err_evt;
+	}uni_data;
+}tstr_twi_nl_evt;
+
+typedef void (*tpf_nl_cb)(tstr_twi_nl_evt* pstr_evt);
+
+/**
+ * @brief	Fragment header byte shared with the firmware.
+ */
+typedef struct
+{
+	twi_u8 u8_fragment_index : 6;
+	twi_u8 u8_packet_sequence_number : 1;
+	twi_u8 u8_last_fragment_flag : 1;
+}tstr_fragment_header;
+
+typedef struct
+{
+	twi_u8 u8_frgmts_num;
+	twi_u8* pu8_pkt_buf;
+	twi_u16 u16_data_len;
+	tstr_fragment_header str_fragment_header;
+	void* pv_arg;
+	twi_u8 au8_done_bitmap[TWI_NL_FRGMTS_BITMAP_SZ];
+	twi_u8 au8_inflight_bitmap[TWI_NL_FRGMTS_BITMAP_SZ];
+	twi_u8 u8_done_frgmts_num;
+	twi_u8 u8_inflight_frgmts_num;
+	twi_u16 u16_crc;
+	twi_u16 u16_crc_len;						/* Packet bytes already folded into u16_crc. */
+}tstr_twi_nl_fgmt_data;
+
+/**
+ * @brief	One reassembly buffer , held while its reference count is not 0.
+ */
+typedef struct
+{
+	twi_u8 au8_pkt_buf[MAX_PKT_SZ];
+	twi_u8 u8_ref_cnt;
+}tstr_twi_nl_rcv_buf;
+
+typedef struct
+{
+	tstr_twi_nl_rcv_buf astr_rcv_bufs[TWI_NL_RCV_BUFS_NUM];
+	twi_u8* pu8_pkt_buf;						/* Buffer of the packet being reassembled , NULL while every buffer is held. */
+	twi_u16 u16_pkt_buf_idx;
+	tstr_fragment_header str_expected_frgmnt_header;
+	twi_u16 u16_crc;
+	twi_u16 u16_crc_frgmts_num;					/* Fragments of the contiguous received prefix folded into u16_crc. */
+	twi_u16 u16_rcvd_crc;
+	twi_u8 au8_rcvd_bitmap[TWI_NL_FRGMTS_BITMAP_SZ];
+	twi_u8 u8_rcvd_frgmts_num;
+	twi_u8 u8_max_rcvd_idx;
+	twi_bool b_is_last_frgmt_rcvd;
+	twi_u8 u8_last_frgmt_idx;
+	twi_u16 u16_last_frgmt_data_len;
+	twi_bool b_is_nack_sent;
+	twi_u8 u8_nack_trigger_idx;
+	twi_u8 u8_nack_cnt;
+	twi_bool b_is_complete;
+}tstr_twi_nl_defgmt_data;
+
+/**
+ * @brief	Network layer counters.
+ */
+typedef struct
+{
+	twi_u32 u32_tx_pkts_cnt;
+	twi_u32 u32_tx_failed_pkts_cnt;
+	twi_u32 u32_tx_frgmts_cnt;
+	twi_u32 u32_tx_retries_cnt;
+	twi_u32 u32_rx_pkts_cnt;
+	twi_u32 u32_rx_frgmts_cnt;
+	twi_u32 u32_rx_crc_errors_cnt;
+	twi_u32 u32_rx_out_of_order_cnt;
+	twi_u32 u32_rx_duplicates_cnt;
+	twi_u32 u32_rx_errors_cnt;
+	twi_u32 u32_nacks_sent_cnt;
+	twi_u32 u32_tx_ack_timeouts_cnt;			/* Sent packets whose reassembly acknowledgement didn't come in time. */
+	tstr_twi_hist str_tx_hist;					/* Time from a packet start to its send status. */
+}tstr_twi_nl_stats;
+
+struct tstr_network_layer_context
+{
+	tenu_twi_ll_type enu_ll_type;
+	tuni_ll_ctx uni_ll_ctx;
+	struct
+	{
+		twi_bool b_is_initialized;
+		tpf_nl_cb pf_nl_cb;
+		void* pv_args;
+		twi_bool b_need_send;
+		twi_bool b_send_in_progress;
+		twi_u8 u8_resend_frgmt_cnt;
+		twi_u8 u8_resend_packet_cnt;
+		twi_u8 u8_snd_wnd_sz;
+		tstr_twi_nl_fgmt_data str_twi_nl_fgmt_data;
+		tstr_twi_nl_defgmt_data str_twi_nl_defgmt_data;
+		twi_u32 u32_tx_pkt_start_ms;
+		/* Once both sides agreed on TWI_LL_CAP_REASSEMBLY_ACK the sent packet is held till the receiver acknowledges it */
+		twi_bool b_is_ack_pending;
+		twi_bool b_is_ack_rcvd;						/* The acknowledgement came before the link layer confirmed the last window. */
+		tstr_timer_mgmt_timer str_ack_timer;
+		twi_bool b_is_ack_due;						/* The last reassembled packet is still to be acknowledged. */
+		tstr_fragment_header str_ack_frgmnt_header;
+		tstr_twi_nl_stats str_stats;
+	}str_global;
+	tpf_twi_system_sleep_mode_forbiden pf_twi_system_sleep_mode_forbiden;
+	tpf_get_time_ms pf_get_time_ms;
+	tpf_start_timer pf_start_timer;
+	tpf_stop_timer pf_stop_timer;
+	void* pv_stack_helpers;
+};
+
+typedef struct tstr_network_layer_context tstr_nl_ctx;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_nl_init(tstr_nl_ctx *pstr_ctx,
+						void * pv_args,
+						tpf_nl_cb pf_evt_cb,
+						tenu_twi_ll_type enu_ll_type,
+						tstr_stack_helpers * pstr_helpers, void* pv_helpers);
+#if defined (TWI_BLE_STACK_ENABLED)
+void twi_nl_handle_ble_evt(tstr_nl_ctx *pstr_ctx, tstr_twi_ble_evt* pstr_ble_evt);
+#endif
+#if defined (TWI_USB_STACK_ENABLED)
+void twi_nl_handle_usb_evt(tstr_nl_ctx *pstr_ctx, tstr_twi_usb_evt* pstr_usb_evt);
+#endif
+twi_s32 twi_nl_send_data(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg );
+twi_s32 twi_nl_send_error( tstr_nl_ctx *pstr_ctx , tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len);
+void twi_nl_dispatcher(tstr_nl_ctx *pstr_ctx);
+void twi_nl_unlock_rcv_buf( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_unlock);
+void twi_nl_ref_rcv_buf( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_ref);
+twi_u16 twi_nl_get_fragment_threshold_size(tstr_nl_ctx *pstr_ctx);
+void twi_nl_set_snd_window_size(tstr_nl_ctx *pstr_ctx, twi_u8 u8_wnd_sz);
+twi_u8 twi_nl_get_capabilities(tstr_nl_ctx *pstr_ctx);
+void twi_nl_get_stats(tstr_nl_ctx *pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats);
+void twi_nl_is_ready_to_send(tstr_nl_ctx* pstr_cntxt, twi_bool* pb_is_ready);
+twi_bool twi_nl_is_idle(tstr_nl_ctx* pstr_cntxt);
+
+#endif /* __TWI_NETWORK_LAYER_H__ */
@@ -0,0 +1,39 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ ** @file		twi_retval.h
+ ** @brief		This file contains the return values of the APIs.
+ */
+
+#ifndef __TWI_RETVAL_H__
+#define __TWI_RETVAL_H__
+
+/*-*********************************************************/
+/*- CONSTANTS ---------------------------------------------*/
+/*-*********************************************************/
+#define TWI_SUCCESS								(0)
+
+#define TWI_ERROR								(-1)
+#define TWI_ERROR_BASE							(-100)
+#define TWI_ERROR_INVALID_ARGUMENTS				(TWI_ERROR_BASE - 1)
+#define TWI_ERROR_NULL_PV						(TWI_ERROR_BASE - 2)
+#define TWI_ERROR_INVALID_LEN					(TWI_ERROR_BASE - 3)
+#define TWI_ERROR_INVALID_STATE					(TWI_ERROR_BASE - 4)
+#define TWI_ERROR_NOT_INITIALIZED				(TWI_ERROR_BASE - 5)
+#define TWI_ERROR_ALREADY_INITIALIZED			(TWI_ERROR_BASE - 6)
+#define TWI_ERROR_NOT_SUPPORTED_FEATURE			(TWI_ERROR_BASE - 7)
+#define TWI_ERROR_INTERNAL_ERROR				(TWI_ERROR_BASE - 8)
+#define TWI_ERROR_BUSY							(TWI_ERROR_BASE - 9)
+
+/* Leaves the enclosing loop or switch on a failed status. */
+#define TWI_ERROR_BREAK(S32_RETVAL)				if(TWI_SUCCESS != (S32_RETVAL)) break
+
+#define TWI_ERROR_USBD_BASE						(-200)
+#define TWI_ERROR_USBD_SEND_BUSY				(TWI_ERROR_USBD_BASE - 1)
+
+#define TWI_ERR_BLE_HAL_BASE					(-300)
+#define TWI_ERR_BLE_HAL_NRF_BUSY				(TWI_ERR_BLE_HAL_BASE - 1)
+
+#endif /* __TWI_RETVAL_H__ */
@@ -0,0 +1,102 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_security_layer.h
+ * @brief:	This file declares the security layer interface in the communication stack.
+ */
+
+#ifndef __TWI_SECURITY_LAYER_H__
+#define __TWI_SECURITY_LAYER_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_stack_common.h"
+#include "twi_network_layer.h"
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	TWI_SL_SEND_STATUS_EVT = 0,
+	TWI_SL_RCV_DATA_EVT,
+	TWI_SL_INVALID_EVT
+}tenu_twi_sl_evnt;
+
+typedef struct
+{
+	tenu_twi_sl_evnt enu_event;
+	void* pv_args;
+	union
+	{
+		struct
+		{
+			twi_bool b_is_success;
+			void* pv_user_arg;
+		}str_send_stts_evt;
+		struct
+		{
+			tenu_twi_stack_msg_type enu_msg_type;
+			twi_u8* pu8_data;
+			twi_u16 u16_data_len;
+		}str_rcv_data_evt;
+	}uni_data;
+}tstr_twi_sl_evt;
+
+typedef void (*tpf_sl_cb)(tstr_twi_sl_evt* pstr_evt);
+
+/* A decompressed message , it keeps the network layer buffer it came from till its last reference is released */
+typedef struct
+{
+	twi_u8 au8_msg_buf[MAX_PKT_SZ];
+	twi_u8* pu8_nl_buf;
+	twi_u8 u8_ref_cnt;
+}tstr_twi_sl_rcv_buf;
+
+struct tstr_security_layer_context
+{
+	tstr_nl_ctx str_nl_ctx;
+	struct
+	{
+		twi_bool b_is_initialized;
+		tpf_sl_cb pf_sl_cb;
+		void* pv_args;
+		twi_bool b_is_compression_enabled;
+		/* Framed message being sent , released by its send status */
+		twi_u8 au8_tx_buf[MAX_PKT_SZ + 1];
+		twi_bool b_is_tx_buf_busy;
+		/* Decompressed messages , one per network layer receive buffer so there is always a free one */
+		tstr_twi_sl_rcv_buf astr_rcv_bufs[TWI_NL_RCV_BUFS_NUM];
+	}str_global;
+};
+
+typedef struct tstr_security_layer_context tstr_sl_ctx;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_sl_init(tstr_sl_ctx *pstr_ctx,
+						void * pv_args,
+						tpf_sl_cb pf_evt_cb,
+						tenu_twi_ll_type enu_ll_type,
+						tstr_stack_helpers * pstr_helpers, void* pv_helpers);
+#if defined (TWI_BLE_STACK_ENABLED)
+void twi_sl_handle_ble_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_ble_evt* pstr_ble_evt);
+#endif
+#if defined (TWI_USB_STACK_ENABLED)
+void twi_sl_handle_usb_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_usb_evt* pstr_usb_evt);
+#endif
+twi_s32 twi_sl_send_data( tstr_sl_ctx *pstr_ctx , tenu_twi_stack_msg_type enu_msg_type, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+void twi_sl_dispatcher(tstr_sl_ctx *pstr_ctx);
+void twi_sl_unlock_rcv_buf( tstr_sl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_unlock);
+void twi_sl_ref_rcv_buf( tstr_sl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_ref);
+void twi_sl_set_snd_window_size(tstr_sl_ctx *pstr_ctx, twi_u8 u8_wnd_sz);
+void twi_sl_set_compression(tstr_sl_ctx *pstr_ctx, twi_bool b_enable);
+void twi_sl_get_stats(tstr_sl_ctx *pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats);
+void twi_sl_is_ready_to_send(tstr_sl_ctx* pstr_cntxt, twi_bool* pb_is_ready);
+twi_bool twi_sl_is_idle(tstr_sl_ctx* pstr_cntxt);
+
+#endif /* __TWI_SECURITY_LAYER_H__ */
@@ -0,0 +1,87 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_stack.h
+ * @brief:	This file declares the communication stack interface used by the application.
+ */
+
+#ifndef __TWI_STACK_H__
+#define __TWI_STACK_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_stack_common.h"
+#include "twi_security_layer.h"
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	TWI_STACK_SEND_STATUS_EVT = 0,
+	TWI_STACK_RCV_DATA_EVT,
+	TWI_STACK_INVALID_EVT
+}tenu_twi_stack_evnt;
+
+typedef struct
+{
+	tenu_twi_stack_evnt enu_event;
+	union
+	{
+		struct
+		{
+			twi_bool b_is_success;
+			void* pv_user_arg;
+		}str_send_stts_evt;
+		struct
+		{
+			tenu_twi_stack_msg_type enu_msg_type;
+			twi_u8* pu8_data;
+			twi_u16 u16_data_len;
+			void* pv_user_arg;
+		}str_rcv_data_evt;
+	}uni_data;
+}tstr_twi_stack_evt;
+
+typedef void (*tpf_stack_cb)(tstr_twi_stack_evt* pstr_evt, void* pv);
+
+struct tstr_stack_layer_context
+{
+	tstr_sl_ctx str_sl_ctx;
+	struct
+	{
+		twi_bool b_is_initialized;
+		tpf_stack_cb pf_stack_cb;
+		void* pv;
+	}str_global;
+};
+
+typedef struct tstr_stack_layer_context tstr_stack_ctx;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_stack_init(	tstr_stack_ctx * pstr_ctx ,
+							tpf_stack_cb pf_evt_cb , void* pv,
+							tenu_twi_ll_type enu_ll_type,
+							tstr_stack_helpers * pstr_helpers);
+#if defined (TWI_BLE_STACK_ENABLED)
+void twi_stack_handle_ble_evt(tstr_stack_ctx * pstr_ctx , tstr_twi_ble_evt * pstr_ble_evt);
+#endif
+#if defined (TWI_USB_STACK_ENABLED)
+void twi_stack_handle_usb_evt(tstr_stack_ctx * pstr_ctx , tstr_twi_usb_evt * pstr_usb_evt);
+#endif
+twi_s32 twi_stack_send_data(tstr_stack_ctx * pstr_ctx , tenu_twi_stack_msg_type enu_msg_type, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+void twi_stack_dispatcher(tstr_stack_ctx * pstr_ctx);
+void twi_stack_unlock_rcv_buf( tstr_stack_ctx * pstr_ctx , twi_u8* pu8_buffer_to_unlock);
+void twi_stack_ref_rcv_buf( tstr_stack_ctx * pstr_ctx , twi_u8* pu8_buffer_to_ref);
+void twi_stack_set_snd_window_size(tstr_stack_ctx * pstr_ctx , twi_u8 u8_wnd_sz);
+void twi_stack_set_compression(tstr_stack_ctx * pstr_ctx, twi_bool b_enable);
+void twi_stack_get_stats(tstr_stack_ctx * pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats);
+void twi_stack_is_ready_to_send(tstr_stack_ctx* pstr_cntxt, twi_bool* pb_is_ready);
+twi_bool twi_stack_is_idle(tstr_stack_ctx* pstr_cntxt);
+
+#endif /* __TWI_STACK_H__ */
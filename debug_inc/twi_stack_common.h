@@ -0,0 +1,233 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_stack_common.h
+ * @brief:	This file contains the types shared by all the layers of the communication stack.
+ */
+
+#ifndef __TWI_STACK_COMMON_H__
+#define __TWI_STACK_COMMON_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_common.h"
+#include "timer_mgmt.h"
+#include "twi_usbd.h"
+
+/*---------------------------------------------------------*/
+/*- CONSTANTS ---------------------------------------------*/
+/*---------------------------------------------------------*/
+#define TWI_STACK_ERR_BASE							(-1000)
+#define TWI_STACK_NL_ERR_SENDING_IN_PROG			(TWI_STACK_ERR_BASE - 1)		/** @brief: A packet is being sent and no more packets can be queued behind it. */
+#define TWI_STACK_NL_ERR_SEND_MEDIUM_BUSY			(TWI_STACK_ERR_BASE - 2)		/** @brief: The link layer can't take the data now, try again from the dispatcher. */
+
+#define MAX_PKT_SZ									(1024)			/** @brief: Largest packet (CTU) the stack sends or reassembles. */
+
+/* Capabilities bitmap agreed in the stack specs , the agreed value is mine & peer. */
+#define TWI_LL_CAP_LZ_COMPRESSION					(0x01)			/** @brief: The messages of the security layer carry a header and may be LZ compressed. */
+#define TWI_LL_CAP_COALESCING						(0x02)			/** @brief: Several single report messages may be packed in one report. */
+#define TWI_LL_CAP_REASSEMBLY_ACK					(0x04)			/** @brief: The receiver acknowledges every reassembled packet, the sender holds the packet till then. */
+
+/*---------------------------------------------------------*/
+/*- STACK HELPERS TYPES -----------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+ * @brief	Called with TWI_TRUE when the stack has dispatcher work pending, so the system shall not sleep.
+ */
+typedef void (*tpf_twi_system_sleep_mode_forbiden)(void* pv, twi_bool b_is_forbidden);
+
+/**
+ * @brief	Stops a stack timer.
+ */
+typedef twi_s32 (*tpf_stop_timer)(void* pv, tstr_timer_mgmt_timer* pstr_timer);
+
+/**
+ * @brief	Starts a stack timer.
+ */
+typedef twi_s32 (*tpf_start_timer)(void* pv, tstr_timer_mgmt_timer* pstr_timer, twi_s8* ps8_name, tenu_mgmt_timer_mode enu_mode, twi_u32 u32_period_ms, tpf_twi_timer_mgmt_cb pf_cb, void* pv_user_data);
+
+/**
+ * @brief	Returns a free running milliseconds clock , used to time the sends and derive their timeouts.
+ */
+typedef twi_u32 (*tpf_get_time_ms)(void* pv);
+
+/**
+ * @brief	Saves a small record that shall survive the connection , NULL data forgets it.
+ */
+typedef void (*tpf_save_data)(void* pv, twi_u16 u16_id, twi_u8* pu8_data, twi_u32 u32_data_sz);
+
+/**
+ * @brief	Loads a record saved by @ref tpf_save_data , *pu32_data_sz is the buffer capacity in and the record size out.
+ */
+typedef twi_s32 (*tpf_load_data)(void* pv, twi_u16 u16_id, twi_u8* pu8_data, twi_u32* pu32_data_sz);
+
+typedef void (*tpf_stack_sign_cb)(void* pv, twi_bool b_is_success, twi_u8* pu8_data, twi_u16 u16_data_len, twi_u8* pu8_sig, void* pv_arg);
+typedef void (*tpf_stack_verify_sig_cb)(void* pv, twi_bool b_is_success, twi_u8* pu8_data, twi_u16 u16_data_len, twi_bool* pb_is_valid, void* pv_arg);
+typedef void (*tpf_stack_encrypt_cb)(void* pv, twi_u8* pu8_in, twi_u8* pu8_out, twi_u16 u16_len, void* pv_arg);
+typedef void (*tpf_stack_decrypt_cb)(void* pv, twi_u8* pu8_in, twi_u8* pu8_out, twi_u16 u16_len, void* pv_arg);
+
+/**
+ * @brief	Sends one report.
+ */
+typedef twi_s32 (*tpf_twi_usbd_send)(void* pv, const void* pv_data, twi_u32 u32_data_len);
+
+/**
+ * @brief	Sends several consecutive full reports in one transfer.
+ */
+typedef twi_s32 (*tpf_twi_usbd_send_batch)(void* pv, const void* pv_reports, twi_u32 u32_reports_num);
+
+/**
+ * @brief	Pulls a received report.
+ */
+typedef twi_s32 (*tpf_twi_usbd_receive)(void* pv, void* pv_data, twi_u32* pu32_data_len);
+
+typedef void (*tpf_twi_usbd_stop)(void* pv);
+
+typedef void (*tpf_twi_usbd_dispatch)(void* pv);
+
+/*---------------------------------------------------------*/
+/*- STACK TYPES -------------------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+ * @brief	Error codes exchanged between the peers.
+ */
+typedef enum
+{
+	TWI_NL_ERR_BASE = 0,
+	TWI_NL_ERR_FRGMNT_OUT_OF_ORDR,
+	TWI_NL_ERR_DUPLCT_FRGMNT,
+	TWI_NL_ERR_INCMPLT_PKT,
+	TWI_NL_ERR_FRGMNT_TOO_SHORT,
+	TWI_NL_ERR_PKT_TOO_SHORT,
+	TWI_NL_ERR_PKT_TOO_LONG,
+	TWI_NL_ERR_INV_CRC,
+	TWI_NL_ERR_FRGMNTS_MISSING,					/* The error data is the fragment header followed by the bitmap of the missing fragments. */
+	TWI_NL_PKT_REASSEMBLED,						/* Not an error, acknowledges a reassembled packet once both sides agreed on TWI_LL_CAP_REASSEMBLY_ACK. The data is its fragment header. */
+	TWI_SL_ERR_BASE = 128,
+	TWI_SL_ERR_SIGNATURE_FAILURE,
+	TWI_SL_ERR_DECRYPT_FAILURE,
+	TWI_SL_ERR_INSFCNT_LEN,
+	TWI_SL_ERR_ENCRYPT_KEY_ABSNT,
+	TWI_SL_ERR_SIGNATURE_KEY_ABSNT,
+	TWI_STACK_SPECS_CMD_ERR_CODE = 254,
+	TWI_STACK_INVALID_ERR_CODE = 255
+}tenu_stack_err_code;
+
+typedef enum
+{
+	TWI_STACK_CLR_MSG = 0,
+	TWI_STACK_ENCRYPTED_MSG,
+	TWI_STACK_SESSION_ESTBLSHMNT_MSG,
+	TWI_STACK_PAIRING_MSG,
+	TWI_STACK_ENCRYPTED_SIGNED_MSG,
+	TWI_STACK_ENCRYPTED_SIGNED_USR_CNFRM_MSG,
+	TWI_STACK_SIGNED_MSG,
+	TWI_STACK_INVLD_MSG
+}tenu_twi_stack_msg_type;
+
+typedef enum
+{
+	TWI_USB_LL = 0,
+	TWI_BLE_LL,
+	TWI_INVALID_LL
+}tenu_twi_ll_type;
+
+typedef enum
+{
+	TWI_LL_SEND_STATUS_EVT = 0,
+	TWI_LL_RCV_DATA_EVT,
+	TWI_LL_RCV_ERROR_EVT,
+	TWI_LL_INVALID_EVT
+}tenu_twi_ll_evnt;
+
+typedef struct
+{
+	tenu_twi_ll_evnt enu_event;
+	void* pv_args;
+	union
+	{
+		struct
+		{
+			twi_bool b_is_success;
+			void* pv_user_arg;
+		}str_send_stts_evt;
+		struct
+		{
+			twi_u8* pu8_data;
+			twi_u16 u16_data_len;
+		}str_rcv_data_evt;
+		struct
+		{
+			tenu_stack_err_code enu_err_code;
+			twi_u8* pu8_err_data;
+			twi_u16 u16_err_data_len;
+		}str_rcv_error_evt;
+	}uni_data;
+}tstr_twi_ll_evt;
+
+typedef void (*tpf_ll_cb)(tstr_twi_ll_evt* pstr_evt);
+
+/**
+ * @brief	One segment of a message that the link layer gathers into the outgoing frame.
+ */
+typedef struct
+{
+	const twi_u8* pu8_data;
+	twi_u16 u16_len;
+}tstr_twi_ll_iovec;
+
+/**
+ * @brief	Link layer counters.
+ */
+typedef struct
+{
+	twi_u32 u32_tx_reports_cnt;
+	twi_u32 u32_tx_fails_cnt;
+	twi_u32 u32_tx_timeouts_cnt;
+	twi_u32 u32_tx_saved_reports_cnt;			/* Reports saved by packing several messages in one report. */
+	twi_u32 u32_rx_reports_cnt;
+	twi_u32 u32_rx_dropped_cnt;
+	twi_u32 u32_rx_coalesced_msgs_cnt;			/* Messages received packed with other messages. */
+	tstr_twi_hist str_tx_hist;					/* Time from a report send to its TX done. */
+}tstr_twi_ll_stats;
+
+struct _tstr_stack_helpers
+{
+	tpf_twi_system_sleep_mode_forbiden pf_twi_system_sleep_mode_forbiden;
+	tpf_stop_timer pf_stop_timer;
+	tpf_start_timer pf_start_timer;
+	tpf_get_time_ms pf_get_time_ms;					/* Optional , without it nothing is timed. */
+	tpf_save_data pf_save_data;						/* Optional. */
+	tpf_load_data pf_load_data;						/* Optional. */
+	tpf_stack_sign_cb pf_stack_sign_cb;
+	tpf_stack_verify_sig_cb pf_stack_verify_sig_cb;
+	tpf_stack_encrypt_cb pf_stack_encrypt_cb;
+	tpf_stack_decrypt_cb pf_stack_decrypt_cb;
+	union
+	{
+		struct
+		{
+			tpf_twi_usbd_send pf_twi_usbd_send;
+			tpf_twi_usbd_send_batch pf_twi_usbd_send_batch;		/* Optional. */
+			tpf_twi_usbd_stop pf_twi_usbd_stop;
+			tpf_twi_usbd_receive pf_twi_usbd_receive;
+			tpf_twi_usbd_dispatch pf_twi_usbd_dispatch;
+		}str_usb;
+	}uni_ll_helpers;
+};
+
+typedef struct _tstr_stack_helpers tstr_stack_helpers;
+
+typedef struct
+{
+	twi_usbd_events_t enu_usbd_evt;
+	twi_u16 u16_len;
+	twi_u8* pu8_data;
+}tstr_twi_usb_evt;
+
+#endif /* __TWI_STACK_COMMON_H__ */
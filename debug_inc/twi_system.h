@@ -0,0 +1,16 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ ** @file		twi_system.h
+ ** @brief		This file declares the system helpers. On the host the sleep control goes through the stack helpers,
+ **				so nothing is needed here.
+ */
+
+#ifndef __TWI_SYSTEM_H__
+#define __TWI_SYSTEM_H__
+
+#include "twi_types.h"
+
+#endif /* __TWI_SYSTEM_H__ */
@@ -0,0 +1,61 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_timer_wheel.h
+@brief		this file declares a two level hashed timer wheel that runs the stack timers on a millisecond clock read by its owner.
+*/
+
+#ifndef __TWI_TIMER_WHEEL_H__
+#define __TWI_TIMER_WHEEL_H__
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include "twi_common.h"
+#include "timer_mgmt.h"
+
+//***********************************************************
+/*- CONSTANTS ---------------------------------------------*/
+//***********************************************************
+#define TWI_TIMER_WHEEL_TIMERS_NUM			(8)			/** @brief: Timers that can be armed at once. */
+#define TWI_TIMER_WHEEL_TICK_MS				(10)
+#define TWI_TIMER_WHEEL_BITS				(6)
+#define TWI_TIMER_WHEEL_SLOTS				(1 << TWI_TIMER_WHEEL_BITS)	/** @brief: Slots of each level, the second level slot spans a whole first level turn. */
+#define TWI_TIMER_WHEEL_NONE				(0xFF)
+
+//***********************************************************
+/*- TYPEDEFS ----------------------------------------------*/
+//***********************************************************
+typedef struct
+{
+	tstr_timer_mgmt_timer* pstr_timer;		/* NULL when the entry is free */
+	tpf_twi_timer_mgmt_cb pf_timer_cb;
+	void* pv_user_data;
+	twi_u32 u32_period_ticks;				/* 0 for the one shot timers */
+	twi_u32 u32_expiry_tick;
+	twi_u8 u8_slot;							/* slot the entry is linked in, TWI_TIMER_WHEEL_NONE when it is unlinked */
+	twi_u8 u8_next;
+	twi_u8 u8_prev;
+}tstr_twi_wheel_timer;
+
+typedef struct
+{
+	tstr_twi_wheel_timer astr_timers[TWI_TIMER_WHEEL_TIMERS_NUM];
+	twi_u8 au8_slots[2 * TWI_TIMER_WHEEL_SLOTS];	/* list heads, the first level slots then the second level ones */
+	twi_u32 u32_tick;						/* last tick the wheel has run */
+	twi_u32 u32_tick_ms;					/* clock time of that tick */
+	twi_u8 u8_timers_num;
+}tstr_twi_timer_wheel;
+
+//***********************************************************
+/*- APIs --------------------------------------------------*/
+//***********************************************************
+void twi_timer_wheel_init(tstr_twi_timer_wheel* pstr_wheel);
+twi_s32 twi_timer_wheel_start(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms, tstr_timer_mgmt_timer* pstr_timer, tenu_mgmt_timer_mode enu_mode, twi_u32 u32_msec, tpf_twi_timer_mgmt_cb pf_timer_cb, void* pv_user_data);
+void twi_timer_wheel_stop(tstr_twi_timer_wheel* pstr_wheel, tstr_timer_mgmt_timer* pstr_timer);
+void twi_timer_wheel_run(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms);
+twi_bool twi_timer_wheel_get_next_timeout(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms, twi_u32* pu32_timeout_ms);
+
+#endif /* __TWI_TIMER_WHEEL_H__ */
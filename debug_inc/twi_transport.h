@@ -0,0 +1,133 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_transport.h
+ * @brief:	Host side transports that carry the USB link layer HID reports natively, in place of the WebHID calls
+ *			crypto_guard_if.c makes from the browser.
+ *			Every backend moves whole TWI_TRANSPORT_REPORT_SZ reports laid out as the usb_send callback builds them:
+ *			[0] the payload length or the port control code, then the link layer message.
+ *
+ *			loopback				an in-process peer, e.g. the simulated firmware of the bench.
+ *			unix:<path>				a Unix stream socket, e.g. "twi_bench serve" on the other end.
+ *			pipe:<read fd>,<write fd>	two inherited file descriptors, e.g. a coprocess.
+ *			hidraw:<path>			a Linux hidraw node of the device, e.g. /dev/hidraw0.
+ *
+ *			@ref twi_transport_bind_stack_helpers lets a stack owned directly by the host send and pull its reports
+ *			through an opened transport.
+ */
+
+#ifndef TWI_TRANSPORT_H_
+#define TWI_TRANSPORT_H_
+
+#include "twi_common.h"
+#include "twi_stack_common.h"
+#include "twi_usb_link_layer.h"
+
+/*---------------------------------------------------------*/
+/*- MODULE MACROS DEFINITION-------------------------------*/
+/*---------------------------------------------------------*/
+#define TWI_TRANSPORT_REPORT_SZ					(TWI_LL_USB_MAX_BUFF_SIZE)	/** @brief: HID report size, the same on every backend.*/
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef struct twi_transport tstr_twi_transport;
+
+typedef twi_s32 (*tpf_transport_open)(tstr_twi_transport* pstr_transport, const char* pc_path);
+typedef twi_s32 (*tpf_transport_listen)(tstr_twi_transport* pstr_transport, const char* pc_path);
+typedef void 	(*tpf_transport_close)(tstr_twi_transport* pstr_transport);
+typedef twi_s32 (*tpf_transport_write)(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num);
+typedef twi_s32 (*tpf_transport_read)(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read);
+
+typedef void 	(*tpf_transport_peer_report)(void* pv_peer, const twi_u8* pu8_report, twi_u32 u32_report_len);
+typedef twi_bool (*tpf_transport_peer_pop)(void* pv_peer, twi_u8* pu8_report);
+
+/*The in-process device of the loopback backend, it answers while it handles the report.*/
+typedef struct
+{
+	tpf_transport_peer_report	pf_host_report;		/*Handles one report of the host.*/
+	tpf_transport_peer_pop		pf_pop_report;		/*Takes the oldest queued response report, TWI_FALSE if there is none.*/
+	void*						pv_peer;
+
+}tstr_twi_transport_peer;
+
+typedef struct
+{
+	const char*				pc_name;		/*Prefix of the transport spec, before the ':'.*/
+	tpf_transport_open		pf_open;		/*Reaches the device or the peer.*/
+	tpf_transport_listen	pf_listen;		/*Optional, waits for one peer to reach this side, NULL if the backend can't serve.*/
+	tpf_transport_close		pf_close;
+	tpf_transport_write		pf_write;		/*Writes contiguous reports, returns once all of them are handed to the OS.*/
+	tpf_transport_read		pf_read;		/*Reads one report, waiting at most the given time for it.*/
+
+}tstr_twi_transport_ops;
+
+struct twi_transport
+{
+	const tstr_twi_transport_ops*	pstr_ops;
+	const tstr_twi_transport_peer*	pstr_peer;		/*Loopback only.*/
+	int								s_rd_fd;
+	int								s_wr_fd;
+	void*							pv_owner;		/*Free for the host once opened, its own stack helpers get it back from the transport.*/
+};
+
+/*---------------------------------------------------------*/
+/*- APIs PROTOTYPES ---------------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+*	@brief		Opens the transport the spec names and reaches the device through it.
+*	@param [out] pstr_transport	Pointer to the transport context.
+*	@param [in]	pc_spec			"loopback", "unix:<path>", "pipe:<read fd>,<write fd>" or "hidraw:<path>".
+*	@param [in]	pstr_peer		In-process device the loopback backend talks to, unused by the others.
+*	@return		TWI_SUCCESS, TWI_ERROR_INVALID_ARGUMENTS for an unknown spec, TWI_ERROR_NOT_SUPPORTED_FEATURE if the backend
+*				isn't built on this OS, TWI_ERROR if the device or the peer can't be reached.
+*/
+twi_s32 twi_transport_open(tstr_twi_transport* pstr_transport, const char* pc_spec, const tstr_twi_transport_peer* pstr_peer);
+
+/**
+*	@brief		Opens the transport the spec names on the device side and waits for the host to reach it.
+*	@param [out] pstr_transport	Pointer to the transport context.
+*	@param [in]	pc_spec			"unix:<path>" or "pipe:<read fd>,<write fd>".
+*	@return		TWI_SUCCESS, TWI_ERROR_NOT_SUPPORTED_FEATURE if the backend can't serve, TWI_ERROR otherwise.
+*/
+twi_s32 twi_transport_listen(tstr_twi_transport* pstr_transport, const char* pc_spec);
+
+/**
+*	@brief		Closes the transport, it can be opened again afterwards.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*/
+void twi_transport_close(tstr_twi_transport* pstr_transport);
+
+/**
+*	@brief		Writes contiguous TWI_TRANSPORT_REPORT_SZ reports.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*	@param [in]	pu8_reports		Pointer to the first report.
+*	@param [in]	u32_reports_num	Number of reports.
+*	@return		TWI_SUCCESS once all of them are written, TWI_ERROR if the device or the peer is gone.
+*/
+twi_s32 twi_transport_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num);
+
+/**
+*	@brief		Reads one report.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*	@param [out] pu8_report		Buffer of at least TWI_TRANSPORT_REPORT_SZ bytes.
+*	@param [in]	u32_timeout_ms	Longest wait for the report, 0 only takes a report that already arrived.
+*	@param [out] pb_is_read		TWI_TRUE if a report was copied.
+*	@return		TWI_SUCCESS, also when no report came in time, TWI_ERROR if the device or the peer is gone.
+*/
+twi_s32 twi_transport_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read);
+
+/**
+*	@brief		Sets the USB helpers of the stack to send and pull its reports through a transport.
+*				The stack shall be initialized with the transport as its helpers pointer, the other helpers find the host
+*				context in pv_owner. A send returns once the reports are written, the host then passes ::TWI_USBD_TX_DONE
+*				to the stack. On ::TWI_USBD_RX_DONE without data the stack pulls the report waiting on the transport.
+*				Closing the transport is left to the host.
+*	@param [out] pstr_helpers	Pointer to the stack helpers, only the USB ones are set.
+*/
+void twi_transport_bind_stack_helpers(tstr_stack_helpers* pstr_helpers);
+
+#endif /* TWI_TRANSPORT_H_ */
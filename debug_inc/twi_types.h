@@ -0,0 +1,84 @@
+/****************************************************************************/
+/* Copyright (c) 2014 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ ** @file		twi_types.h
+ ** @brief		This file contains the basic types used all over the code.
+ */
+
+#ifndef __TWI_TYPES_H__
+#define __TWI_TYPES_H__
+
+/*-*********************************************************/
+/*- INCLUDES ----------------------------------------------*/
+/*-*********************************************************/
+#include <stdint.h>
+#include <stddef.h>
+
+/*-*********************************************************/
+/*- CONSTANTS ---------------------------------------------*/
+/*-*********************************************************/
+#define TWI_TRUE			(1)
+#define TWI_FALSE			(0)
+#define TWI_FLASE			TWI_FALSE		/* Kept for the old spelling in the logger. */
+
+#ifndef NULL
+	#define NULL			((void*)0)
+#endif
+
+/*-*********************************************************/
+/*- TYPEDEFS ----------------------------------------------*/
+/*-*********************************************************/
+
+/**
+ * @brief	boolean type.
+ */
+typedef _Bool		twi_bool;
+
+/**
+ * @brief	unsigned 8 bits type.
+ */
+typedef uint8_t		twi_u8;
+
+/**
+ * @brief	signed 8 bits type.
+ */
+typedef int8_t		twi_s8;
+
+/**
+ * @brief	unsigned 16 bits type.
+ */
+typedef uint16_t	twi_u16;
+
+/**
+ * @brief	signed 16 bits type.
+ */
+typedef int16_t		twi_s16;
+
+/**
+ * @brief	unsigned 32 bits type.
+ */
+typedef uint32_t	twi_u32;
+
+/**
+ * @brief	signed 32 bits type.
+ */
+typedef int32_t		twi_s32;
+
+/**
+ * @brief	unsigned 64 bits type.
+ */
+typedef uint64_t	twi_u64;
+
+/**
+ * @brief	signed 64 bits type.
+ */
+typedef int64_t		twi_s64;
+
+/**
+ * @brief	unsigned type wide enough to hold a pointer.
+ */
+typedef uintptr_t	twi_uptr;
+
+#endif /* __TWI_TYPES_H__ */
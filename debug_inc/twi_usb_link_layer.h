@@ -0,0 +1,120 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_usb_link_layer.h
+ * @brief:	This file declares the USB link layer interface in the communication stack.
+ */
+
+#ifndef __TWI_USB_LINK_LAYER_H__
+#define __TWI_USB_LINK_LAYER_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include "twi_stack_common.h"
+
+/*---------------------------------------------------------*/
+/*- CONSTANTS ---------------------------------------------*/
+/*---------------------------------------------------------*/
+#define TWI_LL_USB_MAX_BUFF_SIZE				(64)			/** @brief: One HID report. */
+#define TWI_LL_USB_ERR_BUFF_SIZE				(33)
+#define TWI_LL_MESSAGE_MARKER_SIZE				(1)
+#define TWI_LL_USB_MAX_BATCH_REPORTS			(64)			/** @brief: Reports handed to the host in one batch , about 3.8 KB of data. */
+#define TWI_LL_USB_MAX_JUMBO_REPORTS			(8)				/** @brief: Reports one data message can span once agreed in the stack specs. */
+#define TWI_LL_USB_TX_SLOTS_NUM					(TWI_LL_USB_MAX_BATCH_REPORTS + 2)	/** @brief: A whole batch plus the slots kept for the control messages. */
+#define TWI_LL_USB_TX_IDS_NUM					(4)				/** @brief: Sends handed to the host whose TX done is awaited , timed out ones included. */
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	USB_LINK_LAYER_STATE_WAITING_TO_CONNECT = 0,
+	USB_LINK_LAYER_STATE_CONNECTED,
+	USB_LINK_LAYER_STATE_READY,
+	USB_LINK_LAYER_STATE_SEND_IN_PROGRESS,
+	USB_LINK_LAYER_STATE_INVALID
+}tenu_usb_link_layer_status;
+
+/**
+ * @brief	One outgoing report of the transmit ring.
+ */
+typedef struct
+{
+	twi_u8 u8_state;					/* @ref tenu_usb_ll_tx_slot_state */
+	twi_u8 u8_type;						/* @ref tenu_usb_ll_tx_slot_type */
+	twi_bool b_is_last;					/* Last report of a message or a batch , it raises the send status. */
+	twi_u16 u16_len;					/* Marker and message data length. */
+	void* pv_user_arg;
+}tstr_usb_ll_tx_slot;
+
+typedef struct
+{
+	struct
+	{
+		twi_bool b_is_initialized;
+		tpf_ll_cb pf_ll_cb;
+		tenu_usb_link_layer_status enu_link_layer_state;
+		tstr_timer_mgmt_timer str_stack_event_timeout;
+		twi_u8 au8_data_rcv_buff[TWI_LL_USB_MAX_BUFF_SIZE];
+		void* pv_args;
+		twi_bool b_is_stack_specs_received;
+		twi_bool b_is_sending_stack_specs;
+		twi_bool b_is_specs_optimistic;				/* READY on the saved specs record , the exchange still runs to verify it. */
+		twi_bool b_need_to_disconnect;
+		/* Agreed stack specs */
+		twi_u32 u32_ctu;
+		twi_u8 u8_jumbo_reports;
+		twi_u8 u8_capabilities;
+		/* Jumbo data message reassembly */
+		twi_u16 u16_jumbo_rcv_len;
+		twi_u16 u16_jumbo_rcv_idx;
+		twi_u8 au8_jumbo_rcv_buf[TWI_LL_USB_MAX_JUMBO_REPORTS * TWI_LL_USB_MAX_BUFF_SIZE];
+		/* Transmit ring */
+		twi_u8 aau8_tx_reports[TWI_LL_USB_TX_SLOTS_NUM][TWI_LL_USB_MAX_BUFF_SIZE];
+		tstr_usb_ll_tx_slot astr_tx_slots[TWI_LL_USB_TX_SLOTS_NUM];
+		twi_u8 aau8_tx_packed[TWI_LL_USB_MAX_BATCH_REPORTS][TWI_LL_USB_MAX_BUFF_SIZE];
+		twi_u8 u8_tx_head;
+		twi_u8 u8_tx_cnt;
+		twi_u8 u8_tx_inflight_num;
+		twi_u16 u16_batch_reports_num;
+		/* Send timing */
+		twi_bool b_is_tx_timed;
+		twi_u16 u16_tx_reports_num;
+		twi_u32 u32_tx_start_ms;
+		/* Ids of the sends handed to the host , oldest first. The host completes them in order */
+		twi_u8 au8_tx_ids[TWI_LL_USB_TX_IDS_NUM];
+		twi_u8 u8_tx_ids_head;
+		twi_u8 u8_tx_ids_num;
+		twi_u8 u8_tx_next_id;
+		twi_u8 u8_tx_inflight_id;
+		tstr_twi_rtt str_tx_rtt;
+		tstr_twi_ll_stats str_stats;
+	}str_global;
+	tstr_stack_helpers* pstr_stack_helpers;
+	void* pv_stack_helpers;
+}tstr_usb_ll_ctx;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+twi_s32 twi_usb_ll_init(tstr_usb_ll_ctx * pstr_ctx, void * pv_args, tpf_ll_cb pf_evt_cb, tstr_stack_helpers * pstr_helpers, void* pv_helpers);
+void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, tstr_twi_usb_evt* pstr_usb_evt);
+twi_s32 twi_usb_ll_send_data(tstr_usb_ll_ctx * pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+twi_s32 twi_usb_ll_send_data_iov(tstr_usb_ll_ctx * pstr_ctx , const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num, void* pv_arg);
+twi_s32 twi_usb_ll_add_batch_data(tstr_usb_ll_ctx * pstr_ctx , const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+twi_s32 twi_usb_ll_send_batch(tstr_usb_ll_ctx * pstr_ctx, void* pv_arg);
+twi_s32 twi_usb_ll_send_error(tstr_usb_ll_ctx * pstr_ctx ,tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len);
+void twi_usb_ll_dispatcher(tstr_usb_ll_ctx * pstr_ctx);
+twi_u16 twi_usb_ll_get_mtu_size(tstr_usb_ll_ctx* pstr_ctx);
+twi_u32 twi_usb_ll_get_ctu_size(tstr_usb_ll_ctx* pstr_ctx);
+twi_u8 twi_usb_ll_get_capabilities(tstr_usb_ll_ctx* pstr_ctx);
+twi_u16 twi_usb_ll_get_batch_capacity(tstr_usb_ll_ctx* pstr_ctx);
+twi_u32 twi_usb_ll_get_send_timeout(tstr_usb_ll_ctx* pstr_ctx);
+void twi_usb_ll_get_stats(tstr_usb_ll_ctx* pstr_ctx, tstr_twi_ll_stats* pstr_stats);
+void twi_usb_ll_is_ready_to_send(tstr_usb_ll_ctx* pstr_cntxt, twi_bool* pb_is_ready);
+twi_bool twi_usb_ll_is_idle(tstr_usb_ll_ctx* pstr_cntxt);
+
+#endif /* __TWI_USB_LINK_LAYER_H__ */
@@ -0,0 +1,496 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_usb_wallet_if.h
+ * @brief:	This file declares the USB hardware wallet interface.
+ */
+
+#ifndef __TWI_USB_WALLET_IF_H__
+#define __TWI_USB_WALLET_IF_H__
+
+/*---------------------------------------------------------*/
+/*- INCLUDES ----------------------------------------------*/
+/*---------------------------------------------------------*/
+#include <pthread.h>
+#include "twi_common.h"
+#include "twi_stack.h"
+#include "twi_timer_wheel.h"
+
+/*---------------------------------------------------------*/
+/*- CONSTANTS ---------------------------------------------*/
+/*---------------------------------------------------------*/
+#define USB_SCAN_DURATION_MS						(10000)
+
+#define USB_WALLET_ID_LEN							(15)
+#define USB_WALLET_PATH_MAX_STEPS					(5)
+#define USB_WALLET_PATH_STEP_SZ						(4)
+#define USB_WALLET_PUBKEY_MAX_LEN					(255)
+#define USB_WALLET_XPUB_BATCH_MAX_PATHS				(32)			/** @brief: Paths of one @ref twi_usb_if_get_ext_pub_keys operation. */
+#define USB_WALLET_OP_QUEUE_LEN						(8)				/** @brief: Operations that can wait behind the running one. */
+
+#define USB_WALLET_APDU_BUFFER_MAX_SZ				(MAX_PKT_SZ - 1)							/** @brief: One stack packet less the security layer frame header. */
+#define USB_WALLET_CMD_INPUT_MAX_SZ					(USB_WALLET_APDU_BUFFER_MAX_SZ - 9)			/** @brief: One APDU less CLA, INS, P1, P2 and the extended Lc and Le. */
+
+#ifndef USB_WALLET_SIGNING_TX_MAX_LEN
+#define USB_WALLET_SIGNING_TX_MAX_LEN				(4096)
+#endif
+#define USB_WALLET_INTERNAL_INPUTS_MAX_NUM			(10)
+#define USB_WALLET_INTERNAL_OUTPUTS_MAX_NUM			(10)
+#define USB_WALLET_TX_INPUTS_MAX_NUM				(15)
+#define USB_WALLET_LOCK_SCRIPT_MAX_LEN				(32)
+#define USB_WALLET_SIGHASH_VALUE_LEN				(4)
+#define USB_WALLET_SIGNED_INPUT_MAX_LEN				(76)
+
+#define USB_WALLET_MSG_MAX_LEN						(1024)
+#define USB_WALLET_MSG_CHUNK_SZ						(128)
+#define USB_WALLET_MSG_SHA_256_HASH_LEN				(32)
+#define USB_WALLET_BITCOIN_SIGNED_MSG_LEN			(65)
+#define USB_WALLET_ETHEREUM_SIGNED_MSG_LEN			(65)
+
+#define TWI_USB_ETHEREUM_SIGNATURE_V_LEN			(1)
+#define TWI_USB_ETHEREUM_SIGNATURE_R_LEN			(32)
+#define TWI_USB_ETHEREUM_SIGNATURE_S_LEN			(32)
+
+/*---------------------------------------------------------*/
+/*- STRUCTS AND UNIONS AND ENUM----------------------------*/
+/*---------------------------------------------------------*/
+typedef enum
+{
+	USB_IF_NO_ERR = 0,
+	USB_IF_ERR_REMOTE_DISCON = 1,
+	USB_IF_ERR_CON_TIMEOUT = 2,
+	USB_IF_ERR_CON_FAILED = 3,
+	USB_IF_ERR_CON_TERMINATED = 4,
+	USB_IF_ERR_SEND_FAIL = 5,
+	USB_IF_ERR_SEND_TIMEOUT = 6,
+	USB_IF_ERR_INVALID_STATE = 7,
+	USB_IF_ERR_UNMATCHED_WALLET_ID = 9,
+	USB_IF_ERR_OP_TERMINATED_BY_USER = 10,
+	USB_IF_ERR_BAD_REQUEST = 11,
+	USB_IF_ERR_INVALID_ARGS = 13,
+	USB_IF_ERR_RESP_PARSING_FAIL = 14,
+	USB_IF_ERR_REQ_DATA_NOT_EXIST = 100,
+	USB_IF_ERR_GET_EXT_PUBKEY_FAILED = 300,
+	USB_IF_ERR_GET_WALLET_ID_FAILED = 301,
+	USB_IF_ERR_OPEN_COIN_APP_FAILED = 302,
+	USB_IF_ERR_SIGN_TX_FAILED = 303,
+	USB_IF_ERR_SIGN_MSG_FAILED = 304
+}tenu_usb_if_err;
+
+typedef struct
+{
+	twi_u8 u8_steps_num;
+	twi_u32 au32_path_steps[USB_WALLET_PATH_MAX_STEPS];
+}tstr_usb_crypto_path;
+
+typedef struct
+{
+	twi_u8 u8_idx;
+	twi_u16 u16_lock_script_len;
+	twi_u8 au8_lock_script[USB_WALLET_LOCK_SCRIPT_MAX_LEN];
+	tstr_usb_crypto_path str_path;
+}tstr_usb_internal_input_info;
+
+typedef struct
+{
+	twi_u8 u8_idx;
+	tstr_usb_crypto_path str_path;
+}tstr_usb_internal_output_info;
+
+typedef struct
+{
+	twi_u32 u32_idx;
+	twi_u16 u16_tx_len;
+	twi_u8 au8_tx[USB_WALLET_SIGNING_TX_MAX_LEN];
+}tstr_usb_tx_input_info;
+
+typedef struct
+{
+	twi_u16 u16_signing_tx_len;
+	twi_u8 au8_signing_tx[USB_WALLET_SIGNING_TX_MAX_LEN];
+	twi_u8 u8_internal_inputs_num;
+	tstr_usb_internal_input_info astr_internal_inputs[USB_WALLET_INTERNAL_INPUTS_MAX_NUM];
+	twi_u8 u8_internal_outputs_num;
+	tstr_usb_internal_output_info astr_internal_outputs[USB_WALLET_INTERNAL_OUTPUTS_MAX_NUM];
+	twi_u32 u32_sighash_value;
+	twi_u16 u16_total_inputs_num;
+	tstr_usb_tx_input_info astr_inputs_info[USB_WALLET_TX_INPUTS_MAX_NUM];
+	twi_u16 u16_delivered_inputs_count;
+}tstr_usb_bitcoin_tx;
+
+typedef struct
+{
+	twi_u16 u16_signing_tx_len;
+	twi_u8 au8_signing_tx[USB_WALLET_SIGNING_TX_MAX_LEN];
+	tstr_usb_crypto_path str_signing_key_path;
+}tstr_usb_ethereum_tx;
+
+typedef struct
+{
+	twi_u8 u8_sign_len;
+	twi_u8 au8_sign_buf[USB_WALLET_SIGNED_INPUT_MAX_LEN];
+}tstr_usb_signed_input_info;
+
+typedef struct
+{
+	tstr_usb_signed_input_info astr_signed_inputs[USB_WALLET_TX_INPUTS_MAX_NUM];
+	twi_u8 u8_signed_inputs_num;
+	twi_u8 u8_sign_type;
+}tstr_usb_bitcoin_signed_tx;
+
+typedef struct
+{
+	twi_u8 u8_sig_v;
+	twi_u8 au8_sig_r[TWI_USB_ETHEREUM_SIGNATURE_R_LEN];
+	twi_u8 au8_sig_s[TWI_USB_ETHEREUM_SIGNATURE_S_LEN];
+}tstr_usb_ethereum_signed_tx;
+
+typedef struct
+{
+	twi_u32 u32_msg_len;
+	twi_u8 au8_msg_buf[USB_WALLET_MSG_MAX_LEN];
+	twi_u8 au8_msg_sha_256_hash[USB_WALLET_MSG_SHA_256_HASH_LEN];
+	tstr_usb_crypto_path str_sign_key_path;
+}tstr_usb_bitcoin_msg;
+
+typedef struct
+{
+	twi_u32 u32_msg_len;
+	twi_u8 au8_msg_buf[USB_WALLET_MSG_MAX_LEN];
+	twi_u8 au8_msg_sha_256_hash[USB_WALLET_MSG_SHA_256_HASH_LEN];
+	tstr_usb_crypto_path str_sign_key_path;
+}tstr_usb_ethereum_msg;
+
+typedef struct
+{
+	twi_u8 au8_signed_msg_buf[USB_WALLET_BITCOIN_SIGNED_MSG_LEN];
+}tstr_usb_bitcoin_signed_msg;
+
+typedef struct
+{
+	twi_u8 u8_sig_v;
+	twi_u8 au8_sig_r[TWI_USB_ETHEREUM_SIGNATURE_R_LEN];
+	twi_u8 au8_sig_s[TWI_USB_ETHEREUM_SIGNATURE_S_LEN];
+}tstr_usb_ethereum_signed_msg;
+
+enum
+{
+	USB_WALLET_APP_OPEN_CONFIRMATION = 0,
+	USB_WALLET_APP_INSTALL_CONFIRMATION,
+	USB_WALLET_APP_UNINSTALL_CONFIRMATION,
+	USB_WALLET_SIGN_TX_CONFIRMATION,
+	USB_WALLET_SIGN_MSG_CONFIRMATION,
+	USB_WALLET_INVALID_CONFIRAMTION
+};
+
+typedef enum
+{
+	USB_WALLET_COIN_BITCOIN = 0,
+	USB_WALLET_COIN_TEST_BITCOIN,
+	USB_WALLET_COIN_ETHEREUM,
+	USB_WALLET_COIN_TEST_ETHEREUM,
+	USB_WALLET_COIN_INVALID
+}tenu_twi_usb_coin_type;
+
+typedef enum
+{
+	USB_WALLET_CMD_INPUT_BUF = 0,
+	USB_WALLET_APDU_BUF,
+	USB_WALLET_PATH_STEPS,
+	USB_WALLET_PATH_STEP_BUF,
+	USB_WALLET_SIGNING_TX_BUF,
+	USB_WALLET_INTERNAL_INPUTS_NUM,
+	USB_WALLET_INTERNAL_OUTPUTS_NUM,
+	USB_WALLET_TX_INPUTS_NUM,
+	USB_WALLET_LOCK_SCRIPT_BUF,
+	USB_WALLET_SIGHASH_VALUE_BUF,
+	USB_WALLET_SIGNED_INPUT_BUF,
+	USB_WALLET_INVALID_BUF
+}tenu_twi_usb_buff_types;
+
+/*
+ * Host callbacks
+ */
+typedef void (*usb_scan_and_connect)(void* const pv_device, twi_u8* pu8_dvc_id, twi_u8 u8_dvc_id_len, twi_u16 u16_vid, twi_u16 u16_pid, twi_u32 u32_scan_time_out_msec, twi_u32 u32_mtu_sz);
+
+typedef void (*usb_disconnect)(void* const pv_device);
+
+/* USB HID reports */
+typedef void (*usb_receive)(void* const pv_device, void* p_rx_buf, twi_u32* pu32_length);
+
+typedef void (*usb_stop)(void* const pv_device);
+
+typedef void (*usb_disable)(void* const pv_device);
+
+typedef void (*usb_dispatch)(void* const pv_device);
+
+typedef void (*usb_wake)(void* const pv_device);
+
+typedef void (*usb_send)(void* const pv_device, twi_u8* const pu8_data, twi_u32 u32_data_sz);
+
+typedef void (*usb_send_batch)(void* const pv_device, twi_u8* const pu8_reports, twi_u32 u32_reports_num);
+
+typedef void (*usb_Start_Timer)(void* const pv_device, twi_u32 u32_idx, twi_u32 u32_dur_msec);
+
+typedef void (*usb_Stop_Timer)(void* const pv_device, twi_u32 u32_idx);
+
+typedef twi_u32 (*usb_get_time_ms)(void* const pv_device);
+
+/* Cloud */
+typedef void (*usb_send_to_cloud)(void* const pv_device, twi_u8* const pu8_data, twi_u32 u32_data_sz);
+
+typedef void (*usb_onUserConfirmationRequested)(void* const pv_device, twi_u32 u32_conf_type);
+
+typedef void (*usb_onUserConfirmationObtained)(void* const pv_device, twi_u32 u32_conf_type);
+
+typedef void (*usb_onGetExtendedPubKeyResult)(void* const pv_device, twi_u8* const pu8_pub_key, twi_u32 u32_pub_key_sz, twi_s32 s32_err);
+
+typedef void (*usb_onGetExtendedPubKeysResult)(void* const pv_device, twi_u8* const pu8_pub_keys, twi_u32 u32_pub_keys_sz, twi_u8 u8_pub_keys_num, twi_s32 s32_err);
+
+typedef void (*usb_onSignTransactionResult)(void* const pv_device, void* pstr_signed_tx, twi_s32 s32_err);
+
+typedef void (*usb_onSignMessageResult)(void* const pv_device, void* pstr_signed_msg, twi_s32 s32_err);
+
+typedef void (*usb_onGetWalletIDResult)(void* const pv_device, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_s32 s32_err);
+
+typedef void (*usb_save)(void* const pv_device, twi_u16 id, twi_u8* pu8_data, twi_u32 u32_data_sz);
+
+/* *pu32_data_sz is the capacity of pu8_data in, the record size out. It's set to 0 if there is no record or it doesn't fit. */
+typedef void (*usb_load)(void* const pv_device, twi_u16 id, twi_u8* pu8_data, twi_u32* pu32_data_sz);
+
+typedef void (*usb_onConnectionDone)(void* const pv_device);
+
+typedef struct
+{
+	usb_scan_and_connect __usb_scan_and_connect;
+	usb_disconnect __usb_disconnect;
+	usb_receive __usb_receive;
+	usb_stop __usb_stop;
+	usb_disable __usb_disable;
+	usb_dispatch __usb_dispatch;
+	usb_wake __usb_wake;
+	usb_send __usb_send;
+	usb_send_batch __usb_send_batch;
+	usb_Start_Timer __start_timer;
+	usb_Stop_Timer __stop_timer;
+	usb_send_to_cloud __send_to_cloud;
+	usb_onUserConfirmationRequested __onUserConfirmationRequested;
+	usb_onUserConfirmationObtained __onUserConfirmationObtained;
+	usb_onGetExtendedPubKeyResult __onGetExtendedPubKeyResult;
+	usb_onGetExtendedPubKeysResult __onGetExtendedPubKeysResult;
+	usb_onSignTransactionResult __onSignTransactionResult;
+	usb_onSignMessageResult __onSignMessageResult;
+	usb_onGetWalletIDResult __onGetWalletIDResult;
+	usb_save __save;
+	usb_load __load;
+	usb_onConnectionDone __onConnectionDone;
+}tstr_usb_if_in_param;
+
+typedef enum
+{
+	USB_WALLET_APDU_GET_INSTALLED_APPS_INFO_CMD = 0,
+	USB_WALLET_APDU_GET_STATUS_CMD,
+	USB_WALLET_APDU_REQUEST_OPEN_APP_CMD,
+	USB_WALLET_APDU_CONFIRM_OPEN_APP_CMD,
+	USB_WALLET_APDU_REQUEST_INSTALL_APP_CMD,
+	USB_WALLET_APDU_CONFIRM_INSTALL_APP_CMD,
+	USB_WALLET_APDU_CONTINUE_INSTALL_APP_CMD,
+	USB_WALLET_APDU_FINISH_INSTALL_APP_CMD,
+	USB_WALLET_APDU_REQUEST_UNINSTALL_APP_CMD,
+	USB_WALLET_APDU_CONFIRM_UNINSTALL_APP_CMD,
+	USB_WALLET_APDU_GET_WALLET_ID_CMD,
+	USB_WALLET_APDU_GET_EXTENDED_PUBKEY_CMD,
+	USB_WALLET_APDU_START_SIGN_TX_CMD,
+	USB_WALLET_APDU_CONTINUE_SIGN_TX_CMD,
+	USB_WALLET_APDU_REQUEST_SIGN_TX_CMD,
+	USB_WALLET_APDU_CONFIRM_SIGN_TX_CMD,
+	USB_WALLET_APDU_FINISH_SIGN_TX_CMD,
+	USB_WALLET_APDU_START_SIGN_MSG_CMD,
+	USB_WALLET_APDU_CONTINUE_SIGN_MSG_CMD,
+	USB_WALLET_APDU_REQUEST_SIGN_MSG_CMD,
+	USB_WALLET_APDU_FINISH_SIGN_MSG_CMD,
+	USB_WALLET_APDU_INVALID_CMD
+}tenu_twi_usb_apdu_cmds;
+
+typedef enum
+{
+	USB_WALLET_APP_IDLE_OP = 0,
+	USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP,
+	USB_WALLET_APP_SIGN_TX_OP,
+	USB_WALLET_APP_SIGN_MSG_OP,
+	USB_WALLET_APP_GET_ID_OP,
+	USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP
+}tenu_twi_usb_app_ops;
+
+typedef enum
+{
+	USB_WALLET_STATE_WAITING_TO_DISCONNECT = 0,
+	USB_WALLET_STATE_WAITING_TO_CONNECT,
+	USB_WALLET_STATE_GET_INSTALLED_APPS_INFO,
+	USB_WALLET_STATE_GET_STATUS,
+	USB_WALLET_STATE_REQUEST_OPEN_APP,
+	USB_WALLET_STATE_CONFIRM_OPEN_APP,
+	USB_WALLET_STATE_REQUEST_INSTALL_APP,
+	USB_WALLET_STATE_CONFIRM_INSTALL_APP,
+	USB_WALLET_STATE_CONTINUE_INSTALL_APP,
+	USB_WALLET_STATE_FINISH_INSTALL_APP,
+	USB_WALLET_STATE_REQUEST_UNINSTALL_APP,
+	USB_WALLET_STATE_CONFIRM_UNINSTALL_APP,
+	USB_WALLET_STATE_GET_ID,
+	USB_WALLET_STATE_GET_EXTENDED_PUBKEY,
+	USB_WALLET_STATE_START_SIGN_TX,
+	USB_WALLET_STATE_CONTINUE_SIGN_TX,
+	USB_WALLET_STATE_REQUEST_SIGN_TX,
+	USB_WALLET_STATE_CONFIRM_SIGN_TX,
+	USB_WALLET_STATE_FINISH_SIGN_TX,
+	USB_WALLET_STATE_START_SIGN_MSG,
+	USB_WALLET_STATE_CONTINUE_SIGN_MSG,
+	USB_WALLET_STATE_REQUEST_SIGN_MSG,
+	USB_WALLET_STATE_FINISH_SIGN_MSG,
+	USB_WALLET_STATE_OPEN_PORT,
+	USB_WALLET_STATE_INVALID
+}tenu_twi_usb_ops_states;
+
+/**
+ * @brief	Events the running operation waits for in its states, the statistics keep a histogram of the wait per event.
+ */
+typedef enum
+{
+	USB_WALLET_OP_STATE_CONNECTION_EVENT = 0,
+	USB_WALLET_OP_STATE_CONNECTION_FAILED_EVENT,
+	USB_WALLET_OP_STATE_DISCONNECTION_EVENT,
+	USB_WALLET_OP_STATE_DATA_RCVD_EVENT,
+	USB_WALLET_OP_STATE_SEND_FAILED_EVENT,
+	USB_WALLET_OP_STATE_TIMER_FIRED_EVENT,
+	USB_WALLET_OP_STATE_USER_CONFIRMATION_EVENT,
+	USB_IF_STATS_STATE_EVENTS_NUM
+}tenu_usb_op_state_event;
+
+typedef struct
+{
+	tenu_twi_usb_app_ops enu_cur_op;
+	tenu_twi_usb_ops_states enu_cur_state;
+	twi_bool b_skip_disconnection;
+	twi_u8 au8_verify_id[USB_WALLET_ID_LEN];
+	twi_u8 u8_verify_id_len;
+	tenu_usb_if_err enu_err_code;
+	tenu_twi_usb_coin_type enu_coin_type;
+	void* pv;
+}tstr_usb_app_op_info;
+
+/**
+ * @brief	Coin app kept open across the operations of a session.
+ */
+typedef struct
+{
+	twi_bool b_is_enabled;
+	twi_bool b_is_app_opened;
+	tenu_twi_usb_coin_type enu_coin_type;
+	twi_bool b_is_wallet_id_known;
+	twi_u8 au8_wallet_id[USB_WALLET_ID_LEN];
+	twi_bool b_is_first_apdu_replayable;		/* The first APDU went out on the session app , it is replayed once on a reopened app if the app was gone. */
+}tstr_usb_app_session;
+
+/**
+ * @brief	Statistics snapshot of a wallet interface and its stack.
+ */
+typedef struct
+{
+	tstr_twi_ll_stats str_ll;
+	tstr_twi_nl_stats str_nl;
+	twi_u32 u32_apdus_cnt;
+	twi_u32 u32_responses_cnt;
+	twi_u32 u32_apdu_timeouts_cnt;									/* Operations failed waiting for a response. */
+	twi_u32 u32_apdu_confirmations_cnt;								/* APDUs whose response waited for the user confirmation , they are not timed. */
+	twi_u32 u32_app_reopens_cnt;									/* First APDUs replayed after the session app was gone. */
+	tstr_twi_hist str_apdu_hist;									/* APDU send to its response. */
+	tstr_twi_hist astr_state_hist[USB_IF_STATS_STATE_EVENTS_NUM];	/* Wait of the running operation for each state event. */
+}tstr_usb_if_stats;
+
+typedef struct
+{
+	void* pv_device_info;
+	tstr_usb_if_in_param str_in_param;
+	tstr_stack_ctx str_stack_context;
+	tstr_usb_app_op_info str_cur_op;
+	tstr_usb_app_session str_app_session;
+	void* pv_op_queue;
+	tstr_twi_timer_wheel str_timer_wheel;		/* the stack timers, run from @ref twi_usb_if_dispatch */
+	tstr_usb_if_stats str_stats;				/* the stack layers part is only filled by @ref twi_usb_if_get_stats */
+	tstr_twi_rtt str_apdu_rtt;					/* APDU response times of the connected wallet */
+	tstr_timer_mgmt_timer str_apdu_timer;		/* fails the operation if the awaited response never comes */
+	twi_bool b_is_apdu_timed;					/* an APDU is sent and its response is awaited */
+	twi_u32 u32_apdu_sent_ms;
+	twi_u32 u32_state_since_ms;					/* time of the last state event of the running operation */
+	twi_u16 u16_vid;
+	twi_u16 u16_pid;
+	pthread_t thread;
+}tstr_usb_if_context;
+
+/*---------------------------------------------------------*/
+/*- APIs --------------------------------------------------*/
+/*---------------------------------------------------------*/
+tstr_usb_if_context* twi_usb_if_new(void);
+void twi_usb_if_free(tstr_usb_if_context* pstr_cntxt);
+
+void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
+								usb_scan_and_connect            __usb_scan_and_connect,
+								usb_disconnect                  __usb_disconnect,
+
+								usb_receive                     __usb_receive,
+								usb_stop                        __usb_stop,
+								usb_disable                     __usb_disable,
+								usb_dispatch                    __usb_dispatch,
+								usb_wake                        __usb_wake,
+								usb_send                        __usb_send,
+								usb_send_batch                  __usb_send_batch,
+
+								//General helpers
+								usb_Start_Timer                 __start_timer,
+								usb_Stop_Timer                  __stop_timer,
+								usb_send_to_cloud               __send_to_cloud,
+
+								//Upper layer's callbacks
+								usb_onUserConfirmationRequested __onUserConfirmationRequested,
+								usb_onUserConfirmationObtained  __onUserConfirmationObtained,
+								usb_onGetExtendedPubKeyResult   __onGetExtendedPubKeyResult,
+								usb_onGetExtendedPubKeysResult  __onGetExtendedPubKeysResult,
+								usb_onSignTransactionResult     __onSignTransactionResult,
+								usb_onSignMessageResult         __onSignMessageResult,
+								usb_onGetWalletIDResult         __onGetWalletIDResult,
+								usb_save                        __save,
+								usb_load                        __load,
+								usb_onConnectionDone            __onConnectionDone);
+
+void twi_usb_if_set_device_info(tstr_usb_if_context* pstr_cntxt, void* pv_dvc_info);
+void twi_usb_if_set_app_session(tstr_usb_if_context* pstr_cntxt, twi_bool b_enable);
+void twi_usb_if_set_send_window(tstr_usb_if_context* pstr_cntxt, twi_u8 u8_wnd_sz);
+void twi_usb_if_set_compression(tstr_usb_if_context* pstr_cntxt, twi_bool b_enable);
+void twi_usb_if_set_device_id(tstr_usb_if_context* pstr_cntxt, twi_u16 u16_vid, twi_u16 u16_pid);
+void twi_usb_if_set_clock(tstr_usb_if_context* pstr_cntxt, usb_get_time_ms __get_time_ms);
+twi_bool twi_usb_if_get_next_timeout(tstr_usb_if_context* pstr_cntxt, twi_u32* pu32_timeout_ms);
+void twi_usb_if_get_op_queue_stats(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_depth, twi_u8* pu8_max_depth, twi_u32* pu32_last_wait_ms, twi_u32* pu32_max_wait_ms);
+twi_u32 twi_usb_if_get_apdu_timeout(tstr_usb_if_context* pstr_cntxt, twi_u32* pu32_srtt_ms);
+void twi_usb_if_get_stats(tstr_usb_if_context* pstr_cntxt, tstr_usb_if_stats* pstr_stats);
+
+void twi_usb_if_get_ext_pub_key(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, tstr_usb_crypto_path* const pstr_path, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect);
+void twi_usb_if_get_ext_pub_keys(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, tstr_usb_crypto_path* const pastr_paths, twi_u8 u8_paths_num, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect);
+void twi_usb_if_sign_tx(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, void* const pstr_tx, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect);
+void twi_usb_if_sign_msg(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, void* const pstr_msg, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect);
+void twi_usb_if_get_wallet_id(tstr_usb_if_context* pstr_cntxt, twi_bool b_disconnect);
+
+void twi_usb_if_notify_connected(tstr_usb_if_context* pstr_cntxt, twi_s32 s32_err_code);
+void twi_usb_if_notify_disconnected(tstr_usb_if_context* pstr_cntxt, twi_u8 u8_reason, twi_s32 s32_err_code);
+void twi_usb_if_notify_send_status(tstr_usb_if_context* pstr_cntxt, twi_s32 s32_err_code);
+void twi_usb_if_notify_cloud_response(twi_u8* const pu8_data, twi_u32 u32_data_sz, twi_s32 s32_err_code);
+void twi_usb_if_notify_loaded_data(twi_u16 id, twi_u8* const pu8_data, twi_u32 u32_data_sz, twi_s32 s32_error_code);
+void twi_usb_if_notify_timer_fired(twi_u32 u32_idx, twi_s32 s32_err_code);
+void twi_usb_if_notify_data_received(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_buf, twi_u16 u16_buf_len, twi_s32 s32_err_code);
+
+void* twi_usb_if_dispatch(void* arg);
+void twi_usb_if_is_ready_to_send(tstr_usb_if_context* pstr_cntxt, twi_bool* pb_is_ready);
+void twi_usb_if_get_size(tenu_twi_usb_buff_types enu_buff_type, twi_u32* pu32_size);
+
+#endif /* __TWI_USB_WALLET_IF_H__ */
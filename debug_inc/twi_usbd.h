@@ -0,0 +1,34 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ ** @file		twi_usbd.h
+ ** @brief		This file declares the USB driver events the stack handles.
+ */
+
+#ifndef __TWI_USBD_H__
+#define __TWI_USBD_H__
+
+/*-*********************************************************/
+/*- INCLUDES ----------------------------------------------*/
+/*-*********************************************************/
+#include "twi_types.h"
+
+/*-*********************************************************/
+/*- TYPEDEFS ----------------------------------------------*/
+/*-*********************************************************/
+enum twi_usbd_events_e
+{
+	TWI_USBD_RX_DONE = 0,		/* A report is received. */
+	TWI_USBD_TX_DONE,			/* The last send is done. */
+	TWI_USBD_TX_FAIL,			/* The last send failed. */
+	TWI_USBD_PORT_OPEN,
+	TWI_USBD_PORT_CLOSE,
+	TWI_USBD_CONNECTED,
+	TWI_USBD_DISCONNECTED
+};
+
+typedef enum twi_usbd_events_e twi_usbd_events_t;
+
+#endif /* __TWI_USBD_H__ */
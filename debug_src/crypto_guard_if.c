@@ -3,6 +3,13 @@
 #include <stdlib.h>
 //#include <assert.h>
 #include <stdarg.h>
+#ifdef CRYPTO_GUARD_IF_THREADED
+#include <pthread.h>
+#include <stdint.h>
+#include <math.h>
+#include <emscripten/threading.h>
+#include <emscripten/proxying.h>
+#endif
 
 #ifdef __cplusplus
 #error
@@ -20,10 +27,30 @@ extern "C" {
 #define CHAIN_CODE_SZ         (32)
 #define COMPRESSED_PUB_KEY_SZ (33)
 #define SHARED_MEM_BUF_LEN    (256)
+#define REPORT_SZ             (64)
 #define CONNECTING            (0)
 #define CONNECTED             (1)
 #define DISCONNECTING         (2)
 #define DISCONNECTED          (3)
+#define MAX_DEVICES_NUM       (4)
+#define RX_RING_SLOTS_NUM     (16)
+#define INVALID_HANDLE        (-1)
+//returned (or given to the result callback) for a handle that is not open, the page is never left hanging on a bad one
+#define CRYPTO_GUARD_IF_ERR_INVALID_HANDLE (TWI_ERROR_BASE - 20)
+//returned by crypto_guard_if_get_stats() while the worker has not published the statistics last asked for
+#define CRYPTO_GUARD_IF_ERR_STATS_PENDING  (TWI_ERROR_BASE - 21)
+#define NO_PENDING_WORK       (-1)
+#define XPUB_CACHE_ENTRIES_NUM (16)
+#define CMD_RING_SLOTS_NUM    (64)
+//kept for the notifications, close and flush, the operations fit in the rest (MAX_DEVICES_NUM * XPUB_OPS_NUM)
+#define CMD_RING_CTRL_SLOTS_NUM (16)
+#define JS_CALL_RING_SLOTS_NUM (64)
+#define DEV_RECORDS_NUM       (8)
+#define DEV_RECORD_MAX_SZ     (16)
+//VID and PID then up to 32 bytes of serial number or product name
+#define DEV_IDENTITY_MAX_LEN  (4 + 32)
+//the running operation and the ones queued behind it
+#define XPUB_OPS_NUM          (USB_WALLET_OP_QUEUE_LEN + 1)
 
 #define FUN_OUT     TWI_LOGGER("FUN_OUT <<< %s %d\r\n",__FUNCTION__,__LINE__)
 typedef enum 
@@ -42,32 +69,217 @@ typedef struct{
   twi_s32 s32_error;
 }tsrt_op_ctx;
 
-static tstr_usb_if_context* gp_curr_ctx = NULL;
-static twi_bool gb_is_init = TWI_FALSE;
-static twi_u8* gpu8_shared_mem = NULL;
-static twi_u8 gu8_conn_state = DISCONNECTED;
-static twi_u8 gau8_rx_buff[64] = {0};
-static twi_bool gb_send_in_dispatch = TWI_FALSE;
-static twi_bool gb_hndl_rcv_data = TWI_FALSE;
-static twi_bool gb_notify_conn_in_dispatch = TWI_FALSE;
-static twi_bool gb_notify_send_status_in_dispatch = TWI_FALSE;
-static twi_s32 gs32_retval = TWI_ERROR;
-static tsrt_op_ctx gstr_send_op = {0};
-static tsrt_op_ctx gstr_rcv_op = {0};
-static tsrt_op_ctx gstr_ntfy_conn_op = {0};
-static tsrt_op_ctx gstr_ntfy_send_status_op = {0};
+//single producer (JS writes the HID input reports straight into the slots then bumps u32_head)
+//single consumer (dispatch parses the slots in place then bumps u32_tail), both indexes are free running
+typedef struct{
+  volatile twi_u32 u32_head;
+  volatile twi_u32 u32_tail;
+  twi_u32 u32_slots_num;
+  twi_u32 u32_slot_sz;
+  twi_u8 aau8_slots[RX_RING_SLOTS_NUM][REPORT_SZ];
+}tstr_crypto_guard_if_rx_ring;
+
+//one cached xpub, the key is the wallet id, the coin type and the derivation path
+typedef struct{
+  twi_bool b_valid;
+  twi_u32 u32_last_used;
+  twi_u8 au8_wallet_id[USB_WALLET_ID_LEN];
+  tenu_twi_usb_coin_type enu_coin_type;
+  tstr_usb_crypto_path str_path;
+  twi_u8 au8_xpub[USB_WALLET_PUBKEY_MAX_LEN + 1];
+}tstr_crypto_guard_if_xpub_entry;
+
+//least recently used entry is evicted first, u32_use_cnt only grows so the smallest u32_last_used is the oldest
+typedef struct{
+  twi_u32 u32_use_cnt;
+  tstr_crypto_guard_if_xpub_entry astr_entries[XPUB_CACHE_ENTRIES_NUM];
+}tstr_crypto_guard_if_xpub_cache;
+
+//one xpub request, the path is copied when it is made so the queued requests never share it
+typedef struct{
+  twi_bool b_submitted;
+  tstr_usb_crypto_path str_path;
+}tstr_crypto_guard_if_xpub_op;
+
+//one xpubs batch request with its own copy of the paths
+typedef struct{
+  twi_u8 u8_paths_num;
+  tstr_usb_crypto_path astr_paths[USB_WALLET_XPUB_BATCH_MAX_PATHS];
+}tstr_crypto_guard_if_xpubs_op;
+
+//stable identity of a wallet, given by the page with CRYPTO_GUARD_IF_CONNECTED_EVT: VID and PID (little endian) then its serial number
+//or product name. Empty when the page gives none, such a wallet keeps no records
+typedef struct{
+  twi_u8 u8_len;
+  twi_u8 au8_id[DEV_IDENTITY_MAX_LEN];
+}tstr_crypto_guard_if_dev_identity;
+
+//one record the stack keeps for a device through usb_save_cb()/usb_load_cb() (the agreed stack specs),
+//keyed by the identity of the wallet so it outlives the connection and a replugged wallet is ready right away
+typedef struct{
+  twi_bool b_valid;
+  tstr_crypto_guard_if_dev_identity str_identity;
+  twi_u16 u16_id;
+  twi_u32 u32_data_sz;
+  twi_u8 au8_data[DEV_RECORD_MAX_SZ];
+}tstr_crypto_guard_if_dev_record;
+
+//calls of the JS bridge made by the stack, the threaded build queues them for the page thread
+typedef enum 
+{
+  CRYPTO_GUARD_IF_JS_USB_SEND,
+  CRYPTO_GUARD_IF_JS_USB_SEND_BATCH,
+  CRYPTO_GUARD_IF_JS_USB_CONNECT,
+  CRYPTO_GUARD_IF_JS_USB_DISCONNECT,
+  CRYPTO_GUARD_IF_JS_CONNECTION_DONE,
+  CRYPTO_GUARD_IF_JS_XPUB_RESULT,
+  CRYPTO_GUARD_IF_JS_XPUBS_RESULT,
+  CRYPTO_GUARD_IF_JS_SIGN_TX_RESULT,
+  CRYPTO_GUARD_IF_JS_SIGN_MSG_RESULT,
+}
+tenum_crypto_guard_if_js_call;
+
+typedef struct{
+  tenum_crypto_guard_if_js_call enum_call;
+  twi_s32 s32_handle;
+  twi_u8* pu8_data;
+  twi_u32 u32_data_len;
+  twi_u32 u32_num;
+  twi_s32 s32_error;
+  twi_bool b_free_data;
+  //small payloads travel inside the slot, NUL terminated so the xpub strings stay strings
+  twi_u8 au8_data[SHARED_MEM_BUF_LEN];
+}tstr_crypto_guard_if_js_call;
+
+//calls of the exported APIs, the threaded build queues them for the worker running the stack
+typedef enum 
+{
+  CRYPTO_GUARD_IF_CMD_GET_XPUB,
+  CRYPTO_GUARD_IF_CMD_GET_XPUBS,
+  CRYPTO_GUARD_IF_CMD_SIGN_TX,
+  CRYPTO_GUARD_IF_CMD_SIGN_MSG,
+  CRYPTO_GUARD_IF_CMD_NOTIFY,
+  CRYPTO_GUARD_IF_CMD_CLOSE,
+  CRYPTO_GUARD_IF_CMD_FLUSH_XPUB_CACHE,
+  CRYPTO_GUARD_IF_CMD_PUBLISH_STATS,
+}
+tenum_crypto_guard_if_cmd;
+
+typedef struct{
+  tenum_crypto_guard_if_cmd enum_cmd;
+  twi_s32 s32_handle;
+  //arguments built by the API, copied to the heap when the command is queued
+  void* pv_args;
+  twi_u32 u32_args_sz;
+  //caller owned buffer, handed as is
+  twi_u8* pu8_data;
+  twi_u32 u32_data_len;
+  twi_s32 s32_arg;
+  twi_u32 u32_num;
+  twi_s32 s32_error;
+}tstr_crypto_guard_if_cmd;
+
+#ifdef CRYPTO_GUARD_IF_THREADED
+//single producer (page thread) single consumer (worker), free running indexes like the RX ring
+typedef struct{
+  volatile twi_u32 u32_head;
+  volatile twi_u32 u32_tail;
+  tstr_crypto_guard_if_cmd astr_slots[CMD_RING_SLOTS_NUM];
+}tstr_crypto_guard_if_cmd_ring;
+
+//single producer (worker) single consumer (page thread)
+typedef struct{
+  volatile twi_u32 u32_head;
+  volatile twi_u32 u32_tail;
+  tstr_crypto_guard_if_js_call astr_slots[JS_CALL_RING_SLOTS_NUM];
+}tstr_crypto_guard_if_js_call_ring;
+#endif
+
+//one entry per opened wallet, the entry itself is the device info handed to the USB IF so every callback knows its device
+typedef struct{
+  twi_bool b_in_use;
+  //set by crypto_guard_if_close() until the context is freed, the handle is not reused meanwhile
+  twi_bool b_closing;
+  twi_s32 s32_handle;
+  twi_u32 u32_dev_id;
+  tstr_crypto_guard_if_dev_identity str_identity;
+  tstr_usb_if_context* p_ctx;
+  twi_u8 u8_conn_state;
+  twi_u8 au8_shared_mem[SHARED_MEM_BUF_LEN];
+  tstr_crypto_guard_if_rx_ring str_rx_ring;
+  twi_bool b_notify_conn_in_dispatch;
+  twi_bool b_notify_send_status_in_dispatch;
+  tsrt_op_ctx str_ntfy_send_status_op;
+  twi_bool b_in_dispatch;
+  twi_bool b_dispatch_requested;
+  twi_bool b_work_pending;
+  //the wallet id is read once per connection before the first xpub so the cache can be used for that wallet
+  twi_bool b_wallet_id_valid;
+  twi_bool b_wallet_id_seen;
+  twi_u8 au8_wallet_id[USB_WALLET_ID_LEN];
+  twi_bool b_xpub_after_wallet_id;
+  twi_bool b_xpub_in_dispatch;
+  //xpub requests in the order the wallet IF answers them, the single ones and the batches are queued at different priorities
+  //so they are kept apart, an entry is removed when its result comes back
+  tstr_crypto_guard_if_xpub_op astr_xpub_ops[XPUB_OPS_NUM];
+  twi_u8 u8_xpub_ops_num;
+  tstr_crypto_guard_if_xpubs_op astr_xpubs_ops[XPUB_OPS_NUM];
+  twi_u8 u8_xpubs_ops_num;
+  //entry being handed to the wallet IF, a result given back right away (the queue is full) belongs to it, -1 otherwise
+  int xpub_submit_idx;
+  int xpubs_submit_idx;
+  //stack statistics as of the last crypto_guard_if_request_stats() the worker ran, kept after the context is freed,
+  //odd sequence while the worker writes them
+  volatile twi_u32 u32_stats_seq;
+  tstr_usb_if_stats str_stats;
+  //number of the last request asked by the page thread and of the one the published statistics answer,
+  //they differ while a CRYPTO_GUARD_IF_CMD_PUBLISH_STATS is queued so no other one is queued
+  volatile twi_u32 u32_stats_requested;
+  volatile twi_u32 u32_stats_published;
+#ifdef CRYPTO_GUARD_IF_THREADED
+  //page thread copy of the data handed to the JS calls, usbSend() may read it after an await
+  twi_u8 au8_js_mem[SHARED_MEM_BUF_LEN];
+#endif
+}tstr_crypto_guard_if_dev;
+
+static tstr_crypto_guard_if_dev gastr_devs[MAX_DEVICES_NUM] = {0};
+static tstr_crypto_guard_if_xpub_cache gstr_xpub_cache = {0};
+//only used by the stack, so from the worker in the threaded build
+static tstr_crypto_guard_if_dev_record gastr_dev_records[DEV_RECORDS_NUM] = {0};
+static twi_u32 gu32_dev_records_next = 0;
+#ifdef CRYPTO_GUARD_IF_THREADED
+static tstr_crypto_guard_if_cmd_ring gstr_cmd_ring = {0};
+static tstr_crypto_guard_if_js_call_ring gstr_js_call_ring = {0};
+//bumped for every command and RX report, the worker sleeps on it
+static volatile twi_u32 gu32_worker_wake_seq = 0;
+//one requestDispatch() is pending at most until the page thread runs the queued JS calls
+static volatile twi_u32 gu32_js_dispatch_requested = 0;
+static twi_bool gb_worker_started = TWI_FALSE;
+static pthread_t gs_worker_thread;
+#endif
 /////////////////////////////////////////////////////////////////////////
 ///////////////////////////JS Helpers///////////////////////////////////
 extern char* consoleLog(char* data);
 //extern twi_u8* allocateOnMemory(twi_u32 data_len);
-extern void usbSend(twi_u8* pu8_data, twi_u32 data_len);
-extern void usbConnect(void);
-extern void usbDisconnect(void);
-extern void onConnectionDone(void);
-extern void onGetXpubResult(void* xpub, twi_s32 error_code); //in this function the bridge should notify the kyring with the operation result
+//all the JS helpers take the device handle returned by crypto_guard_if_open() as first argument
+extern void usbSend(twi_s32 handle, twi_u8* pu8_data, twi_u32 data_len);
+//hands reports_num contiguous REPORT_SZ reports to WebHID and answers with a single CRYPTO_GUARD_IF_SEND_STATUS_EVT
+extern void usbSendBatch(twi_s32 handle, twi_u8* pu8_reports, twi_u32 reports_num);
+extern void usbConnect(twi_s32 handle);
+extern void usbDisconnect(twi_s32 handle);
+extern void onConnectionDone(twi_s32 handle);
+//asks the bridge to call crypto_guard_if_dispatch() as soon as possible, it is called once until that dispatch runs
+extern void requestDispatch(twi_s32 handle);
+//in the threaded build the stack runs on a worker: the helpers above and below are only called from the page thread,
+//consoleLog() and curTime() are called from the worker as well
+//milliseconds clock, only differences between two readings are used
+extern twi_u32 curTime(void);
+extern void onGetXpubResult(twi_s32 handle, void* xpub, twi_s32 error_code); //in this function the bridge should notify the kyring with the operation result
+//xpubs holds xpubs_num records of [xpub length (1 byte)][xpub string] in the requested paths order, xpubs_sz bytes in total
+extern void onGetXpubsResult(twi_s32 handle, twi_u8* xpubs, twi_u32 xpubs_sz, twi_u32 xpubs_num, twi_s32 error_code);
 //extern void onSignTxResult(twi_u32 v_off, twi_u32 v_len, twi_u32 r_off, twi_u32 r_len, twi_u32 s_off, twi_u32 s_len, twi_s32 error_code); //in this function the bridge should notify the kyring with the operation result
-extern void onSignTxResult(twi_u8 v_off, twi_u8* r, twi_u8* s, twi_s32 error_code);
-extern void onSignMsgResult(twi_u8 v_off, twi_u8* r, twi_u8* s, twi_s32 error_code);
+extern void onSignTxResult(twi_s32 handle, twi_u8 v_off, twi_u8* r, twi_u8* s, twi_s32 error_code);
+extern void onSignMsgResult(twi_s32 handle, twi_u8 v_off, twi_u8* r, twi_u8* s, twi_s32 error_code);
 /////////////////////////////////////////////////////////////////////////
 void web_printf(const twi_u8* pu8_prnt_msg, ...)
 {
@@ -80,33 +292,336 @@ void web_printf(const twi_u8* pu8_prnt_msg, ...)
 }
 /////////////////////////////////////////////////////////////////////////
 ///////////////////////////Static functions//////////////////////////////
+//NULL when the handle comes from the page but is not open (or was closed since)
+static tstr_crypto_guard_if_dev* crypto_guard_if_get_dev(twi_s32 s32_handle)
+{
+  tstr_crypto_guard_if_dev* pstr_dev = NULL;
+  if((s32_handle >= 0) && (s32_handle < MAX_DEVICES_NUM) && (TWI_TRUE == __atomic_load_n(&gastr_devs[s32_handle].b_in_use, __ATOMIC_ACQUIRE)))
+  {
+    pstr_dev = &gastr_devs[s32_handle];
+  }
+  return pstr_dev;
+}
+
+static void crypto_guard_if_wake(tstr_crypto_guard_if_dev* pstr_dev)
+{
+  pstr_dev->b_work_pending = TWI_TRUE;
+#ifndef CRYPTO_GUARD_IF_THREADED
+  //a wake raised by the dispatch itself is reported through its return value
+  if((TWI_TRUE != pstr_dev->b_in_dispatch) && (TWI_TRUE != pstr_dev->b_dispatch_requested))
+  {
+    pstr_dev->b_dispatch_requested = TWI_TRUE;
+    requestDispatch(pstr_dev->s32_handle);
+  }
+#else
+  //wakes only come from the worker itself, its loop dispatches again before sleeping
+#endif
+}
+
+static void crypto_guard_if_js_run(tstr_crypto_guard_if_js_call* pstr_call)
+{
+  twi_u8* pu8_data = pstr_call->pu8_data;
+  switch(pstr_call->enum_call)
+  {
+    case CRYPTO_GUARD_IF_JS_USB_SEND:
+    {
+      usbSend(pstr_call->s32_handle, pu8_data, pstr_call->u32_data_len);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_USB_SEND_BATCH:
+    {
+      usbSendBatch(pstr_call->s32_handle, pu8_data, pstr_call->u32_num);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_USB_CONNECT:
+    {
+      usbConnect(pstr_call->s32_handle);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_USB_DISCONNECT:
+    {
+      usbDisconnect(pstr_call->s32_handle);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_CONNECTION_DONE:
+    {
+      onConnectionDone(pstr_call->s32_handle);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_XPUB_RESULT:
+    {
+      onGetXpubResult(pstr_call->s32_handle, pu8_data, pstr_call->s32_error);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_XPUBS_RESULT:
+    {
+      onGetXpubsResult(pstr_call->s32_handle, pu8_data, pstr_call->u32_data_len, pstr_call->u32_num, pstr_call->s32_error);
+      break;
+    }
+
+    //[v][r (32)][s (32)]
+    case CRYPTO_GUARD_IF_JS_SIGN_TX_RESULT:
+    {
+      onSignTxResult(pstr_call->s32_handle, pu8_data[0], &pu8_data[1], &pu8_data[33], pstr_call->s32_error);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_JS_SIGN_MSG_RESULT:
+    {
+      onSignMsgResult(pstr_call->s32_handle, pu8_data[0], &pu8_data[1], &pu8_data[33], pstr_call->s32_error);
+      break;
+    }
+
+    default:
+    {
+      TWI_LOGGER_ERR("Invalid JS call\r\n");
+      TWI_ASSERT(TWI_FALSE);
+    }
+  }
+}
+
+#ifdef CRYPTO_GUARD_IF_THREADED
+static void crypto_guard_if_js_request_dispatch(void* pv_handle)
+{
+  requestDispatch((twi_s32)(intptr_t)pv_handle);
+}
+
+//page thread side, runs the JS calls queued by the worker
+static void crypto_guard_if_js_drain(void)
+{
+  tstr_crypto_guard_if_js_call_ring* pstr_ring = &gstr_js_call_ring;
+  twi_u32 u32_tail = pstr_ring->u32_tail;
+
+  while(u32_tail != __atomic_load_n(&pstr_ring->u32_head, __ATOMIC_ACQUIRE))
+  {
+    tstr_crypto_guard_if_js_call* pstr_call = &pstr_ring->astr_slots[u32_tail % JS_CALL_RING_SLOTS_NUM];
+    if(pstr_call->pu8_data == pstr_call->au8_data)
+    {
+      //the slot is reused once released, the JS side gets a per device copy that lives until the next call
+      twi_u8* pu8_js_mem = gastr_devs[pstr_call->s32_handle].au8_js_mem;
+      TWI_MEMCPY(pu8_js_mem, pstr_call->au8_data, (pstr_call->u32_data_len < SHARED_MEM_BUF_LEN)? (pstr_call->u32_data_len + 1) : SHARED_MEM_BUF_LEN);
+      pstr_call->pu8_data = pu8_js_mem;
+    }
+    crypto_guard_if_js_run(pstr_call);
+    if(TWI_TRUE == pstr_call->b_free_data)
+    {
+      free(pstr_call->pu8_data);
+    }
+    u32_tail++;
+    __atomic_store_n(&pstr_ring->u32_tail, u32_tail, __ATOMIC_RELEASE);
+  }
+}
+#endif
+
+//every call of the JS bridge made on behalf of the stack goes through here
+static void crypto_guard_if_js_post(tenum_crypto_guard_if_js_call enum_call, twi_s32 s32_handle, twi_u8* pu8_data, twi_u32 u32_data_len, twi_u32 u32_num, twi_s32 s32_error)
+{
+#ifdef CRYPTO_GUARD_IF_THREADED
+  tstr_crypto_guard_if_js_call_ring* pstr_ring = &gstr_js_call_ring;
+  twi_u32 u32_head = pstr_ring->u32_head;
+  twi_u32 u32_tail = __atomic_load_n(&pstr_ring->u32_tail, __ATOMIC_ACQUIRE);
+
+  //the worker waits for the page thread to make room, no call is dropped
+  while((u32_head - u32_tail) >= JS_CALL_RING_SLOTS_NUM)
+  {
+    emscripten_futex_wait(&pstr_ring->u32_tail, u32_tail, 1);
+    u32_tail = __atomic_load_n(&pstr_ring->u32_tail, __ATOMIC_ACQUIRE);
+  }
+
+  tstr_crypto_guard_if_js_call* pstr_call = &pstr_ring->astr_slots[u32_head % JS_CALL_RING_SLOTS_NUM];
+  pstr_call->enum_call = enum_call;
+  pstr_call->s32_handle = s32_handle;
+  pstr_call->pu8_data = pu8_data;
+  pstr_call->u32_data_len = u32_data_len;
+  pstr_call->u32_num = u32_num;
+  pstr_call->s32_error = s32_error;
+  pstr_call->b_free_data = TWI_FALSE;
+  //the batch reports stay in the link layer buffer until the send status, any other buffer may be reused once this returns
+  if((NULL != pu8_data) && (CRYPTO_GUARD_IF_JS_USB_SEND_BATCH != enum_call))
+  {
+    if(u32_data_len < SHARED_MEM_BUF_LEN)
+    {
+      TWI_MEMCPY(pstr_call->au8_data, pu8_data, u32_data_len);
+      pstr_call->au8_data[u32_data_len] = 0;
+      pstr_call->pu8_data = pstr_call->au8_data;
+    }
+    else
+    {
+      pstr_call->pu8_data = malloc(u32_data_len);
+      TWI_ASSERT(NULL != pstr_call->pu8_data);
+      TWI_MEMCPY(pstr_call->pu8_data, pu8_data, u32_data_len);
+      pstr_call->b_free_data = TWI_TRUE;
+    }
+  }
+  __atomic_store_n(&pstr_ring->u32_head, u32_head + 1, __ATOMIC_RELEASE);
+
+  if(0 == __atomic_exchange_n(&gu32_js_dispatch_requested, 1, __ATOMIC_ACQ_REL))
+  {
+    emscripten_proxy_async(emscripten_proxy_get_system_queue(), emscripten_main_runtime_thread_id(), crypto_guard_if_js_request_dispatch, (void*)(intptr_t)s32_handle);
+  }
+#else
+  tstr_crypto_guard_if_js_call str_call;
+  str_call.enum_call = enum_call;
+  str_call.s32_handle = s32_handle;
+  str_call.pu8_data = pu8_data;
+  str_call.u32_data_len = u32_data_len;
+  str_call.u32_num = u32_num;
+  str_call.s32_error = s32_error;
+  str_call.b_free_data = TWI_FALSE;
+  crypto_guard_if_js_run(&str_call);
+#endif
+}
+
+static tstr_crypto_guard_if_xpub_entry* crypto_guard_if_xpub_cache_find(const twi_u8* pu8_wallet_id, tenu_twi_usb_coin_type enu_coin_type, const tstr_usb_crypto_path* pstr_path)
+{
+  tstr_crypto_guard_if_xpub_entry* pstr_found = NULL;
+  for(int i = 0; (i < XPUB_CACHE_ENTRIES_NUM) && (NULL == pstr_found); i++)
+  {
+    tstr_crypto_guard_if_xpub_entry* pstr_entry = &gstr_xpub_cache.astr_entries[i];
+    if((TWI_TRUE == pstr_entry->b_valid) && (enu_coin_type == pstr_entry->enu_coin_type) &&
+       (pstr_path->u8_steps_num == pstr_entry->str_path.u8_steps_num) &&
+       (0 == TWI_MEMCMP(pstr_path->au32_path_steps, pstr_entry->str_path.au32_path_steps, pstr_path->u8_steps_num * sizeof(twi_u32))) &&
+       (0 == TWI_MEMCMP(pu8_wallet_id, pstr_entry->au8_wallet_id, USB_WALLET_ID_LEN)))
+    {
+      pstr_found = pstr_entry;
+    }
+  }
+  return pstr_found;
+}
+
+static void crypto_guard_if_xpub_cache_add(const twi_u8* pu8_wallet_id, tenu_twi_usb_coin_type enu_coin_type, const tstr_usb_crypto_path* pstr_path, const twi_u8* pu8_xpub, twi_u32 u32_xpub_sz)
+{
+  tstr_crypto_guard_if_xpub_entry* pstr_entry = crypto_guard_if_xpub_cache_find(pu8_wallet_id, enu_coin_type, pstr_path);
+  if((NULL != pu8_xpub) && (u32_xpub_sz <= USB_WALLET_PUBKEY_MAX_LEN))
+  {
+    //pick a free entry or evict the least recently used one
+    if(NULL == pstr_entry)
+    {
+      //free entries have u32_last_used = 0 so they are picked before any used one
+      pstr_entry = &gstr_xpub_cache.astr_entries[0];
+      for(int i = 1; i < XPUB_CACHE_ENTRIES_NUM; i++)
+      {
+        if(gstr_xpub_cache.astr_entries[i].u32_last_used < pstr_entry->u32_last_used)
+        {
+          pstr_entry = &gstr_xpub_cache.astr_entries[i];
+        }
+      }
+    }
+    TWI_MEMSET(pstr_entry, 0, sizeof(tstr_crypto_guard_if_xpub_entry));
+    TWI_MEMCPY(pstr_entry->au8_wallet_id, pu8_wallet_id, USB_WALLET_ID_LEN);
+    pstr_entry->enu_coin_type = enu_coin_type;
+    TWI_MEMCPY(&pstr_entry->str_path, pstr_path, sizeof(tstr_usb_crypto_path));
+    //kept NUL terminated, the bridge reads it as a string
+    TWI_MEMCPY(pstr_entry->au8_xpub, pu8_xpub, u32_xpub_sz);
+    pstr_entry->u32_last_used = ++gstr_xpub_cache.u32_use_cnt;
+    pstr_entry->b_valid = TWI_TRUE;
+  }
+}
+
+//drops the xpubs of one wallet only, the other handles may still be using theirs
+static void crypto_guard_if_xpub_cache_flush(const twi_u8* pu8_wallet_id)
+{
+  for(int i = 0; i < XPUB_CACHE_ENTRIES_NUM; i++)
+  {
+    tstr_crypto_guard_if_xpub_entry* pstr_entry = &gstr_xpub_cache.astr_entries[i];
+    if((TWI_TRUE == pstr_entry->b_valid) && (0 == TWI_MEMCMP(pu8_wallet_id, pstr_entry->au8_wallet_id, USB_WALLET_ID_LEN)))
+    {
+      TWI_MEMSET(pstr_entry, 0, sizeof(tstr_crypto_guard_if_xpub_entry));
+    }
+  }
+}
+
+static void crypto_guard_if_xpub_op_remove(tstr_crypto_guard_if_dev* pstr_dev, int idx)
+{
+  TWI_ASSERT(idx < pstr_dev->u8_xpub_ops_num);
+  pstr_dev->u8_xpub_ops_num--;
+  memmove(&pstr_dev->astr_xpub_ops[idx], &pstr_dev->astr_xpub_ops[idx + 1], (pstr_dev->u8_xpub_ops_num - idx) * sizeof(tstr_crypto_guard_if_xpub_op));
+}
+
+static void crypto_guard_if_xpubs_op_remove(tstr_crypto_guard_if_dev* pstr_dev, int idx)
+{
+  TWI_ASSERT(idx < pstr_dev->u8_xpubs_ops_num);
+  pstr_dev->u8_xpubs_ops_num--;
+  memmove(&pstr_dev->astr_xpubs_ops[idx], &pstr_dev->astr_xpubs_ops[idx + 1], (pstr_dev->u8_xpubs_ops_num - idx) * sizeof(tstr_crypto_guard_if_xpubs_op));
+}
+
+//hands the xpub requests not submitted yet to the wallet IF in order, the oldest request is served from the cache when it holds its path
+//(a later one would overtake the requests still running on the device)
+static void crypto_guard_if_xpub_request(tstr_crypto_guard_if_dev* pstr_dev)
+{
+  int idx = 0;
+  while(idx < pstr_dev->u8_xpub_ops_num)
+  {
+    tstr_crypto_guard_if_xpub_op* pstr_op = &pstr_dev->astr_xpub_ops[idx];
+    tstr_crypto_guard_if_xpub_entry* pstr_entry = NULL;
+    if(TWI_TRUE == pstr_op->b_submitted)
+    {
+      idx++;
+      continue;
+    }
+
+    if((0 == idx) && (TWI_TRUE == pstr_dev->b_wallet_id_valid))
+    {
+      pstr_entry = crypto_guard_if_xpub_cache_find(pstr_dev->au8_wallet_id, USB_WALLET_COIN_ETHEREUM, &pstr_op->str_path);
+    }
+
+    if(NULL != pstr_entry)
+    {
+      TWI_LOGGER("XPUB cache hit\r\n");
+      pstr_entry->u32_last_used = ++gstr_xpub_cache.u32_use_cnt;
+      crypto_guard_if_xpub_op_remove(pstr_dev, idx);
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUB_RESULT, pstr_dev->s32_handle, pstr_entry->au8_xpub, twi_strlen(pstr_entry->au8_xpub), 0, TWI_SUCCESS);
+    }
+    else
+    {
+      //the wallet IF may complete the path, the requested one stays the cache key
+      tstr_usb_crypto_path str_usb_crypto_path;
+      twi_u8 u8_ops_num = pstr_dev->u8_xpub_ops_num;
+      TWI_MEMCPY(&str_usb_crypto_path, &pstr_op->str_path, sizeof(tstr_usb_crypto_path));
+      pstr_op->b_submitted = TWI_TRUE;
+      pstr_dev->xpub_submit_idx = idx;
+      twi_usb_if_get_ext_pub_key(pstr_dev->p_ctx, USB_WALLET_COIN_ETHEREUM, &str_usb_crypto_path, NULL, 0, TWI_FALSE);
+      pstr_dev->xpub_submit_idx = -1;
+      //a refused request is already answered and removed
+      if(u8_ops_num == pstr_dev->u8_xpub_ops_num)
+      {
+        idx++;
+      }
+    }
+  }
+}
+
 static void usb_scan_and_connect_cb(void* const pv_device, twi_u8* pu8_dvc_id, twi_u8 u8_dvc_id_len, twi_u16 u16_vid, twi_u16 u16_pid, twi_u32 u32_scan_time_out_msec, twi_u32 u32_mtu_sz)
 {
   FUN_IN;
-  usbConnect();
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_CONNECT, pstr_dev->s32_handle, NULL, 0, 0, TWI_SUCCESS);
 }
 
 static void usb_disconnect_cb(void* const pv_device)
 {
   FUN_IN;
-  gu8_conn_state = DISCONNECTING;
-  TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-  gpu8_shared_mem[0] = 0x80; //close port
-  // gb_send_in_dispatch = TWI_TRUE;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  pstr_dev->u8_conn_state = DISCONNECTING;
+  TWI_MEMSET(pstr_dev->au8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
+  pstr_dev->au8_shared_mem[0] = 0x80; //close port
 
   TWI_LOGGER("Handle send \r\n");
-  TWI_ASSERT(NULL != gpu8_shared_mem);
-  usbSend(gpu8_shared_mem, 64);
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_SEND, pstr_dev->s32_handle, pstr_dev->au8_shared_mem, REPORT_SZ, 0, TWI_SUCCESS);
 
   //usbDisconnect();
 }
 
 static void usb_receive_cb(void* const pv_device, void *p_rx_buf, twi_u32* pu32_length)
 {
-  // FUN_IN;
-  *pu32_length = gau8_rx_buff[0]; 
-  TWI_MEMCPY(p_rx_buf, &gau8_rx_buff[1], *pu32_length);
-  // FUN_OUT;
+  //the reports are always handed to twi_usb_if_notify_data_received() and the link layer parses them in place
+  *pu32_length = 0;
 }
 
 static void usb_stop_cb(void* const pv_device)
@@ -124,30 +639,40 @@ static void usb_dispatch_cb(void* const pv_device)
   //FUN_IN;
 }
 
+static void usb_wake_cb(void* const pv_device)
+{
+  crypto_guard_if_wake((tstr_crypto_guard_if_dev*)pv_device);
+}
+
 static void usb_send_cb(void* const pv_device, twi_u8* const pu8_data, twi_u32 u32_data_sz)
 {
   //allocate or copy to the JS bufefr
   // FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
   TWI_LOGGER("Send Buffer::\r\n");
   // for(int i =0; i<u32_data_sz; i++)
   // {
   //   TWI_LOGGER("%d",pu8_data[i]);
   // }
   // TWI_LOGGER("\r\n");
-  TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-  gpu8_shared_mem[0] = 0x0; //supported port
-  gpu8_shared_mem[0] = u32_data_sz & 0x3f;
-  TWI_MEMCPY(&gpu8_shared_mem[1], pu8_data, u32_data_sz);
-  // TWI_ASSERT(gb_send_in_dispatch != TWI_TRUE);
-  // gb_send_in_dispatch = TWI_TRUE;
+  TWI_MEMSET(pstr_dev->au8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
+  pstr_dev->au8_shared_mem[0] = u32_data_sz & 0x3f;
+  TWI_MEMCPY(&pstr_dev->au8_shared_mem[1], pu8_data, u32_data_sz);
 
   TWI_LOGGER("Handle send \r\n");
-  TWI_ASSERT(NULL != gpu8_shared_mem);
-  usbSend(gpu8_shared_mem, 64);
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_SEND, pstr_dev->s32_handle, pstr_dev->au8_shared_mem, REPORT_SZ, 0, TWI_SUCCESS);
 
   // FUN_OUT;
 }
 
+static void usb_send_batch_cb(void* const pv_device, twi_u8* const pu8_reports, twi_u32 u32_reports_num)
+{
+  //the link layer already framed every report, they are read straight from its buffer until the send status comes back
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  TWI_LOGGER("Handle send batch, reports = %d\r\n", u32_reports_num);
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_SEND_BATCH, pstr_dev->s32_handle, pu8_reports, u32_reports_num * REPORT_SZ, u32_reports_num, TWI_SUCCESS);
+}
+
 static void usb_Start_Timer_cb(void* const pv_device, twi_u32 u32_idx, twi_u32 u32_dur_msec)
 {
   FUN_IN;
@@ -178,82 +703,212 @@ static void usb_onGetExtendedPubKeyResult_cb(void* const pv_device, twi_u8* cons
 {
   //map the buffers
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
   TWI_LOGGER("public_key = %d, error = %d \r\n", u32_pub_key_sz, s32_err);
   // for(int i =0; i<u32_pub_key_sz; i++)
   // {
   //    TWI_LOGGER("%d", pu8_pub_key[i]);
   // }
   TWI_LOGGER("XPUB = %s\r\n", pu8_pub_key);
-  // if(s32_err == 0)
-  // {
-  //   TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-  //   TWI_MEMCPY(gpu8_shared_mem,  &pu8_pub_key[CHAIN_CODE_IDX], CHAIN_CODE_SZ);
-  //   TWI_MEMCPY(&((twi_u8*)gpu8_shared_mem)[CHAIN_CODE_SZ],  &pu8_pub_key[CHAIN_CODE_IDX + CHAIN_CODE_SZ], COMPRESSED_PUB_KEY_SZ);
-  // }
-  onGetXpubResult(pu8_pub_key, s32_err);
+  //the results come back in the requests order, except a request refused while it is submitted
+  int idx = (-1 != pstr_dev->xpub_submit_idx)? pstr_dev->xpub_submit_idx : 0;
+  if(idx < pstr_dev->u8_xpub_ops_num)
+  {
+    if((0 == s32_err) && (TWI_TRUE == pstr_dev->b_wallet_id_valid))
+    {
+      crypto_guard_if_xpub_cache_add(pstr_dev->au8_wallet_id, USB_WALLET_COIN_ETHEREUM, &pstr_dev->astr_xpub_ops[idx].str_path, pu8_pub_key, u32_pub_key_sz);
+    }
+    crypto_guard_if_xpub_op_remove(pstr_dev, idx);
+  }
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUB_RESULT, pstr_dev->s32_handle, pu8_pub_key, (NULL != pu8_pub_key)? u32_pub_key_sz : 0, 0, s32_err);
+  FUN_OUT;
+}
+
+static void usb_onGetExtendedPubKeysResult_cb(void* const pv_device, twi_u8* const pu8_pub_keys, twi_u32 u32_pub_keys_sz, twi_u8 u8_pub_keys_num, twi_s32 s32_err)
+{
+  FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  TWI_LOGGER("public_keys = %d, size = %d, error = %d \r\n", u8_pub_keys_num, u32_pub_keys_sz, s32_err);
+  int idx = (-1 != pstr_dev->xpubs_submit_idx)? pstr_dev->xpubs_submit_idx : 0;
+  if(idx < pstr_dev->u8_xpubs_ops_num)
+  {
+    tstr_crypto_guard_if_xpubs_op* pstr_op = &pstr_dev->astr_xpubs_ops[idx];
+    //the keys received before a failure are good as well, they are cached too
+    if((TWI_TRUE == pstr_dev->b_wallet_id_valid) && (NULL != pu8_pub_keys))
+    {
+      twi_u32 u32_offset = 0;
+      for(int i = 0; (i < u8_pub_keys_num) && (i < pstr_op->u8_paths_num) && (u32_offset < u32_pub_keys_sz); i++)
+      {
+        crypto_guard_if_xpub_cache_add(pstr_dev->au8_wallet_id, USB_WALLET_COIN_ETHEREUM, &pstr_op->astr_paths[i], &pu8_pub_keys[u32_offset + 1], pu8_pub_keys[u32_offset]);
+        u32_offset += 1 + pu8_pub_keys[u32_offset];
+      }
+    }
+    crypto_guard_if_xpubs_op_remove(pstr_dev, idx);
+  }
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUBS_RESULT, pstr_dev->s32_handle, pu8_pub_keys, (NULL != pu8_pub_keys)? u32_pub_keys_sz : 0, u8_pub_keys_num, s32_err);
   FUN_OUT;
 }
 
 static void usb_onSignTransactionResult_cb(void* const pv_device, void* pstr_signed_tx, twi_s32 s32_err)
 {
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
   tstr_usb_ethereum_signed_tx* pstr_sign_tx = (tstr_usb_ethereum_signed_tx*)pstr_signed_tx;
-  TWI_ASSERT(NULL != gpu8_shared_mem);
+  twi_u8* pu8_shared_mem = pstr_dev->au8_shared_mem;
 
   if(s32_err == 0)
   {
-    TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-    gpu8_shared_mem[0] = pstr_sign_tx->u8_sig_v;
-    TWI_MEMCPY(&gpu8_shared_mem[1], pstr_sign_tx->au8_sig_r, 32);
-    TWI_MEMCPY(&gpu8_shared_mem[33], pstr_sign_tx->au8_sig_s, 32);
+    TWI_MEMSET(pu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
+    pu8_shared_mem[0] = pstr_sign_tx->u8_sig_v;
+    TWI_MEMCPY(&pu8_shared_mem[1], pstr_sign_tx->au8_sig_r, 32);
+    TWI_MEMCPY(&pu8_shared_mem[33], pstr_sign_tx->au8_sig_s, 32);
   }
-  onSignTxResult(gpu8_shared_mem[0],&gpu8_shared_mem[1], &gpu8_shared_mem[33], s32_err);
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_SIGN_TX_RESULT, pstr_dev->s32_handle, pu8_shared_mem, 1 + 32 + 32, 0, s32_err);
   FUN_OUT;
 }
 
 static void usb_onSignMessageResult_cb(void* const pv_device, void* pstr_signed_msg, twi_s32 s32_err)
 {
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
   tstr_usb_ethereum_signed_msg* pstr_sign_msg = (tstr_usb_ethereum_signed_msg*)pstr_signed_msg;
-  TWI_ASSERT(NULL != gpu8_shared_mem);
+  twi_u8* pu8_shared_mem = pstr_dev->au8_shared_mem;
+
   if(s32_err == 0)
   {
-    TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-    gpu8_shared_mem[0] = pstr_sign_msg->u8_sig_v;
-    TWI_MEMCPY(&gpu8_shared_mem[1], pstr_sign_msg->au8_sig_r, 32);
-    TWI_MEMCPY(&gpu8_shared_mem[33], pstr_sign_msg->au8_sig_s, 32);
+    TWI_MEMSET(pu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
+    pu8_shared_mem[0] = pstr_sign_msg->u8_sig_v;
+    TWI_MEMCPY(&pu8_shared_mem[1], pstr_sign_msg->au8_sig_r, 32);
+    TWI_MEMCPY(&pu8_shared_mem[33], pstr_sign_msg->au8_sig_s, 32);
   }
-  onSignMsgResult(gpu8_shared_mem[0],&gpu8_shared_mem[1], &gpu8_shared_mem[33], s32_err);
+  crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_SIGN_MSG_RESULT, pstr_dev->s32_handle, pu8_shared_mem, 1 + 32 + 32, 0, s32_err);
   FUN_OUT;
 }
 
 static void usb_onGetWalletIDResult_cb(void* const pv_device, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_s32 s32_err)
 {
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  if((0 == s32_err) && (USB_WALLET_ID_LEN == u8_wallet_id_len))
+  {
+    //another wallet behind this handle, the xpubs cached for the previous one are not trusted anymore
+    if((TWI_TRUE == pstr_dev->b_wallet_id_seen) && (0 != TWI_MEMCMP(pstr_dev->au8_wallet_id, pu8_wallet_id, USB_WALLET_ID_LEN)))
+    {
+      TWI_LOGGER("Wallet ID changed, flush its XPUB cache entries\r\n");
+      crypto_guard_if_xpub_cache_flush(pstr_dev->au8_wallet_id);
+    }
+    TWI_MEMCPY(pstr_dev->au8_wallet_id, pu8_wallet_id, USB_WALLET_ID_LEN);
+    pstr_dev->b_wallet_id_seen = TWI_TRUE;
+    pstr_dev->b_wallet_id_valid = TWI_TRUE;
+  }
+
+  if(TWI_TRUE == pstr_dev->b_xpub_after_wallet_id)
+  {
+    pstr_dev->b_xpub_after_wallet_id = TWI_FALSE;
+    //the wallet IF is still finalizing the wallet id operation, the waiting xpubs are requested from the dispatch,
+    //without a wallet id they still go to the device but are not cached
+    pstr_dev->b_xpub_in_dispatch = TWI_TRUE;
+    crypto_guard_if_wake(pstr_dev);
+  }
+}
+
+static tstr_crypto_guard_if_dev_record* crypto_guard_if_find_dev_record(tstr_crypto_guard_if_dev_identity* pstr_identity, twi_u16 u16_id)
+{
+  for(int i = 0; i < DEV_RECORDS_NUM; i++)
+  {
+    if((TWI_TRUE == gastr_dev_records[i].b_valid) && (u16_id == gastr_dev_records[i].u16_id) && (pstr_identity->u8_len == gastr_dev_records[i].str_identity.u8_len) &&
+       (0 == TWI_MEMCMP(pstr_identity->au8_id, gastr_dev_records[i].str_identity.au8_id, pstr_identity->u8_len)))
+    {
+      return &gastr_dev_records[i];
+    }
+  }
+  return NULL;
 }
 
+//an empty record drops the saved one, a new record takes a free entry or the oldest one
 static void usb_save_cb(void* const pv_device, twi_u16 id,  twi_u8* pu8_data, twi_u32 u32_data_sz)
 {
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  tstr_crypto_guard_if_dev_record* pstr_record = crypto_guard_if_find_dev_record(&pstr_dev->str_identity, id);
+
+  if(0 == pstr_dev->str_identity.u8_len)
+  {
+    return;
+  }
+  if((NULL == pu8_data) || (0 == u32_data_sz) || (u32_data_sz > DEV_RECORD_MAX_SZ))
+  {
+    if(NULL != pstr_record)
+    {
+      pstr_record->b_valid = TWI_FALSE;
+    }
+    return;
+  }
+
+  if(NULL == pstr_record)
+  {
+    for(int i = 0; (i < DEV_RECORDS_NUM) && (NULL == pstr_record); i++)
+    {
+      if(TWI_TRUE != gastr_dev_records[i].b_valid)
+      {
+        pstr_record = &gastr_dev_records[i];
+      }
+    }
+    if(NULL == pstr_record)
+    {
+      pstr_record = &gastr_dev_records[gu32_dev_records_next];
+      gu32_dev_records_next = (gu32_dev_records_next + 1) % DEV_RECORDS_NUM;
+    }
+  }
+  pstr_record->b_valid = TWI_TRUE;
+  pstr_record->str_identity = pstr_dev->str_identity;
+  pstr_record->u16_id = id;
+  pstr_record->u32_data_sz = u32_data_sz;
+  TWI_MEMCPY(pstr_record->au8_data, pu8_data, u32_data_sz);
 }
 
+//*pu32_data_sz is the capacity of pu8_data, it's set to 0 when the device has no such record or it doesn't fit
 static void usb_load_cb(void* const pv_device, twi_u16 id, twi_u8* pu8_data, twi_u32* pu32_data_sz)
 {
   FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  tstr_crypto_guard_if_dev_record* pstr_record = NULL;
+
+  if(0 != pstr_dev->str_identity.u8_len)
+  {
+    pstr_record = crypto_guard_if_find_dev_record(&pstr_dev->str_identity, id);
+  }
+  if((NULL != pstr_record) && (pstr_record->u32_data_sz <= *pu32_data_sz))
+  {
+    TWI_MEMCPY(pu8_data, pstr_record->au8_data, pstr_record->u32_data_sz);
+    *pu32_data_sz = pstr_record->u32_data_sz;
+  }
+  else
+  {
+    *pu32_data_sz = 0;
+  }
 }
 
 static void usb_onConnectionDone_cb(void* const pv_device)
 {
   // FUN_IN;
   //notify the upper layer
-  gb_notify_conn_in_dispatch = TWI_TRUE;  
+  tstr_crypto_guard_if_dev* pstr_dev = (tstr_crypto_guard_if_dev*)pv_device;
+  pstr_dev->b_notify_conn_in_dispatch = TWI_TRUE;  
   // FUN_OUT;
 }
 
+static twi_u32 usb_get_time_ms_cb(void* const pv_device)
+{
+  return curTime();
+}
+
 static tstr_usb_if_context* cyrpto_guard_if_init(void)
 {
   tstr_usb_if_context* presult = NULL;
   presult = twi_usb_if_new();
+  // runs the stack timers and measures the queue waits and the APDU response times, set before the callbacks
+  twi_usb_if_set_clock(presult, usb_get_time_ms_cb);
   twi_usb_if_set_callbacks( presult, 
                             usb_scan_and_connect_cb            ,
                             usb_disconnect_cb                  ,
@@ -261,158 +916,212 @@ static tstr_usb_if_context* cyrpto_guard_if_init(void)
                             usb_stop_cb                        ,
                             usb_disable_cb                     ,
                             usb_dispatch_cb                    ,
+                            usb_wake_cb                        ,
                             usb_send_cb                        ,
+                            usb_send_batch_cb                  ,
                             usb_Start_Timer_cb                 ,
                             usb_Stop_Timer_cb                  ,
                             usb_send_to_cloud_cb               ,
                             usb_onUserConfirmationRequested_cb ,
                             usb_onUserConfirmationObtained_cb  ,
                             usb_onGetExtendedPubKeyResult_cb   ,
+                            usb_onGetExtendedPubKeysResult_cb  ,
                             usb_onSignTransactionResult_cb     ,
                             usb_onSignMessageResult_cb         ,
                             usb_onGetWalletIDResult_cb         ,
                             usb_save_cb                        ,
                             usb_load_cb                        ,
                             usb_onConnectionDone_cb            );
-  gu8_conn_state = DISCONNECTED;
+  // keep the coin app open between operations
+  twi_usb_if_set_app_session(presult, TWI_TRUE);
   return  presult;                         
 }
 
-static void init_module_var(void)
+static void init_dev_var(tstr_crypto_guard_if_dev* pstr_dev)
 {
-  gb_is_init = TWI_FALSE;
-  gu8_conn_state = DISCONNECTED;
-  TWI_MEMSET(gau8_rx_buff, 0, sizeof(gau8_rx_buff));
-  gb_send_in_dispatch = TWI_FALSE;
-  gb_hndl_rcv_data = TWI_FALSE;
-  gb_notify_conn_in_dispatch = TWI_FALSE;
-  gb_notify_send_status_in_dispatch = TWI_FALSE;
-  gs32_retval = TWI_ERROR;
-  TWI_MEMSET(gpu8_shared_mem, 0, SHARED_MEM_BUF_LEN);
-  TWI_MEMSET(&gstr_send_op, 0, sizeof(tsrt_op_ctx));
-  TWI_MEMSET(&gstr_rcv_op, 0, sizeof(tsrt_op_ctx));
-  TWI_MEMSET(&gstr_ntfy_conn_op, 0, sizeof(tsrt_op_ctx));
-  TWI_MEMSET(&gstr_ntfy_send_status_op, 0, sizeof(tsrt_op_ctx));
+  pstr_dev->p_ctx = NULL;
+  pstr_dev->u8_conn_state = DISCONNECTED;
+  //reports left from the previous connection are dropped
+  __atomic_store_n(&pstr_dev->str_rx_ring.u32_tail, __atomic_load_n(&pstr_dev->str_rx_ring.u32_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  pstr_dev->str_rx_ring.u32_slots_num = RX_RING_SLOTS_NUM;
+  pstr_dev->str_rx_ring.u32_slot_sz = REPORT_SZ;
+  TWI_MEMSET(pstr_dev->au8_shared_mem, 0, SHARED_MEM_BUF_LEN);
+  pstr_dev->b_notify_conn_in_dispatch = TWI_FALSE;
+  pstr_dev->b_notify_send_status_in_dispatch = TWI_FALSE;
+  TWI_MEMSET(&pstr_dev->str_ntfy_send_status_op, 0, sizeof(tsrt_op_ctx));
+  pstr_dev->b_work_pending = TWI_FALSE;
+  //a new connection may be another wallet, its id is read again before using the cache
+  pstr_dev->b_wallet_id_valid = TWI_FALSE;
+  pstr_dev->b_xpub_after_wallet_id = TWI_FALSE;
+  pstr_dev->b_xpub_in_dispatch = TWI_FALSE;
+  pstr_dev->u8_xpub_ops_num = 0;
+  pstr_dev->u8_xpubs_ops_num = 0;
+  pstr_dev->xpub_submit_idx = -1;
+  pstr_dev->xpubs_submit_idx = -1;
 }
 
-static void crypto_guard_if_create_ctx(void)
+static void crypto_guard_if_create_ctx(tstr_crypto_guard_if_dev* pstr_dev)
 {
-   if(TWI_FALSE == gb_is_init)
+   if(NULL == pstr_dev->p_ctx)
    {
-      init_module_var();
-      gp_curr_ctx = cyrpto_guard_if_init();
-	    gb_is_init = TWI_TRUE;
-      TWI_ASSERT(NULL != gpu8_shared_mem);
-      twi_usb_if_set_device_info(gp_curr_ctx, gpu8_shared_mem);
+      init_dev_var(pstr_dev);
+      pstr_dev->p_ctx = cyrpto_guard_if_init();
+      TWI_ASSERT(NULL != pstr_dev->p_ctx);
+      twi_usb_if_set_device_info(pstr_dev->p_ctx, pstr_dev);
    }
 }
 
-static void crypto_guard_if_free_ctx(void)
+//stack side, the page thread reads the copy with crypto_guard_if_get_stats().
+//without a context the copy published when it was freed stays, only the request it answers moves
+static void crypto_guard_if_stats_publish(tstr_crypto_guard_if_dev* pstr_dev, twi_u32 u32_request)
 {
-  if(NULL != gp_curr_ctx)
+  twi_u32 u32_seq = pstr_dev->u32_stats_seq;
+
+  __atomic_store_n(&pstr_dev->u32_stats_seq, u32_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  if(NULL != pstr_dev->p_ctx)
   {
-      twi_usb_if_free(gp_curr_ctx);
-      gp_curr_ctx = NULL;
+    twi_usb_if_get_stats(pstr_dev->p_ctx, &pstr_dev->str_stats);
   }
-  init_module_var();
+  pstr_dev->u32_stats_published = u32_request;
+  __atomic_store_n(&pstr_dev->u32_stats_seq, u32_seq + 2, __ATOMIC_RELEASE);
 }
-/////////////////////////////////////////////////////////////////////////
 
-/////////////////////////////////////////////////////////////////////////
-//////////////////////////////APIS///////////////////////////////////////
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_mem_init(twi_u8* pu8_shared_mem)
+static void crypto_guard_if_free_ctx(tstr_crypto_guard_if_dev* pstr_dev)
 {
-  TWI_ASSERT(NULL != pu8_shared_mem);
-  gpu8_shared_mem = pu8_shared_mem;
+  if(NULL != pstr_dev->p_ctx)
+  {
+      //answers every request, none is taken once the device is closing
+      crypto_guard_if_stats_publish(pstr_dev, __atomic_load_n(&pstr_dev->u32_stats_requested, __ATOMIC_ACQUIRE));
+      twi_usb_if_free(pstr_dev->p_ctx);
+      pstr_dev->p_ctx = NULL;
+  }
+  init_dev_var(pstr_dev);
 }
 
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_get_xpub(twi_u8* pu8_xpub_path, int num_of_step)
+static void crypto_guard_if_drain_rx_ring(tstr_crypto_guard_if_dev* pstr_dev)
 {
-  FUN_IN;
-  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step));
-  //communicate with the keyfon_cb(handshake and openning the nano-app) then getting the xpub
-  tstr_usb_crypto_path str_usb_crypto_path = {0};
-  str_usb_crypto_path.u8_steps_num = num_of_step;
-  TWI_MEMCPY(str_usb_crypto_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
-  if(NULL == gp_curr_ctx)
+  tstr_crypto_guard_if_rx_ring* pstr_ring = &pstr_dev->str_rx_ring;
+  twi_u32 u32_tail = pstr_ring->u32_tail;
+
+  while(u32_tail != __atomic_load_n(&pstr_ring->u32_head, __ATOMIC_ACQUIRE))
   {
-    crypto_guard_if_create_ctx();
+    if(NULL != pstr_dev->p_ctx)
+    {
+      twi_usb_if_notify_data_received(pstr_dev->p_ctx, pstr_ring->aau8_slots[u32_tail % RX_RING_SLOTS_NUM], REPORT_SZ, TWI_SUCCESS);
+    }
+    //the slot is handed back to JS only after the stack is done with it
+    u32_tail++;
+    __atomic_store_n(&pstr_ring->u32_tail, u32_tail, __ATOMIC_RELEASE);
   }
-  twi_usb_if_get_ext_pub_key(gp_curr_ctx, USB_WALLET_COIN_ETHEREUM, &str_usb_crypto_path,NULL, 0,TWI_FALSE);
-  FUN_OUT;
 }
 
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_sign_tx(twi_u8* pu8_xpub_path, int num_of_step, twi_u8* pu8_tx, twi_u32 u32_tx_len)
+static int crypto_guard_if_next_deadline(tstr_crypto_guard_if_dev* pstr_dev)
 {
-  FUN_IN;
-  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step) && (NULL != pu8_tx) && ((u32_tx_len > 0) && (u32_tx_len <= USB_WALLET_SIGNING_TX_MAX_LEN)));
-  
-  tstr_usb_ethereum_tx eth_tx;
-  eth_tx.u16_signing_tx_len = (twi_u16) u32_tx_len;
-  TWI_MEMCPY(eth_tx.au8_signing_tx, pu8_tx, u32_tx_len);
-  eth_tx.str_signing_key_path.u8_steps_num = num_of_step;
-  TWI_MEMCPY(eth_tx.str_signing_key_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
-  if(NULL == gp_curr_ctx)
+  int next_deadline_ms = NO_PENDING_WORK;
+  twi_u32 u32_timeout_ms = 0;
+  //the earliest stack timer is the deadline unless there is work to run right away
+  if((NULL != pstr_dev->p_ctx) && (TWI_TRUE == twi_usb_if_get_next_timeout(pstr_dev->p_ctx, &u32_timeout_ms)))
+  {
+    next_deadline_ms = (u32_timeout_ms > INT32_MAX)? INT32_MAX : (int)u32_timeout_ms;
+  }
+  if((TWI_TRUE == pstr_dev->b_work_pending) || (TWI_TRUE == pstr_dev->b_notify_send_status_in_dispatch) || (TWI_TRUE == pstr_dev->b_notify_conn_in_dispatch) ||
+     (TWI_TRUE == pstr_dev->b_xpub_in_dispatch) ||
+     (pstr_dev->str_rx_ring.u32_tail != __atomic_load_n(&pstr_dev->str_rx_ring.u32_head, __ATOMIC_ACQUIRE)))
   {
-    crypto_guard_if_create_ctx();
+    next_deadline_ms = 0;
   }
-  twi_usb_if_sign_tx(gp_curr_ctx, USB_WALLET_COIN_ETHEREUM, &eth_tx,NULL, 0, TWI_FALSE);
+  return next_deadline_ms;
 }
+/////////////////////////////////////////////////////////////////////////
 
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_sign_msg(twi_u8* pu8_xpub_path, int num_of_step, twi_u8* pu8_msg, twi_u32 u32_msg_len, twi_u8* pu8_msg_hash, twi_u32 msg_hash_len)
+//the stack side of crypto_guard_if_dispatch()
+static int crypto_guard_if_dev_dispatch(tstr_crypto_guard_if_dev* pstr_dev)
 {
-  FUN_IN;
-  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step) && (NULL != pu8_msg) && ((u32_msg_len > 0) && (u32_msg_len <= USB_WALLET_MSG_MAX_LEN)));
-  
-  tstr_usb_ethereum_msg eth_msg;
-  eth_msg.u32_msg_len = (twi_u16) u32_msg_len;
-  TWI_MEMCPY(eth_msg.au8_msg_buf, pu8_msg, u32_msg_len);
-  //TWI_ASSERT(msg_hash_len <= 32);
-  TWI_MEMCPY(eth_msg.au8_msg_sha_256_hash, pu8_msg_hash, 32);
-  eth_msg.str_sign_key_path.u8_steps_num = num_of_step;
-  TWI_MEMCPY(eth_msg.str_sign_key_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
-  if(NULL == gp_curr_ctx)
+  pstr_dev->b_in_dispatch = TWI_TRUE;
+  pstr_dev->b_dispatch_requested = TWI_FALSE;
+  crypto_guard_if_drain_rx_ring(pstr_dev);
+  //work made runnable so far (including by the reports above) is handled by the stack dispatcher below
+  pstr_dev->b_work_pending = TWI_FALSE;
+  if(NULL != pstr_dev->p_ctx)
   {
-    crypto_guard_if_create_ctx();
+    twi_usb_if_dispatch(pstr_dev->p_ctx);
+
+    if (pstr_dev->b_notify_send_status_in_dispatch)
+    {
+      TWI_LOGGER("Handle notify send status in dispatch, handle = %d, conn_state = %d\r\n", pstr_dev->s32_handle, pstr_dev->u8_conn_state);
+      pstr_dev->b_notify_send_status_in_dispatch = TWI_FALSE;
+      if(pstr_dev->u8_conn_state == CONNECTING)
+      {
+        pstr_dev->u8_conn_state = CONNECTED;
+        twi_usb_if_notify_connected(pstr_dev->p_ctx, pstr_dev->str_ntfy_send_status_op.s32_error);
+      }
+      else if (pstr_dev->u8_conn_state == CONNECTED)
+      {
+        twi_usb_if_notify_send_status(pstr_dev->p_ctx, pstr_dev->str_ntfy_send_status_op.s32_error);
+      }
+      else if(pstr_dev->u8_conn_state == DISCONNECTING)
+      {
+        TWI_LOGGER("LOCAL DISCONNECT\r\n");
+        pstr_dev->u8_conn_state = DISCONNECTED;
+        crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_DISCONNECT, pstr_dev->s32_handle, NULL, 0, 0, TWI_SUCCESS);
+      }
+      else
+      {
+        TWI_LOGGER_ERR("Invlaid state\r\n");
+        TWI_ASSERT(TWI_FALSE);
+      }
+    }
+
+    if (pstr_dev->b_notify_conn_in_dispatch)
+    {
+      TWI_LOGGER("Handle NTFY in dispatch\r\n");
+      pstr_dev->b_notify_conn_in_dispatch = TWI_FALSE;
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_CONNECTION_DONE, pstr_dev->s32_handle, NULL, 0, 0, TWI_SUCCESS);
+    }
+
+    if (pstr_dev->b_xpub_in_dispatch)
+    {
+      pstr_dev->b_xpub_in_dispatch = TWI_FALSE;
+      crypto_guard_if_xpub_request(pstr_dev);
+    }
   }
-  twi_usb_if_sign_msg(gp_curr_ctx, USB_WALLET_COIN_ETHEREUM, &eth_msg,NULL, 0, TWI_FALSE);
+  pstr_dev->b_in_dispatch = TWI_FALSE;
+  return crypto_guard_if_next_deadline(pstr_dev);
 }
 
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_notify(tenum_crypto_guard_if_event enum_event, twi_u8* data, int len, int error)
+static void crypto_guard_if_notify_run(tstr_crypto_guard_if_dev* pstr_dev, tenum_crypto_guard_if_event enum_event, twi_u8* data, int len, int error)
 {
-  // FUN_IN;
-  TWI_LOGGER("enum_event = %d, error = %d\r\n", enum_event, error);
+  TWI_LOGGER("handle = %d, enum_event = %d, error = %d\r\n", pstr_dev->s32_handle, enum_event, error);
   switch(enum_event)
   {
     case CRYPTO_GUARD_IF_CONNECTED_EVT:
     {
+      //the identity of the connected wallet keys its saved records, the port opens after it is known
+      pstr_dev->str_identity.u8_len = 0;
+      if((NULL != data) && (0 < len))
+      {
+        pstr_dev->str_identity.u8_len = (len > DEV_IDENTITY_MAX_LEN)? DEV_IDENTITY_MAX_LEN : (twi_u8)len;
+        TWI_MEMCPY(pstr_dev->str_identity.au8_id, data, pstr_dev->str_identity.u8_len);
+      }
+
       //TODO: this is a workaround to open the port before sending the stack specs
-      //crypto_guard_if_free_ctx();
-      //crypto_guard_if_create_ctx();
-      gu8_conn_state = CONNECTING;
-      TWI_ASSERT(NULL != gpu8_shared_mem);
-      TWI_MEMSET(gpu8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
-      gpu8_shared_mem[0] = 0x40; //open port
-      // gb_send_in_dispatch = TWI_TRUE;
+      pstr_dev->u8_conn_state = CONNECTING;
+      TWI_MEMSET(pstr_dev->au8_shared_mem, 0x0, SHARED_MEM_BUF_LEN);
+      pstr_dev->au8_shared_mem[0] = 0x40; //open port
 
       TWI_LOGGER("Handle send \r\n");
-      TWI_ASSERT(NULL != gpu8_shared_mem);
-      usbSend(gpu8_shared_mem, 64);
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_USB_SEND, pstr_dev->s32_handle, pstr_dev->au8_shared_mem, REPORT_SZ, 0, TWI_SUCCESS);
 
       break;
     }
 
     case CRYPTO_GUARD_IF_DISCONNECTED_EVT:
     {
-      if(NULL != gp_curr_ctx)
+      if(NULL != pstr_dev->p_ctx)
       {
-        twi_usb_if_notify_disconnected(gp_curr_ctx, 0, error);
-        crypto_guard_if_free_ctx();
+        twi_usb_if_notify_disconnected(pstr_dev->p_ctx, 0, error);
+        crypto_guard_if_free_ctx(pstr_dev);
       }
       break;
     }
@@ -420,49 +1129,23 @@ void crypto_guard_if_notify(tenum_crypto_guard_if_event enum_event, twi_u8* data
     case CRYPTO_GUARD_IF_SEND_STATUS_EVT:
     {
       TWI_LOGGER("CRYPTO_GUARD_IF_SEND_STATUS_EVT <<\r\n");
-      TWI_ASSERT(TWI_TRUE != gb_notify_send_status_in_dispatch);
-      gstr_ntfy_send_status_op.pv_data = data;
-      gstr_ntfy_send_status_op.u32_data_len = len;
-      gstr_ntfy_send_status_op.s32_error = error;
-      gb_notify_send_status_in_dispatch = TWI_TRUE;
+      TWI_ASSERT(TWI_TRUE != pstr_dev->b_notify_send_status_in_dispatch);
+      pstr_dev->str_ntfy_send_status_op.pv_data = data;
+      pstr_dev->str_ntfy_send_status_op.u32_data_len = len;
+      pstr_dev->str_ntfy_send_status_op.s32_error = error;
+      pstr_dev->b_notify_send_status_in_dispatch = TWI_TRUE;
+      crypto_guard_if_wake(pstr_dev);
       TWI_LOGGER("CRYPTO_GUARD_IF_SEND_STATUS_EVT >>\r\n");
-
-      // TWI_LOGGER("notify send status , gu8_conn_state = %d\r\n", gu8_conn_state);
-      // if(gu8_conn_state == CONNECTING)
-      // {
-      //   gu8_conn_state = CONNECTED;
-      //   twi_usb_if_notify_connected(gp_curr_ctx, gstr_ntfy_send_status_op.s32_error);
-      // }
-      // else if (gu8_conn_state == CONNECTED)
-      // {
-      //   twi_usb_if_notify_send_status(gp_curr_ctx, gstr_ntfy_send_status_op.s32_error);
-      // }
-      // else if(gu8_conn_state == DISCONNECTING)
-      // {
-      //   TWI_LOGGER("LOCAL DISCONNECT\r\n");
-      //   gu8_conn_state = DISCONNECTED;
-      //   usbDisconnect();
-      // }
-      // else
-      // {
-      //   TWI_LOGGER_ERR("Invlaid state\r\n");
-      //   TWI_ASSERT(TWI_FALSE);
-      // }
       break;
     }
 
     case CRYPTO_GUARD_IF_RECIEVED_DATA_EVT:
     {
-      TWI_ASSERT(NULL != gp_curr_ctx);
-      TWI_ASSERT(gb_hndl_rcv_data != TWI_TRUE);
+      //reports normally go through the RX ring, this is kept for callers that own their buffer, it is parsed in place as well
+      TWI_ASSERT((NULL != pstr_dev->p_ctx) && (NULL != data) && (len <= REPORT_SZ));
       TWI_LOGGER("CRYPTO_GUARD_IF_RECIEVED_DATA_EVT addr = 0x%x, len = %d\r\n", data, len);
-      TWI_MEMSET(gau8_rx_buff, 0x0, 64);
-      TWI_MEMCPY(gau8_rx_buff, data, len);
-      // gstr_rcv_op.pv_data = data;
-      // gstr_rcv_op.u32_data_len = len;
-      // gstr_rcv_op.s32_error = error;
-      // gb_hndl_rcv_data = TWI_TRUE;
-      twi_usb_if_notify_data_received(gp_curr_ctx, gau8_rx_buff, len, error);
+      twi_usb_if_notify_data_received(pstr_dev->p_ctx, data, len, error);
+      crypto_guard_if_wake(pstr_dev);
       break;
     }
 
@@ -472,62 +1155,544 @@ void crypto_guard_if_notify(tenum_crypto_guard_if_event enum_event, twi_u8* data
       TWI_ASSERT(TWI_FALSE);
     }
   }
-  // FUN_OUT;
 }
 
-EMSCRIPTEN_KEEPALIVE
-void crypto_guard_if_dispatch(void)
+//runs an exported API call on the thread that owns the stack
+//answers an operation that will not run, the other commands have no result to give
+static void crypto_guard_if_cmd_reject(tstr_crypto_guard_if_cmd* pstr_cmd, twi_s32 s32_error)
 {
-  if(NULL != gp_curr_ctx)
+  //the signature results always carry [v][r (32)][s (32)]
+  twi_u8 au8_no_sig[1 + 32 + 32] = {0};
+  switch(pstr_cmd->enum_cmd)
   {
-    twi_usb_if_dispatch(gp_curr_ctx);
+    case CRYPTO_GUARD_IF_CMD_GET_XPUB:
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUB_RESULT, pstr_cmd->s32_handle, NULL, 0, 0, s32_error);
+      break;
+    case CRYPTO_GUARD_IF_CMD_GET_XPUBS:
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUBS_RESULT, pstr_cmd->s32_handle, NULL, 0, 0, s32_error);
+      break;
+    case CRYPTO_GUARD_IF_CMD_SIGN_TX:
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_SIGN_TX_RESULT, pstr_cmd->s32_handle, au8_no_sig, sizeof(au8_no_sig), 0, s32_error);
+      break;
+    case CRYPTO_GUARD_IF_CMD_SIGN_MSG:
+      crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_SIGN_MSG_RESULT, pstr_cmd->s32_handle, au8_no_sig, sizeof(au8_no_sig), 0, s32_error);
+      break;
+    default:
+      TWI_LOGGER_ERR("Command for a closed handle dropped, cmd = %d\r\n", pstr_cmd->enum_cmd);
+      break;
+  }
+}
 
-    // if(gb_send_in_dispatch == TWI_TRUE)
-    // {
-    //   TWI_LOGGER("Handle send in dispatch\r\n");
-    //   gb_send_in_dispatch = TWI_FALSE;
-    //   TWI_ASSERT(NULL != gpu8_shared_mem);
-    //   usbSend(gpu8_shared_mem, 64);
-    // }
-    if (gb_notify_send_status_in_dispatch)
+static void crypto_guard_if_cmd_run(tstr_crypto_guard_if_cmd* pstr_cmd)
+{
+  //a closing device is still in use until its CRYPTO_GUARD_IF_CMD_CLOSE runs, the commands queued behind it find none
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(pstr_cmd->s32_handle);
+
+  if(NULL == pstr_dev)
+  {
+    crypto_guard_if_cmd_reject(pstr_cmd, CRYPTO_GUARD_IF_ERR_INVALID_HANDLE);
+    return;
+  }
+
+  switch(pstr_cmd->enum_cmd)
+  {
+    case CRYPTO_GUARD_IF_CMD_GET_XPUB:
     {
-      TWI_LOGGER("Handle notify send status in dispatch, gu8_conn_state = %d\r\n", gu8_conn_state);
-      gb_notify_send_status_in_dispatch = TWI_FALSE;
-      if(gu8_conn_state == CONNECTING)
+      //communicate with the keyfon_cb(handshake and openning the nano-app) then getting the xpub
+      crypto_guard_if_create_ctx(pstr_dev);
+      if(XPUB_OPS_NUM <= pstr_dev->u8_xpub_ops_num)
       {
-        gu8_conn_state = CONNECTED;
-        twi_usb_if_notify_connected(gp_curr_ctx, gstr_ntfy_send_status_op.s32_error);
+        //as many requests as the wallet IF queue holds are waiting already
+        crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUB_RESULT, pstr_dev->s32_handle, NULL, 0, 0, USB_IF_ERR_INVALID_STATE);
+        break;
       }
-      else if (gu8_conn_state == CONNECTED)
+      tstr_crypto_guard_if_xpub_op* pstr_op = &pstr_dev->astr_xpub_ops[pstr_dev->u8_xpub_ops_num++];
+      TWI_MEMCPY(&pstr_op->str_path, pstr_cmd->pv_args, sizeof(tstr_usb_crypto_path));
+      pstr_op->b_submitted = TWI_FALSE;
+      if(TWI_TRUE == pstr_dev->b_wallet_id_valid)
       {
-        twi_usb_if_notify_send_status(gp_curr_ctx, gstr_ntfy_send_status_op.s32_error);
+        crypto_guard_if_xpub_request(pstr_dev);
       }
-      else if(gu8_conn_state == DISCONNECTING)
+      else if(TWI_TRUE != pstr_dev->b_xpub_after_wallet_id)
       {
-        TWI_LOGGER("LOCAL DISCONNECT\r\n");
-        gu8_conn_state = DISCONNECTED;
-        usbDisconnect();
+        //the cache is keyed by the wallet id, read it first (the waiting xpubs follow on the same connection)
+        pstr_dev->b_xpub_after_wallet_id = TWI_TRUE;
+        twi_usb_if_get_wallet_id(pstr_dev->p_ctx, TWI_FALSE);
       }
-      else
+      crypto_guard_if_wake(pstr_dev);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_GET_XPUBS:
+    {
+      crypto_guard_if_create_ctx(pstr_dev);
+      if(XPUB_OPS_NUM <= pstr_dev->u8_xpubs_ops_num)
       {
-        TWI_LOGGER_ERR("Invlaid state\r\n");
-        TWI_ASSERT(TWI_FALSE);
+        crypto_guard_if_js_post(CRYPTO_GUARD_IF_JS_XPUBS_RESULT, pstr_dev->s32_handle, NULL, 0, 0, USB_IF_ERR_INVALID_STATE);
+        break;
       }
+      tstr_crypto_guard_if_xpubs_op* pstr_op = &pstr_dev->astr_xpubs_ops[pstr_dev->u8_xpubs_ops_num];
+      pstr_op->u8_paths_num = (twi_u8)pstr_cmd->u32_num;
+      TWI_MEMCPY(pstr_op->astr_paths, pstr_cmd->pv_args, pstr_cmd->u32_num * sizeof(tstr_usb_crypto_path));
+      pstr_dev->xpubs_submit_idx = pstr_dev->u8_xpubs_ops_num++;
+      //the wallet IF copies the paths as well, the app is opened once and the keys come back in one callback
+      twi_usb_if_get_ext_pub_keys(pstr_dev->p_ctx, USB_WALLET_COIN_ETHEREUM, (tstr_usb_crypto_path*)pstr_cmd->pv_args, (twi_u8)pstr_cmd->u32_num, NULL, 0, TWI_FALSE);
+      pstr_dev->xpubs_submit_idx = -1;
+      crypto_guard_if_wake(pstr_dev);
+      break;
     }
-    // else if(gb_hndl_rcv_data == TWI_TRUE)
-    // {
-    //   TWI_LOGGER("Handle RCV in dispatch\r\n");
-    //   gb_hndl_rcv_data = TWI_FALSE;
-    //   twi_usb_if_notify_data_received(gp_curr_ctx, gau8_rx_buff, gau8_rx_buff[0]+1, gstr_rcv_op.s32_error);
-    // }
-    if (gb_notify_conn_in_dispatch)
+
+    case CRYPTO_GUARD_IF_CMD_SIGN_TX:
     {
-      TWI_LOGGER("Handle NTFY in dispatch\r\n");
-      gb_notify_conn_in_dispatch = TWI_FALSE;
-      onConnectionDone();
+      crypto_guard_if_create_ctx(pstr_dev);
+      twi_usb_if_sign_tx(pstr_dev->p_ctx, USB_WALLET_COIN_ETHEREUM, (tstr_usb_ethereum_tx*)pstr_cmd->pv_args, NULL, 0, TWI_FALSE);
+      crypto_guard_if_wake(pstr_dev);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_SIGN_MSG:
+    {
+      crypto_guard_if_create_ctx(pstr_dev);
+      twi_usb_if_sign_msg(pstr_dev->p_ctx, USB_WALLET_COIN_ETHEREUM, (tstr_usb_ethereum_msg*)pstr_cmd->pv_args, NULL, 0, TWI_FALSE);
+      crypto_guard_if_wake(pstr_dev);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_NOTIFY:
+    {
+      //a copied report comes in pv_args, other events keep the caller buffer
+      crypto_guard_if_notify_run(pstr_dev, (tenum_crypto_guard_if_event)pstr_cmd->s32_arg, (NULL != pstr_cmd->pv_args)? (twi_u8*)pstr_cmd->pv_args : pstr_cmd->pu8_data,
+                                 (int)pstr_cmd->u32_data_len, pstr_cmd->s32_error);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_CLOSE:
+    {
+      crypto_guard_if_free_ctx(pstr_dev);
+      pstr_dev->b_closing = TWI_FALSE;
+      __atomic_store_n(&pstr_dev->b_in_use, TWI_FALSE, __ATOMIC_RELEASE);
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_FLUSH_XPUB_CACHE:
+    {
+      //nothing is cached for a handle whose wallet id was never read
+      if(TWI_TRUE == pstr_dev->b_wallet_id_seen)
+      {
+        crypto_guard_if_xpub_cache_flush(pstr_dev->au8_wallet_id);
+      }
+      break;
+    }
+
+    case CRYPTO_GUARD_IF_CMD_PUBLISH_STATS:
+    {
+      crypto_guard_if_stats_publish(pstr_dev, pstr_cmd->u32_num);
+      break;
+    }
+
+    default:
+    {
+      TWI_LOGGER_ERR("Invalid command\r\n");
+      TWI_ASSERT(TWI_FALSE);
     }
   }
+}
+
+#ifdef CRYPTO_GUARD_IF_THREADED
+static void crypto_guard_if_worker_wake(void)
+{
+  __atomic_add_fetch(&gu32_worker_wake_seq, 1, __ATOMIC_RELEASE);
+  emscripten_futex_wake(&gu32_worker_wake_seq, 1);
+}
+
+//worker side, runs the API calls queued by the page thread
+static void crypto_guard_if_cmd_drain(void)
+{
+  tstr_crypto_guard_if_cmd_ring* pstr_ring = &gstr_cmd_ring;
+  twi_u32 u32_tail = pstr_ring->u32_tail;
+
+  while(u32_tail != __atomic_load_n(&pstr_ring->u32_head, __ATOMIC_ACQUIRE))
+  {
+    tstr_crypto_guard_if_cmd* pstr_cmd = &pstr_ring->astr_slots[u32_tail % CMD_RING_SLOTS_NUM];
+    crypto_guard_if_cmd_run(pstr_cmd);
+    free(pstr_cmd->pv_args);
+    u32_tail++;
+    __atomic_store_n(&pstr_ring->u32_tail, u32_tail, __ATOMIC_RELEASE);
+  }
+}
+
+//the stack, its dispatcher and the RX ring parsing only run here, the page thread never waits for them
+static void* crypto_guard_if_worker(void* pv_arg)
+{
+  for(;;)
+  {
+    //read before looking for work, a wake that comes after it makes the wait below return right away
+    twi_u32 u32_seq = __atomic_load_n(&gu32_worker_wake_seq, __ATOMIC_ACQUIRE);
+    int next_deadline_ms = NO_PENDING_WORK;
 
+    crypto_guard_if_cmd_drain();
+    for(int i = 0; i < MAX_DEVICES_NUM; i++)
+    {
+      if(TWI_TRUE == __atomic_load_n(&gastr_devs[i].b_in_use, __ATOMIC_ACQUIRE))
+      {
+        int dev_deadline_ms = crypto_guard_if_dev_dispatch(&gastr_devs[i]);
+        if((NO_PENDING_WORK != dev_deadline_ms) && ((NO_PENDING_WORK == next_deadline_ms) || (dev_deadline_ms < next_deadline_ms)))
+        {
+          next_deadline_ms = dev_deadline_ms;
+        }
+      }
+    }
+
+    if(0 != next_deadline_ms)
+    {
+      emscripten_futex_wait(&gu32_worker_wake_seq, u32_seq, (NO_PENDING_WORK == next_deadline_ms)? INFINITY : (double)next_deadline_ms);
+    }
+  }
+  return NULL;
+}
+#endif
+
+//every exported API call goes through here, the threaded build hands it to the worker.
+//the page thread never waits, TWI_ERROR_BUSY is returned when the worker is that far behind
+//and CRYPTO_GUARD_IF_ERR_INVALID_HANDLE when the handle is not open
+static twi_s32 crypto_guard_if_cmd_post(tstr_crypto_guard_if_cmd* pstr_cmd)
+{
+  twi_s32 s32_retval = TWI_SUCCESS;
+  if(NULL == crypto_guard_if_get_dev(pstr_cmd->s32_handle))
+  {
+    TWI_LOGGER_ERR("Invalid handle = %d, cmd = %d\r\n", pstr_cmd->s32_handle, pstr_cmd->enum_cmd);
+    return CRYPTO_GUARD_IF_ERR_INVALID_HANDLE;
+  }
+#ifdef CRYPTO_GUARD_IF_THREADED
+  tstr_crypto_guard_if_cmd_ring* pstr_ring = &gstr_cmd_ring;
+  twi_u32 u32_head = pstr_ring->u32_head;
+  tstr_crypto_guard_if_cmd* pstr_slot = &pstr_ring->astr_slots[u32_head % CMD_RING_SLOTS_NUM];
+  twi_u32 u32_slots_num = CMD_RING_SLOTS_NUM;
+
+  //an operation or a stats publish never takes the slots of the send status and close of the devices
+  if((CRYPTO_GUARD_IF_CMD_GET_XPUB == pstr_cmd->enum_cmd) || (CRYPTO_GUARD_IF_CMD_GET_XPUBS == pstr_cmd->enum_cmd) ||
+     (CRYPTO_GUARD_IF_CMD_SIGN_TX == pstr_cmd->enum_cmd) || (CRYPTO_GUARD_IF_CMD_SIGN_MSG == pstr_cmd->enum_cmd) ||
+     (CRYPTO_GUARD_IF_CMD_PUBLISH_STATS == pstr_cmd->enum_cmd))
+  {
+    u32_slots_num -= CMD_RING_CTRL_SLOTS_NUM;
+  }
+  if((u32_head - __atomic_load_n(&pstr_ring->u32_tail, __ATOMIC_ACQUIRE)) >= u32_slots_num)
+  {
+    TWI_LOGGER_ERR("Command ring full, cmd = %d\r\n", pstr_cmd->enum_cmd);
+    s32_retval = TWI_ERROR_BUSY;
+  }
+  else
+  {
+    TWI_MEMCPY(pstr_slot, pstr_cmd, sizeof(tstr_crypto_guard_if_cmd));
+    pstr_slot->pv_args = NULL;
+    if(0 != pstr_cmd->u32_args_sz)
+    {
+      pstr_slot->pv_args = malloc(pstr_cmd->u32_args_sz);
+      TWI_ASSERT(NULL != pstr_slot->pv_args);
+      TWI_MEMCPY(pstr_slot->pv_args, pstr_cmd->pv_args, pstr_cmd->u32_args_sz);
+    }
+    __atomic_store_n(&pstr_ring->u32_head, u32_head + 1, __ATOMIC_RELEASE);
+    crypto_guard_if_worker_wake();
+  }
+#else
+  crypto_guard_if_cmd_run(pstr_cmd);
+#endif
+  return s32_retval;
+}
+/////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////
+//////////////////////////////APIS///////////////////////////////////////
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_open(twi_u32 u32_dev_id)
+{
+  FUN_IN;
+  int handle = INVALID_HANDLE;
+  int free_handle = INVALID_HANDLE;
+#ifdef CRYPTO_GUARD_IF_THREADED
+  if(TWI_FALSE == gb_worker_started)
+  {
+    int ret = pthread_create(&gs_worker_thread, NULL, crypto_guard_if_worker, NULL);
+    TWI_ASSERT(0 == ret);
+    gb_worker_started = TWI_TRUE;
+  }
+#endif
+  for(int i = 0; (i < MAX_DEVICES_NUM) && (INVALID_HANDLE == handle); i++)
+  {
+    if(TWI_TRUE == __atomic_load_n(&gastr_devs[i].b_in_use, __ATOMIC_ACQUIRE))
+    {
+      if((u32_dev_id == gastr_devs[i].u32_dev_id) && (TWI_TRUE != gastr_devs[i].b_closing))
+      {
+        handle = i;
+      }
+    }
+    else if(INVALID_HANDLE == free_handle)
+    {
+      free_handle = i;
+    }
+  }
+
+  if((INVALID_HANDLE == handle) && (INVALID_HANDLE != free_handle))
+  {
+    handle = free_handle;
+    TWI_MEMSET(&gastr_devs[handle], 0, sizeof(tstr_crypto_guard_if_dev));
+    gastr_devs[handle].s32_handle = handle;
+    gastr_devs[handle].u32_dev_id = u32_dev_id;
+    init_dev_var(&gastr_devs[handle]);
+    //published last, the worker dispatches the devices in use
+    __atomic_store_n(&gastr_devs[handle].b_in_use, TWI_TRUE, __ATOMIC_RELEASE);
+  }
+  TWI_LOGGER("dev_id = %d, handle = %d\r\n", u32_dev_id, handle);
+  return handle;
+}
+
+//NULL for a handle that is not open
+EMSCRIPTEN_KEEPALIVE
+void* crypto_guard_if_get_rx_ring(int handle)
+{
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(handle);
+  return (NULL != pstr_dev)? &pstr_dev->str_rx_ring : NULL;
+}
+
+//returns TWI_ERROR_BUSY when the worker is too far behind to take it, the handle stays open then,
+//CRYPTO_GUARD_IF_ERR_INVALID_HANDLE when it is not open or already closing
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_close(int handle)
+{
+  FUN_IN;
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(handle);
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  twi_s32 s32_retval;
+  if((NULL == pstr_dev) || (TWI_TRUE == pstr_dev->b_closing))
+  {
+    return CRYPTO_GUARD_IF_ERR_INVALID_HANDLE;
+  }
+  pstr_dev->b_closing = TWI_TRUE;
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_CLOSE;
+  str_cmd.s32_handle = handle;
+  s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+  if(TWI_SUCCESS != s32_retval)
+  {
+    pstr_dev->b_closing = TWI_FALSE;
+  }
+  return s32_retval;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void crypto_guard_if_get_xpub(int handle, twi_u8* pu8_xpub_path, int num_of_step)
+{
+  FUN_IN;
+  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step));
+  tstr_usb_crypto_path str_path = {0};
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  str_path.u8_steps_num = num_of_step;
+  TWI_MEMCPY(str_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_GET_XPUB;
+  str_cmd.s32_handle = handle;
+  str_cmd.pv_args = &str_path;
+  str_cmd.u32_args_sz = sizeof(tstr_usb_crypto_path);
+  //a refused request is answered right away, like a request the wallet IF cannot queue
+  twi_s32 s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+  if(TWI_SUCCESS != s32_retval)
+  {
+    onGetXpubResult(handle, NULL, s32_retval);
+  }
+  FUN_OUT;
+}
+
+//pu8_xpub_paths holds num_of_paths paths of num_of_step steps each, it is copied so the caller may free it once this returns.
+//up to USB_WALLET_XPUB_BATCH_MAX_PATHS paths of up to USB_WALLET_PATH_MAX_STEPS steps, others get USB_IF_ERR_INVALID_ARGS
+EMSCRIPTEN_KEEPALIVE
+void crypto_guard_if_get_xpubs(int handle, twi_u8* pu8_xpub_paths, int num_of_step, int num_of_paths)
+{
+  FUN_IN;
+  tstr_usb_crypto_path astr_paths[USB_WALLET_XPUB_BATCH_MAX_PATHS];
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  if((NULL == pu8_xpub_paths) || (0 >= num_of_step) || (num_of_step > USB_WALLET_PATH_MAX_STEPS) || (0 >= num_of_paths) || (num_of_paths > USB_WALLET_XPUB_BATCH_MAX_PATHS))
+  {
+    onGetXpubsResult(handle, NULL, 0, 0, USB_IF_ERR_INVALID_ARGS);
+    return;
+  }
+  TWI_MEMSET(astr_paths, 0, sizeof(astr_paths));
+  for(int i = 0; i < num_of_paths; i++)
+  {
+    astr_paths[i].u8_steps_num = num_of_step;
+    TWI_MEMCPY(astr_paths[i].au32_path_steps, &pu8_xpub_paths[i * num_of_step * 4], num_of_step*4);
+  }
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_GET_XPUBS;
+  str_cmd.s32_handle = handle;
+  str_cmd.pv_args = astr_paths;
+  str_cmd.u32_args_sz = num_of_paths * sizeof(tstr_usb_crypto_path);
+  str_cmd.u32_num = num_of_paths;
+  twi_s32 s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+  if(TWI_SUCCESS != s32_retval)
+  {
+    onGetXpubsResult(handle, NULL, 0, 0, s32_retval);
+  }
+  FUN_OUT;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void crypto_guard_if_sign_tx(int handle, twi_u8* pu8_xpub_path, int num_of_step, twi_u8* pu8_tx, twi_u32 u32_tx_len)
+{
+  FUN_IN;
+  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step) && (NULL != pu8_tx) && ((u32_tx_len > 0) && (u32_tx_len <= USB_WALLET_SIGNING_TX_MAX_LEN)));
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  
+  tstr_usb_ethereum_tx eth_tx;
+  eth_tx.u16_signing_tx_len = (twi_u16) u32_tx_len;
+  TWI_MEMCPY(eth_tx.au8_signing_tx, pu8_tx, u32_tx_len);
+  eth_tx.str_signing_key_path.u8_steps_num = num_of_step;
+  TWI_MEMCPY(eth_tx.str_signing_key_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_SIGN_TX;
+  str_cmd.s32_handle = handle;
+  str_cmd.pv_args = &eth_tx;
+  str_cmd.u32_args_sz = sizeof(tstr_usb_ethereum_tx);
+  twi_s32 s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+  if(TWI_SUCCESS != s32_retval)
+  {
+    onSignTxResult(handle, 0, NULL, NULL, s32_retval);
+  }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void crypto_guard_if_sign_msg(int handle, twi_u8* pu8_xpub_path, int num_of_step, twi_u8* pu8_msg, twi_u32 u32_msg_len, twi_u8* pu8_msg_hash, twi_u32 msg_hash_len)
+{
+  FUN_IN;
+  TWI_ASSERT((NULL != pu8_xpub_path) && (0 != num_of_step) && (NULL != pu8_msg) && ((u32_msg_len > 0) && (u32_msg_len <= USB_WALLET_MSG_MAX_LEN)));
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  
+  tstr_usb_ethereum_msg eth_msg;
+  eth_msg.u32_msg_len = (twi_u16) u32_msg_len;
+  TWI_MEMCPY(eth_msg.au8_msg_buf, pu8_msg, u32_msg_len);
+  //TWI_ASSERT(msg_hash_len <= 32);
+  TWI_MEMCPY(eth_msg.au8_msg_sha_256_hash, pu8_msg_hash, 32);
+  eth_msg.str_sign_key_path.u8_steps_num = num_of_step;
+  TWI_MEMCPY(eth_msg.str_sign_key_path.au32_path_steps, pu8_xpub_path, num_of_step*4);
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_SIGN_MSG;
+  str_cmd.s32_handle = handle;
+  str_cmd.pv_args = &eth_msg;
+  str_cmd.u32_args_sz = sizeof(tstr_usb_ethereum_msg);
+  twi_s32 s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+  if(TWI_SUCCESS != s32_retval)
+  {
+    onSignMsgResult(handle, 0, NULL, NULL, s32_retval);
+  }
+}
+
+//returns TWI_ERROR_BUSY when the worker is too far behind to take the event, it shall be notified again,
+//CRYPTO_GUARD_IF_ERR_INVALID_HANDLE when the handle is not open
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_notify(int handle, tenum_crypto_guard_if_event enum_event, twi_u8* data, int len, int error)
+{
+  // FUN_IN;
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_NOTIFY;
+  str_cmd.s32_handle = handle;
+  str_cmd.s32_arg = enum_event;
+  str_cmd.pu8_data = data;
+  str_cmd.u32_data_len = len;
+  str_cmd.s32_error = error;
+  //the threaded build parses the report and the wallet identity after this returns, they get a copy
+  if(((CRYPTO_GUARD_IF_RECIEVED_DATA_EVT == enum_event) || (CRYPTO_GUARD_IF_CONNECTED_EVT == enum_event)) && (NULL != data) && (0 < len))
+  {
+    str_cmd.pv_args = data;
+    str_cmd.u32_args_sz = len;
+  }
+  return crypto_guard_if_cmd_post(&str_cmd);
+  // FUN_OUT;
+}
+
+//returns NO_PENDING_WORK when idle (the next requestDispatch() tells when to come back),
+//otherwise the number of ms after which dispatch shall be called again, 0 meaning right away.
+//CRYPTO_GUARD_IF_ERR_INVALID_HANDLE for a handle that is not open, the threaded build serves every handle from any of them
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_dispatch(int handle)
+{
+#ifdef CRYPTO_GUARD_IF_THREADED
+  //the worker runs the stack, here the JS calls it queued are run and it is woken up for the reports pushed to the RX ring
+  __atomic_store_n(&gu32_js_dispatch_requested, 0, __ATOMIC_RELEASE);
+  crypto_guard_if_js_drain();
+  crypto_guard_if_worker_wake();
+  return NO_PENDING_WORK;
+#else
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(handle);
+  return (NULL != pstr_dev)? crypto_guard_if_dev_dispatch(pstr_dev) : CRYPTO_GUARD_IF_ERR_INVALID_HANDLE;
+#endif
+}
+
+//asks for the tstr_usb_if_stats of the current (or last) connection of the device, crypto_guard_if_get_stats() reads them.
+//the statistics are only gathered when asked for here, the threaded build has the worker gather them after the commands queued before,
+//the other build right away. A request while the previous one is still queued is answered by that one.
+//returns TWI_ERROR_BUSY when the worker is too far behind to take it and CRYPTO_GUARD_IF_ERR_INVALID_HANDLE when the handle is not open
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_request_stats(int handle)
+{
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(handle);
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  twi_u32 u32_request;
+  twi_s32 s32_retval = TWI_SUCCESS;
+  if(NULL == pstr_dev)
+  {
+    return CRYPTO_GUARD_IF_ERR_INVALID_HANDLE;
+  }
+  u32_request = pstr_dev->u32_stats_requested;
+  //a closing device publishes its last statistics when its context is freed
+  if((TWI_TRUE != pstr_dev->b_closing) && (u32_request == __atomic_load_n(&pstr_dev->u32_stats_published, __ATOMIC_ACQUIRE)))
+  {
+    u32_request++;
+    __atomic_store_n(&pstr_dev->u32_stats_requested, u32_request, __ATOMIC_RELEASE);
+    str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_PUBLISH_STATS;
+    str_cmd.s32_handle = handle;
+    str_cmd.u32_num = u32_request;
+    s32_retval = crypto_guard_if_cmd_post(&str_cmd);
+    if(TWI_SUCCESS != s32_retval)
+    {
+      __atomic_store_n(&pstr_dev->u32_stats_requested, u32_request - 1, __ATOMIC_RELEASE);
+    }
+  }
+  return s32_retval;
+}
+
+//copies the statistics published for the last crypto_guard_if_request_stats() to ptr and returns their size.
+//never waits for the worker: CRYPTO_GUARD_IF_ERR_STATS_PENDING while it has not run that request yet, ptr holds the
+//previous copy then and the page asks again later. A negative error when the handle is not open or ptr is NULL
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_get_stats(int handle, void* ptr)
+{
+  tstr_crypto_guard_if_dev* pstr_dev = crypto_guard_if_get_dev(handle);
+  twi_u32 u32_seq;
+  twi_u32 u32_published;
+  if(NULL == pstr_dev)
+  {
+    return CRYPTO_GUARD_IF_ERR_INVALID_HANDLE;
+  }
+  if(NULL == ptr)
+  {
+    return TWI_ERROR_INVALID_ARGUMENTS;
+  }
+  //a copy torn by a publish in between is read again
+  do
+  {
+    u32_seq = __atomic_load_n(&pstr_dev->u32_stats_seq, __ATOMIC_ACQUIRE);
+    TWI_MEMCPY(ptr, &pstr_dev->str_stats, sizeof(tstr_usb_if_stats));
+    u32_published = pstr_dev->u32_stats_published;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  }while((0 != (u32_seq & 1)) || (u32_seq != __atomic_load_n(&pstr_dev->u32_stats_seq, __ATOMIC_RELAXED)));
+  return (u32_published == pstr_dev->u32_stats_requested)? (int)sizeof(tstr_usb_if_stats) : CRYPTO_GUARD_IF_ERR_STATS_PENDING;
+}
+
+//drops the xpubs cached for the wallet last read behind the handle, the next crypto_guard_if_get_xpub() of each of its paths
+//goes to the device, the other wallets keep theirs, returns TWI_ERROR_BUSY when the worker is too far behind to take it
+//and CRYPTO_GUARD_IF_ERR_INVALID_HANDLE when the handle is not open
+EMSCRIPTEN_KEEPALIVE
+int crypto_guard_if_flush_xpub_cache(int handle)
+{
+  FUN_IN;
+  tstr_crypto_guard_if_cmd str_cmd = {0};
+  str_cmd.enum_cmd = CRYPTO_GUARD_IF_CMD_FLUSH_XPUB_CACHE;
+  str_cmd.s32_handle = handle;
+  return crypto_guard_if_cmd_post(&str_cmd);
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -626,6 +626,134 @@ void twi_next_circular_index(twi_u8* pu8_index, twi_u8 u8_queue_len)
 	}
 }
 
+/*
+ *	@brief		This function is used to reset a round trip time estimator.
+ *	@param[in]	pstr_rtt:			Pointer to the estimator.
+ *	@param[in]	u32_init_rto_ms:	Retransmission timeout used till the first sample.
+ *	@param[in]	u32_min_rto_ms:		Lower bound of the retransmission timeout.
+ *	@param[in]	u32_max_rto_ms:		Upper bound of the retransmission timeout, the backoff stops there.
+ */
+void twi_rtt_init(tstr_twi_rtt* pstr_rtt, twi_u32 u32_init_rto_ms, twi_u32 u32_min_rto_ms, twi_u32 u32_max_rto_ms)
+{
+	TWI_ASSERT(NULL != pstr_rtt);
+
+	pstr_rtt->u32_srtt_x8		= 0;
+	pstr_rtt->u32_rttvar_x4		= 0;
+	pstr_rtt->u32_min_rto_ms	= u32_min_rto_ms;
+	pstr_rtt->u32_max_rto_ms	= u32_max_rto_ms;
+	pstr_rtt->u32_rto_ms		= u32_init_rto_ms;
+	pstr_rtt->u32_samples_cnt	= 0;
+}
+
+/*
+ *	@brief		This function is used to fold a round trip time sample into the smoothed RTT and its variance and derive the retransmission timeout.
+ *				It follows Jacobson's estimator ( gains of 1/8 and 1/4 ) with the RTT kept multiplied by 8 and the variance by 4,
+ *				so the small millisecond samples are not lost to the integer division. A sample also clears any backoff.
+ *	@param[in]	pstr_rtt:			Pointer to the estimator.
+ *	@param[in]	u32_sample_ms:		Measured round trip time.
+ */
+void twi_rtt_sample(tstr_twi_rtt* pstr_rtt, twi_u32 u32_sample_ms)
+{
+	twi_u32 u32_rto_ms;
+
+	TWI_ASSERT(NULL != pstr_rtt);
+
+	if(0 == pstr_rtt->u32_samples_cnt)
+	{
+		pstr_rtt->u32_srtt_x8	= u32_sample_ms << 3;
+		pstr_rtt->u32_rttvar_x4	= u32_sample_ms << 1;
+	}
+	else
+	{
+		twi_s32 s32_err = (twi_s32)u32_sample_ms - (twi_s32)(pstr_rtt->u32_srtt_x8 >> 3);
+
+		pstr_rtt->u32_srtt_x8	= (twi_u32)((twi_s32)pstr_rtt->u32_srtt_x8 + s32_err);
+		if(s32_err < 0)
+		{
+			s32_err = -s32_err;
+		}
+		pstr_rtt->u32_rttvar_x4	= pstr_rtt->u32_rttvar_x4 + (twi_u32)s32_err - (pstr_rtt->u32_rttvar_x4 >> 2);
+	}
+	pstr_rtt->u32_samples_cnt++;
+
+	/* RTO = SRTT + 4 * RTTVAR , the variance term is at least one clock tick */
+	u32_rto_ms = (pstr_rtt->u32_srtt_x8 >> 3) + ((0 != pstr_rtt->u32_rttvar_x4) ? pstr_rtt->u32_rttvar_x4 : 1);
+	if(u32_rto_ms < pstr_rtt->u32_min_rto_ms)
+	{
+		u32_rto_ms = pstr_rtt->u32_min_rto_ms;
+	}
+	if(u32_rto_ms > pstr_rtt->u32_max_rto_ms)
+	{
+		u32_rto_ms = pstr_rtt->u32_max_rto_ms;
+	}
+	pstr_rtt->u32_rto_ms = u32_rto_ms;
+}
+
+/*
+ *	@brief		This function is used to double the retransmission timeout after a timeout, up to its upper bound.
+ *	@param[in]	pstr_rtt:			Pointer to the estimator.
+ */
+void twi_rtt_backoff(tstr_twi_rtt* pstr_rtt)
+{
+	TWI_ASSERT(NULL != pstr_rtt);
+
+	if(pstr_rtt->u32_rto_ms > (pstr_rtt->u32_max_rto_ms >> 1))
+	{
+		pstr_rtt->u32_rto_ms = pstr_rtt->u32_max_rto_ms;
+	}
+	else
+	{
+		pstr_rtt->u32_rto_ms = pstr_rtt->u32_rto_ms << 1;
+	}
+}
+
+/*
+ *	@brief		This function is used to get the current retransmission timeout.
+ *	@param[in]	pstr_rtt:			Pointer to the estimator.
+ *	@return     The retransmission timeout in milliseconds.
+ */
+twi_u32 twi_rtt_get_rto(const tstr_twi_rtt* pstr_rtt)
+{
+	TWI_ASSERT(NULL != pstr_rtt);
+	return pstr_rtt->u32_rto_ms;
+}
+
+/*
+ *	@brief		This function is used to clear a latency histogram.
+ *	@param[in]	pstr_hist:			Pointer to the histogram.
+ */
+void twi_hist_reset(tstr_twi_hist* pstr_hist)
+{
+	TWI_ASSERT(NULL != pstr_hist);
+	TWI_MEMSET(pstr_hist, 0, sizeof(tstr_twi_hist));
+}
+
+/*
+ *	@brief		This function is used to count a latency sample in a histogram of log2 buckets.
+ *				Bucket 0 counts the samples of 0 ms and bucket N the samples in [ 2^(N-1) , 2^N ) ms,
+ *				the last bucket also counts everything above it.
+ *	@param[in]	pstr_hist:			Pointer to the histogram.
+ *	@param[in]	u32_sample_ms:		Measured latency.
+ */
+void twi_hist_add(tstr_twi_hist* pstr_hist, twi_u32 u32_sample_ms)
+{
+	twi_u8 u8_bucket = 0;
+
+	TWI_ASSERT(NULL != pstr_hist);
+
+	while((u8_bucket < (TWI_HIST_BUCKETS_NUM - 1)) && ((u32_sample_ms >> u8_bucket) != 0))
+	{
+		u8_bucket++;
+	}
+	pstr_hist->au32_buckets[u8_bucket]++;
+	pstr_hist->u32_samples_cnt++;
+	pstr_hist->u32_sum_ms += u32_sample_ms;
+	if(u32_sample_ms > pstr_hist->u32_max_ms)
+	{
+		pstr_hist->u32_max_ms = u32_sample_ms;
+	}
+}
+
 void twi_assert(twi_bool b_cond, const char* func_name, unsigned int line_number)
 {
 	if(b_cond == TWI_FALSE)
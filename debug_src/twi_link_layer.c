@@ -84,7 +84,7 @@ void twi_ll_handle_evt(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, voi
 	if(TWI_USB_LL == enu_ll_type)
 	{
 #if defined (TWI_USB_STACK_ENABLED)
-		twi_usb_ll_handle_usb_evt(&(puni_ctx->str_usb), ((tstr_twi_usb_evt*)pstr_evt)->enu_usbd_evt);
+		twi_usb_ll_handle_usb_evt(&(puni_ctx->str_usb), (tstr_twi_usb_evt*)pstr_evt);
 #endif	
 	}
 	else if(TWI_BLE_LL == enu_ll_type)
@@ -126,6 +126,40 @@ twi_s32 twi_ll_send_data(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, t
 	return s32_retval;
 }
 
+/*
+*	@brief		This is the Link Layer scatter-gather send data function. The segments are gathered straight into the outgoing
+*				frame, so the caller can point them into its own buffers instead of building the frame first.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@param [in]	pstr_iov		Pointer to the array of segments to be sent in order. They are copied before the call returns.
+*	@param [in]	u8_iov_num    	Number of segments.
+*	@param [in]	pv_arg    		User argument.
+*/
+twi_s32 twi_ll_send_data_iov(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num, void* pv_arg)
+{
+	twi_s32 s32_retval = TWI_ERROR_NOT_SUPPORTED_FEATURE;
+	if(TWI_USB_LL == enu_ll_type)
+	{
+
+#if defined (TWI_USB_STACK_ENABLED)
+		s32_retval = twi_usb_ll_send_data_iov(&(puni_ctx->str_usb), pstr_iov, u8_iov_num, pv_arg);
+#endif
+
+	}
+	else if(TWI_BLE_LL == enu_ll_type)
+	{
+
+#if defined (TWI_BLE_STACK_ENABLED)
+		/*The BLE Link Layer keeps its own copy of the frame, gather the segments in front of it*/
+		twi_u8 au8_data[twi_ble_ll_get_mtu_size(&(puni_ctx->str_ble))];
+		twi_u16 u16_data_len = twi_ll_iov_gather(au8_data, sizeof(au8_data), pstr_iov, u8_iov_num);
+		s32_retval = (0 != u16_data_len) ? twi_ble_ll_send_data(&(puni_ctx->str_ble), au8_data, u16_data_len, pv_arg) : TWI_ERROR_INVALID_ARGUMENTS;
+#endif
+
+	}
+	return s32_retval;
+}
+
 /*
 *	@brief		This is the Link Layer send error function
 *	@param [in]	enu_ll_type		Link Layer Type.
@@ -195,7 +229,7 @@ twi_u16 twi_ll_get_mtu_size(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx
 	if(TWI_USB_LL == enu_ll_type)
 	{
 #if defined (TWI_USB_STACK_ENABLED)
-		u16_retval = twi_usb_ll_get_mtu_size();
+		u16_retval = twi_usb_ll_get_mtu_size(&(puni_ctx->str_usb));
 #endif
 	}
 	else if(TWI_BLE_LL == enu_ll_type)
@@ -208,6 +242,154 @@ twi_u16 twi_ll_get_mtu_size(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx
 	return u16_retval;
 }
 
+/*
+*	@brief		This is an API to get the CTU size agreed upon in the connection, the maximum size of an unfragmented packet.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@return	    The CTU size.
+*/
+twi_u32 twi_ll_get_ctu_size(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx)
+{
+	twi_u32 u32_retval = MAX_PKT_SZ;
+
+	if(TWI_USB_LL == enu_ll_type)
+	{
+#if defined (TWI_USB_STACK_ENABLED)
+		u32_retval = twi_usb_ll_get_ctu_size(&(puni_ctx->str_usb));
+#endif
+	}
+	return u32_retval;
+}
+
+/*
+*	@brief		This is an API to get the capabilities both sides agreed upon in the connection.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@return	    Bitmap of the agreed capabilities @ref TWI_LL_CAP_LZ_COMPRESSION.
+*/
+twi_u8 twi_ll_get_capabilities(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx)
+{
+	twi_u8 u8_retval = 0;
+
+	if(TWI_USB_LL == enu_ll_type)
+	{
+#if defined (TWI_USB_STACK_ENABLED)
+		u8_retval = twi_usb_ll_get_capabilities(&(puni_ctx->str_usb));
+#endif
+	}
+	return u8_retval;
+}
+
+/*
+*	@brief		This is the Link Layer API to stage one more frame in the transmit batch.
+*				The staged frames are only handed to the lower layer by @ref twi_ll_send_batch.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@param [in]	pstr_iov		Pointer to the array of segments that make the frame. They are gathered into the batch, so they can be reused once the call returns.
+*	@param [in]	u8_iov_num    	Number of segments.
+*/
+twi_s32 twi_ll_add_batch_data(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_s32 s32_retval = TWI_ERROR_NOT_SUPPORTED_FEATURE;
+	if(TWI_USB_LL == enu_ll_type)
+	{
+
+#if defined (TWI_USB_STACK_ENABLED)
+		s32_retval = twi_usb_ll_add_batch_data(&(puni_ctx->str_usb), pstr_iov, u8_iov_num);
+#endif
+
+	}
+	return s32_retval;
+}
+
+/*
+*	@brief		This is the Link Layer API to send all the staged frames in one shot.
+*				A single TWI_LL_SEND_STATUS_EVT is passed to the network layer for the whole batch.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@param [in]	pv_arg    		User argument.
+*/
+twi_s32 twi_ll_send_batch(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, void* pv_arg)
+{
+	twi_s32 s32_retval = TWI_ERROR_NOT_SUPPORTED_FEATURE;
+	if(TWI_USB_LL == enu_ll_type)
+	{
+
+#if defined (TWI_USB_STACK_ENABLED)
+		s32_retval = twi_usb_ll_send_batch(&(puni_ctx->str_usb), pv_arg);
+#endif
+
+	}
+	return s32_retval;
+}
+
+/*
+*	@brief		This is a helper to copy scatter-gather segments back to back into one buffer.
+*	@param [out] pu8_dst		Pointer to the destination buffer.
+*	@param [in]	u16_dst_len		Destination buffer length.
+*	@param [in]	pstr_iov		Pointer to the array of segments.
+*	@param [in]	u8_iov_num    	Number of segments.
+*	@return	    The gathered length, 0 if the segments don't fit in the destination.
+*/
+twi_u16 twi_ll_iov_gather(twi_u8* pu8_dst, twi_u16 u16_dst_len, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_u16 u16_len = 0;
+	twi_u8 u8_idx;
+
+	for(u8_idx = 0; u8_idx < u8_iov_num; u8_idx++)
+	{
+		if((u16_len + pstr_iov[u8_idx].u16_len) > u16_dst_len)
+		{
+			u16_len = 0;
+			break;
+		}
+		if(0 != pstr_iov[u8_idx].u16_len)
+		{
+			TWI_MEMCPY(&pu8_dst[u16_len], pstr_iov[u8_idx].pu8_data, pstr_iov[u8_idx].u16_len);
+			u16_len += pstr_iov[u8_idx].u16_len;
+		}
+	}
+	return u16_len;
+}
+
+/*
+*	@brief		This is an API to get the maximum number of frames the link layer can send in one batch.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@return	    The batch capacity, 0 if batching is not supported.
+*/
+twi_u16 twi_ll_get_batch_capacity(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx)
+{
+	twi_u16 u16_retval = 0;
+
+	if(TWI_USB_LL == enu_ll_type)
+	{
+#if defined (TWI_USB_STACK_ENABLED)
+		u16_retval = twi_usb_ll_get_batch_capacity(&(puni_ctx->str_usb));
+#endif
+	}
+	return u16_retval;
+}
+
+/*
+*	@brief		This is an API to copy the link layer statistics.
+*	@param [in]	enu_ll_type		Link Layer Type.
+*	@param [in]	puni_ctx		Pointer to structure of the whole layer context.
+*	@param [out] pstr_stats		Pointer to the statistics , cleared if the link layer doesn't keep any.
+*/
+void twi_ll_get_stats(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, tstr_twi_ll_stats* pstr_stats)
+{
+	TWI_ASSERT((puni_ctx != NULL) && (pstr_stats != NULL));
+	TWI_MEMSET(pstr_stats, 0, sizeof(tstr_twi_ll_stats));
+
+	if(TWI_USB_LL == enu_ll_type)
+	{
+#if defined (TWI_USB_STACK_ENABLED)
+		twi_usb_ll_get_stats(&(puni_ctx->str_usb), pstr_stats);
+#endif
+	}
+}
+
 
 void twi_ll_is_ready_to_send(tenu_twi_ll_type enu_ll_type, tuni_ll_ctx * puni_ctx, twi_bool* pb_is_ready)
 {
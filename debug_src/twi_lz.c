@@ -0,0 +1,206 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_lz.c
+@brief		this file contains a small LZ77 codec with a bounded window, used to compress the stack messages.
+			The stream is a sequence of groups , each group is one flags byte followed by up to 8 items.
+			Bit N of the flags byte tells whether item N is a literal byte (0) or a match (1).
+			A match is 2 bytes: 12 bits of (offset - 1) then 4 bits of (length - 3).
+			A length nibble of 15 is followed by one more byte that is added to 18, so a match covers 3 to 273 bytes.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include "twi_lz.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define LZ_WINDOW_SZ			(4096)		/* Farthest a match can look back */
+#define LZ_MIN_MATCH			(3)
+#define LZ_EXT_LEN_CODE			(15)		/* Length nibble that is followed by an extension byte */
+#define LZ_MAX_MATCH			(LZ_MIN_MATCH + LZ_EXT_LEN_CODE + 0xFF)
+#define LZ_ITEMS_PER_GROUP		(8)
+#define LZ_HASH_BITS			(10)
+#define LZ_HASH_SZ				(1 << LZ_HASH_BITS)
+
+#define LZ_HASH(PU8)			((twi_u16)(((((twi_u32)(PU8)[0] << 16) | ((twi_u32)(PU8)[1] << 8) | (PU8)[2]) * 2654435761UL) >> (32 - LZ_HASH_BITS)) & (LZ_HASH_SZ - 1))
+
+//***********************************************************
+/*- LOCAL FUNCTIONS PROTOTYPES ----------------------------*/
+//***********************************************************
+
+//***********************************************************
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+//***********************************************************
+
+//***********************************************************
+/*- GLOBAL EXTERN VARIABLES -------------------------------*/
+//***********************************************************
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+
+/*
+* @brief		function compresses a buffer. Matches are found through a single entry hash table of the last 3 bytes positions.
+* @param[in]	pu8_src:	pointer to data buffer
+* @param[in]	u16_src_len:	length of data buffer
+* @param[out]	pu8_dst:	pointer to the compressed data buffer
+* @param[in]	u16_dst_cap:	size of the compressed data buffer
+* @return		compressed length , 0 if it doesn't fit in the compressed data buffer.
+*/
+twi_u16 twi_lz_compress(const twi_u8* pu8_src, twi_u16 u16_src_len, twi_u8* pu8_dst, twi_u16 u16_dst_cap)
+{
+	twi_u16 au16_hash[LZ_HASH_SZ];		/* Position + 1 of the last occurrence , 0 if none */
+	twi_u32 u32_src_idx = 0;
+	twi_u32 u32_dst_idx = 0;
+
+	for (twi_u32 u32_counter = 0; u32_counter < LZ_HASH_SZ; ++u32_counter)
+	{
+		au16_hash[u32_counter] = 0;
+	}
+
+	while (u32_src_idx < u16_src_len)
+	{
+		twi_u32 u32_flags_idx = u32_dst_idx;
+		twi_u8	u8_flags = 0;
+
+		if (u32_dst_idx >= u16_dst_cap)
+		{
+			return 0;
+		}
+		u32_dst_idx++;
+
+		for (twi_u8 u8_item = 0; (u8_item < LZ_ITEMS_PER_GROUP) && (u32_src_idx < u16_src_len); ++u8_item)
+		{
+			twi_u32 u32_match_len = 0;
+			twi_u32 u32_match_off = 0;
+
+			if ((u32_src_idx + LZ_MIN_MATCH) <= u16_src_len)
+			{
+				twi_u16 u16_hash = LZ_HASH(&pu8_src[u32_src_idx]);
+				twi_u32 u32_cand = au16_hash[u16_hash];
+
+				au16_hash[u16_hash] = (twi_u16)(u32_src_idx + 1);
+				if ((0 != u32_cand) && ((u32_src_idx - (u32_cand - 1)) <= LZ_WINDOW_SZ))
+				{
+					u32_cand--;
+					while (((u32_src_idx + u32_match_len) < u16_src_len) && (u32_match_len < LZ_MAX_MATCH) &&
+						   (pu8_src[u32_cand + u32_match_len] == pu8_src[u32_src_idx + u32_match_len]))
+					{
+						u32_match_len++;
+					}
+					u32_match_off = u32_src_idx - u32_cand;
+				}
+			}
+
+			if (u32_match_len >= LZ_MIN_MATCH)
+			{
+				twi_u32 u32_len_code = u32_match_len - LZ_MIN_MATCH;
+
+				if ((u32_dst_idx + 3) > u16_dst_cap)
+				{
+					return 0;
+				}
+				pu8_dst[u32_dst_idx++] = (twi_u8)((u32_match_off - 1) >> 4);
+				if (u32_len_code < LZ_EXT_LEN_CODE)
+				{
+					pu8_dst[u32_dst_idx++] = (twi_u8)((((u32_match_off - 1) & 0x0F) << 4) | u32_len_code);
+				}
+				else
+				{
+					pu8_dst[u32_dst_idx++] = (twi_u8)((((u32_match_off - 1) & 0x0F) << 4) | LZ_EXT_LEN_CODE);
+					pu8_dst[u32_dst_idx++] = (twi_u8)(u32_len_code - LZ_EXT_LEN_CODE);
+				}
+				u8_flags |= (twi_u8)(1 << u8_item);
+
+				/* Index the positions the match covers , so the next matches can point into it */
+				for (twi_u32 u32_counter = 1; (u32_counter < u32_match_len) && ((u32_src_idx + u32_counter + LZ_MIN_MATCH) <= u16_src_len); ++u32_counter)
+				{
+					au16_hash[LZ_HASH(&pu8_src[u32_src_idx + u32_counter])] = (twi_u16)(u32_src_idx + u32_counter + 1);
+				}
+				u32_src_idx += u32_match_len;
+			}
+			else
+			{
+				if (u32_dst_idx >= u16_dst_cap)
+				{
+					return 0;
+				}
+				pu8_dst[u32_dst_idx++] = pu8_src[u32_src_idx++];
+			}
+		}
+		pu8_dst[u32_flags_idx] = u8_flags;
+	}
+	return (twi_u16)u32_dst_idx;
+}
+
+/*
+* @brief		function decompresses a buffer compressed by @ref twi_lz_compress.
+* @param[in]	pu8_src:	pointer to the compressed data buffer
+* @param[in]	u16_src_len:	length of the compressed data buffer
+* @param[out]	pu8_dst:	pointer to data buffer
+* @param[in]	u16_dst_cap:	size of data buffer
+* @return		decompressed length , 0 if the compressed data is malformed or doesn't fit in the data buffer.
+*/
+twi_u16 twi_lz_decompress(const twi_u8* pu8_src, twi_u16 u16_src_len, twi_u8* pu8_dst, twi_u16 u16_dst_cap)
+{
+	twi_u32 u32_src_idx = 0;
+	twi_u32 u32_dst_idx = 0;
+
+	while (u32_src_idx < u16_src_len)
+	{
+		twi_u8 u8_flags = pu8_src[u32_src_idx++];
+
+		for (twi_u8 u8_item = 0; (u8_item < LZ_ITEMS_PER_GROUP) && (u32_src_idx < u16_src_len); ++u8_item)
+		{
+			if (0 != (u8_flags & (1 << u8_item)))
+			{
+				twi_u32 u32_match_off;
+				twi_u32 u32_match_len;
+
+				if ((u32_src_idx + 2) > u16_src_len)
+				{
+					return 0;
+				}
+				u32_match_off = ((((twi_u32)pu8_src[u32_src_idx]) << 4) | (pu8_src[u32_src_idx + 1] >> 4)) + 1;
+				u32_match_len = (pu8_src[u32_src_idx + 1] & 0x0F) + LZ_MIN_MATCH;
+				u32_src_idx += 2;
+				if ((LZ_EXT_LEN_CODE + LZ_MIN_MATCH) == u32_match_len)
+				{
+					if (u32_src_idx >= u16_src_len)
+					{
+						return 0;
+					}
+					u32_match_len += pu8_src[u32_src_idx++];
+				}
+				if ((u32_match_off > u32_dst_idx) || ((u32_dst_idx + u32_match_len) > u16_dst_cap))
+				{
+					return 0;
+				}
+				/* Byte by byte , the match may overlap the bytes it produces */
+				for (twi_u32 u32_counter = 0; u32_counter < u32_match_len; ++u32_counter, ++u32_dst_idx)
+				{
+					pu8_dst[u32_dst_idx] = pu8_dst[u32_dst_idx - u32_match_off];
+				}
+			}
+			else
+			{
+				if (u32_dst_idx >= u16_dst_cap)
+				{
+					return 0;
+				}
+				pu8_dst[u32_dst_idx++] = pu8_src[u32_src_idx++];
+			}
+		}
+	}
+	return (twi_u16)u32_dst_idx;
+}
@@ -62,7 +62,11 @@
 #define RESEND_FRAGMENT_TIMES 		    3
 #define SEND_FRAGMENT_TIMES 		    1
 #define RESEND_PACKET_TIMES 			3
+#define REASSEMBLY_ACK_TIMEOUT_MS		500
 #define BUFFER_SIZE_FOR_WINDOWS 		600
+
+#define FRGMT_BIT_SET(BITMAP, IDX)		( (BITMAP)[(IDX) >> 3] |= (twi_u8) ( 1 << ((IDX) & 0x07) ) )                  /** @brief:	Macro that marks fragment IDX in a fragments bitmap. */
+#define FRGMT_BIT_IS_SET(BITMAP, IDX)	( ( (BITMAP)[(IDX) >> 3] & ( 1 << ((IDX) & 0x07) ) ) ? TWI_TRUE : TWI_FALSE )  /** @brief:	Macro that checks fragment IDX in a fragments bitmap. */
 /*---------------------------------------------------------*/
 /*- STRUCTS AND UNIONS AND ENUM----------------------------*/
 /*---------------------------------------------------------*/
@@ -96,10 +100,26 @@ TWI_STATIC_FN void twi_ll_cb(tstr_twi_ll_evt* pstr_evt);
 static void twi_init_nl_global_variables(tstr_nl_ctx *pstr_ctx);
 
 /**
- *	@brief: This is the function that is used to fragment the PDU from APP to MTUs and send it to the link layer
+ *	@brief: This is the function that is used to send the next window of fragments that are not yet confirmed by the link layer.
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
 */
-static twi_s32 twi_nl_snd_fgmnts(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len);
+static twi_s32 twi_nl_snd_fgmnts_window(tstr_nl_ctx *pstr_ctx);
+
+/**
+ *	@brief: This is the function that is used to get the number of fragments that can be in flight at once.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@return	    The send window size in fragments, 1 if the link layer can't batch.
+*/
+static twi_u8 twi_nl_get_snd_window_size(tstr_nl_ctx *pstr_ctx);
+
+/**
+ *	@brief: This is the function that is used to describe the current fragment ( fragment header , fragment data and the CRC if it is the last fragment ) as link layer segments.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [out] pu8_hdr_crc	Pointer to a scratch buffer of ( FRAGMENT_HEADER_LEN + CRC_SZ ) bytes that holds the fragment header and the packet CRC.
+ *	@param [out] pstr_iov		Pointer to an array of 3 segments, the fragment data segment points into the packet buffer.
+ *	@return	    The number of segments used.
+*/
+static twi_u8 twi_nl_build_fgmnt(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_hdr_crc, tstr_twi_ll_iovec* pstr_iov);
 
 /**
  *	@brief:	This function calculate fragmentation data needed.
@@ -132,12 +152,72 @@ static tenu_stack_err_code  twi_nl_validate_rcv_fgmnt_header( tstr_nl_ctx *pstr_
 */
 static tenu_stack_err_code  twi_nl_rcv_fgmnt( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len );
 
+/**
+ *	@brief: NACK the missing fragments of the packet being reassembled.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in] str_fragment_header  	header of the fragment that ended the round, it carries the packet sequence number.
+*/
+static void twi_nl_snd_missing_frgmnts( tstr_nl_ctx *pstr_ctx , tstr_fragment_header str_fragment_header );
+
+/**
+ *	@brief: Resend the fragments NACKed by the receiver if the packet is still held.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_nack		Pointer to the NACK data : fragment header then the missing fragments bitmap.
+ *	@param [in]	u16_nack_len    NACK data length.
+ *	@return	    TWI_TRUE if fragments are scheduled for resending.
+*/
+static twi_bool twi_nl_rcv_missing_frgmnts( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_nack , twi_u16 u16_nack_len );
+
+/**
+ *	@brief: Acknowledge the reassembled packet once both sides agreed on TWI_LL_CAP_REASSEMBLY_ACK.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in] str_fragment_header  	fragment header carrying the packet sequence number.
+*/
+static void twi_nl_snd_reassembly_ack( tstr_nl_ctx *pstr_ctx , tstr_fragment_header str_fragment_header );
+
+/**
+ *	@brief: Match a reassembly acknowledgement with the packet being sent.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_ack			Pointer to the acknowledgement data : the fragment header , NULL for a packet received from the peer.
+ *	@param [in]	u16_ack_len     Acknowledgement data length.
+ *	@return	    TWI_TRUE if the packet was waiting for it and is done.
+*/
+static twi_bool twi_nl_rcv_reassembly_ack( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_ack , twi_u16 u16_ack_len );
+
+/**
+ *	@brief: Stop waiting for the reassembly acknowledgement of the packet being sent.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+*/
+static void twi_nl_stop_ack_wait( tstr_nl_ctx *pstr_ctx );
+
+/**
+ *	@brief: The reassembly acknowledgement didn't come in time , resend the last fragment.
+ *	@param [in] pv  	  		pointer to the network layer context.
+*/
+static void twi_nl_ack_timeout_cb( void* pv );
+
+/**
+ *	@brief: Release the sent packet and fill the success send status event.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [out] pstr_nl_evt  	the send status event to raise.
+*/
+static void twi_nl_snd_pkt_done( tstr_nl_ctx *pstr_ctx , tstr_twi_nl_evt* pstr_nl_evt );
+
 /**
  *	@brief: Propagate Failure Sending To the upper Layer
  *	@param [in]  pstr_ctx  : 	a pointer to the context structure that contains all the needed context data.
 */
 static void twi_nl_propagate_snd_fail(tstr_nl_ctx *pstr_ctx );
 
+/**
+ *	@brief: Start sending a packet.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_data		Pointer to data to be sent.
+ *	@param [in]	u16_data_len    Data length.
+ *  @param [in]	pv_arg    		User argument.
+*/
+static void twi_nl_start_pkt(tstr_nl_ctx *pstr_ctx, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+
 /**
  *	@brief: Preparing fragment structure for next packet 
 */
@@ -148,6 +228,27 @@ static void twi_nl_prepare_frgmt_next_pkt(tstr_nl_ctx *pstr_ctx);
 */
 static void twi_nl_prepare_defrgmt_next_pkt(tstr_nl_ctx *pstr_ctx);
 
+/**
+ *	@brief: Clearing the reassembly state ( received fragments bitmap , last fragment and NACK rounds ) of the packet being received
+*/
+static void twi_nl_reset_reassembly(tstr_nl_ctx *pstr_ctx);
+
+/**
+ *	@brief: Pick a reassembly buffer that is not held by the upper layer for the next packet , none is picked if all of them are held
+*/
+static void twi_nl_get_free_rcv_buf(tstr_nl_ctx *pstr_ctx);
+
+/**
+ *	@brief: Find the reassembly buffer the passed pointer points into , the upper layer may skip its own header before passing the data on
+ *	@return	    Pointer to the reassembly buffer , NULL if the pointer is not in a reassembly buffer.
+*/
+static tstr_twi_nl_rcv_buf* twi_nl_find_rcv_buf(tstr_nl_ctx *pstr_ctx, twi_u8* pu8_buf);
+
+/**
+ *	@brief: Release all the reassembly buffers , on disconnection the upper layer drops the buffers it holds
+*/
+static void twi_nl_reset_rcv_bufs(tstr_nl_ctx *pstr_ctx);
+
 /**
 *	@brief		This is an API to get the size of fragment payload = (twi_nl_get_fragment_threshold_size() - FRAGMENT_HEADER_LEN ).
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
@@ -179,40 +280,50 @@ TWI_STATIC_FN void twi_ll_cb(tstr_twi_ll_evt* pstr_evt)
 		case TWI_LL_SEND_STATUS_EVT:
 		{
 			NTWRK_LOG_INFO("TWI_LL_SEND_STATUS_EVT\r\n");
-			/* check if the fragment is sent successfully */
+			/* check if the fragment window is sent successfully */
 			if( TWI_TRUE == pstr_evt->uni_data.str_send_stts_evt.b_is_success)
 			{	
-				pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index++;
+				twi_u8 u8_idx;
 
-				/* Send next fragment */
-				if ( pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index < pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num )
+				/* Every fragment of the window is confirmed */
+				for ( u8_idx = 0; u8_idx < sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap); u8_idx++ )
+				{
+					pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap[u8_idx] 	  |= pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap[u8_idx];
+					pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap[u8_idx]  = 0;
+				}
+				pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num 	   += pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num;
+				pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num 	= 0;
+
+				/* Send next window */
+				if ( pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num < pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num )
 				{
 					pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
 	
 					pstr_ctx->str_global.u8_resend_frgmt_cnt 					 = 0;
-					pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf 		+= twi_nl_get_fragment_payload_size(pstr_ctx) ;							// Point to next fragment 	
 					pstr_ctx->str_global.b_need_send 							 = TWI_TRUE;
 					str_nl_evt.enu_event 								   		 = TWI_NL_INVALID_EVT;
 				}
+				/* Full Packet is sent , hold it till the receiver acknowledges its reassembly so the NACKed fragments can be resent */
+				else if ( ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) ) && ( TWI_FALSE == pstr_ctx->str_global.b_is_ack_rcvd ) )
+				{
+					pstr_ctx->str_global.b_is_ack_pending 						 = TWI_TRUE;
+					TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pf_start_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_ack_timer), (twi_s8*)"NL Reassembly Ack", TWI_TIMER_TYPE_ONE_SHOT, REASSEMBLY_ACK_TIMEOUT_MS, twi_nl_ack_timeout_cb, (void*) pstr_ctx));
+					str_nl_evt.enu_event 								   		 = TWI_NL_INVALID_EVT;
+				}
 				/* Full Packet is sent successfully */
 				else
 				{
-					twi_nl_prepare_frgmt_next_pkt(pstr_ctx);
-		
-					pstr_ctx->str_global.b_send_in_progress 					 = TWI_FALSE;
-					TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);	
-					pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number = ~ (pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number) ;
-
-					str_nl_evt.enu_event 										 = TWI_NL_SEND_STATUS_EVT;
-					str_nl_evt.uni_data.str_send_stts_evt.b_is_success 			 = pstr_evt->uni_data.str_send_stts_evt.b_is_success;
-					str_nl_evt.uni_data.str_send_stts_evt.pv_user_arg 			 = pstr_evt->uni_data.str_send_stts_evt.pv_user_arg;
+					twi_nl_snd_pkt_done( pstr_ctx , &str_nl_evt );
 				}
 			}
 			else
 			{
-				/* In Dispatcher : Resend Fragment up to three times then propagate to the upper layer*/
+				/* In Dispatcher : Resend the fragments of the failed window up to three times then propagate to the upper layer*/
+				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap) );
+				pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num = 0;
 				pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
 				pstr_ctx->str_global.u8_resend_frgmt_cnt++;
+				pstr_ctx->str_global.str_stats.u32_tx_retries_cnt++;
 				pstr_ctx->str_global.b_need_send 								 = TWI_TRUE;
 				str_nl_evt.enu_event 											 = TWI_NL_INVALID_EVT;
 			}
@@ -224,47 +335,89 @@ TWI_STATIC_FN void twi_ll_cb(tstr_twi_ll_evt* pstr_evt)
 			NTWRK_LOG_INFO("TWI_LL_RCV_DATA_EVT\r\n");
 			tenu_stack_err_code enu_retval = TWI_STACK_INVALID_ERR_CODE;
 
-			if(TWI_FALSE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked)
+			pstr_ctx->str_global.str_stats.u32_rx_frgmts_cnt++;
+			if(NULL != pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf)
 			{
 				/* Receive Fragment */
 				enu_retval = twi_nl_defragment( pstr_ctx , pstr_evt->uni_data.str_rcv_data_evt.pu8_data , pstr_evt->uni_data.str_rcv_data_evt.u16_data_len) ;
 			}
 
+			/* Every reassembly buffer is held by the upper layer */
+			if(NULL == pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf)
+			{
+				NTWRK_LOG_ERR("No Free Reassembly Buffer , Fragment Is Dropped\r\n");
+				pstr_ctx->str_global.str_stats.u32_rx_errors_cnt++;
+				str_nl_evt.enu_event 									= TWI_NL_INVALID_EVT;
+			}
 			/* Success */
-			if((TWI_STACK_INVALID_ERR_CODE == enu_retval) && (TWI_FALSE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked))
+			else if(TWI_STACK_INVALID_ERR_CODE == enu_retval)
 			{
-				/* receive fragment header from first byte of fragment */
-				tstr_fragment_header str_fragment_header;
-
-				TWI_MEMCPY( &str_fragment_header , pstr_evt->uni_data.str_rcv_data_evt.pu8_data, FRAGMENT_HEADER_LEN );
-
-				if ( 1 == str_fragment_header.u8_last_fragment_flag )
+				/* Every fragment up to the last one is received and the CRC matches */
+				if ( TWI_TRUE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_complete )
 				{
+					/* Acknowledged from the dispatcher , unless a packet to the peer starts first and stands for the acknowledgement */
+					if ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) )
+					{
+						pstr_ctx->str_global.b_is_ack_due 		= TWI_TRUE;
+						pstr_ctx->str_global.str_ack_frgmnt_header 	= pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header;
+						pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+					}
+					/* Likewise this packet stands for the acknowledgement of the packet being sent */
+					if ( TWI_TRUE == twi_nl_rcv_reassembly_ack( pstr_ctx , NULL , 0 ) )
+					{
+						tstr_twi_nl_evt str_snd_evt;
+
+						TWI_MEMSET(&str_snd_evt, 0, sizeof(tstr_twi_nl_evt));
+						twi_nl_snd_pkt_done( pstr_ctx , &str_snd_evt );
+						str_snd_evt.pv_args = pstr_ctx->str_global.pv_args;
+						TWI_ASSERT(NULL != pstr_ctx->str_global.pf_nl_cb);
+						pstr_ctx->str_global.pf_nl_cb(&str_snd_evt);
+					}
 					/* Logging Full Reassembled Packet For Testing */
-					NTWRK_LOG_HEX("reassembled Packet : \r\n", pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf , pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx );
+					NTWRK_LOG_HEX("reassembled Packet : \r\n", pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf , pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx );
+					pstr_ctx->str_global.str_stats.u32_rx_pkts_cnt++;
 
 					str_nl_evt.enu_event 									= TWI_NL_RCV_DATA_EVT;
-					str_nl_evt.uni_data.str_rcv_data_evt.pu8_data			= pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf ;
+					str_nl_evt.uni_data.str_rcv_data_evt.pu8_data			= pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf ;
 					str_nl_evt.uni_data.str_rcv_data_evt.u16_data_len		= pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx ;
 
-					/*Lock the buffer, to be unlocked from the app layer*/
-					pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked 				= TWI_TRUE;
-					/* Expect next packet */
+					/*Hand the buffer to the app layer with one reference, it is reused once all the references are released*/
+					twi_nl_find_rcv_buf( pstr_ctx , pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf )->u8_ref_cnt = 1;
+					/* Expect next packet in a free reassembly buffer */
 					twi_nl_prepare_defrgmt_next_pkt(pstr_ctx);
+					twi_nl_get_free_rcv_buf(pstr_ctx);
 				}
 				else
 				{
 					str_nl_evt.enu_event 									= TWI_NL_INVALID_EVT;
 				}
 			}	
+			/* Resent Fragment that is already received */
+			else if ( TWI_NL_ERR_DUPLCT_FRGMNT == enu_retval )
+			{
+				NTWRK_LOG_INFO("Duplicated Fragment Is Ignored\r\n");
+				pstr_ctx->str_global.str_stats.u32_rx_duplicates_cnt++;
+				str_nl_evt.enu_event 									= TWI_NL_INVALID_EVT;
+			}
 			/* Fragmentation Error */
 			else if ( ( enu_retval >=TWI_NL_ERR_BASE ) && ( enu_retval < TWI_SL_ERR_BASE ) ) 
 			{
 				NTWRK_LOG_ERR("Failed To Receive Data From Link Layer With Error = %d\r\n", enu_retval);
+				if ( TWI_NL_ERR_INV_CRC == enu_retval )
+				{
+					pstr_ctx->str_global.str_stats.u32_rx_crc_errors_cnt++;
+				}
+				else if ( TWI_NL_ERR_FRGMNT_OUT_OF_ORDR == enu_retval )
+				{
+					pstr_ctx->str_global.str_stats.u32_rx_out_of_order_cnt++;
+				}
+				else
+				{
+					pstr_ctx->str_global.str_stats.u32_rx_errors_cnt++;
+				}
 				
-				/* discard all the available fragments of the current packet sequence number  */ 
+				/* discard all the available fragments of the current packet sequence number , the reassembly bitmap is cleared so the stale buffer content is never delivered */ 
 				twi_nl_prepare_defrgmt_next_pkt(pstr_ctx);
-				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf) );
 
 				/* send the fragmentation error message to the fragmentation layer of the initiator on the control characteristic, with the specific error type */	
 				twi_ll_send_error( pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx) , enu_retval ,pstr_evt->uni_data.str_rcv_data_evt.pu8_data ,  sizeof(tenu_stack_err_code) );
@@ -276,7 +429,7 @@ TWI_STATIC_FN void twi_ll_cb(tstr_twi_ll_evt* pstr_evt)
 			{	
 				/* discard all the available fragments of the current packet sequence number  */ 
 				twi_nl_prepare_defrgmt_next_pkt(pstr_ctx);
-				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf) );
+				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[0].au8_pkt_buf) );
 
 				NTWRK_LOG_ERR("Failed To Receive Data From Link Layer With Error = %d\r\n", enu_retval);
 				str_nl_evt.enu_event 									= TWI_NL_RCV_DATA_EVT;
@@ -289,14 +442,50 @@ TWI_STATIC_FN void twi_ll_cb(tstr_twi_ll_evt* pstr_evt)
 		case TWI_LL_RCV_ERROR_EVT:
 		{
 			NTWRK_LOG_INFO("TWI_LL_RCV_ERROR_EVT\r\n");
-			if (  ( pstr_evt->uni_data.str_rcv_error_evt.enu_err_code > TWI_NL_ERR_BASE ) && ( pstr_evt->uni_data.str_rcv_error_evt.enu_err_code < TWI_SL_ERR_BASE) )
+			if ( TWI_NL_ERR_FRGMNTS_MISSING == pstr_evt->uni_data.str_rcv_error_evt.enu_err_code )
+			{
+				/* The receiver NACKed some fragments , resend only them */
+				if ( TWI_TRUE == twi_nl_rcv_missing_frgmnts( pstr_ctx , pstr_evt->uni_data.str_rcv_error_evt.pu8_err_data , pstr_evt->uni_data.str_rcv_error_evt.u16_err_data_len ) )
+				{
+					twi_nl_stop_ack_wait(pstr_ctx);
+					NTWRK_LOG_INFO("Resend Missing Fragments , Done : %d of %d\r\n", pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num , pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num );
+					pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+					pstr_ctx->str_global.b_need_send 						= TWI_TRUE;
+					pstr_ctx->str_global.u8_resend_frgmt_cnt++;
+					pstr_ctx->str_global.str_stats.u32_tx_retries_cnt++;
+				}
+				else
+				{
+					NTWRK_LOG_ERR("Missing Fragments NACK Of Released Packet Is Ignored\r\n");
+				}
+				str_nl_evt.enu_event 									= TWI_NL_INVALID_EVT;
+			}
+			else if ( TWI_NL_PKT_REASSEMBLED == pstr_evt->uni_data.str_rcv_error_evt.enu_err_code )
+			{
+				/* The receiver has the whole packet , release it */
+				if ( TWI_TRUE == twi_nl_rcv_reassembly_ack( pstr_ctx , pstr_evt->uni_data.str_rcv_error_evt.pu8_err_data , pstr_evt->uni_data.str_rcv_error_evt.u16_err_data_len ) )
+				{
+					twi_nl_snd_pkt_done( pstr_ctx , &str_nl_evt );
+				}
+				else
+				{
+					str_nl_evt.enu_event 								= TWI_NL_INVALID_EVT;
+				}
+			}
+			else if (  ( pstr_evt->uni_data.str_rcv_error_evt.enu_err_code > TWI_NL_ERR_BASE ) && ( pstr_evt->uni_data.str_rcv_error_evt.enu_err_code < TWI_SL_ERR_BASE) )
 			{
 				/* Fragmentation Error */
 				NTWRK_LOG_ERR("Fragmentation Error = %d\r\n", pstr_evt->uni_data.str_rcv_error_evt.enu_err_code);
-				/* Resend fragment */
+				/* The receiver dropped the partial packet, resend it from the first fragment */
+				twi_nl_stop_ack_wait(pstr_ctx);
+				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap) );
+				TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap) );
+				pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num 	 = 0;
+				pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num = 0;
 				pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
 				pstr_ctx->str_global.b_need_send 						= TWI_TRUE;
 				pstr_ctx->str_global.u8_resend_frgmt_cnt++;
+				pstr_ctx->str_global.str_stats.u32_tx_retries_cnt++;
 	
 				str_nl_evt.enu_event 									= TWI_NL_INVALID_EVT;
 			}	
@@ -344,9 +533,16 @@ static void twi_init_nl_global_variables(tstr_nl_ctx *pstr_ctx)
 	pstr_ctx->str_global.u8_resend_frgmt_cnt					= 0;
 	pstr_ctx->str_global.u8_resend_packet_cnt  					= 0;
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num = 0;
+	pstr_ctx->str_global.u8_snd_wnd_sz							= 0;
+	pstr_ctx->str_global.u32_tx_pkt_start_ms					= 0;
+	pstr_ctx->str_global.b_is_ack_pending						= TWI_FALSE;
+	pstr_ctx->str_global.b_is_ack_rcvd							= TWI_FALSE;
+	pstr_ctx->str_global.b_is_ack_due							= TWI_FALSE;
 
 	TWI_MEMSET( &pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header , 0 , FRAGMENT_HEADER_LEN );
+	TWI_MEMSET( &pstr_ctx->str_global.str_stats , 0 , sizeof(pstr_ctx->str_global.str_stats) );
 	TWI_MEMSET( &pstr_ctx->str_global.str_twi_nl_defgmt_data , 0x00 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data) );
+	twi_nl_get_free_rcv_buf(pstr_ctx);
 }
 
 /**
@@ -368,86 +564,151 @@ static void twi_nl_fragment_prepare(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, tw
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_data_len 		= u16_data_len;													// Passing data length to global fragmentation structure
 
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg 			= pv_arg;														// Passing user argment to global fragmentation structure 
+
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num 		= 0;														// No fragment is confirmed yet
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc 					= 0;														// Running CRC of the packet data described so far
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc_len 				= 0;
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num 	= 0;
+	TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap) );
+	TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap) );
 	
 	NTWRK_LOG_INFO("Fragments Number: %d \r\n", pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num  );					// Logging Fragment For Info 
 }
 
 /**
- *	@brief: This is the function that is used to fragment the PDU from APP to fragments and send it to the link layer
+ *	@brief: This is the function that is used to describe the current fragment ( fragment header , fragment data and the CRC if it is the last fragment ) as link layer segments.
+ *			The fragment data is not copied here, its segment points into the packet buffer and the link layer gathers it into the outgoing frame.
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
 */
-static twi_s32 twi_nl_snd_fgmnts(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len)
+static twi_u8 twi_nl_build_fgmnt(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_hdr_crc, tstr_twi_ll_iovec* pstr_iov)
 {
-	TWI_ASSERT( (NULL != pu8_data) && (0 != u16_data_len) );
+	twi_u8	u8_iov_num 		= 0;
+	twi_u16 u16_data_len 	= pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_data_len;
+	twi_u16 u16_sent_data 	= pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index * twi_nl_get_fragment_payload_size(pstr_ctx);	// Packet data carried by the previous fragments
+	twi_u16 u16_frgmt_data 	= 0;
 
-	twi_s32 s32_retval = TWI_SUCCESS ;
-#ifndef WIN32
-	twi_u8	au8_frgmt_buf[twi_nl_get_fragment_threshold_size(pstr_ctx)];																 // U8 Array buffer to save ( fragment header , fragment data ) and send it 
-#else
-	twi_u8*	au8_frgmt_buf = calloc(1, twi_nl_get_fragment_threshold_size(pstr_ctx));
-#endif
-	TWI_MEMSET( au8_frgmt_buf , 0 , sizeof(au8_frgmt_buf)  );													 // Clear Data Buffer 
+	u16_sent_data = (u16_data_len < u16_sent_data)? u16_data_len:u16_sent_data;
 
-	twi_u16 u16_fgmnt_size = 0;																					 // U16 to save fragment size <= twi_nl_get_fragment_threshold_size()  = ( FRAGMENT_HEADER_LEN + twi_nl_get_fragment_payload_size()  ) 
+	/* Put fragment header on first segment */
+	TWI_MEMCPY( pu8_hdr_crc , &pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header , FRAGMENT_HEADER_LEN );
+	pstr_iov[u8_iov_num].pu8_data 	= pu8_hdr_crc;
+	pstr_iov[u8_iov_num].u16_len 	= FRAGMENT_HEADER_LEN;
+	u8_iov_num++;
 
-	/* Check if we need to resend fragment or not : in case of resending we shouldn't update the fragment structure with the next fragment data and resend the fragment */
-	if ( 0 == pstr_ctx->str_global.u8_resend_frgmt_cnt  )
+	/* Check the last fragment */
+	if (  1 != pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag  )
 	{
-		/* Set last fragment flag if this is the last fragment */
-		if ( pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index == ( pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num - 1 ) )
-		{
-			pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag = 1;
-		}
-	}	
+		u16_frgmt_data = u16_data_len - u16_sent_data;
+		u16_frgmt_data = (u16_frgmt_data >= twi_nl_get_fragment_payload_size(pstr_ctx))? twi_nl_get_fragment_payload_size(pstr_ctx): u16_frgmt_data;
+	}
 	else
 	{
-		/************** Resend the fragment *****************/
-		NTWRK_LOG_INFO("Resend Fragment Times : %d\r\n", pstr_ctx->str_global.u8_resend_frgmt_cnt );
+		/* Remaining data in the last fragment */
+		u16_frgmt_data = u16_data_len - u16_sent_data;
 	}
 
-	/* Put fragment header on first byte of buffer */
-	TWI_MEMCPY( au8_frgmt_buf , &pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header , 1 );
+	/* Fragment data segment points to the fragment data inside the packet */
+	if ( 0 != u16_frgmt_data )
+	{
+		pstr_iov[u8_iov_num].pu8_data 	= &pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf[u16_sent_data];
+		pstr_iov[u8_iov_num].u16_len 	= u16_frgmt_data;
+		u8_iov_num++;
+	}
 
-	/* Check the last fragment */
-	if (  1 != pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag  )
+	/* Fold the fragment data in the running CRC the first time it is described , retransmits find it already folded */
+	if ( u16_sent_data == pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc_len )
 	{
-		twi_u16 u16_remain_sz = u16_data_len - (pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index * twi_nl_get_fragment_payload_size(pstr_ctx));
-		u16_fgmnt_size = (u16_remain_sz >= twi_nl_get_fragment_payload_size(pstr_ctx))? twi_nl_get_fragment_threshold_size(pstr_ctx): (u16_remain_sz + FRAGMENT_HEADER_LEN);		
-		/* Filling fragment data in fragment buffer after fragment header */
-		TWI_MEMCPY( &au8_frgmt_buf[1] , pu8_data , u16_fgmnt_size - FRAGMENT_HEADER_LEN);
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc 	  = twi_crc16_compute_checksum ( pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc, &pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf[u16_sent_data] , u16_frgmt_data );
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc_len += u16_frgmt_data;
 	}
-	else
+
+	if (  1 == pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag  )
 	{
-		twi_u16 u16_max_sent_data = pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index  * twi_nl_get_fragment_payload_size(pstr_ctx);
-		twi_u16 u16_sent_data = (u16_data_len < u16_max_sent_data)? u16_data_len:u16_max_sent_data;
-		u16_fgmnt_size = FRAGMENT_HEADER_LEN + u16_data_len + CRC_SZ - u16_sent_data;
-	
-		/* Filling remaining data in the last fragment */
-		TWI_MEMCPY( &au8_frgmt_buf[1] , pu8_data , ( u16_fgmnt_size - ( CRC_SZ + FRAGMENT_HEADER_LEN ) ) ) ;
+		/* The fragments are always described in order before the last one , so the running CRC already covers the full packet */
+		TWI_ASSERT( pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc_len == u16_data_len );
+
+		/* Filling The CRC of the Full Packet in the last segment */
+		TWI_MEMCPY( &pu8_hdr_crc[FRAGMENT_HEADER_LEN] , &pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc , CRC_SZ);
+		pstr_iov[u8_iov_num].pu8_data 	= &pu8_hdr_crc[FRAGMENT_HEADER_LEN];
+		pstr_iov[u8_iov_num].u16_len 	= CRC_SZ;
+		u8_iov_num++;
+	}
+
+	/* Log Fragment For Debuging */
+	NTWRK_LOG_INFO("Fragment Header : Fragment Index : %d , Packet Sequence Number : %d , Last Fragment Flag : %d , Data Length : %d \r\n",pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index , pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number , pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag , u16_frgmt_data);
+
+	return u8_iov_num;
+}
 
-		/* Calculate CRC */
+/**
+ *	@brief: This is the function that is used to send the next window of fragments that are not yet confirmed by the link layer.
+ *			Up to twi_nl_get_snd_window_size() fragments are described from the packet start and handed to the link layer in one batch
+ *			( or one by one through twi_ll_send_data_iov if the link layer can't batch ). The sent fragments are marked in the
+ *			in flight bitmap and move to the done bitmap on the TWI_LL_SEND_STATUS_EVT, so a failed window only resends its own fragments.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+*/
+static twi_s32 twi_nl_snd_fgmnts_window(tstr_nl_ctx *pstr_ctx)
+{
+	TWI_ASSERT( (NULL != pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf) && (0 != pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_data_len) );
 
-		/* Repoint to the start of the full packet to calculate the crc to the full packet */
-		if ( 0 != pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index )
+	twi_s32 s32_retval = TWI_SUCCESS ;
+	twi_u8	au8_hdr_crc[FRAGMENT_HEADER_LEN + CRC_SZ];																					 // Fragment header and packet CRC, the fragment data is gathered by the link layer straight from the packet
+	tstr_twi_ll_iovec astr_iov[3];
+	twi_u8	u8_iov_num 		= 0;
+	twi_u8	u8_wnd_sz 		= twi_nl_get_snd_window_size(pstr_ctx);
+	twi_bool b_use_batch 	= ( 0 != twi_ll_get_batch_capacity(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx)) ) ? TWI_TRUE : TWI_FALSE;
+	twi_u8	u8_staged_num 	= 0;
+	twi_u16 u16_frgmt_idx 	= 0;
+
+	if ( 0 != pstr_ctx->str_global.u8_resend_frgmt_cnt )
+	{
+		NTWRK_LOG_INFO("Resend Window Times : %d\r\n", pstr_ctx->str_global.u8_resend_frgmt_cnt );
+	}
+
+	TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap) );
+
+	for ( u16_frgmt_idx = 0; ( u16_frgmt_idx < pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num ) && ( u8_staged_num < u8_wnd_sz ) && ( TWI_SUCCESS == s32_retval ); u16_frgmt_idx++ )
+	{
+		if ( TWI_FALSE == FRGMT_BIT_IS_SET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap , u16_frgmt_idx ) )
 		{
-			pu8_data -= ( ( pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index ) * twi_nl_get_fragment_payload_size(pstr_ctx) ) ;
-		}
+			pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index 	= u16_frgmt_idx ;
+			pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag = ( u16_frgmt_idx == ( pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num - 1 ) ) ? 1 : 0 ;
 
-		twi_u16 u16_packet_crc = twi_crc16_compute_checksum ( 0, pu8_data , u16_data_len );
+			u8_iov_num = twi_nl_build_fgmnt(pstr_ctx, au8_hdr_crc, astr_iov);
 
-		/* Filling The CRC of the Full Packet in the last fragment */
-		TWI_MEMCPY( &au8_frgmt_buf[ ( u16_fgmnt_size - CRC_SZ  ) ]  , &u16_packet_crc , CRC_SZ);
-	}	
+			if ( TWI_TRUE == b_use_batch )
+			{
+				s32_retval = twi_ll_add_batch_data(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx), astr_iov, u8_iov_num);
+			}
+			else
+			{
+				s32_retval = twi_ll_send_data_iov(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx), astr_iov, u8_iov_num, pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg ) ;
+			}
 
-	/************* Send Fragment *************/
+			FRGMT_BIT_SET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , u16_frgmt_idx );
+			u8_staged_num++;
+		}
+	}
 
-	/* Log Fragment For Debuging */
-	NTWRK_LOG_INFO("Fragment Header : Fragment Index : %d , Packet Sequence Number : %d , Last Fragment Flag : %d \r\n",pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_fragment_index , pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number , pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag);
-	NTWRK_LOG_HEX("Fragment : ",au8_frgmt_buf ,u16_fgmnt_size );
+	/************* Send Window *************/
+	if ( ( TWI_SUCCESS == s32_retval ) && ( TWI_TRUE == b_use_batch ) )
+	{
+		s32_retval = twi_ll_send_batch(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx), pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg);
+	}
 
-	/* Mapping the error Here to NETWORK LAYER BUSY "BLE BUSY" in case of TWI_USE_BLE_STACK or "USB_BUSY" in case of TWI_USE_USB_STACK */
-	s32_retval = twi_ll_send_data(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx) ,au8_frgmt_buf, u16_fgmnt_size , pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg ) ;
+	if ( TWI_SUCCESS == s32_retval )
+	{
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num = u8_staged_num;
+		pstr_ctx->str_global.str_stats.u32_tx_frgmts_cnt 				+= u8_staged_num;
+	}
+	else
+	{
+		/* Nothing of this window is in flight, it is rebuilt on the next try */
+		TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_inflight_bitmap) );
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num = 0;
+	}
 
+	/* Mapping the error Here to NETWORK LAYER BUSY "BLE BUSY" in case of TWI_USE_BLE_STACK or "USB_BUSY" in case of TWI_USE_USB_STACK */
 #if defined (TWI_BLE_STACK_ENABLED)
 	if(s32_retval == TWI_ERR_BLE_HAL_NRF_BUSY)
 	{
@@ -463,12 +724,35 @@ static twi_s32 twi_nl_snd_fgmnts(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u
 #endif
 	/*****************************************/
 
-#ifdef WIN32
-	free(au8_frgmt_buf);
-#endif
 	return s32_retval;
 }
 
+/**
+ *	@brief: This is the function that is used to get the number of fragments that can be in flight at once.
+ *			The configured window is bounded by the link layer batch capacity. 0 selects the whole capacity.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@return	    The send window size in fragments, 1 if the link layer can't batch.
+*/
+static twi_u8 twi_nl_get_snd_window_size(tstr_nl_ctx *pstr_ctx)
+{
+	twi_u16 u16_capacity = twi_ll_get_batch_capacity(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx));
+	twi_u16 u16_wnd_sz 	 = pstr_ctx->str_global.u8_snd_wnd_sz;
+
+	if ( ( 0 == u16_wnd_sz ) || ( u16_wnd_sz > u16_capacity ) )
+	{
+		u16_wnd_sz = u16_capacity;
+	}
+	if ( 0 == u16_wnd_sz )
+	{
+		u16_wnd_sz = 1;
+	}
+	else if ( u16_wnd_sz > 0xFF )
+	{
+		u16_wnd_sz = 0xFF;
+	}
+	return (twi_u8) u16_wnd_sz;
+}
+
 /**
  *	@brief:	This function receive fragments and make defragmentation 
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
@@ -506,6 +790,7 @@ static tenu_stack_err_code  twi_nl_defragment( tstr_nl_ctx *pstr_ctx ,twi_u8* pu
 
 /**
  *	@brief: Receive and Check Fragment Header
+ *			Fragments of the expected packet are accepted in any order, the reassembly bitmap tells the missing ones apart from the duplicated ones.
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
 */
 static tenu_stack_err_code twi_nl_validate_rcv_fgmnt_header( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data )
@@ -517,36 +802,48 @@ static tenu_stack_err_code twi_nl_validate_rcv_fgmnt_header( tstr_nl_ctx *pstr_c
 	/* receive fragment header from first byte of fragment */
 	TWI_MEMCPY( &str_fragment_header , pu8_data , FRAGMENT_HEADER_LEN );
 
-	/* Check Duplicated Fragment */
-	if ( str_fragment_header.u8_fragment_index != ( pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index - 1 ) )
+	/* Check Packet Sequence Number */
+	if ( str_fragment_header.u8_packet_sequence_number == pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number )
 	{
-		/* Check Out of order Fragment */
-		if ( str_fragment_header.u8_fragment_index == pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index )
+		/* Check Duplicated Fragment */
+		if ( TWI_FALSE == FRGMT_BIT_IS_SET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap , str_fragment_header.u8_fragment_index ) )
 		{
-			/* Check Packet Sequence Number */
-			if ( str_fragment_header.u8_packet_sequence_number == pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number )
+			/* Check Out of order Fragment : nothing comes after the last fragment */
+			if ( ( ( TWI_TRUE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_last_frgmt_rcvd ) && ( str_fragment_header.u8_fragment_index > pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx ) ) ||
+				 ( ( 1 == str_fragment_header.u8_last_fragment_flag ) && ( 0 != pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num ) && ( str_fragment_header.u8_fragment_index < pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_max_rcvd_idx ) ) )
 			{
-				pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index++;	
-			}
-			else
-			{
-				enu_retval = TWI_NL_ERR_INCMPLT_PKT;
+				enu_retval = TWI_NL_ERR_FRGMNT_OUT_OF_ORDR;
 			}
 		}
 		else
 		{
-			enu_retval = TWI_NL_ERR_FRGMNT_OUT_OF_ORDR;
+			/* The sender missed the NACK and resent the last fragment , NACK again what is still missing */
+			if ( ( 1 == str_fragment_header.u8_last_fragment_flag ) && ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) ) &&
+				 ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_cnt < RESEND_FRAGMENT_TIMES ) )
+			{
+				twi_nl_snd_missing_frgmnts( pstr_ctx , str_fragment_header );
+			}
+			enu_retval = TWI_NL_ERR_DUPLCT_FRGMNT;
 		}
 	}
-	else
+	/* The packet is delivered already and the sender missed its acknowledgement , acknowledge it again */
+	else if ( ( 1 == str_fragment_header.u8_last_fragment_flag ) && ( 0 == pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num ) &&
+			  ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) ) )
 	{
+		twi_nl_snd_reassembly_ack( pstr_ctx , str_fragment_header );
 		enu_retval = TWI_NL_ERR_DUPLCT_FRGMNT;
 	}
+	else
+	{
+		enu_retval = TWI_NL_ERR_INCMPLT_PKT;
+	}
 	return enu_retval;
 }
 
 /**
  *	@brief: Receive Fragments 
+ *			The fragment data is placed by index, every fragment except the last one carries a full fragment payload.
+ *			The running CRC follows the contiguous received prefix, the packet is complete once every index up to the last fragment is received.
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
 */
 static tenu_stack_err_code twi_nl_rcv_fgmnt( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len )
@@ -556,66 +853,340 @@ static tenu_stack_err_code twi_nl_rcv_fgmnt( tstr_nl_ctx *pstr_ctx , twi_u8* pu8
 	tenu_stack_err_code enu_retval = TWI_STACK_INVALID_ERR_CODE;
 
 	tstr_fragment_header str_fragment_header;
+	twi_u16 u16_payload_sz = twi_nl_get_fragment_payload_size(pstr_ctx);
+	twi_u16 u16_offset;
 
 	/* receive fragment header from first byte of fragment */
 	TWI_MEMCPY( &str_fragment_header , pu8_data , FRAGMENT_HEADER_LEN );
 
-	/* Check The Packet Size */
-	if ( (pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx + u16_data_len ) < MAX_PKT_SZ)
+	/* Point to the fragment payload data */
+	pu8_data 	+= FRAGMENT_HEADER_LEN ;
+	u16_offset 	 = str_fragment_header.u8_fragment_index * u16_payload_sz ;
+
+	if ( 1 != str_fragment_header.u8_last_fragment_flag)
 	{
-		/* Point to the fragment payload data */
-		pu8_data += FRAGMENT_HEADER_LEN ;
+		/* Substract the fragment header size from data length */
+		u16_data_len -= FRAGMENT_HEADER_LEN ;
 
-		if ( 1 != str_fragment_header.u8_last_fragment_flag)
+		if ( u16_data_len != u16_payload_sz )
 		{
-			/* Substract the fragment header size from data length */
-			u16_data_len -= FRAGMENT_HEADER_LEN ;
-			
-			/* Receive Fragment data in buffer */
-			TWI_MEMCPY( &pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf[pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx] , pu8_data , u16_data_len) ;
-
-			/* Increment data buffer index by length of fragment */
-			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx += u16_data_len ;
+			enu_retval = TWI_NL_ERR_FRGMNT_TOO_SHORT;
+		}
+		/* Check The Packet Size */
+		else if ( ( u16_offset + u16_data_len ) >= MAX_PKT_SZ )
+		{
+			enu_retval = TWI_NL_ERR_PKT_TOO_LONG;
+		}
+		else
+		{
+			/* Receive Fragment data in buffer at its place */
+			TWI_MEMCPY( &pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf[u16_offset] , pu8_data , u16_data_len) ;
+		}
+	}
+	else
+	{
+		/* Check The Packet Size if the packet is one fragment and hold the fragment header and CRC only and there is no data */ 
+		if ( ( u16_data_len < ( FRAGMENT_HEADER_LEN + CRC_SZ ) ) || ( ( u16_data_len == ( FRAGMENT_HEADER_LEN + CRC_SZ ) ) && ( 0 == str_fragment_header.u8_fragment_index ) ) )
+		{
+			enu_retval = TWI_NL_ERR_PKT_TOO_SHORT;
 		}
 		else
 		{
 			/* Substract the fragment header size and 16-bit CRC length from data length */
 			u16_data_len -= ( FRAGMENT_HEADER_LEN + CRC_SZ ) ;
 
-			/* Check The Packet Size if the packet is one fragment and hold the fragment header and CRC only and there is no data */ 
-			if ( (u16_data_len  > 0)  || (str_fragment_header.u8_fragment_index != 0) )
+			/* Check The Packet Size */
+			if ( ( u16_offset + u16_data_len ) >= MAX_PKT_SZ )
 			{
-				/* Receive Fragment data on buffer */
-				TWI_MEMCPY( &pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf[pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx] , pu8_data , u16_data_len ) ;
+				enu_retval = TWI_NL_ERR_PKT_TOO_LONG;
+			}
+			else
+			{
+				/* Receive Fragment data on buffer at its place */
+				TWI_MEMCPY( &pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf[u16_offset] , pu8_data , u16_data_len ) ;
 
-				/* Increment data buffer index by length of fragment */
-				pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx +=  u16_data_len ;
+				/* Receive 16-bit CRC of the full packet */
+				TWI_MEMCPY( &pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_rcvd_crc , &pu8_data[u16_data_len] , CRC_SZ ) ;
 
-				/* Point to the 16-bit CRC of the full packet*/
-				pu8_data += u16_data_len ;
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_last_frgmt_rcvd 	= TWI_TRUE;
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx 		= str_fragment_header.u8_fragment_index;
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_last_frgmt_data_len = u16_data_len;
+			}
+		}
+	}
 
-				/* Receive 16-bit CRC of the full packet */
-				twi_u16 u16_packet_crc = 0;
-				TWI_MEMCPY( &u16_packet_crc , pu8_data  , CRC_SZ) ;
+	if ( TWI_STACK_INVALID_ERR_CODE == enu_retval )
+	{
+		FRGMT_BIT_SET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap , str_fragment_header.u8_fragment_index );
+		pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num++;
+		if ( str_fragment_header.u8_fragment_index > pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_max_rcvd_idx )
+		{
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_max_rcvd_idx = str_fragment_header.u8_fragment_index;
+		}
 
-				/* Check the Received 16-bit CRC */
-				if ( u16_packet_crc != twi_crc16_compute_checksum( 0 , pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf , pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx   ) )
+		/* Fold the contiguous received fragments in the running CRC of the packet */
+		while ( ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num < ( sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap) * 8 ) ) &&
+				( TWI_TRUE == FRGMT_BIT_IS_SET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap , pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num ) ) )
+		{
+			u16_offset = pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num * u16_payload_sz;
+			if ( ( TWI_TRUE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_last_frgmt_rcvd ) && ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num == pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx ) )
+			{
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc = twi_crc16_compute_checksum( pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc , &pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf[u16_offset] , pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_last_frgmt_data_len );
+			}
+			else
+			{
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc = twi_crc16_compute_checksum( pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc , &pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf[u16_offset] , u16_payload_sz );
+			}
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num++;
+		}
+
+		if ( TWI_TRUE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_last_frgmt_rcvd )
+		{
+			/* Every fragment is received */
+			if ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num == ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx + 1 ) )
+			{
+				pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx = ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx * u16_payload_sz ) + pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_last_frgmt_data_len;
+
+				/* Check the Received 16-bit CRC against the running CRC of the reassembled packet */
+				if ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_rcvd_crc != pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc )
 				{
 					enu_retval = TWI_NL_ERR_INV_CRC;
 				}
+				else
+				{
+					pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_complete = TWI_TRUE;
+				}
+			}
+			/* The sender is done with this round ( the last fragment or the highest NACKed one ) but fragments are missing */
+			else if ( ( ( TWI_FALSE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_nack_sent ) && ( 1 == str_fragment_header.u8_last_fragment_flag ) ) ||
+					  ( ( TWI_TRUE == pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_nack_sent ) && ( str_fragment_header.u8_fragment_index == pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_trigger_idx ) ) )
+			{
+				if ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_cnt < RESEND_FRAGMENT_TIMES )
+				{
+					twi_nl_snd_missing_frgmnts( pstr_ctx , str_fragment_header );
+				}
+				else
+				{
+					enu_retval = TWI_NL_ERR_INCMPLT_PKT;
+				}
 			}
 			else
 			{
-				enu_retval = TWI_NL_ERR_PKT_TOO_SHORT;
+				// Do Nothing , wait for the rest of the round
 			}
 		}
 	}
-	else
+
+	return enu_retval;
+}
+
+/**
+ *	@brief: NACK the missing fragments of the packet being reassembled.
+ *			The error data is the fragment header of the packet followed by a bitmap of the missing fragment indices up to the last fragment.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in] str_fragment_header  	header of the fragment that ended the round, it carries the packet sequence number.
+*/
+static void twi_nl_snd_missing_frgmnts( tstr_nl_ctx *pstr_ctx , tstr_fragment_header str_fragment_header )
+{
+	twi_u8	au8_nack[FRAGMENT_HEADER_LEN + sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap)];
+	twi_u16 u16_bitmap_len 	= CEIL( ( pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx + 1 ) , 8 );
+	twi_u16 u16_idx;
+	twi_s32 s32_retval;
+
+	TWI_MEMSET( au8_nack , 0 , sizeof(au8_nack) );
+	str_fragment_header.u8_fragment_index 		= 0;
+	str_fragment_header.u8_last_fragment_flag 	= 0;
+	TWI_MEMCPY( au8_nack , &str_fragment_header , FRAGMENT_HEADER_LEN );
+
+	for ( u16_idx = 0; u16_idx <= pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx; u16_idx++ )
 	{
-		enu_retval = TWI_NL_ERR_PKT_TOO_LONG;
+		if ( TWI_FALSE == FRGMT_BIT_IS_SET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap , u16_idx ) )
+		{
+			FRGMT_BIT_SET( &au8_nack[FRAGMENT_HEADER_LEN] , u16_idx );
+			/* The sender resends the missing fragments in order , the highest one ends the next round */
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_trigger_idx = u16_idx;
+		}
 	}
 
-	return enu_retval;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_nack_sent = TWI_TRUE;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_cnt++;
+	pstr_ctx->str_global.str_stats.u32_nacks_sent_cnt++;
+
+	NTWRK_LOG_INFO("NACK Missing Fragments , Received : %d of %d \r\n", pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num , pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx + 1 );
+	s32_retval = twi_ll_send_error( pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx) , TWI_NL_ERR_FRGMNTS_MISSING , au8_nack , FRAGMENT_HEADER_LEN + u16_bitmap_len );
+	if ( TWI_SUCCESS != s32_retval )
+	{
+		NTWRK_LOG_ERR("Failed To Send The Missing Fragments NACK With Error = %d\r\n", s32_retval);
+	}
+}
+
+/**
+ *	@brief: Resend the fragments NACKed by the receiver if the packet is still held.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_nack		Pointer to the NACK data : fragment header then the missing fragments bitmap.
+ *	@param [in]	u16_nack_len    NACK data length.
+ *	@return	    TWI_TRUE if fragments are scheduled for resending.
+*/
+static twi_bool twi_nl_rcv_missing_frgmnts( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_nack , twi_u16 u16_nack_len )
+{
+	twi_bool b_retval = TWI_FALSE;
+	tstr_fragment_header str_fragment_header;
+	twi_u16 u16_idx;
+
+	if ( ( TWI_TRUE == pstr_ctx->str_global.b_send_in_progress ) && ( NULL != pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf ) && ( NULL != pu8_nack ) && ( u16_nack_len > FRAGMENT_HEADER_LEN ) )
+	{
+		TWI_MEMCPY( &str_fragment_header , pu8_nack , FRAGMENT_HEADER_LEN );
+		if ( str_fragment_header.u8_packet_sequence_number == pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number )
+		{
+			for ( u16_idx = 0; ( u16_idx < pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num ) && ( ( u16_idx >> 3 ) < ( u16_nack_len - FRAGMENT_HEADER_LEN ) ); u16_idx++ )
+			{
+				if ( ( TWI_TRUE == FRGMT_BIT_IS_SET( &pu8_nack[FRAGMENT_HEADER_LEN] , u16_idx ) ) && ( TWI_TRUE == FRGMT_BIT_IS_SET( pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap , u16_idx ) ) )
+				{
+					pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap[u16_idx >> 3] &= (twi_u8) ~( 1 << ( u16_idx & 0x07 ) );
+					pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num--;
+					b_retval = TWI_TRUE;
+				}
+			}
+		}
+	}
+	return b_retval;
+}
+
+/**
+ *	@brief: Acknowledge the reassembled packet once both sides agreed on TWI_LL_CAP_REASSEMBLY_ACK.
+ *			Only the packet sequence number of the header is meaningful to the sender.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in] str_fragment_header  	fragment header carrying the packet sequence number.
+*/
+static void twi_nl_snd_reassembly_ack( tstr_nl_ctx *pstr_ctx , tstr_fragment_header str_fragment_header )
+{
+	twi_s32 s32_retval;
+
+	if ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) )
+	{
+		s32_retval = twi_ll_send_error( pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx) , TWI_NL_PKT_REASSEMBLED , (twi_u8*) &str_fragment_header , FRAGMENT_HEADER_LEN );
+		if ( TWI_SUCCESS != s32_retval )
+		{
+			/* The sender times out and resends the last fragment , it is acknowledged then */
+			NTWRK_LOG_ERR("Failed To Send The Reassembly Ack With Error = %d\r\n", s32_retval);
+		}
+	}
+}
+
+/**
+ *	@brief: Match a reassembly acknowledgement with the packet being sent.
+ *			Both sides acknowledge a packet before they answer it , so a packet received from the peer once the whole packet
+ *			is handed to the link layer stands for its acknowledgement too.
+ *			An acknowledgement that comes before the link layer confirmed the last window is kept till then.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_ack			Pointer to the acknowledgement data : the fragment header , NULL for a packet received from the peer.
+ *	@param [in]	u16_ack_len     Acknowledgement data length.
+ *	@return	    TWI_TRUE if the packet was waiting for it and is done.
+*/
+static twi_bool twi_nl_rcv_reassembly_ack( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_ack , twi_u16 u16_ack_len )
+{
+	twi_bool b_retval 	= TWI_FALSE;
+	twi_bool b_is_match = TWI_FALSE;
+	tstr_fragment_header str_fragment_header;
+
+	if ( ( TWI_TRUE == pstr_ctx->str_global.b_send_in_progress ) && ( NULL != pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf ) )
+	{
+		if ( NULL == pu8_ack )
+		{
+			/* Only once the whole packet is handed to the link layer , the peer can't answer it before */
+			b_is_match = ( ( 0 != ( twi_nl_get_capabilities(pstr_ctx) & TWI_LL_CAP_REASSEMBLY_ACK ) ) &&
+						   ( ( pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num + pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num ) == pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num ) ) ? TWI_TRUE : TWI_FALSE;
+		}
+		else if ( u16_ack_len >= FRAGMENT_HEADER_LEN )
+		{
+			TWI_MEMCPY( &str_fragment_header , pu8_ack , FRAGMENT_HEADER_LEN );
+			b_is_match = ( str_fragment_header.u8_packet_sequence_number == pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number ) ? TWI_TRUE : TWI_FALSE;
+		}
+	}
+
+	if ( TWI_TRUE == b_is_match )
+	{
+		if ( TWI_TRUE == pstr_ctx->str_global.b_is_ack_pending )
+		{
+			twi_nl_stop_ack_wait(pstr_ctx);
+			b_retval = TWI_TRUE;
+		}
+		else
+		{
+			pstr_ctx->str_global.b_is_ack_rcvd = TWI_TRUE;
+		}
+	}
+	else if ( NULL != pu8_ack )
+	{
+		NTWRK_LOG_INFO("Reassembly Ack Is Not Awaited Now\r\n");
+	}
+	return b_retval;
+}
+
+/**
+ *	@brief: Stop waiting for the reassembly acknowledgement of the packet being sent.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+*/
+static void twi_nl_stop_ack_wait( tstr_nl_ctx *pstr_ctx )
+{
+	if ( TWI_TRUE == pstr_ctx->str_global.b_is_ack_pending )
+	{
+		pstr_ctx->str_global.b_is_ack_pending = TWI_FALSE;
+		TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pf_stop_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_ack_timer)));
+	}
+}
+
+/**
+ *	@brief: The reassembly acknowledgement didn't come in time , resend the last fragment.
+ *			The receiver NACKs the fragments it still misses or acknowledges the packet again if it has it already.
+ *			The resends count against the same budget as the failed windows.
+ *	@param [in] pv  	  		pointer to the network layer context.
+*/
+static void twi_nl_ack_timeout_cb( void* pv )
+{
+	tstr_nl_ctx * pstr_ctx = (tstr_nl_ctx *) pv;
+	twi_u8 u8_last_idx;
+
+	if ( TWI_TRUE == pstr_ctx->str_global.b_is_ack_pending )
+	{
+		NTWRK_LOG_ERR("Reassembly Ack Timeout , Resend The Last Fragment\r\n");
+		pstr_ctx->str_global.b_is_ack_pending 	= TWI_FALSE;
+		pstr_ctx->str_global.str_stats.u32_tx_ack_timeouts_cnt++;
+
+		u8_last_idx = pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_frgmts_num - 1;
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.au8_done_bitmap[u8_last_idx >> 3] &= (twi_u8) ~( 1 << ( u8_last_idx & 0x07 ) );
+		pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num--;
+
+		pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+		pstr_ctx->str_global.b_need_send 		= TWI_TRUE;
+		pstr_ctx->str_global.u8_resend_frgmt_cnt++;
+		pstr_ctx->str_global.str_stats.u32_tx_retries_cnt++;
+	}
+}
+
+/**
+ *	@brief: Release the sent packet and fill the success send status event.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [out] pstr_nl_evt  	the send status event to raise.
+*/
+static void twi_nl_snd_pkt_done( tstr_nl_ctx *pstr_ctx , tstr_twi_nl_evt* pstr_nl_evt )
+{
+	pstr_ctx->str_global.str_stats.u32_tx_pkts_cnt++;
+	if ( NULL != pstr_ctx->pf_get_time_ms )
+	{
+		twi_hist_add( &pstr_ctx->str_global.str_stats.str_tx_hist , pstr_ctx->pf_get_time_ms(pstr_ctx->pv_stack_helpers) - pstr_ctx->str_global.u32_tx_pkt_start_ms );
+	}
+
+	pstr_nl_evt->enu_event 										= TWI_NL_SEND_STATUS_EVT;
+	pstr_nl_evt->uni_data.str_send_stts_evt.b_is_success 		= TWI_TRUE;
+	pstr_nl_evt->uni_data.str_send_stts_evt.pv_user_arg 		= pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg;
+
+	twi_nl_prepare_frgmt_next_pkt(pstr_ctx);
+
+	pstr_ctx->str_global.b_send_in_progress 					= TWI_FALSE;
+	TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);
+
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number = ~ (pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number) ;
 }
 
 /**
@@ -632,6 +1203,8 @@ static void twi_nl_propagate_snd_fail(tstr_nl_ctx *pstr_ctx )
 	str_nl_evt.uni_data.str_send_stts_evt.b_is_success 		= TWI_FALSE;
 	str_nl_evt.uni_data.str_send_stts_evt.pv_user_arg 		= pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg;
 
+	twi_nl_stop_ack_wait(pstr_ctx);
+	pstr_ctx->str_global.str_stats.u32_tx_failed_pkts_cnt++;
 	pstr_ctx->str_global.b_need_send 						= TWI_FALSE;
 	pstr_ctx->str_global.b_send_in_progress 				= TWI_FALSE;
 	TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);	
@@ -643,6 +1216,30 @@ static void twi_nl_propagate_snd_fail(tstr_nl_ctx *pstr_ctx )
 	pstr_ctx->str_global.pf_nl_cb(&str_nl_evt);
 }
 
+/**
+ *	@brief: Start sending a packet.
+ *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
+ *	@param [in]	pu8_data		Pointer to data to be sent.
+ *	@param [in]	u16_data_len    Data length.
+ *  @param [in]	pv_arg    		User argument.
+*/
+static void twi_nl_start_pkt(tstr_nl_ctx *pstr_ctx, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg)
+{
+	/* The peer takes this packet for the acknowledgement of the one reassembled before it */
+	pstr_ctx->str_global.b_is_ack_due 			= TWI_FALSE;
+	twi_nl_fragment_prepare( pstr_ctx ,pu8_data, u16_data_len , pv_arg );
+	if ( NULL != pstr_ctx->pf_get_time_ms )
+	{
+		pstr_ctx->str_global.u32_tx_pkt_start_ms = pstr_ctx->pf_get_time_ms(pstr_ctx->pv_stack_helpers);
+	}
+	pstr_ctx->str_global.u8_resend_frgmt_cnt	= 0;
+	pstr_ctx->str_global.u8_resend_packet_cnt 	= 0;
+	pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+	pstr_ctx->str_global.b_need_send 			= TWI_TRUE;
+	pstr_ctx->str_global.b_send_in_progress		= TWI_TRUE;
+	TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);
+}
+
 /**
  *	@brief: Preparing fragment structure for next packet 
 */
@@ -654,6 +1251,11 @@ static void twi_nl_prepare_frgmt_next_pkt(tstr_nl_ctx *pstr_ctx)
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_last_fragment_flag 			 = 0;
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf 											 = NULL;
 	pstr_ctx->str_global.str_twi_nl_fgmt_data.pv_arg 												 = NULL;
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_done_frgmts_num 									 = 0;
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u8_inflight_frgmts_num 								 = 0;
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc 												 = 0;
+	pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_crc_len 											 = 0;
+	pstr_ctx->str_global.b_is_ack_rcvd 																 = TWI_FALSE;
 }
 
 /**
@@ -662,9 +1264,85 @@ static void twi_nl_prepare_frgmt_next_pkt(tstr_nl_ctx *pstr_ctx)
 static void twi_nl_prepare_defrgmt_next_pkt(tstr_nl_ctx *pstr_ctx)
 {
 	pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx 									 = 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc 											 = 0;
 	pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index      	 = 0;
 	pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number = ~ (pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number) ;	
 	pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_last_fragment_flag  	 = 0;
+	twi_nl_reset_reassembly(pstr_ctx);
+}
+
+/**
+ *	@brief: Clearing the reassembly state ( received fragments bitmap , last fragment and NACK rounds ) of the packet being received
+*/
+static void twi_nl_reset_reassembly(tstr_nl_ctx *pstr_ctx)
+{
+	TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap , 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_rcvd_bitmap) );
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_rcvd_frgmts_num 		= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_max_rcvd_idx 		= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc_frgmts_num 		= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_last_frgmt_rcvd 	= TWI_FALSE;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_last_frgmt_idx 		= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_last_frgmt_data_len = 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_rcvd_crc 			= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_nack_sent 			= TWI_FALSE;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_trigger_idx 	= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.u8_nack_cnt 			= 0;
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_complete 			= TWI_FALSE;
+}
+
+/**
+ *	@brief: Pick a reassembly buffer that is not held by the upper layer for the next packet , none is picked if all of them are held
+*/
+static void twi_nl_get_free_rcv_buf(tstr_nl_ctx *pstr_ctx)
+{
+	twi_u8 u8_idx;
+
+	pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf = NULL;
+	for ( u8_idx = 0; u8_idx < TWI_NL_RCV_BUFS_NUM; u8_idx++ )
+	{
+		if ( 0 == pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].u8_ref_cnt )
+		{
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf = pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].au8_pkt_buf;
+			break;
+		}
+	}
+}
+
+/**
+ *	@brief: Find the reassembly buffer the passed pointer points into , the upper layer may skip its own header before passing the data on
+ *	@return	    Pointer to the reassembly buffer , NULL if the pointer is not in a reassembly buffer.
+*/
+static tstr_twi_nl_rcv_buf* twi_nl_find_rcv_buf(tstr_nl_ctx *pstr_ctx, twi_u8* pu8_buf)
+{
+	tstr_twi_nl_rcv_buf* pstr_retval = NULL;
+	twi_u8 u8_idx;
+
+	for ( u8_idx = 0; u8_idx < TWI_NL_RCV_BUFS_NUM; u8_idx++ )
+	{
+		twi_u8* pu8_start = pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].au8_pkt_buf;
+
+		if ( ( pu8_buf >= pu8_start ) && ( pu8_buf < ( pu8_start + sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].au8_pkt_buf) ) ) )
+		{
+			pstr_retval = &pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx];
+			break;
+		}
+	}
+	return pstr_retval;
+}
+
+/**
+ *	@brief: Release all the reassembly buffers , on disconnection the upper layer drops the buffers it holds
+*/
+static void twi_nl_reset_rcv_bufs(tstr_nl_ctx *pstr_ctx)
+{
+	twi_u8 u8_idx;
+
+	for ( u8_idx = 0; u8_idx < TWI_NL_RCV_BUFS_NUM; u8_idx++ )
+	{
+		pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].u8_ref_cnt = 0;
+		TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].au8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.astr_rcv_bufs[u8_idx].au8_pkt_buf) );
+	}
+	twi_nl_get_free_rcv_buf(pstr_ctx);
 }
 
 /**
@@ -706,6 +1384,9 @@ twi_s32 twi_nl_init(tstr_nl_ctx *pstr_ctx,
 
 			pstr_ctx->enu_ll_type = enu_ll_type;
 			pstr_ctx->pf_twi_system_sleep_mode_forbiden = pstr_helpers->pf_twi_system_sleep_mode_forbiden;
+			pstr_ctx->pf_get_time_ms = pstr_helpers->pf_get_time_ms;
+			pstr_ctx->pf_start_timer = pstr_helpers->pf_start_timer;
+			pstr_ctx->pf_stop_timer = pstr_helpers->pf_stop_timer;
 			pstr_ctx->pv_stack_helpers = pv_helpers;
 
 			s32_retval = twi_ll_init(	pstr_ctx->enu_ll_type,
@@ -765,11 +1446,12 @@ void twi_nl_handle_ble_evt(tstr_nl_ctx *pstr_ctx, tstr_twi_ble_evt* pstr_ble_evt
 			pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number 			= 0;
 
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx 										= 0;
-			pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked												= TWI_FALSE;
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc 												= 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index    		= 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number    = 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_last_fragment_flag    	= 0;						
-			TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf) );
+			twi_nl_reset_reassembly(pstr_ctx);
+			twi_nl_reset_rcv_bufs(pstr_ctx);
 
 			break;
 		}
@@ -803,6 +1485,7 @@ void twi_nl_handle_usb_evt(tstr_nl_ctx *pstr_ctx, tstr_twi_usb_evt* pstr_usb_evt
 
 			pstr_ctx->str_global.b_need_send = TWI_FALSE;
 			pstr_ctx->str_global.b_send_in_progress = TWI_FALSE;
+			pstr_ctx->str_global.b_is_ack_due = TWI_FALSE;
 			TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);	
 
 			pstr_ctx->str_global.u8_resend_frgmt_cnt = 0;
@@ -811,11 +1494,12 @@ void twi_nl_handle_usb_evt(tstr_nl_ctx *pstr_ctx, tstr_twi_usb_evt* pstr_usb_evt
 			pstr_ctx->str_global.str_twi_nl_fgmt_data.str_fragment_header.u8_packet_sequence_number 			= 0;
 
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_pkt_buf_idx 										= 0;
-			pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked												= TWI_FALSE;
+			pstr_ctx->str_global.str_twi_nl_defgmt_data.u16_crc 												= 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_fragment_index    		= 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_packet_sequence_number    = 0;
 			pstr_ctx->str_global.str_twi_nl_defgmt_data.str_expected_frgmnt_header.u8_last_fragment_flag    	= 0;						
-			TWI_MEMSET( pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf, 0 , sizeof(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf) );
+			twi_nl_reset_reassembly(pstr_ctx);
+			twi_nl_reset_rcv_bufs(pstr_ctx);
 
 			break;
 		}
@@ -841,23 +1525,13 @@ twi_s32 twi_nl_send_data(tstr_nl_ctx *pstr_ctx , twi_u8* pu8_data, twi_u16 u16_d
 	twi_s32 s32_retval = TWI_SUCCESS;
 	if(TWI_TRUE == pstr_ctx->str_global.b_is_initialized)
 	{
-		if ( TWI_FALSE == pstr_ctx->str_global.b_send_in_progress )
+		if((pu8_data == NULL) || (u16_data_len == 0) || (pstr_ctx == NULL) || (u16_data_len > twi_ll_get_ctu_size(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx))))
 		{
-			if((pu8_data != NULL) && (u16_data_len > 0) && (pstr_ctx != NULL))
-			{
-				twi_nl_fragment_prepare( pstr_ctx ,pu8_data, u16_data_len , pv_arg );
-				pstr_ctx->str_global.u8_resend_frgmt_cnt	= 0;
-				pstr_ctx->str_global.u8_resend_packet_cnt 	= 0;
-				pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
-				pstr_ctx->str_global.b_need_send 			= TWI_TRUE;
-				pstr_ctx->str_global.b_send_in_progress		= TWI_TRUE;
-				TWI_LOGGER_ERR("%s:%d:b_send_in_progress = %d\r\n", __FUNCTION__, __LINE__, pstr_ctx->str_global.b_send_in_progress);				
-
-			}
-			else
-			{
-				s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
-			}
+			s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+		}
+		else if ( TWI_FALSE == pstr_ctx->str_global.b_send_in_progress )
+		{
+			twi_nl_start_pkt( pstr_ctx ,pu8_data, u16_data_len , pv_arg );
 		}
 		else
 		{
@@ -908,11 +1582,17 @@ twi_s32 twi_nl_send_error( tstr_nl_ctx *pstr_ctx , tenu_stack_err_code enu_err_c
 /**
  *	@brief:	This is the Network Manager Layer dispatcher. This is used to handle the periodic events of the network manager.
  *	@param [in] pstr_ctx  	  	pointer to the context structure that contains all the needed context data.
- *  Usage : send Fragment and in case of failing Resend it up to three times then resend the packet up to three times then propagate to the upper layer 
+ *  Usage : send the next window of fragments and in case of failing Resend it up to three times then resend the packet up to three times then propagate to the upper layer 
 */
 void twi_nl_dispatcher(tstr_nl_ctx *pstr_ctx)
 {
 	TWI_ASSERT(pstr_ctx != NULL);
+	/* No packet to the peer started since the last reassembled packet , acknowledge it on its own */
+	if ( TWI_TRUE == pstr_ctx->str_global.b_is_ack_due )
+	{
+		pstr_ctx->str_global.b_is_ack_due = TWI_FALSE;
+		twi_nl_snd_reassembly_ack( pstr_ctx , pstr_ctx->str_global.str_ack_frgmnt_header );
+	}
 	if ( pstr_ctx->str_global.b_need_send )
 	{
 		pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_FALSE);
@@ -924,16 +1604,18 @@ void twi_nl_dispatcher(tstr_nl_ctx *pstr_ctx)
 
 		if (  pstr_ctx->str_global.u8_resend_frgmt_cnt < ( SEND_FRAGMENT_TIMES + RESEND_FRAGMENT_TIMES ) )
 		{	
-			s32_retval = twi_nl_snd_fgmnts(pstr_ctx , pstr_ctx->str_global.str_twi_nl_fgmt_data.pu8_pkt_buf , pstr_ctx->str_global.str_twi_nl_fgmt_data.u16_data_len );
+			/* Hand the next window of unconfirmed fragments to the link layer */
+			s32_retval = twi_nl_snd_fgmnts_window(pstr_ctx);
 			
 			if( TWI_SUCCESS != s32_retval)
 			{					
 				if ( TWI_STACK_NL_ERR_SEND_MEDIUM_BUSY == s32_retval )
 				{	
-					/* Resend fragment */
+					/* Resend window */
 					pstr_ctx->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);				
 					pstr_ctx->str_global.b_need_send 		= TWI_TRUE;
 					pstr_ctx->str_global.u8_resend_frgmt_cnt++;
+					pstr_ctx->str_global.str_stats.u32_tx_retries_cnt++;
 
 				}
 				else 
@@ -985,22 +1667,48 @@ void twi_nl_dispatcher(tstr_nl_ctx *pstr_ctx)
 }
 
 /**
-*	@brief		This is an API to unlock the receive buffer in the Network Layer.
+*	@brief		This is an API to release one reference on a receive buffer handed by the Network Layer.
+*				The buffer is reused for reassembly once all its references are released.
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
-*	@param [in]	pu8_buffer_to_unlock		Pointer to buffer to unlock.
+*	@param [in]	pu8_buffer_to_unlock		Pointer to buffer to unlock , or to any byte of it.
 *
 *	@return	    None.
 */
 void twi_nl_unlock_rcv_buf( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_unlock)
 {
-	if(pstr_ctx->str_global.str_twi_nl_defgmt_data.au8_pkt_buf == pu8_buffer_to_unlock)
+	tstr_twi_nl_rcv_buf* pstr_rcv_buf = twi_nl_find_rcv_buf( pstr_ctx , pu8_buffer_to_unlock );
+
+	if( ( NULL != pstr_rcv_buf ) && ( 0 != pstr_rcv_buf->u8_ref_cnt ) )
 	{
 		//PLATFORM_CRITICAL_SECTION_ENTER();
-		pstr_ctx->str_global.str_twi_nl_defgmt_data.b_is_locked = TWI_FALSE;
+		pstr_rcv_buf->u8_ref_cnt--;
+		/* Resume the reassembly if it was stopped for lack of a free buffer */
+		if ( NULL == pstr_ctx->str_global.str_twi_nl_defgmt_data.pu8_pkt_buf )
+		{
+			twi_nl_get_free_rcv_buf(pstr_ctx);
+		}
 		//PLATFORM_CRITICAL_SECTION_EXIT();
 	}
 }
 
+/**
+*	@brief		This is an API to take one more reference on a receive buffer handed by the Network Layer,
+*				so it can be kept by more than one user. Each reference is released by @ref twi_nl_unlock_rcv_buf.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pu8_buffer_to_ref	Pointer to the received buffer.
+*
+*	@return	    None.
+*/
+void twi_nl_ref_rcv_buf( tstr_nl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_ref)
+{
+	tstr_twi_nl_rcv_buf* pstr_rcv_buf = twi_nl_find_rcv_buf( pstr_ctx , pu8_buffer_to_ref );
+
+	if( ( NULL != pstr_rcv_buf ) && ( 0 != pstr_rcv_buf->u8_ref_cnt ) && ( 0xFF != pstr_rcv_buf->u8_ref_cnt ) )
+	{
+		pstr_rcv_buf->u8_ref_cnt++;
+	}
+}
+
 /**
 *	@brief		This is an API to get the size of fragment threshold.
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
@@ -1012,6 +1720,43 @@ twi_u16 twi_nl_get_fragment_threshold_size(tstr_nl_ctx *pstr_ctx)
 	return ( twi_ll_get_mtu_size(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx)));	
 }
 
+/**
+*	@brief		This is an API to configure how many fragments of a packet can be in flight at once.
+*				The window is bounded by the link layer batch capacity and takes effect from the next window sent.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	u8_wnd_sz			Window size in fragments, 0 uses the whole link layer batch capacity.
+*/
+void twi_nl_set_snd_window_size(tstr_nl_ctx *pstr_ctx, twi_u8 u8_wnd_sz)
+{
+	TWI_ASSERT(pstr_ctx != NULL);
+	pstr_ctx->str_global.u8_snd_wnd_sz = u8_wnd_sz;
+}
+
+/**
+*	@brief		This is an API to get the capabilities both sides agreed upon in the connection.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@return	    Bitmap of the agreed capabilities @ref TWI_LL_CAP_LZ_COMPRESSION.
+*/
+twi_u8 twi_nl_get_capabilities(tstr_nl_ctx *pstr_ctx)
+{
+	TWI_ASSERT(pstr_ctx != NULL);
+	return ( twi_ll_get_capabilities(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx)) );
+}
+
+/**
+*	@brief		This is an API to copy the Network Layer statistics and the Link Layer ones under it.
+*				The packet send times are only measured if the stack helpers provide a clock.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [out] pstr_nl_stats		Pointer to the Network Layer statistics.
+*	@param [out] pstr_ll_stats		Pointer to the Link Layer statistics.
+*/
+void twi_nl_get_stats(tstr_nl_ctx *pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats)
+{
+	TWI_ASSERT( (pstr_ctx != NULL) && (pstr_nl_stats != NULL) && (pstr_ll_stats != NULL) );
+	TWI_MEMCPY( pstr_nl_stats , &pstr_ctx->str_global.str_stats , sizeof(tstr_twi_nl_stats) );
+	twi_ll_get_stats(pstr_ctx->enu_ll_type, &(pstr_ctx->uni_ll_ctx), pstr_ll_stats);
+}
+
 void twi_nl_is_ready_to_send(tstr_nl_ctx* pstr_cntxt, twi_bool* pb_is_ready)
 {
 	TWI_ASSERT(pstr_cntxt != NULL);		
@@ -1021,6 +1766,11 @@ void twi_nl_is_ready_to_send(tstr_nl_ctx* pstr_cntxt, twi_bool* pb_is_ready)
 twi_bool twi_nl_is_idle(tstr_nl_ctx* pstr_cntxt)
 {
 	TWI_ASSERT(pstr_cntxt != NULL);	
+	/* The sent packet may wait for its reassembly acknowledgement and the received one may wait to be acknowledged */
+	if ( ( TWI_TRUE == pstr_cntxt->str_global.b_is_ack_pending ) || ( TWI_TRUE == pstr_cntxt->str_global.b_is_ack_due ) )
+	{
+		return TWI_FALSE;
+	}
 	return twi_ll_is_idle(pstr_cntxt->enu_ll_type, &(pstr_cntxt->uni_ll_ctx));
 }
 
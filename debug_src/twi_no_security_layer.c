@@ -9,6 +9,7 @@
 
 #include "twi_security_layer.h"
 #include "twi_retval.h"
+#include "twi_lz.h"
 
 #define NO_SEC_LOG(...)
 #define NO_SEC_LOG_ERR(...)
@@ -40,6 +41,15 @@
 #endif
 #endif
 
+/*---------------------------------------------------------*/
+/*- LOCAL MACROS ------------------------------------------*/
+/*---------------------------------------------------------*/
+/*Once both sides agreed on @ref TWI_LL_CAP_LZ_COMPRESSION every message starts with one of these bytes*/
+#define TWI_SL_MSG_HDR_LEN				(1)
+#define TWI_SL_MSG_HDR_PLAIN			(0x00)
+#define TWI_SL_MSG_HDR_LZ				(0x01)
+#define TWI_SL_LZ_MIN_LEN				(32)		/*Shorter messages are sent plain, they hardly ever shrink*/
+
 /*---------------------------------------------------------*/
 /*- STRUCTS AND UNIONS AND ENUM----------------------------*/
 /*---------------------------------------------------------*/
@@ -61,6 +71,11 @@
 /*---------------------------------------------------------*/
 static void twi_nl_cb(tstr_twi_nl_evt* pstr_evt);
 static void twi_init_ns_global_variables(tstr_sl_ctx *pstr_ctx);
+static twi_bool twi_sl_is_lz_agreed(tstr_sl_ctx *pstr_ctx);
+static twi_s32 twi_sl_send_framed(tstr_sl_ctx *pstr_ctx, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg);
+static twi_bool twi_sl_rcv_framed(tstr_sl_ctx *pstr_ctx, twi_u8** ppu8_data, twi_u16* pu16_data_len);
+static tstr_twi_sl_rcv_buf* twi_sl_find_rcv_buf(tstr_sl_ctx *pstr_ctx, twi_u8* pu8_buf);
+static void twi_sl_reset_rcv_bufs(tstr_sl_ctx *pstr_ctx);
 /*---------------------------------------------------------*/
 /*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
 /*---------------------------------------------------------*/
@@ -85,6 +100,8 @@ static void twi_nl_cb(tstr_twi_nl_evt* pstr_evt)
 			str_sl_evt.enu_event								= TWI_SL_SEND_STATUS_EVT;
 			str_sl_evt.uni_data.str_send_stts_evt.b_is_success 	= pstr_evt->uni_data.str_send_stts_evt.b_is_success;
 			str_sl_evt.uni_data.str_send_stts_evt.pv_user_arg 	= pstr_evt->uni_data.str_send_stts_evt.pv_user_arg;
+			/*The framed message is no longer needed once its packet is sent or failed*/
+			pstr_ctx->str_global.b_is_tx_buf_busy 				= TWI_FALSE;
 			break;
 		}
 			
@@ -95,6 +112,11 @@ static void twi_nl_cb(tstr_twi_nl_evt* pstr_evt)
 			str_sl_evt.uni_data.str_rcv_data_evt.enu_msg_type 	= TWI_STACK_CLR_MSG;
 			str_sl_evt.uni_data.str_rcv_data_evt.pu8_data 		= pstr_evt->uni_data.str_rcv_data_evt.pu8_data;
 			str_sl_evt.uni_data.str_rcv_data_evt.u16_data_len 	= pstr_evt->uni_data.str_rcv_data_evt.u16_data_len;
+			if((TWI_TRUE == twi_sl_is_lz_agreed(pstr_ctx)) &&
+				(TWI_FALSE == twi_sl_rcv_framed(pstr_ctx, &(str_sl_evt.uni_data.str_rcv_data_evt.pu8_data), &(str_sl_evt.uni_data.str_rcv_data_evt.u16_data_len))))
+			{
+				str_sl_evt.enu_event 							= TWI_SL_INVALID_EVT;
+			}
 			break;
 		}
 
@@ -128,8 +150,157 @@ static void twi_nl_cb(tstr_twi_nl_evt* pstr_evt)
 */
 static void twi_init_ns_global_variables(tstr_sl_ctx *pstr_ctx)
 {
-	pstr_ctx->str_global.b_is_initialized 	= TWI_FALSE;
-	pstr_ctx->str_global.pf_sl_cb	 		= NULL;
+	pstr_ctx->str_global.b_is_initialized 			= TWI_FALSE;
+	pstr_ctx->str_global.pf_sl_cb	 				= NULL;
+	pstr_ctx->str_global.b_is_compression_enabled 	= TWI_TRUE;
+	pstr_ctx->str_global.b_is_tx_buf_busy 			= TWI_FALSE;
+	twi_sl_reset_rcv_bufs(pstr_ctx);
+}
+
+/**
+ *	@brief:	This function tells whether both sides agreed on compressing the messages, so every message carries the message header.
+*/
+static twi_bool twi_sl_is_lz_agreed(tstr_sl_ctx *pstr_ctx)
+{
+	return (0 != (twi_nl_get_capabilities(&(pstr_ctx->str_nl_ctx)) & TWI_LL_CAP_LZ_COMPRESSION)) ? TWI_TRUE : TWI_FALSE;
+}
+
+/**
+ *	@brief:	This function adds the message header and sends the message through the framed message buffer.
+ *			The message is compressed if it is enabled and it makes the message shorter, otherwise it is copied as is.
+ *	@param[in]  pu8_data: 		Pointer to the message.
+ *	@param[in]  u16_data_len: 	Message length.
+ *	@param[in]  pv_arg: 		User argument.
+*/
+static twi_s32 twi_sl_send_framed(tstr_sl_ctx *pstr_ctx, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg)
+{
+	twi_s32 s32_retval = TWI_STACK_NL_ERR_SENDING_IN_PROG;
+	twi_u8* pu8_buf;
+	twi_u16 u16_buf_len = 0;
+
+	if(u16_data_len > (sizeof(pstr_ctx->str_global.au8_tx_buf) - TWI_SL_MSG_HDR_LEN))
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	else if(TWI_TRUE != pstr_ctx->str_global.b_is_tx_buf_busy)
+	{
+		/*The buffer shall remain untouched till the send status of this message*/
+		pu8_buf = pstr_ctx->str_global.au8_tx_buf;
+
+		if((TWI_TRUE == pstr_ctx->str_global.b_is_compression_enabled) && (u16_data_len >= TWI_SL_LZ_MIN_LEN))
+		{
+			u16_buf_len = twi_lz_compress(pu8_data, u16_data_len, &pu8_buf[TWI_SL_MSG_HDR_LEN], u16_data_len - TWI_SL_MSG_HDR_LEN);
+		}
+
+		if(0 != u16_buf_len)
+		{
+			NO_SEC_LOG("Message Compressed From %d To %d Bytes\r\n", u16_data_len, u16_buf_len);
+			pu8_buf[0] = TWI_SL_MSG_HDR_LZ;
+		}
+		else
+		{
+			pu8_buf[0] = TWI_SL_MSG_HDR_PLAIN;
+			TWI_MEMCPY(&pu8_buf[TWI_SL_MSG_HDR_LEN], pu8_data, u16_data_len);
+			u16_buf_len = u16_data_len;
+		}
+
+		s32_retval = twi_nl_send_data(&(pstr_ctx->str_nl_ctx), pu8_buf, u16_buf_len + TWI_SL_MSG_HDR_LEN, pv_arg);
+		if(TWI_SUCCESS == s32_retval)
+		{
+			pstr_ctx->str_global.b_is_tx_buf_busy = TWI_TRUE;
+		}
+	}
+	return s32_retval;
+}
+
+/**
+ *	@brief:	This function removes the message header of a received message and decompresses it if needed.
+ *			A compressed message is decompressed in a security layer receive buffer , which keeps the network layer buffer
+ *			locked till it is released. So a receive buffer is free for every message the network layer can hand.
+ *	@param[in/out]  ppu8_data: 		Pointer to the received message, updated to point to the message without the header.
+ *	@param[in/out]  pu16_data_len: 	Received message length, updated to the length of the message without the header.
+ *	@return : ::TWI_TRUE if the message shall be passed on, TWI_FALSE if it is dropped. The buffer of a dropped message is unlocked.
+*/
+static twi_bool twi_sl_rcv_framed(tstr_sl_ctx *pstr_ctx, twi_u8** ppu8_data, twi_u16* pu16_data_len)
+{
+	twi_bool b_retval 	= TWI_FALSE;
+	twi_u8* pu8_msg 	= *ppu8_data;
+	twi_u16 u16_msg_len = *pu16_data_len;
+	tstr_twi_sl_rcv_buf* pstr_rcv_buf = twi_sl_find_rcv_buf(pstr_ctx, NULL);
+	twi_u16 u16_len;
+
+	if((u16_msg_len > TWI_SL_MSG_HDR_LEN) && (TWI_SL_MSG_HDR_PLAIN == pu8_msg[0]))
+	{
+		*ppu8_data 		= &pu8_msg[TWI_SL_MSG_HDR_LEN];
+		*pu16_data_len 	= u16_msg_len - TWI_SL_MSG_HDR_LEN;
+		b_retval 		= TWI_TRUE;
+	}
+	else if((u16_msg_len > TWI_SL_MSG_HDR_LEN) && (TWI_SL_MSG_HDR_LZ == pu8_msg[0]) && (NULL != pstr_rcv_buf))
+	{
+		u16_len = twi_lz_decompress(&pu8_msg[TWI_SL_MSG_HDR_LEN], u16_msg_len - TWI_SL_MSG_HDR_LEN, pstr_rcv_buf->au8_msg_buf, sizeof(pstr_rcv_buf->au8_msg_buf));
+		if(0 != u16_len)
+		{
+			NO_SEC_LOG("Message Decompressed From %d To %d Bytes\r\n", u16_msg_len - TWI_SL_MSG_HDR_LEN, u16_len);
+			pstr_rcv_buf->u8_ref_cnt 	= 1;
+			pstr_rcv_buf->pu8_nl_buf 	= pu8_msg;
+			*ppu8_data 					= pstr_rcv_buf->au8_msg_buf;
+			*pu16_data_len 				= u16_len;
+			b_retval 					= TWI_TRUE;
+		}
+		else
+		{
+			NO_SEC_LOG_ERR("Malformed Compressed Message Is Dropped\r\n");
+			twi_nl_unlock_rcv_buf(&(pstr_ctx->str_nl_ctx), pu8_msg);
+		}
+	}
+	else
+	{
+		NO_SEC_LOG_ERR("Message Is Dropped, Header = %d, Length = %d\r\n", pu8_msg[0], u16_msg_len);
+		twi_nl_unlock_rcv_buf(&(pstr_ctx->str_nl_ctx), pu8_msg);
+	}
+	return b_retval;
+}
+
+/**
+ *	@brief:	This function finds the security layer receive buffer holding pu8_buf , or a free one if pu8_buf is NULL.
+ *	@return : The receive buffer , NULL if there is none.
+*/
+static tstr_twi_sl_rcv_buf* twi_sl_find_rcv_buf(tstr_sl_ctx *pstr_ctx, twi_u8* pu8_buf)
+{
+	tstr_twi_sl_rcv_buf* pstr_retval = NULL;
+	twi_u8 u8_idx;
+
+	for(u8_idx = 0; (u8_idx < TWI_NL_RCV_BUFS_NUM) && (NULL == pstr_retval); u8_idx++)
+	{
+		tstr_twi_sl_rcv_buf* pstr_rcv_buf = &pstr_ctx->str_global.astr_rcv_bufs[u8_idx];
+
+		if(NULL == pu8_buf)
+		{
+			if(0 == pstr_rcv_buf->u8_ref_cnt)
+			{
+				pstr_retval = pstr_rcv_buf;
+			}
+		}
+		else if((pu8_buf >= pstr_rcv_buf->au8_msg_buf) && (pu8_buf < (pstr_rcv_buf->au8_msg_buf + sizeof(pstr_rcv_buf->au8_msg_buf))))
+		{
+			pstr_retval = pstr_rcv_buf;
+		}
+	}
+	return pstr_retval;
+}
+
+/**
+ *	@brief:	This function frees all the security layer receive buffers , the network layer drops its buffers the same way.
+*/
+static void twi_sl_reset_rcv_bufs(tstr_sl_ctx *pstr_ctx)
+{
+	twi_u8 u8_idx;
+
+	for(u8_idx = 0; u8_idx < TWI_NL_RCV_BUFS_NUM; u8_idx++)
+	{
+		pstr_ctx->str_global.astr_rcv_bufs[u8_idx].u8_ref_cnt = 0;
+		pstr_ctx->str_global.astr_rcv_bufs[u8_idx].pu8_nl_buf = NULL;
+	}
 }
 /*---------------------------------------------------------*/
 /*- APIs IMPLEMENTATION -----------------------------------*/
@@ -193,6 +364,10 @@ twi_s32 twi_sl_init(tstr_sl_ctx *pstr_ctx,
 void twi_sl_handle_ble_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_ble_evt* pstr_ble_evt)
 {
 	TWI_ASSERT((pstr_ble_evt != NULL) && (pstr_ctx != NULL));
+	if(TWI_BLE_EVT_DISCONNECTED == pstr_ble_evt->enu_evt)
+	{
+		twi_sl_reset_rcv_bufs(pstr_ctx);
+	}
 	twi_nl_handle_ble_evt(&(pstr_ctx->str_nl_ctx) , pstr_ble_evt);
 }
 #endif
@@ -205,6 +380,10 @@ void twi_sl_handle_ble_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_ble_evt* pstr_ble_ev
 void twi_sl_handle_usb_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_usb_evt* pstr_usb_evt)
 {
 	TWI_ASSERT((pstr_usb_evt != NULL) && (pstr_ctx != NULL));
+	if(TWI_USBD_PORT_CLOSE == pstr_usb_evt->enu_usbd_evt)
+	{
+		twi_sl_reset_rcv_bufs(pstr_ctx);
+	}
 	twi_nl_handle_usb_evt(&(pstr_ctx->str_nl_ctx) , pstr_usb_evt);
 }
 #endif
@@ -216,6 +395,8 @@ void twi_sl_handle_usb_evt(tstr_sl_ctx *pstr_ctx , tstr_twi_usb_evt* pstr_usb_ev
 *                               This buffer shall remain untouched by the application till a TWI_SL_SEND_STATUS_EVT is passed from the network layer.
 *	@param [in]	u16_data_len    Data length.
 *	@param [in]	pv_arg    		User argument.
+*	@note		Once both sides agreed on @ref TWI_LL_CAP_LZ_COMPRESSION the message is framed in a security layer buffer , so the
+*				passed buffer can be reused as soon as the call returns.
 */
 twi_s32 twi_sl_send_data( tstr_sl_ctx *pstr_ctx , tenu_twi_stack_msg_type enu_msg_type, twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg)
 {
@@ -226,7 +407,14 @@ twi_s32 twi_sl_send_data( tstr_sl_ctx *pstr_ctx , tenu_twi_stack_msg_type enu_ms
 		{
 			if(TWI_STACK_CLR_MSG == enu_msg_type)
 			{
-				s32_retval = twi_nl_send_data(&(pstr_ctx->str_nl_ctx) , pu8_data, u16_data_len, pv_arg);
+				if(TWI_TRUE == twi_sl_is_lz_agreed(pstr_ctx))
+				{
+					s32_retval = twi_sl_send_framed(pstr_ctx, pu8_data, u16_data_len, pv_arg);
+				}
+				else
+				{
+					s32_retval = twi_nl_send_data(&(pstr_ctx->str_nl_ctx) , pu8_data, u16_data_len, pv_arg);
+				}
 				if(s32_retval != TWI_SUCCESS)
 				{
 					NO_SEC_LOG_ERR("Failed to Send Data To Network Layer With Error = %d\r\n", s32_retval);
@@ -267,7 +455,83 @@ void twi_sl_dispatcher(tstr_sl_ctx *pstr_ctx)
 */
 void twi_sl_unlock_rcv_buf( tstr_sl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_unlock)
 {
-	twi_nl_unlock_rcv_buf( &(pstr_ctx->str_nl_ctx) , pu8_buffer_to_unlock);
+	/*Decompressed messages are handed in the security layer receive buffers*/
+	tstr_twi_sl_rcv_buf* pstr_rcv_buf = twi_sl_find_rcv_buf(pstr_ctx, pu8_buffer_to_unlock);
+
+	if(NULL != pstr_rcv_buf)
+	{
+		if(0 != pstr_rcv_buf->u8_ref_cnt)
+		{
+			pstr_rcv_buf->u8_ref_cnt--;
+			/*The network layer buffer of the compressed message is released with the last reference*/
+			if(0 == pstr_rcv_buf->u8_ref_cnt)
+			{
+				twi_nl_unlock_rcv_buf( &(pstr_ctx->str_nl_ctx) , pstr_rcv_buf->pu8_nl_buf);
+				pstr_rcv_buf->pu8_nl_buf = NULL;
+			}
+		}
+	}
+	else
+	{
+		twi_nl_unlock_rcv_buf( &(pstr_ctx->str_nl_ctx) , pu8_buffer_to_unlock);
+	}
+}
+
+/**
+*	@brief		This is an API to take one more reference on a receive buffer handed by the Network Layer.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pu8_buffer_to_ref	Pointer to the received buffer.
+*
+*	@return	    None.
+*/
+void twi_sl_ref_rcv_buf( tstr_sl_ctx *pstr_ctx , twi_u8* pu8_buffer_to_ref)
+{
+	tstr_twi_sl_rcv_buf* pstr_rcv_buf = twi_sl_find_rcv_buf(pstr_ctx, pu8_buffer_to_ref);
+
+	if(NULL != pstr_rcv_buf)
+	{
+		if((0 != pstr_rcv_buf->u8_ref_cnt) && (0xFF != pstr_rcv_buf->u8_ref_cnt))
+		{
+			pstr_rcv_buf->u8_ref_cnt++;
+		}
+	}
+	else
+	{
+		twi_nl_ref_rcv_buf( &(pstr_ctx->str_nl_ctx) , pu8_buffer_to_ref);
+	}
+}
+
+/**
+*	@brief		This is an API to configure the number of fragments the Network Layer keeps in flight.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	u8_wnd_sz			Window size in fragments, 0 uses the whole link layer batch capacity.
+*/
+void twi_sl_set_snd_window_size(tstr_sl_ctx *pstr_ctx, twi_u8 u8_wnd_sz)
+{
+	twi_nl_set_snd_window_size(&(pstr_ctx->str_nl_ctx), u8_wnd_sz);
+}
+
+/**
+*	@brief		This is an API to enable or disable compressing the sent messages. It only applies once both sides agreed
+*				on @ref TWI_LL_CAP_LZ_COMPRESSION in the stack specs , the received compressed messages are always decompressed.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	b_enable			TWI_TRUE to compress the messages that get shorter , enabled by default.
+*/
+void twi_sl_set_compression(tstr_sl_ctx *pstr_ctx, twi_bool b_enable)
+{
+	TWI_ASSERT(pstr_ctx != NULL);
+	pstr_ctx->str_global.b_is_compression_enabled = b_enable;
+}
+
+/**
+*	@brief		This is an API to copy the statistics of the layers under the security layer.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [out] pstr_nl_stats		Pointer to the Network Layer statistics.
+*	@param [out] pstr_ll_stats		Pointer to the Link Layer statistics.
+*/
+void twi_sl_get_stats(tstr_sl_ctx *pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats)
+{
+	twi_nl_get_stats(&(pstr_ctx->str_nl_ctx), pstr_nl_stats, pstr_ll_stats);
 }
 
 void twi_sl_is_ready_to_send(tstr_sl_ctx* pstr_cntxt, twi_bool* pb_is_ready)
@@ -251,6 +251,49 @@ void twi_stack_unlock_rcv_buf( tstr_stack_ctx * pstr_ctx , twi_u8* pu8_buffer_to
 	twi_sl_unlock_rcv_buf( &(pstr_ctx->str_sl_ctx) , pu8_buffer_to_unlock);
 }
 
+/**
+*	@brief		This is an API to take one more reference on a receive buffer handed by the Network Layer.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pu8_buffer_to_ref	Pointer to the received buffer.
+*
+*	@return	    None.
+*/
+void twi_stack_ref_rcv_buf( tstr_stack_ctx * pstr_ctx , twi_u8* pu8_buffer_to_ref)
+{
+	twi_sl_ref_rcv_buf( &(pstr_ctx->str_sl_ctx) , pu8_buffer_to_ref);
+}
+
+/**
+*	@brief		This is an API to configure the number of fragments the Network Layer keeps in flight.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	u8_wnd_sz			Window size in fragments, 0 uses the whole link layer batch capacity.
+*/
+void twi_stack_set_snd_window_size(tstr_stack_ctx * pstr_ctx , twi_u8 u8_wnd_sz)
+{
+	twi_sl_set_snd_window_size(&(pstr_ctx->str_sl_ctx), u8_wnd_sz);
+}
+
+/**
+*	@brief		This is an API to enable or disable compressing the sent messages once both sides agreed on it.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	b_enable			TWI_TRUE to compress the messages that get shorter , enabled by default.
+*/
+void twi_stack_set_compression(tstr_stack_ctx * pstr_ctx, twi_bool b_enable)
+{
+	twi_sl_set_compression(&(pstr_ctx->str_sl_ctx), b_enable);
+}
+
+/**
+*	@brief		This is an API to copy the Network Layer and Link Layer statistics , counters and latency histograms.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [out] pstr_nl_stats		Pointer to the Network Layer statistics.
+*	@param [out] pstr_ll_stats		Pointer to the Link Layer statistics.
+*/
+void twi_stack_get_stats(tstr_stack_ctx * pstr_ctx, tstr_twi_nl_stats* pstr_nl_stats, tstr_twi_ll_stats* pstr_ll_stats)
+{
+	twi_sl_get_stats(&(pstr_ctx->str_sl_ctx), pstr_nl_stats, pstr_ll_stats);
+}
+
 void twi_stack_is_ready_to_send(tstr_stack_ctx* pstr_cntxt, twi_bool* pb_is_ready)
 {
 	//FUN_IN;
@@ -0,0 +1,332 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_timer_wheel.c
+@brief		this file contains a two level hashed timer wheel that runs the stack timers on a millisecond clock read by its owner.
+			The first level has a slot per tick , the second level a slot per first level turn.
+			Starting , stopping and firing a timer cost O(1) , running the wheel costs one slot per elapsed tick.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include "twi_timer_wheel.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define TIMER_WHEEL_SLOT_MASK		(TWI_TIMER_WHEEL_SLOTS - 1)
+
+//***********************************************************
+/*- LOCAL FUNCTIONS PROTOTYPES ----------------------------*/
+//***********************************************************
+static void timer_wheel_link(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx);
+static void timer_wheel_unlink(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx);
+static void timer_wheel_fire(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx);
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+
+/*
+* @brief		Links a timer in the slot of its expiry tick. The timers due within a first level turn go to the first level,
+*				the ones due within a second level turn go to the second level and are linked again when their slot cascades.
+*				Anything farther is parked in the last second level slot and goes through the same until it gets close enough.
+*/
+static void timer_wheel_link(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx)
+{
+	tstr_twi_wheel_timer* pstr_timer = &pstr_wheel->astr_timers[u8_idx];
+	twi_u32 u32_blocks = (pstr_timer->u32_expiry_tick >> TWI_TIMER_WHEEL_BITS) - (pstr_wheel->u32_tick >> TWI_TIMER_WHEEL_BITS);
+	twi_u8 u8_slot;
+
+	if((pstr_timer->u32_expiry_tick - pstr_wheel->u32_tick) < TWI_TIMER_WHEEL_SLOTS)
+	{
+		u8_slot = (twi_u8)(pstr_timer->u32_expiry_tick & TIMER_WHEEL_SLOT_MASK);
+	}
+	else if(u32_blocks < TWI_TIMER_WHEEL_SLOTS)
+	{
+		u8_slot = (twi_u8)(TWI_TIMER_WHEEL_SLOTS + ((pstr_timer->u32_expiry_tick >> TWI_TIMER_WHEEL_BITS) & TIMER_WHEEL_SLOT_MASK));
+	}
+	else
+	{
+		u8_slot = (twi_u8)(TWI_TIMER_WHEEL_SLOTS + (((pstr_wheel->u32_tick >> TWI_TIMER_WHEEL_BITS) + TWI_TIMER_WHEEL_SLOTS - 1) & TIMER_WHEEL_SLOT_MASK));
+	}
+
+	pstr_timer->u8_slot = u8_slot;
+	pstr_timer->u8_prev = TWI_TIMER_WHEEL_NONE;
+	pstr_timer->u8_next = pstr_wheel->au8_slots[u8_slot];
+	if(TWI_TIMER_WHEEL_NONE != pstr_timer->u8_next)
+	{
+		pstr_wheel->astr_timers[pstr_timer->u8_next].u8_prev = u8_idx;
+	}
+	pstr_wheel->au8_slots[u8_slot] = u8_idx;
+}
+
+/*
+* @brief		Unlinks a timer from its slot, if it is linked.
+*/
+static void timer_wheel_unlink(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx)
+{
+	tstr_twi_wheel_timer* pstr_timer = &pstr_wheel->astr_timers[u8_idx];
+
+	if(TWI_TIMER_WHEEL_NONE != pstr_timer->u8_slot)
+	{
+		if(TWI_TIMER_WHEEL_NONE != pstr_timer->u8_prev)
+		{
+			pstr_wheel->astr_timers[pstr_timer->u8_prev].u8_next = pstr_timer->u8_next;
+		}
+		else
+		{
+			pstr_wheel->au8_slots[pstr_timer->u8_slot] = pstr_timer->u8_next;
+		}
+		if(TWI_TIMER_WHEEL_NONE != pstr_timer->u8_next)
+		{
+			pstr_wheel->astr_timers[pstr_timer->u8_next].u8_prev = pstr_timer->u8_prev;
+		}
+		pstr_timer->u8_slot = TWI_TIMER_WHEEL_NONE;
+	}
+}
+
+/*
+* @brief		Fires an expired timer that is already unlinked. The periodic timers are linked again, the one shot ones are freed.
+*				The wheel is updated before the callback runs, so the callback can start or stop any timer including its own.
+*/
+static void timer_wheel_fire(tstr_twi_timer_wheel* pstr_wheel, twi_u8 u8_idx)
+{
+	tstr_twi_wheel_timer* pstr_timer = &pstr_wheel->astr_timers[u8_idx];
+	tpf_twi_timer_mgmt_cb pf_timer_cb = pstr_timer->pf_timer_cb;
+	void* pv_user_data = pstr_timer->pv_user_data;
+	twi_bool b_is_fired = pstr_timer->pstr_timer->b_is_active;
+
+	/* a timer its owner cleared without stopping it, e.g. by resetting its context, is dropped silently */
+	if((TWI_TRUE == b_is_fired) && (0 != pstr_timer->u32_period_ticks))
+	{
+		pstr_timer->u32_expiry_tick += pstr_timer->u32_period_ticks;
+		if((twi_s32)(pstr_timer->u32_expiry_tick - pstr_wheel->u32_tick) <= 0)
+		{
+			pstr_timer->u32_expiry_tick = pstr_wheel->u32_tick + pstr_timer->u32_period_ticks;
+		}
+		timer_wheel_link(pstr_wheel, u8_idx);
+	}
+	else
+	{
+		pstr_timer->pstr_timer->b_is_active = TWI_FALSE;
+		pstr_timer->pstr_timer = NULL;
+		pstr_wheel->u8_timers_num--;
+	}
+
+	if(TWI_TRUE == b_is_fired)
+	{
+		pf_timer_cb(pv_user_data);
+	}
+}
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+
+/*
+* @brief		function initializes an empty wheel at clock time 0 , the first run catches up with the clock.
+* @param[out]	pstr_wheel:	pointer to the wheel
+*/
+void twi_timer_wheel_init(tstr_twi_timer_wheel* pstr_wheel)
+{
+	TWI_ASSERT(NULL != pstr_wheel);
+	TWI_MEMSET(pstr_wheel, 0, sizeof(tstr_twi_timer_wheel));
+	TWI_MEMSET(pstr_wheel->au8_slots, TWI_TIMER_WHEEL_NONE, sizeof(pstr_wheel->au8_slots));
+}
+
+/*
+* @brief		function starts a timer , starting an armed timer restarts it. The expiry is rounded up from the tick the wheel is at,
+*				so the timer never fires early.
+* @param[in]	pstr_wheel:	pointer to the wheel
+* @param[in]	u32_now_ms:	clock time
+* @param[in]	pstr_timer:	timer of the caller , it stays armed till it fires or is stopped
+* @param[in]	enu_mode:	one shot or periodic
+* @param[in]	u32_msec:	timeout , and period of the periodic timers
+* @param[in]	pf_timer_cb:	called from @ref twi_timer_wheel_run once the timer expires
+* @param[in]	pv_user_data:	argument of pf_timer_cb
+* @return		TWI_SUCCESS , or TWI_ERROR_INTERNAL_ERROR if every timer entry is taken.
+*/
+twi_s32 twi_timer_wheel_start(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms, tstr_timer_mgmt_timer* pstr_timer, tenu_mgmt_timer_mode enu_mode, twi_u32 u32_msec, tpf_twi_timer_mgmt_cb pf_timer_cb, void* pv_user_data)
+{
+	twi_u32 u32_lag_ms = u32_now_ms - pstr_wheel->u32_tick_ms;		/* clock time the wheel hasn't run yet */
+	twi_u32 u32_period_ticks = (u32_msec + TWI_TIMER_WHEEL_TICK_MS - 1) / TWI_TIMER_WHEEL_TICK_MS;
+	twi_u8 u8_free_idx = TWI_TIMER_WHEEL_NONE;
+	twi_u8 u8_idx;
+	twi_s32 s32_retval = TWI_SUCCESS;
+
+	TWI_ASSERT((NULL != pstr_wheel) && (NULL != pstr_timer) && (NULL != pf_timer_cb));
+	for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+	{
+		if(pstr_timer == pstr_wheel->astr_timers[u8_idx].pstr_timer)
+		{
+			timer_wheel_unlink(pstr_wheel, u8_idx);
+			u8_free_idx = u8_idx;
+			break;
+		}
+		if((TWI_TIMER_WHEEL_NONE == u8_free_idx) && (NULL == pstr_wheel->astr_timers[u8_idx].pstr_timer))
+		{
+			u8_free_idx = u8_idx;
+		}
+	}
+
+	if(TWI_TIMER_WHEEL_NONE != u8_free_idx)
+	{
+		tstr_twi_wheel_timer* pstr_entry = &pstr_wheel->astr_timers[u8_free_idx];
+
+		if(NULL == pstr_entry->pstr_timer)
+		{
+			pstr_wheel->u8_timers_num++;
+		}
+		pstr_entry->pstr_timer = pstr_timer;
+		pstr_entry->pf_timer_cb = pf_timer_cb;
+		pstr_entry->pv_user_data = pv_user_data;
+		pstr_entry->u32_period_ticks = (TWI_TIMER_TYPE_PERIODIC == enu_mode)? ((0 != u32_period_ticks)? u32_period_ticks : 1) : 0;
+		pstr_entry->u32_expiry_tick = pstr_wheel->u32_tick + ((u32_lag_ms + u32_msec + TWI_TIMER_WHEEL_TICK_MS - 1) / TWI_TIMER_WHEEL_TICK_MS);
+		if(pstr_entry->u32_expiry_tick == pstr_wheel->u32_tick)
+		{
+			pstr_entry->u32_expiry_tick++;
+		}
+		timer_wheel_link(pstr_wheel, u8_free_idx);
+		pstr_timer->b_is_active = TWI_TRUE;
+	}
+	else
+	{
+		s32_retval = TWI_ERROR_INTERNAL_ERROR;
+	}
+
+	return s32_retval;
+}
+
+/*
+* @brief		function stops a timer , stopping a timer that is not armed only marks it inactive.
+* @param[in]	pstr_wheel:	pointer to the wheel
+* @param[in]	pstr_timer:	timer of the caller
+*/
+void twi_timer_wheel_stop(tstr_twi_timer_wheel* pstr_wheel, tstr_timer_mgmt_timer* pstr_timer)
+{
+	twi_u8 u8_idx;
+
+	TWI_ASSERT((NULL != pstr_wheel) && (NULL != pstr_timer));
+	for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+	{
+		if(pstr_timer == pstr_wheel->astr_timers[u8_idx].pstr_timer)
+		{
+			timer_wheel_unlink(pstr_wheel, u8_idx);
+			pstr_wheel->astr_timers[u8_idx].pstr_timer = NULL;
+			pstr_wheel->u8_timers_num--;
+			break;
+		}
+	}
+	pstr_timer->b_is_active = TWI_FALSE;
+}
+
+/*
+* @brief		function brings the wheel up to the clock and fires the expired timers. Each tick costs one first level slot,
+*				plus one second level slot every first level turn. When the wheel is further behind than a first level turn,
+*				every timer is linked again from the current tick instead of stepping through the slots.
+* @param[in]	pstr_wheel:	pointer to the wheel
+* @param[in]	u32_now_ms:	clock time
+*/
+void twi_timer_wheel_run(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms)
+{
+	twi_u32 u32_ticks;
+	twi_u8 u8_idx;
+
+	TWI_ASSERT(NULL != pstr_wheel);
+	u32_ticks = (u32_now_ms - pstr_wheel->u32_tick_ms) / TWI_TIMER_WHEEL_TICK_MS;
+
+	if((0 == pstr_wheel->u8_timers_num) || (u32_ticks > TWI_TIMER_WHEEL_SLOTS))
+	{
+		pstr_wheel->u32_tick += u32_ticks;
+		pstr_wheel->u32_tick_ms += u32_ticks * TWI_TIMER_WHEEL_TICK_MS;
+
+		if(0 != pstr_wheel->u8_timers_num)
+		{
+			TWI_MEMSET(pstr_wheel->au8_slots, TWI_TIMER_WHEEL_NONE, sizeof(pstr_wheel->au8_slots));
+			for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+			{
+				pstr_wheel->astr_timers[u8_idx].u8_slot = TWI_TIMER_WHEEL_NONE;
+				if((NULL != pstr_wheel->astr_timers[u8_idx].pstr_timer) && ((twi_s32)(pstr_wheel->astr_timers[u8_idx].u32_expiry_tick - pstr_wheel->u32_tick) > 0))
+				{
+					timer_wheel_link(pstr_wheel, u8_idx);
+				}
+			}
+			/* the timers left unlinked are expired, a callback may have stopped or restarted some of them meanwhile */
+			for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+			{
+				if((NULL != pstr_wheel->astr_timers[u8_idx].pstr_timer) && (TWI_TIMER_WHEEL_NONE == pstr_wheel->astr_timers[u8_idx].u8_slot))
+				{
+					timer_wheel_fire(pstr_wheel, u8_idx);
+				}
+			}
+		}
+		return;
+	}
+
+	while(0 != u32_ticks--)
+	{
+		twi_u8 u8_slot;
+
+		/* the clock time moves with the tick, so a timer started from a callback is still linked relative to the tick the wheel is at */
+		pstr_wheel->u32_tick++;
+		pstr_wheel->u32_tick_ms += TWI_TIMER_WHEEL_TICK_MS;
+
+		if(0 == (pstr_wheel->u32_tick & TIMER_WHEEL_SLOT_MASK))
+		{
+			u8_slot = (twi_u8)(TWI_TIMER_WHEEL_SLOTS + ((pstr_wheel->u32_tick >> TWI_TIMER_WHEEL_BITS) & TIMER_WHEEL_SLOT_MASK));
+			while(TWI_TIMER_WHEEL_NONE != (u8_idx = pstr_wheel->au8_slots[u8_slot]))
+			{
+				timer_wheel_unlink(pstr_wheel, u8_idx);
+				timer_wheel_link(pstr_wheel, u8_idx);
+			}
+		}
+
+		u8_slot = (twi_u8)(pstr_wheel->u32_tick & TIMER_WHEEL_SLOT_MASK);
+		while(TWI_TIMER_WHEEL_NONE != (u8_idx = pstr_wheel->au8_slots[u8_slot]))
+		{
+			timer_wheel_unlink(pstr_wheel, u8_idx);
+			timer_wheel_fire(pstr_wheel, u8_idx);
+		}
+	}
+}
+
+/*
+* @brief		function gets when the earliest timer expires.
+* @param[in]	pstr_wheel:	pointer to the wheel
+* @param[in]	u32_now_ms:	clock time
+* @param[out]	pu32_timeout_ms:	time left till the earliest expiry , 0 if it is already due.
+* @return		TWI_TRUE if a timer is armed.
+*/
+twi_bool twi_timer_wheel_get_next_timeout(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_now_ms, twi_u32* pu32_timeout_ms)
+{
+	twi_bool b_is_armed = TWI_FALSE;
+	twi_u32 u32_min_ticks = 0;
+	twi_u8 u8_idx;
+
+	TWI_ASSERT((NULL != pstr_wheel) && (NULL != pu32_timeout_ms));
+	for(u8_idx = 0; (u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM) && (0 != pstr_wheel->u8_timers_num); u8_idx++)
+	{
+		if(NULL != pstr_wheel->astr_timers[u8_idx].pstr_timer)
+		{
+			twi_u32 u32_ticks = pstr_wheel->astr_timers[u8_idx].u32_expiry_tick - pstr_wheel->u32_tick;
+
+			if((TWI_FALSE == b_is_armed) || (u32_ticks < u32_min_ticks))
+			{
+				u32_min_ticks = u32_ticks;
+				b_is_armed = TWI_TRUE;
+			}
+		}
+	}
+
+	if(TWI_TRUE == b_is_armed)
+	{
+		twi_u32 u32_elapsed_ms = u32_now_ms - pstr_wheel->u32_tick_ms;
+
+		*pu32_timeout_ms = ((u32_min_ticks * TWI_TIMER_WHEEL_TICK_MS) > u32_elapsed_ms)? ((u32_min_ticks * TWI_TIMER_WHEEL_TICK_MS) - u32_elapsed_ms) : 0;
+	}
+	return b_is_armed;
+}
@@ -0,0 +1,565 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+ * @file:	twi_transport.c
+ * @brief:	Loopback, stream (Unix socket and pipe) and hidraw backends of the native host transport, and the stack USB
+ *			helpers that run on top of them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "twi_transport.h"
+
+/*---------------------------------------------------------*/
+/*- MODULE LOCAL MACROS DEFINITION-------------------------*/
+/*---------------------------------------------------------*/
+#define TRANSPORT_SPEC_SEPARATOR				(':')
+#define TRANSPORT_NO_FD							(-1)
+#define TRANSPORT_HIDRAW_REPORT_ID				(0)			/*The wallet doesn't number its reports, hidraw still takes the id byte first on write.*/
+#define TRANSPORT_HIDRAW_REPORT_ID_SZ			(1)
+#define TRANSPORT_REPORT_LEN_IDX				(0)
+#define TRANSPORT_REPORT_MSG_IDX				(1)			/*[Data Length][Link Layer Message], as the link layer lays out its reports.*/
+
+/*---------------------------------------------------------*/
+/*- LOCAL FUNCTIONS PROTOTYPES ----------------------------*/
+/*---------------------------------------------------------*/
+static twi_s32 loopback_open(tstr_twi_transport* pstr_transport, const char* pc_path);
+static void loopback_close(tstr_twi_transport* pstr_transport);
+static twi_s32 loopback_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num);
+static twi_s32 loopback_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read);
+
+static twi_s32 fd_write_all(int s_fd, const twi_u8* pu8_buf, twi_u32 u32_len);
+static twi_s32 fd_wait_readable(int s_fd, twi_u32 u32_timeout_ms, twi_bool* pb_is_readable);
+static twi_s32 unix_open(tstr_twi_transport* pstr_transport, const char* pc_path);
+static twi_s32 unix_listen(tstr_twi_transport* pstr_transport, const char* pc_path);
+static twi_s32 pipe_open(tstr_twi_transport* pstr_transport, const char* pc_path);
+static void stream_close(tstr_twi_transport* pstr_transport);
+static twi_s32 stream_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num);
+static twi_s32 stream_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read);
+
+static twi_s32 hidraw_open(tstr_twi_transport* pstr_transport, const char* pc_path);
+static twi_s32 hidraw_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num);
+static twi_s32 hidraw_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read);
+
+static const tstr_twi_transport_ops* transport_find(const char* pc_spec, const char** ppc_path);
+
+static twi_s32 transport_usbd_send(void* pv, const void* pv_data, twi_u32 u32_data_len);
+static twi_s32 transport_usbd_send_batch(void* pv, const void* pv_reports, twi_u32 u32_reports_num);
+static twi_s32 transport_usbd_receive(void* pv, void* pv_data, twi_u32* pu32_data_len);
+static void transport_usbd_stop(void* pv);
+static void transport_usbd_dispatch(void* pv);
+
+/*---------------------------------------------------------*/
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+/*---------------------------------------------------------*/
+static const tstr_twi_transport_ops gastr_transports[] =
+{
+	{"loopback",	loopback_open,	NULL,			loopback_close,	loopback_write,	loopback_read},
+	{"unix",		unix_open,		unix_listen,	stream_close,	stream_write,	stream_read},
+	{"pipe",		pipe_open,		pipe_open,		stream_close,	stream_write,	stream_read},
+	{"hidraw",		hidraw_open,	NULL,			stream_close,	hidraw_write,	hidraw_read},
+};
+
+/*---------------------------------------------------------*/
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+/*---------------------------------------------------------*/
+
+/*The peer answers while it handles the report, so its responses are already queued when the read comes.*/
+static twi_s32 loopback_open(tstr_twi_transport* pstr_transport, const char* pc_path)
+{
+	const tstr_twi_transport_peer* pstr_peer = pstr_transport->pstr_peer;
+
+	return ((NULL != pstr_peer) && (NULL != pstr_peer->pf_host_report) && (NULL != pstr_peer->pf_pop_report)) ? TWI_SUCCESS : TWI_ERROR_INVALID_ARGUMENTS;
+}
+
+static void loopback_close(tstr_twi_transport* pstr_transport)
+{
+}
+
+static twi_s32 loopback_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num)
+{
+	twi_u32 u32_idx;
+
+	for(u32_idx = 0; u32_idx < u32_reports_num; u32_idx++)
+	{
+		pstr_transport->pstr_peer->pf_host_report(pstr_transport->pstr_peer->pv_peer, &pu8_reports[u32_idx * TWI_TRANSPORT_REPORT_SZ], TWI_TRANSPORT_REPORT_SZ);
+	}
+	return TWI_SUCCESS;
+}
+
+static twi_s32 loopback_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read)
+{
+	*pb_is_read = pstr_transport->pstr_peer->pf_pop_report(pstr_transport->pstr_peer->pv_peer, pu8_report);
+	return TWI_SUCCESS;
+}
+
+static twi_s32 fd_write_all(int s_fd, const twi_u8* pu8_buf, twi_u32 u32_len)
+{
+	twi_s32 s32_retval 	= TWI_SUCCESS;
+	twi_u32 u32_done 	= 0;
+	ssize_t s_len;
+
+	while((u32_done < u32_len) && (TWI_SUCCESS == s32_retval))
+	{
+		s_len = write(s_fd, &pu8_buf[u32_done], u32_len - u32_done);
+		if(s_len > 0)
+		{
+			u32_done += (twi_u32)s_len;
+		}
+		else if((s_len < 0) && (EINTR == errno))
+		{
+			continue;
+		}
+		else
+		{
+			s32_retval = TWI_ERROR;
+		}
+	}
+	return s32_retval;
+}
+
+static twi_s32 fd_wait_readable(int s_fd, twi_u32 u32_timeout_ms, twi_bool* pb_is_readable)
+{
+	twi_s32 		s32_retval = TWI_SUCCESS;
+	struct pollfd 	str_pfd;
+	int 			s_ready;
+
+	str_pfd.fd 		= s_fd;
+	str_pfd.events 	= POLLIN;
+	str_pfd.revents = 0;
+	do
+	{
+		s_ready = poll(&str_pfd, 1, (int)u32_timeout_ms);
+	}while((s_ready < 0) && (EINTR == errno));
+
+	*pb_is_readable = TWI_FALSE;
+	if(s_ready < 0)
+	{
+		s32_retval = TWI_ERROR;
+	}
+	else if(s_ready > 0)
+	{
+		/*A hang up with data left is still read, the next read sees the end of the stream.*/
+		*pb_is_readable = TWI_TRUE;
+	}
+	return s32_retval;
+}
+
+static twi_s32 unix_open(tstr_twi_transport* pstr_transport, const char* pc_path)
+{
+	twi_s32 			s32_retval = TWI_ERROR;
+	struct sockaddr_un 	str_addr;
+	int 				s_fd;
+
+	if((NULL == pc_path) || (strlen(pc_path) >= sizeof(str_addr.sun_path)))
+	{
+		return TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	TWI_MEMSET(&str_addr, 0, sizeof(str_addr));
+	str_addr.sun_family = AF_UNIX;
+	strcpy(str_addr.sun_path, pc_path);
+
+	s_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(s_fd >= 0)
+	{
+		if(0 == connect(s_fd, (struct sockaddr*)&str_addr, sizeof(str_addr)))
+		{
+			pstr_transport->s_rd_fd = s_fd;
+			pstr_transport->s_wr_fd = s_fd;
+			s32_retval = TWI_SUCCESS;
+		}
+		else
+		{
+			close(s_fd);
+		}
+	}
+	return s32_retval;
+}
+
+/*Serves one host: the socket file is created, the first connection is taken and the file is removed again.*/
+static twi_s32 unix_listen(tstr_twi_transport* pstr_transport, const char* pc_path)
+{
+	twi_s32 			s32_retval = TWI_ERROR;
+	struct sockaddr_un 	str_addr;
+	int 				s_listen_fd;
+	int 				s_fd;
+
+	if((NULL == pc_path) || (strlen(pc_path) >= sizeof(str_addr.sun_path)))
+	{
+		return TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	TWI_MEMSET(&str_addr, 0, sizeof(str_addr));
+	str_addr.sun_family = AF_UNIX;
+	strcpy(str_addr.sun_path, pc_path);
+
+	s_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(s_listen_fd >= 0)
+	{
+		unlink(pc_path);
+		if((0 == bind(s_listen_fd, (struct sockaddr*)&str_addr, sizeof(str_addr))) && (0 == listen(s_listen_fd, 1)))
+		{
+			do
+			{
+				s_fd = accept(s_listen_fd, NULL, NULL);
+			}while((s_fd < 0) && (EINTR == errno));
+
+			if(s_fd >= 0)
+			{
+				pstr_transport->s_rd_fd = s_fd;
+				pstr_transport->s_wr_fd = s_fd;
+				s32_retval = TWI_SUCCESS;
+			}
+			unlink(pc_path);
+		}
+		close(s_listen_fd);
+	}
+	return s32_retval;
+}
+
+/*Both sides of a pipe pair are already open, the spec only names them.*/
+static twi_s32 pipe_open(tstr_twi_transport* pstr_transport, const char* pc_path)
+{
+	twi_s32 s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	int 	s_rd_fd;
+	int 	s_wr_fd;
+
+	if((NULL != pc_path) && (2 == sscanf(pc_path, "%d,%d", &s_rd_fd, &s_wr_fd)))
+	{
+		s32_retval = TWI_ERROR;
+		if((fcntl(s_rd_fd, F_GETFD) >= 0) && (fcntl(s_wr_fd, F_GETFD) >= 0))
+		{
+			pstr_transport->s_rd_fd = s_rd_fd;
+			pstr_transport->s_wr_fd = s_wr_fd;
+			s32_retval = TWI_SUCCESS;
+		}
+	}
+	return s32_retval;
+}
+
+static void stream_close(tstr_twi_transport* pstr_transport)
+{
+	if(TRANSPORT_NO_FD != pstr_transport->s_rd_fd)
+	{
+		close(pstr_transport->s_rd_fd);
+	}
+	if((TRANSPORT_NO_FD != pstr_transport->s_wr_fd) && (pstr_transport->s_wr_fd != pstr_transport->s_rd_fd))
+	{
+		close(pstr_transport->s_wr_fd);
+	}
+	pstr_transport->s_rd_fd = TRANSPORT_NO_FD;
+	pstr_transport->s_wr_fd = TRANSPORT_NO_FD;
+}
+
+static twi_s32 stream_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num)
+{
+	return fd_write_all(pstr_transport->s_wr_fd, pu8_reports, u32_reports_num * TWI_TRANSPORT_REPORT_SZ);
+}
+
+/*A stream has no report boundaries: once the first byte is there the rest of the report is waited for.*/
+static twi_s32 stream_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read)
+{
+	twi_s32 	s32_retval 	= fd_wait_readable(pstr_transport->s_rd_fd, u32_timeout_ms, pb_is_read);
+	twi_u32 	u32_done 	= 0;
+	ssize_t 	s_len;
+
+	while((TWI_SUCCESS == s32_retval) && (TWI_TRUE == *pb_is_read) && (u32_done < TWI_TRANSPORT_REPORT_SZ))
+	{
+		s_len = read(pstr_transport->s_rd_fd, &pu8_report[u32_done], TWI_TRANSPORT_REPORT_SZ - u32_done);
+		if(s_len > 0)
+		{
+			u32_done += (twi_u32)s_len;
+		}
+		else if((s_len < 0) && (EINTR == errno))
+		{
+			continue;
+		}
+		else
+		{
+			/*The peer is gone, a partial report is dropped with it.*/
+			*pb_is_read = TWI_FALSE;
+			s32_retval 	= TWI_ERROR;
+		}
+	}
+	return s32_retval;
+}
+
+static twi_s32 hidraw_open(tstr_twi_transport* pstr_transport, const char* pc_path)
+{
+#if defined(__linux__)
+	twi_s32 s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	int 	s_fd;
+
+	if(NULL != pc_path)
+	{
+		s32_retval 	= TWI_ERROR;
+		s_fd 		= open(pc_path, O_RDWR | O_CLOEXEC);
+		if(s_fd >= 0)
+		{
+			pstr_transport->s_rd_fd = s_fd;
+			pstr_transport->s_wr_fd = s_fd;
+			s32_retval = TWI_SUCCESS;
+		}
+	}
+	return s32_retval;
+#else
+	return TWI_ERROR_NOT_SUPPORTED_FEATURE;
+#endif
+}
+
+/*Same as the WebHID sendReport(0, report) calls: one output report per write, each one after the report id.*/
+static twi_s32 hidraw_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num)
+{
+	twi_s32 s32_retval = TWI_SUCCESS;
+	twi_u8 	au8_report[TRANSPORT_HIDRAW_REPORT_ID_SZ + TWI_TRANSPORT_REPORT_SZ];
+	twi_u32 u32_idx;
+
+	au8_report[0] = TRANSPORT_HIDRAW_REPORT_ID;
+	for(u32_idx = 0; (u32_idx < u32_reports_num) && (TWI_SUCCESS == s32_retval); u32_idx++)
+	{
+		TWI_MEMCPY(&au8_report[TRANSPORT_HIDRAW_REPORT_ID_SZ], &pu8_reports[u32_idx * TWI_TRANSPORT_REPORT_SZ], TWI_TRANSPORT_REPORT_SZ);
+		s32_retval = fd_write_all(pstr_transport->s_wr_fd, au8_report, sizeof(au8_report));
+	}
+	return s32_retval;
+}
+
+/*hidraw hands one whole input report per read, without the report id of an unnumbered report.*/
+static twi_s32 hidraw_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read)
+{
+	twi_s32 	s32_retval = fd_wait_readable(pstr_transport->s_rd_fd, u32_timeout_ms, pb_is_read);
+	ssize_t 	s_len;
+
+	if((TWI_SUCCESS == s32_retval) && (TWI_TRUE == *pb_is_read))
+	{
+		TWI_MEMSET(pu8_report, 0, TWI_TRANSPORT_REPORT_SZ);
+		do
+		{
+			s_len = read(pstr_transport->s_rd_fd, pu8_report, TWI_TRANSPORT_REPORT_SZ);
+		}while((s_len < 0) && (EINTR == errno));
+
+		if(s_len <= 0)
+		{
+			/*Unplugged.*/
+			*pb_is_read = TWI_FALSE;
+			s32_retval 	= TWI_ERROR;
+		}
+	}
+	return s32_retval;
+}
+
+static const tstr_twi_transport_ops* transport_find(const char* pc_spec, const char** ppc_path)
+{
+	const tstr_twi_transport_ops* 	pstr_ops 	= NULL;
+	const char* 					pc_sep 		= strchr(pc_spec, TRANSPORT_SPEC_SEPARATOR);
+	size_t 							s_name_len 	= (NULL != pc_sep) ? (size_t)(pc_sep - pc_spec) : strlen(pc_spec);
+	twi_u8 							u8_idx;
+
+	for(u8_idx = 0; (u8_idx < (sizeof(gastr_transports) / sizeof(gastr_transports[0]))) && (NULL == pstr_ops); u8_idx++)
+	{
+		if((strlen(gastr_transports[u8_idx].pc_name) == s_name_len) && (0 == strncmp(gastr_transports[u8_idx].pc_name, pc_spec, s_name_len)))
+		{
+			pstr_ops = &gastr_transports[u8_idx];
+		}
+	}
+	*ppc_path = (NULL != pc_sep) ? (pc_sep + 1) : NULL;
+	return pstr_ops;
+}
+
+/*The link layer hands the message alone, the report is built around it like the WebHID usbSend() does.*/
+static twi_s32 transport_usbd_send(void* pv, const void* pv_data, twi_u32 u32_data_len)
+{
+	tstr_twi_transport* pstr_transport = (tstr_twi_transport*)pv;
+	twi_u8 				au8_report[TWI_TRANSPORT_REPORT_SZ];
+
+	TWI_ASSERT((NULL != pstr_transport) && (NULL != pv_data));
+	if(u32_data_len > (TWI_TRANSPORT_REPORT_SZ - TRANSPORT_REPORT_MSG_IDX))
+	{
+		return TWI_ERROR_INVALID_LEN;
+	}
+	TWI_MEMSET(au8_report, 0, sizeof(au8_report));
+	au8_report[TRANSPORT_REPORT_LEN_IDX] = (twi_u8)u32_data_len;
+	TWI_MEMCPY(&au8_report[TRANSPORT_REPORT_MSG_IDX], pv_data, u32_data_len);
+	return twi_transport_write(pstr_transport, au8_report, 1);
+}
+
+static twi_s32 transport_usbd_send_batch(void* pv, const void* pv_reports, twi_u32 u32_reports_num)
+{
+	return twi_transport_write((tstr_twi_transport*)pv, (const twi_u8*)pv_reports, u32_reports_num);
+}
+
+/*Takes the report already waiting, *pu32_data_len is left 0 when none is.*/
+static twi_s32 transport_usbd_receive(void* pv, void* pv_data, twi_u32* pu32_data_len)
+{
+	twi_s32 	s32_retval;
+	twi_u8 		au8_report[TWI_TRANSPORT_REPORT_SZ];
+	twi_bool 	b_is_read;
+	twi_u32 	u32_len;
+
+	TWI_ASSERT((NULL != pv_data) && (NULL != pu32_data_len));
+	s32_retval = twi_transport_read((tstr_twi_transport*)pv, au8_report, 0, &b_is_read);
+	u32_len 	= 0;
+	if((TWI_SUCCESS == s32_retval) && (TWI_TRUE == b_is_read))
+	{
+		u32_len = au8_report[TRANSPORT_REPORT_LEN_IDX];
+		if((u32_len > (TWI_TRANSPORT_REPORT_SZ - TRANSPORT_REPORT_MSG_IDX)) || (u32_len > *pu32_data_len))
+		{
+			u32_len 	= 0;
+			s32_retval 	= TWI_ERROR_INVALID_LEN;
+		}
+		else
+		{
+			TWI_MEMCPY(pv_data, &au8_report[TRANSPORT_REPORT_MSG_IDX], u32_len);
+		}
+	}
+	*pu32_data_len = u32_len;
+	return s32_retval;
+}
+
+static void transport_usbd_stop(void* pv)
+{
+}
+
+static void transport_usbd_dispatch(void* pv)
+{
+}
+
+/*---------------------------------------------------------*/
+/*- APIs IMPLEMENTATION -----------------------------------*/
+/*---------------------------------------------------------*/
+
+/**
+*	@brief		Opens the transport the spec names and reaches the device through it.
+*	@param [out] pstr_transport	Pointer to the transport context.
+*	@param [in]	pc_spec			"loopback", "unix:<path>", "pipe:<read fd>,<write fd>" or "hidraw:<path>".
+*	@param [in]	pstr_peer		In-process device the loopback backend talks to, unused by the others.
+*	@return		TWI_SUCCESS, TWI_ERROR_INVALID_ARGUMENTS for an unknown spec, TWI_ERROR_NOT_SUPPORTED_FEATURE if the backend
+*				isn't built on this OS, TWI_ERROR if the device or the peer can't be reached.
+*/
+twi_s32 twi_transport_open(tstr_twi_transport* pstr_transport, const char* pc_spec, const tstr_twi_transport_peer* pstr_peer)
+{
+	twi_s32 						s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	const tstr_twi_transport_ops* 	pstr_ops;
+	const char* 					pc_path;
+
+	TWI_ASSERT((NULL != pstr_transport) && (NULL != pc_spec));
+	TWI_MEMSET(pstr_transport, 0, sizeof(tstr_twi_transport));
+	pstr_transport->s_rd_fd 	= TRANSPORT_NO_FD;
+	pstr_transport->s_wr_fd 	= TRANSPORT_NO_FD;
+	pstr_transport->pstr_peer 	= pstr_peer;
+
+	pstr_ops = transport_find(pc_spec, &pc_path);
+	if(NULL != pstr_ops)
+	{
+		/*A peer that goes away shall fail the write, not kill the host.*/
+		signal(SIGPIPE, SIG_IGN);
+		s32_retval = pstr_ops->pf_open(pstr_transport, pc_path);
+		if(TWI_SUCCESS == s32_retval)
+		{
+			pstr_transport->pstr_ops = pstr_ops;
+		}
+	}
+	return s32_retval;
+}
+
+/**
+*	@brief		Opens the transport the spec names on the device side and waits for the host to reach it.
+*	@param [out] pstr_transport	Pointer to the transport context.
+*	@param [in]	pc_spec			"unix:<path>" or "pipe:<read fd>,<write fd>".
+*	@return		TWI_SUCCESS, TWI_ERROR_NOT_SUPPORTED_FEATURE if the backend can't serve, TWI_ERROR otherwise.
+*/
+twi_s32 twi_transport_listen(tstr_twi_transport* pstr_transport, const char* pc_spec)
+{
+	twi_s32 						s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	const tstr_twi_transport_ops* 	pstr_ops;
+	const char* 					pc_path;
+
+	TWI_ASSERT((NULL != pstr_transport) && (NULL != pc_spec));
+	TWI_MEMSET(pstr_transport, 0, sizeof(tstr_twi_transport));
+	pstr_transport->s_rd_fd = TRANSPORT_NO_FD;
+	pstr_transport->s_wr_fd = TRANSPORT_NO_FD;
+
+	pstr_ops = transport_find(pc_spec, &pc_path);
+	if(NULL != pstr_ops)
+	{
+		s32_retval = TWI_ERROR_NOT_SUPPORTED_FEATURE;
+		if(NULL != pstr_ops->pf_listen)
+		{
+			signal(SIGPIPE, SIG_IGN);
+			s32_retval = pstr_ops->pf_listen(pstr_transport, pc_path);
+			if(TWI_SUCCESS == s32_retval)
+			{
+				pstr_transport->pstr_ops = pstr_ops;
+			}
+		}
+	}
+	return s32_retval;
+}
+
+/**
+*	@brief		Closes the transport, it can be opened again afterwards.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*/
+void twi_transport_close(tstr_twi_transport* pstr_transport)
+{
+	TWI_ASSERT(NULL != pstr_transport);
+	if(NULL != pstr_transport->pstr_ops)
+	{
+		pstr_transport->pstr_ops->pf_close(pstr_transport);
+		pstr_transport->pstr_ops = NULL;
+	}
+}
+
+/**
+*	@brief		Writes contiguous TWI_TRANSPORT_REPORT_SZ reports.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*	@param [in]	pu8_reports		Pointer to the first report.
+*	@param [in]	u32_reports_num	Number of reports.
+*	@return		TWI_SUCCESS once all of them are written, TWI_ERROR if the device or the peer is gone.
+*/
+twi_s32 twi_transport_write(tstr_twi_transport* pstr_transport, const twi_u8* pu8_reports, twi_u32 u32_reports_num)
+{
+	TWI_ASSERT((NULL != pstr_transport) && (NULL != pstr_transport->pstr_ops) && (NULL != pu8_reports));
+	return pstr_transport->pstr_ops->pf_write(pstr_transport, pu8_reports, u32_reports_num);
+}
+
+/**
+*	@brief		Reads one report.
+*	@param [in]	pstr_transport	Pointer to the transport context.
+*	@param [out] pu8_report		Buffer of at least TWI_TRANSPORT_REPORT_SZ bytes.
+*	@param [in]	u32_timeout_ms	Longest wait for the report, 0 only takes a report that already arrived.
+*	@param [out] pb_is_read		TWI_TRUE if a report was copied.
+*	@return		TWI_SUCCESS, also when no report came in time, TWI_ERROR if the device or the peer is gone.
+*/
+twi_s32 twi_transport_read(tstr_twi_transport* pstr_transport, twi_u8* pu8_report, twi_u32 u32_timeout_ms, twi_bool* pb_is_read)
+{
+	TWI_ASSERT((NULL != pstr_transport) && (NULL != pstr_transport->pstr_ops) && (NULL != pu8_report) && (NULL != pb_is_read));
+	*pb_is_read = TWI_FALSE;
+	return pstr_transport->pstr_ops->pf_read(pstr_transport, pu8_report, u32_timeout_ms, pb_is_read);
+}
+
+/**
+*	@brief		Sets the USB helpers of the stack to send and pull its reports through a transport.
+*				The stack shall be initialized with the transport as its helpers pointer, the other helpers find the host
+*				context in pv_owner. A send returns once the reports are written, the host then passes ::TWI_USBD_TX_DONE
+*				to the stack. On ::TWI_USBD_RX_DONE without data the stack pulls the report waiting on the transport.
+*				Closing the transport is left to the host.
+*	@param [out] pstr_helpers	Pointer to the stack helpers, only the USB ones are set.
+*/
+void twi_transport_bind_stack_helpers(tstr_stack_helpers* pstr_helpers)
+{
+	TWI_ASSERT(NULL != pstr_helpers);
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send 		= transport_usbd_send;
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch = transport_usbd_send_batch;
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_receive 	= transport_usbd_receive;
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_stop 		= transport_usbd_stop;
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_dispatch 	= transport_usbd_dispatch;
+}
@@ -52,11 +52,16 @@
 /*---------------------------------------------------------*/
 /*- MODULE LOCAL MACROS DEFINITION-------------------------*/
 /*---------------------------------------------------------*/
-#define TWI_SEND_TIMEOUT_MS								(10000)			/** @brief: 1 Second. This is the maximum allowed timeout for the data/error send. It's used to propagate send error to upper layers if the @ref: TWI_USBD_TX_DONE is not received in less than this time window*/
+#define TWI_SEND_TIMEOUT_MS								(10000)			/** @brief: 10 Seconds. This is the maximum allowed timeout for the data send, the bound of the send timeout backoff. It's used to propagate send error to upper layers if the @ref: TWI_USBD_TX_DONE is not received in less than this time window*/
+#define TWI_SEND_RTO_INIT_MS							(1000)			/** @brief: Send timeout of one report till the first round trip time is measured.*/
+#define TWI_SEND_RTO_MIN_MS								(100)			/** @brief: Lower bound of the send timeout of one report derived from the measured round trip times, above the host scheduling jitter.*/
 #define TWI_STACK_SPECS_COMMANDS_TIMEOUT_MS				(10000)			/** @brief: 1 Seconds. This is the time window allowed For the Mobile side and the Firmware Side to exchange their stack specification info.*/
 
 #define CONTROL_MESSAGE_MARKER							(1)				
 #define DATA_MESSAGE_MARKER								(0)
+#define JUMBO_MESSAGE_MARKER							(2)				/*First report of a data message spread over several reports, the 2 bytes message length follow the marker.*/
+#define JUMBO_CONTINUATION_MARKER						(3)				/*Next reports of a data message spread over several reports.*/
+#define COALESCED_MESSAGE_MARKER						(4)				/*Several single report messages packed in one report, once both sides agreed on TWI_LL_CAP_COALESCING.*/
 
 #define MESSAGE_TYPE_MARKER_INDEX						(0)
 #define DATA_MESSAGE_ERR_CODE_INDEX						(1)
@@ -68,10 +73,20 @@
 #define FW_STACK_SPECS_VERSION_SIZE						(2)	/*1 Byte For Major, 1 Byte For Minor*/
 #define FW_STACK_SPECS_MAX_CTU_SIZE						(4)	/*4 Bytes for the Max CTU*/
 #define FW_STACK_SPECS_DATA_SIZE						(FW_STACK_SPECS_VERSION_SIZE + FW_STACK_SPECS_MAX_CTU_SIZE)	/*1 For Major Version, 1 For Minor Version, 4 For The Supported MAX CTU*/
+#define FW_STACK_SPECS_JUMBO_REPORTS_SIZE				(1)	/*1 Byte for the Max Reports of one Data Message. Optional, the peers that don't send it support one report only*/
+#define FW_STACK_SPECS_CAPABILITIES_SIZE				(1)	/*1 Byte for the Capabilities Bitmap @ref TWI_LL_CAP_LZ_COMPRESSION. Optional, it follows the Max Reports and the peers that don't send it support none*/
+#define FW_STACK_SPECS_EXT_DATA_SIZE					(FW_STACK_SPECS_DATA_SIZE + FW_STACK_SPECS_JUMBO_REPORTS_SIZE + FW_STACK_SPECS_CAPABILITIES_SIZE)
 #define FIND_CURRENT_STACK_SEPCS_BUFF_IDX(IDX)			(FW_STACK_SPECS_VERSION_SIZE + IDX)
+#define FW_STACK_SPECS_JUMBO_REPORTS_IDX				(FW_STACK_SPECS_DATA_SIZE)
+#define FW_STACK_SPECS_CAPABILITIES_IDX					(FW_STACK_SPECS_JUMBO_REPORTS_IDX + FW_STACK_SPECS_JUMBO_REPORTS_SIZE)
+#define MY_STACK_SPECS_CAPABILITIES						(TWI_LL_CAP_LZ_COMPRESSION | TWI_LL_CAP_COALESCING | TWI_LL_CAP_REASSEMBLY_ACK)
+#define STACK_SPECS_RECORD_ID							(0x5353)		/*Id of the agreed stack specs record kept through the save/load helpers, one record per device.*/
+#define STACK_SPECS_RECORD_SIZE							(FW_STACK_SPECS_EXT_DATA_SIZE)	/*Same layout as the stack specs data, holding the agreed values.*/
 
 #define DATA_MESSAGE_MARKER_SIZE						(sizeof(twi_u8))
 #define DATA_MESSAGE_ERR_CODE_SIZE						(sizeof(twi_u8))
+#define JUMBO_MESSAGE_LENGTH_SIZE						(sizeof(twi_u16))
+#define COALESCED_RECORD_LENGTH_SIZE					(sizeof(twi_u8))
 
 #define REPORT_ID_ELEMENT_SIZE							(sizeof(twi_u8))
 #define DATA_LENGTH_ELEMENT_SIZE						(sizeof(twi_u8))
@@ -87,6 +102,24 @@
 #else
 #error "Not Supported USB HAL Type!"
 #endif
+
+#if defined (TWI_USE_USB_AS_HID)
+#define TX_REPORT_MSG_IDX								(DATA_LENGTH_ELEMENT_SIZE)	/*The transmit slots keep the HID report layout [Data Length][MSG MARKER][MESSAGE DATA] the batch send helper takes.*/
+#else
+#define TX_REPORT_MSG_IDX								(0)
+#endif
+
+#define TWI_LL_USB_TX_CTRL_SLOTS_NUM					(2)				/** @brief: Transmit slots the data messages can't take, so a control message always finds room.*/
+#define TWI_LL_USB_TX_DATA_SLOTS_NUM					(TWI_LL_USB_TX_SLOTS_NUM - TWI_LL_USB_TX_CTRL_SLOTS_NUM)
+#define TX_SLOT_IDX(PSTR_CTX, POS)						(((PSTR_CTX)->str_global.u8_tx_head + (POS)) % TWI_LL_USB_TX_SLOTS_NUM)
+
+#if defined (TWI_USE_USB_AS_HID) && (TWI_LL_USB_MAX_JUMBO_REPORTS > TWI_LL_USB_MAX_BATCH_REPORTS)
+#error "One Jumbo Data Message Shall Fit In The Batch Reports"
+#endif
+
+#if (TWI_LL_USB_TX_DATA_SLOTS_NUM < TWI_LL_USB_MAX_BATCH_REPORTS) || (TWI_LL_USB_TX_SLOTS_NUM > 255)
+#error "The Transmit Slots Shall Hold A Whole Batch Plus The Control Slots"
+#endif
 /**
  * 	@brief: The Formation of the Buffers to Send/ Receive over the USB.
  *	@ref: 	TWI_USBD_RX_DONE_BYTES_COUNT_TRIGGER. 
@@ -112,20 +145,57 @@
  * |					|							|
  * |--------------------|---------------------------|
  * 
- * 				 Data To Send Buffer Format (64 Bytes)
- * |--------------------|---------------------------|
- * |					|							|
- * |					|							|
- * |--<- MSG MARKER	->--|----<- MESSAGE DATA ->-----|
- * |		[1 Byte]	|			[n Bytes]		|
- * |					|							|
- * |--------------------|---------------------------|
+ * 		Jumbo Data Message Format, once both sides agreed on more than one report per message in the stack specs
+ * |--------------------|-------------------|---------------------------|		|--------------------|---------------------------|
+ * |					|					|							|		|					|							|
+ * |--<- MSG MARKER	->--|--<- MSG LENGTH ->-|----<- MESSAGE DATA ->-----|  ...	|--<- MSG MARKER	->--|----<- MESSAGE DATA ->-----|
+ * |		[2]			|		[2 Bytes]	|			[n Bytes]		|		|		[3]			|			[n Bytes]		|
+ * |					|					|							|		|					|							|
+ * |--------------------|-------------------|---------------------------|		|--------------------|---------------------------|
+ * 
+ * 		Coalesced Message Format, once both sides agreed on TWI_LL_CAP_COALESCING in the stack specs. Each record is a whole
+ * 		data or control message, marker included, so it's parsed like a report of its own. A zero length ends the records.
+ * |--------------------|-------------------|---------------------------|-------------------|---------------------------|
+ * |					|					|							|					|							|
+ * |--<- MSG MARKER	->--|--<- REC LENGTH ->-|----<- MESSAGE (n) ->------|--<- REC LENGTH ->-|----<- MESSAGE (m) ->------|  ...
+ * |		[4]			|		[n]			|	[MSG MARKER][MSG DATA]	|		[m]			|	[MSG MARKER][MSG DATA]	|
+ * |					|					|							|					|							|
+ * |--------------------|-------------------|---------------------------|-------------------|---------------------------|
+ * 
+ * 				 Transmit Slot Format (64 Bytes), the data length is only there for the HID
+ * |--------------------|--------------------|---------------------------|
+ * |					|					 |							 |
+ * |					|					 |							 |
+ * |--<- DATA LENGTH ->-|--<- MSG MARKER ->--|----<- MESSAGE DATA ->-----|
+ * |		[1 Byte]	|		[1 Byte]	 |			[n Bytes]		 |
+ * |					|					 |							 |
+ * |--------------------|--------------------|---------------------------|
+ *
+ * 	The transmit slots make a ring. Every outgoing report, data or control, takes a slot that goes FREE -> ( STAGED ) -> QUEUED -> IN_FLIGHT -> FREE.
+ * 	The reports are handed to the host in ring order as soon as it took the previous ones, all the contiguous queued reports at once if the host
+ * 	provided the batch send helper. The last report of a data message, or of a batch, raises the TWI_LL_SEND_STATUS_EVT once it's done.
+ * 	Once coalescing is agreed, the queued single report messages that fit together are packed in one report when they are handed to the host.
+ * 	Each of them keeps its own slot, so the send status of each one is raised as if it went alone.
 */
 
 
 /*---------------------------------------------------------*/
 /*- STRUCTS AND UNIONS AND ENUM----------------------------*/
 /*---------------------------------------------------------*/
+typedef enum
+{
+	USB_LL_TX_SLOT_FREE = 0,
+	USB_LL_TX_SLOT_STAGED,			/*Report of a data message of a batch that is not sent yet by twi_usb_ll_send_batch*/
+	USB_LL_TX_SLOT_QUEUED,			/*Waiting for the host to take the previous reports*/
+	USB_LL_TX_SLOT_IN_FLIGHT,		/*Handed to the host, waiting for the TWI_USBD_TX_DONE/TWI_USBD_TX_FAIL*/
+}tenu_usb_ll_tx_slot_state;
+
+typedef enum
+{
+	USB_LL_TX_SLOT_DATA = 0,
+	USB_LL_TX_SLOT_CTRL,
+	USB_LL_TX_SLOT_STACK_SPECS,
+}tenu_usb_ll_tx_slot_type;
 
 /*---------------------------------------------------------*/
 /*- GLOBAL CONST VARIABLES --------------------------------*/
@@ -151,6 +221,8 @@ static void twi_init_ll_global_variables(tstr_usb_ll_ctx * pstr_ctx, tstr_stack_
 
 /**
  *	@brief			            			This function is used to parse the stack specs command data.
+ *											The agreed CTU, reports per data message and capabilities are kept in the link layer context.
+ *	@param[in]	pv: 						Pointer to the usb link layer context.
  *	@param[in]	pu8_data: 					The Stack Specifications Data.
  *	@param[in]	u16_data_length: 			The Length Of Stack Specification Data.
  *	@param[out]	pu8_formatted_data: 		Pointer to the Formatted Data which we will send to the mobile.
@@ -164,6 +236,201 @@ static twi_bool parse_compose_stack_specs(void* pv, twi_u8* pu8_data, twi_u16 u1
  *	@param[in]  pv: 				a pointer to the needed user data. This is reserved for future development needs
 */
 static void twi_stack_specs_timer_timeout_cb (void* pv);
+
+#if defined (TWI_USB_HOST)
+/**
+ *	@brief			            	This function saves the agreed stack specs through the save helper, so the next connection to the same device can use them right away.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static void twi_usb_ll_specs_save(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function drops the saved stack specs, the next connection goes through the whole exchange.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static void twi_usb_ll_specs_forget(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function loads the stack specs saved for the connected device and applies them.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@return : ::TWI_TRUE if a valid record of this stack specs version was applied.
+*/
+static twi_bool twi_usb_ll_specs_load(tstr_usb_ll_ctx * pstr_ctx);
+#endif
+
+/**
+ *	@brief			            	This function returns the number of reports one data message can span on this side.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static twi_u8 twi_usb_ll_get_my_jumbo_reports(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function returns the total length of the data described by scatter-gather segments.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static twi_u32 twi_usb_ll_iov_len(const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+
+/**
+ *	@brief			            	This function copies a range of the data described by scatter-gather segments.
+ *	@param[out] pu8_dst: 			Pointer to the destination buffer.
+ *	@param[in]  u16_offset: 		Offset of the range in the concatenated segments.
+ *	@param[in]  u16_len: 			Length of the range.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static void twi_usb_ll_iov_copy(twi_u8* pu8_dst, twi_u16 u16_offset, twi_u16 u16_len, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+
+/**
+ *	@brief			            	This function stages one data message in the transmit slots, as one report or as a jumbo data message.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments that make the message data.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static twi_s32 twi_usb_ll_stage_reports(tstr_usb_ll_ctx * pstr_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num);
+
+/**
+ *	@brief			            	This function reassembles the reports of a jumbo data message.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+ *	@param[out] pstr_evt: 			The event to propagate once the message is complete.
+ *	@return : ::TWI_TRUE if the jumbo data message is complete.
+*/
+static twi_bool twi_usb_ll_rcv_jumbo(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len, tstr_twi_ll_evt* pstr_evt);
+
+/**
+ *	@brief			            	This function handles one link layer message received after the stack specs exchange and raises its event.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+*/
+static void twi_usb_ll_rcv_msg(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len);
+
+/**
+ *	@brief			            	This function unpacks the messages of a coalesced report and handles them in order.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+*/
+static void twi_usb_ll_rcv_coalesced(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len);
+
+/**
+ *	@brief			            	This function is used to start timing a data send handed to the host, if the host provided a clock.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u16_reports_num: 	Number of reports of the send.
+*/
+static void twi_usb_ll_tx_timing_start(tstr_usb_ll_ctx * pstr_ctx, twi_u16 u16_reports_num);
+
+/**
+ *	@brief			            	This function is used to check the TWI_USBD_TX_DONE/TWI_USBD_TX_FAIL of a timed data send.
+ *									A successful send gives a round trip time sample per report.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		TWI_TRUE for the TWI_USBD_TX_DONE.
+*/
+static void twi_usb_ll_tx_timing_stop(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success);
+
+/**
+ *	@brief			            	This function gives the next send handed to the host its id, the id of the flight in the transmit slots.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_id_push(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function takes the id of the send a TWI_USBD_TX_DONE/TWI_USBD_TX_FAIL belongs to, the oldest one handed to the host.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@return : ::TWI_TRUE if the event belongs to the flight in the transmit slots, TWI_FALSE if it belongs to a send already
+ *				failed by its timeout or to none, so it shall be ignored.
+*/
+static twi_bool twi_usb_ll_tx_id_pop(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function is used to fail the data send that is not done within its timeout.
+ *									The timeout is the send timeout of one report times the reports of the send, it's doubled on every expiry.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_timing_check(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function empties the transmit slots without raising any event.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_reset(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function frees the staged transmit slots of a batch that is not sent.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_drop_staged(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function queues the staged transmit slots, the last one raises the TWI_LL_SEND_STATUS_EVT.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	pv_arg: 			User argument of the TWI_LL_SEND_STATUS_EVT.
+*/
+static twi_s32 twi_usb_ll_tx_commit(tstr_usb_ll_ctx * pstr_ctx, void* pv_arg);
+
+/**
+ *	@brief			            	This function queues one control message in a transmit slot.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	enu_err_code: 		Error code of the control message.
+ *	@param[in]	pu8_error_data: 	Pointer to the error data.
+ *	@param[in]	u16_error_len: 		Error data length.
+*/
+static twi_s32 twi_usb_ll_tx_queue_ctrl(tstr_usb_ll_ctx * pstr_ctx, tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len);
+
+/**
+ *	@brief			            	This function checks if a queued transmit slot can be packed in a coalesced report.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u8_pos: 			Position of the slot from the ring head.
+ *	@param[in]	u16_used_len: 		Length of the records already packed in the report.
+*/
+static twi_bool twi_usb_ll_tx_is_packable(tstr_usb_ll_ctx * pstr_ctx, twi_u8 u8_pos, twi_u16 u16_used_len);
+
+/**
+ *	@brief			            	This function packs the queued transmit slots at the ring head in coalesced reports.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[out]	pu8_reports_num: 	Number of packed reports.
+ *	@param[out]	pu16_len: 			Length of the first packed report.
+ *	@return : ::The number of slots the packed reports carry, 0 if nothing could be packed.
+*/
+static twi_u8 twi_usb_ll_tx_pack(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_reports_num, twi_u16* pu16_len);
+
+/**
+ *	@brief			            	This function hands the queued transmit slots at the ring head to the host, if it took the previous ones.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@return : ::TWI_SUCCESS or the host send error, the slots stay queued on TWI_ERROR_USBD_SEND_BUSY and in flight otherwise.
+*/
+static twi_s32 twi_usb_ll_tx_drain(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function frees the transmit slots in flight once the host is done with them.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		TWI_TRUE if the host sent them.
+*/
+static void twi_usb_ll_tx_complete(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success);
+
+/**
+ *	@brief			            	This function keeps the host fed from the transmit slots, the sends the host refuses are failed.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_service(tstr_usb_ll_ctx * pstr_ctx);
+
+/**
+ *	@brief			            	This function raises the TWI_LL_SEND_STATUS_EVT.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		The send status.
+ *	@param[in]	pv_user_arg: 		User argument of the send.
+*/
+static void twi_usb_ll_tx_notify(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success, void* pv_user_arg);
+
+/**
+ *	@brief			            	This function handles the end of a control message send, it moves the stack specs exchange on.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u8_type: 			@ref tenu_usb_ll_tx_slot_type of the control message.
+ *	@param[in]	b_is_success: 		TWI_TRUE if the host sent it.
+*/
+static void twi_usb_ll_tx_ctrl_done(tstr_usb_ll_ctx * pstr_ctx, twi_u8 u8_type, twi_bool b_is_success);
 /*---------------------------------------------------------*/
 /*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
 /*---------------------------------------------------------*/
@@ -176,24 +443,34 @@ static void twi_init_ll_global_variables(tstr_usb_ll_ctx * pstr_ctx, tstr_stack_
 	pstr_ctx->str_global.b_need_to_disconnect					= TWI_FALSE;
 	pstr_ctx->str_global.b_is_initialized						= TWI_FALSE;
 	pstr_ctx->str_global.pf_ll_cb	 							= NULL;	
-	pstr_ctx->str_global.pv_user_arg							= NULL;
-	pstr_ctx->str_global.u16_err_buf_length						= 0;
-	pstr_ctx->str_global.u16_data_buf_length					= 0;
-	pstr_ctx->str_global.u16_data_to_send_buf_length			= 0;
 	pstr_ctx->str_global.enu_link_layer_state					= USB_LINK_LAYER_STATE_WAITING_TO_CONNECT;
 	pstr_ctx->str_global.b_is_stack_specs_received 				= TWI_FALSE;
 	pstr_ctx->str_global.b_is_sending_stack_specs				= TWI_FALSE; 
+	pstr_ctx->str_global.b_is_specs_optimistic					= TWI_FALSE;
+	pstr_ctx->str_global.u32_ctu								= MAX_PKT_SZ;
+	pstr_ctx->str_global.u8_jumbo_reports						= 1;
+	pstr_ctx->str_global.u8_capabilities						= 0;
+	pstr_ctx->str_global.u16_jumbo_rcv_len						= 0;
+	pstr_ctx->str_global.u16_jumbo_rcv_idx						= 0;
+	pstr_ctx->str_global.b_is_tx_timed							= TWI_FALSE;
+	pstr_ctx->str_global.u16_tx_reports_num						= 0;
+	pstr_ctx->str_global.u32_tx_start_ms						= 0;
+	pstr_ctx->str_global.u8_tx_next_id							= 0;
+	pstr_ctx->str_global.u8_tx_inflight_id						= 0;
+	twi_rtt_init(&(pstr_ctx->str_global.str_tx_rtt), TWI_SEND_RTO_INIT_MS, TWI_SEND_RTO_MIN_MS, TWI_SEND_TIMEOUT_MS);
 	pstr_ctx->pstr_stack_helpers								= pstr_helper;
 	pstr_ctx->pv_stack_helpers									= pv_helpers;
 
-	TWI_MEMSET(pstr_ctx->str_global.au8_err_send_buff,  			0, 	sizeof(pstr_ctx->str_global.au8_err_send_buff));
 	TWI_MEMSET(pstr_ctx->str_global.au8_data_rcv_buff, 				0, 	sizeof(pstr_ctx->str_global.au8_data_rcv_buff));
-	TWI_MEMSET(pstr_ctx->str_global.au8_data_send_buf, 				0, 	sizeof(pstr_ctx->str_global.au8_data_send_buf));
 	TWI_MEMSET(&(pstr_ctx->str_global.str_stack_event_timeout), 	0, 	sizeof(pstr_ctx->str_global.str_stack_event_timeout));
+	TWI_MEMSET(&(pstr_ctx->str_global.str_stats), 					0, 	sizeof(pstr_ctx->str_global.str_stats));
+	twi_usb_ll_tx_reset(pstr_ctx);
 }
 
 /**
  *	@brief			            			This function is used to parse the stack specs command data.
+ *											The agreed CTU, reports per data message and capabilities are kept in the link layer context.
+ *	@param[in]	pv: 						Pointer to the usb link layer context.
  *	@param[in]	pu8_data: 					The Stack Specifications Data.
  *	@param[in]	u16_data_length: 			The Length Of Stack Specification Data.
  *	@param[out]	pu8_formatted_data: 		Pointer to the Formatted Data which we will send to the mobile.
@@ -208,6 +485,7 @@ static twi_bool parse_compose_stack_specs(void* pv, twi_u8* pu8_data, twi_u16 u1
 		| 		1 Byte		|		1 Byte		|									4 Bytes											|
 		|	Major Version 	|	Minor Version	|	Maximum Supported CTU "Maximum Size of Unfragmented Packet to send or receive"	|
 		|-------------------|-------------------|-----------------------------------------------------------------------------------|
+		Followed by the optional 1 Byte Max Reports of one Data Message and the optional 1 Byte Capabilities Bitmap.
 	*/
 
 	twi_bool b_retval							= TWI_TRUE;
@@ -218,75 +496,1080 @@ static twi_bool parse_compose_stack_specs(void* pv, twi_u8* pu8_data, twi_u16 u1
 	twi_u32 u32_ctu_for_peer 					= 0;
 	twi_u32 u32_ctu_for_mine 					= 0;
 	twi_u32 u32_min_ctu_from_both_ctu_values 	= 0;
+	twi_u8	u8_jumbo_reports 					= 1;
+	twi_bool b_is_jumbo_supported 				= TWI_FALSE;
+	twi_u8	u8_capabilities 					= 0;
+	twi_bool b_is_caps_supported 				= TWI_FALSE;
+	tstr_usb_ll_ctx * pstr_ctx 					= (tstr_usb_ll_ctx*) pv;
+
+	/*Input Parameters Validation*/
+	if ((pu8_data != NULL) && (u16_data_length != 0)) 
+	{
+		/*this is the parsing section. This means that we received a STACK SPECS command from the other side.*/
+		if ((pu8_data[0] == MY_STACK_SPECS_MAJOR_VER) && (pu8_data[1] == MY_STACK_SPECS_MINOR_VER))
+		{
+			u16_least_significant_ctu_peer = TWO_BYTE_CONCAT(pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(1)], pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(0)]);
+			u16_most_significant_ctu_peer = TWO_BYTE_CONCAT(pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(3)], pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(2)]);
+			u32_ctu_for_peer = TWO_16BITS_CONCAT(u16_most_significant_ctu_peer, u16_least_significant_ctu_peer);
+			u32_ctu_for_mine = MAX_PKT_SZ;
+
+			USB_LINK_LAYER_LOG("STACK_SPECS COMMAND DATA: Major = %d, Minor = %d, CTU Mine = %d, CTU Peer = %d\r\n", pu8_data[0], pu8_data[1], u32_ctu_for_mine, u32_ctu_for_peer);
+
+			/*Getting the Minimum of Both CTU Values for Mobile and FW Side*/
+			u32_min_ctu_from_both_ctu_values = (u32_ctu_for_mine < u32_ctu_for_peer) ? (u32_ctu_for_mine) : (u32_ctu_for_peer);
+
+			/*The Max Reports of one Data Message is only sent by the peers that support jumbo data messages*/
+			u8_jumbo_reports = twi_usb_ll_get_my_jumbo_reports(pstr_ctx);
+			if (u16_data_length > FW_STACK_SPECS_JUMBO_REPORTS_IDX)
+			{
+				b_is_jumbo_supported 	= TWI_TRUE;
+				u8_jumbo_reports 		= (pu8_data[FW_STACK_SPECS_JUMBO_REPORTS_IDX] < u8_jumbo_reports) ? (pu8_data[FW_STACK_SPECS_JUMBO_REPORTS_IDX]) : (u8_jumbo_reports);
+			}
+			else
+			{
+				u8_jumbo_reports 		= 1;
+			}
+			if (u8_jumbo_reports == 0)
+			{
+				u8_jumbo_reports 		= 1;
+			}
+
+			/*The Capabilities are only sent by the peers that support some of them, only the ones both sides support are used*/
+			if (u16_data_length > FW_STACK_SPECS_CAPABILITIES_IDX)
+			{
+				b_is_caps_supported 	= TWI_TRUE;
+				u8_capabilities 		= pu8_data[FW_STACK_SPECS_CAPABILITIES_IDX] & MY_STACK_SPECS_CAPABILITIES;
+			}
+
+			pstr_ctx->str_global.u32_ctu 			= u32_min_ctu_from_both_ctu_values;
+			pstr_ctx->str_global.u8_jumbo_reports 	= u8_jumbo_reports;
+			pstr_ctx->str_global.u8_capabilities 	= u8_capabilities;
+			USB_LINK_LAYER_LOG("Agreed CTU = %d, Reports Per Data Message = %d, Capabilities = 0x%x\r\n", u32_min_ctu_from_both_ctu_values, u8_jumbo_reports, u8_capabilities);
+		}
+		else
+		{
+			/*Invalid Data Length!*/
+			USB_LINK_LAYER_LOG_ERR("Invalid Major Or Minor Versions! Major = %d, Minor = %d\r\n", pu8_data[0], pu8_data[1]);
+			b_retval = TWI_FALSE;
+		}
+	}
+	else 
+	{
+		/*this is the composing section. This means that we send a STACK SPECS command to the other side.*/
+		USB_LINK_LAYER_LOG("Composing Stack Specs Command!\r\n");
+		u32_min_ctu_from_both_ctu_values = MAX_PKT_SZ;
+		u8_jumbo_reports 				 = twi_usb_ll_get_my_jumbo_reports(pstr_ctx);
+		b_is_jumbo_supported 			 = TWI_TRUE;
+		u8_capabilities 				 = MY_STACK_SPECS_CAPABILITIES;
+		b_is_caps_supported 			 = TWI_TRUE;
+	}
+
+	if ((pu8_formatted_data != NULL) && (pu16_formatted_data_length != NULL))
+	{
+		twi_u16 u16_max_buff_length = *pu16_formatted_data_length;
+
+		if (u16_max_buff_length >= FW_STACK_SPECS_DATA_SIZE)
+		{
+			/*Format Both Major and Minor Versions.*/
+			pu8_formatted_data[u16_current_data_index++] = MY_STACK_SPECS_MAJOR_VER;
+			pu8_formatted_data[u16_current_data_index++] = MY_STACK_SPECS_MINOR_VER;
+
+			for (u8_looping_index = 0; u8_looping_index < FW_STACK_SPECS_MAX_CTU_SIZE; u8_looping_index++)
+			{
+				/*Copy The Minimum of both Firmware & Mobile CTU Size. With taking into consideration of bytes flipping over BLE*/
+				pu8_formatted_data[u8_looping_index + u16_current_data_index] = GET_BYTE_STATUS(u32_min_ctu_from_both_ctu_values, u8_looping_index);
+			}
+			/*Updating The Current Data Index to be equal to the total data length. And Store its value inside the pointer passed to the function*/
+			u16_current_data_index += sizeof(u32_min_ctu_from_both_ctu_values);
+
+			/*Only answer with the Max Reports of one Data Message if the peer sent it, the older peers expect the exact specs size*/
+			if ((b_is_jumbo_supported == TWI_TRUE) && (u16_max_buff_length > FW_STACK_SPECS_JUMBO_REPORTS_IDX))
+			{
+				pu8_formatted_data[u16_current_data_index++] = u8_jumbo_reports;
+
+				/*The same for the Capabilities, they always follow the Max Reports*/
+				if ((b_is_caps_supported == TWI_TRUE) && (u16_max_buff_length > FW_STACK_SPECS_CAPABILITIES_IDX))
+				{
+					pu8_formatted_data[u16_current_data_index++] = u8_capabilities;
+				}
+			}
+			*pu16_formatted_data_length = u16_current_data_index;
+		}
+	}
+	
+	return b_retval;
+}
+
+/**
+ *	@brief			            	This function is used as the timer callback for the @ref: gstr_stack_event_timeout.
+ *	@param[in]  pv: 				a pointer to the needed user data. This is reserved for future development needs
+*/
+static void twi_stack_specs_timer_timeout_cb (void* pv)
+{
+	tstr_usb_ll_ctx * pstr_ctx = (tstr_usb_ll_ctx*) pv;
+	USB_LINK_LAYER_LOG_ERR("Stack Specs Timeout Fired!\r\n");
+#if defined (TWI_USB_HOST)
+	/*The saved specs weren't confirmed, don't trust them next time*/
+	if(TWI_TRUE == pstr_ctx->str_global.b_is_specs_optimistic)
+	{
+		twi_usb_ll_specs_forget(pstr_ctx);
+	}
+#endif
+	pstr_ctx->pstr_stack_helpers->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+	/*pstr_ctx->str_global.b_need_to_disconnect = TWI_TRUE;*/
+}
+
+#if defined (TWI_USB_HOST)
+/**
+ *	@brief			            	This function saves the agreed stack specs through the save helper, so the next connection to the same device can use them right away.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static void twi_usb_ll_specs_save(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_u8	au8_record[STACK_SPECS_RECORD_SIZE];
+	twi_u8	u8_looping_index;
+
+	if(NULL != pstr_ctx->pstr_stack_helpers->pf_save_data)
+	{
+		au8_record[0] = MY_STACK_SPECS_MAJOR_VER;
+		au8_record[1] = MY_STACK_SPECS_MINOR_VER;
+		for (u8_looping_index = 0; u8_looping_index < FW_STACK_SPECS_MAX_CTU_SIZE; u8_looping_index++)
+		{
+			au8_record[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(u8_looping_index)] = GET_BYTE_STATUS(pstr_ctx->str_global.u32_ctu, u8_looping_index);
+		}
+		au8_record[FW_STACK_SPECS_JUMBO_REPORTS_IDX] 	= pstr_ctx->str_global.u8_jumbo_reports;
+		au8_record[FW_STACK_SPECS_CAPABILITIES_IDX] 	= pstr_ctx->str_global.u8_capabilities;
+		pstr_ctx->pstr_stack_helpers->pf_save_data(pstr_ctx->pv_stack_helpers, STACK_SPECS_RECORD_ID, au8_record, sizeof(au8_record));
+	}
+}
+
+/**
+ *	@brief			            	This function drops the saved stack specs, the next connection goes through the whole exchange.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static void twi_usb_ll_specs_forget(tstr_usb_ll_ctx * pstr_ctx)
+{
+	if(NULL != pstr_ctx->pstr_stack_helpers->pf_save_data)
+	{
+		pstr_ctx->pstr_stack_helpers->pf_save_data(pstr_ctx->pv_stack_helpers, STACK_SPECS_RECORD_ID, NULL, 0);
+	}
+}
+
+/**
+ *	@brief			            	This function loads the stack specs saved for the connected device and applies its CTU and reports per data message.
+ *									The capabilities stay off till the device confirms them, they change the format of what is sent.
+ *									A record of another stack specs version or with values this side can't use is ignored.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@return : ::TWI_TRUE if a valid record of this stack specs version was applied.
+*/
+static twi_bool twi_usb_ll_specs_load(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_bool b_retval 			= TWI_FALSE;
+	twi_u8	au8_record[STACK_SPECS_RECORD_SIZE];
+	twi_u32 u32_record_len 		= sizeof(au8_record);
+	twi_u32 u32_ctu;
+
+	if((NULL != pstr_ctx->pstr_stack_helpers->pf_load_data) &&
+	   (TWI_SUCCESS == pstr_ctx->pstr_stack_helpers->pf_load_data(pstr_ctx->pv_stack_helpers, STACK_SPECS_RECORD_ID, au8_record, &u32_record_len)) &&
+	   (sizeof(au8_record) == u32_record_len) && (MY_STACK_SPECS_MAJOR_VER == au8_record[0]) && (MY_STACK_SPECS_MINOR_VER == au8_record[1]))
+	{
+		u32_ctu = TWO_16BITS_CONCAT(TWO_BYTE_CONCAT(au8_record[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(3)], au8_record[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(2)]),
+									TWO_BYTE_CONCAT(au8_record[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(1)], au8_record[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(0)]));
+		if((0 != u32_ctu) && (u32_ctu <= MAX_PKT_SZ) && (0 != au8_record[FW_STACK_SPECS_JUMBO_REPORTS_IDX]) &&
+		   (au8_record[FW_STACK_SPECS_JUMBO_REPORTS_IDX] <= twi_usb_ll_get_my_jumbo_reports(pstr_ctx)) &&
+		   (0 == (au8_record[FW_STACK_SPECS_CAPABILITIES_IDX] & ~MY_STACK_SPECS_CAPABILITIES)))
+		{
+			pstr_ctx->str_global.u32_ctu 			= u32_ctu;
+			pstr_ctx->str_global.u8_jumbo_reports 	= au8_record[FW_STACK_SPECS_JUMBO_REPORTS_IDX];
+			pstr_ctx->str_global.u8_capabilities 	= 0;
+			b_retval 								= TWI_TRUE;
+		}
+	}
+	return b_retval;
+}
+#endif
+
+/**
+ *	@brief			            	This function returns the number of reports one data message can span on this side.
+ *									The reports of a message are queued back to back in the transmit slots, so no control message gets between them.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+*/
+static twi_u8 twi_usb_ll_get_my_jumbo_reports(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_u8 u8_retval = 1;
+#if defined (TWI_USE_USB_AS_HID)
+	u8_retval = TWI_LL_USB_MAX_JUMBO_REPORTS;
+#endif
+	return u8_retval;
+}
+
+/**
+ *	@brief			            	This function returns the total length of the data described by scatter-gather segments.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static twi_u32 twi_usb_ll_iov_len(const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_u32 u32_len = 0;
+	twi_u8 	u8_idx;
+
+	for(u8_idx = 0; u8_idx < u8_iov_num; u8_idx++)
+	{
+		u32_len += pstr_iov[u8_idx].u16_len;
+	}
+	return u32_len;
+}
+
+/**
+ *	@brief			            	This function copies a range of the data described by scatter-gather segments.
+ *	@param[out] pu8_dst: 			Pointer to the destination buffer.
+ *	@param[in]  u16_offset: 		Offset of the range in the concatenated segments.
+ *	@param[in]  u16_len: 			Length of the range.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static void twi_usb_ll_iov_copy(twi_u8* pu8_dst, twi_u16 u16_offset, twi_u16 u16_len, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_u8 	u8_idx;
+	twi_u16 u16_chunk;
+
+	for(u8_idx = 0; (u8_idx < u8_iov_num) && (u16_len > 0); u8_idx++)
+	{
+		if(u16_offset >= pstr_iov[u8_idx].u16_len)
+		{
+			u16_offset -= pstr_iov[u8_idx].u16_len;
+		}
+		else
+		{
+			u16_chunk = pstr_iov[u8_idx].u16_len - u16_offset;
+			u16_chunk = (u16_chunk < u16_len) ? u16_chunk : u16_len;
+			TWI_MEMCPY(pu8_dst, &(pstr_iov[u8_idx].pu8_data[u16_offset]), u16_chunk);
+			pu8_dst 	+= u16_chunk;
+			u16_len 	-= u16_chunk;
+			u16_offset 	 = 0;
+		}
+	}
+}
+
+/**
+ *	@brief			            	This function stages one data message in the transmit slots. A message that fits in one report keeps the
+ *									plain data message format, a longer one is spread over several reports as a jumbo data message.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pstr_iov: 			Pointer to the array of segments that make the message data.
+ *	@param[in]  u8_iov_num: 		Number of segments.
+*/
+static twi_s32 twi_usb_ll_stage_reports(tstr_usb_ll_ctx * pstr_ctx, const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_s32 s32_retval 		= TWI_SUCCESS;
+	twi_u8* pu8_report;
+	twi_u8	u8_slot_idx;
+	twi_u32 u32_msg_len 	= twi_usb_ll_iov_len(pstr_iov, u8_iov_num);
+	twi_u16 u16_reports_num;
+	twi_u16 u16_sent 		= 0;
+	twi_u16 u16_chunk;
+	twi_u16 u16_hdr_len;
+
+	if(u32_msg_len <= TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN)
+	{
+		u16_reports_num = 1;
+	}
+	else
+	{
+		u16_reports_num = CEIL((u32_msg_len + JUMBO_MESSAGE_LENGTH_SIZE), TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN);
+	}
+
+	if((0 == u32_msg_len) || (u32_msg_len > twi_usb_ll_get_mtu_size(pstr_ctx)))
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	else if(((pstr_ctx->str_global.u16_batch_reports_num + u16_reports_num) > TWI_LL_USB_MAX_BATCH_REPORTS) || ((pstr_ctx->str_global.u8_tx_cnt + u16_reports_num) > TWI_LL_USB_TX_DATA_SLOTS_NUM))
+	{
+		USB_LINK_LAYER_LOG("No Room For %d Reports, Staged = %d, Used Slots = %d\r\n", u16_reports_num, pstr_ctx->str_global.u16_batch_reports_num, pstr_ctx->str_global.u8_tx_cnt);
+		s32_retval = TWI_ERROR_USBD_SEND_BUSY;
+	}
+	else
+	{
+		for(; u16_reports_num > 0; u16_reports_num--)
+		{
+			u8_slot_idx = TX_SLOT_IDX(pstr_ctx, pstr_ctx->str_global.u8_tx_cnt);
+			pu8_report 	= &(pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx][TX_REPORT_MSG_IDX]);
+			u16_hdr_len = 0;
+			TWI_MEMSET(pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx], 0, TWI_LL_USB_MAX_BUFF_SIZE);
+
+			if(u32_msg_len <= TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN)
+			{
+				pu8_report[MESSAGE_TYPE_MARKER_INDEX] 	= (twi_u8) DATA_MESSAGE_MARKER;
+			}
+			else if(0 == u16_sent)
+			{
+				pu8_report[MESSAGE_TYPE_MARKER_INDEX] 	= (twi_u8) JUMBO_MESSAGE_MARKER;
+				pu8_report[DATA_MESSAGE_INDEX] 			= GET_BYTE_STATUS(u32_msg_len, 0);
+				pu8_report[DATA_MESSAGE_INDEX + 1] 		= GET_BYTE_STATUS(u32_msg_len, 1);
+				u16_hdr_len 							= JUMBO_MESSAGE_LENGTH_SIZE;
+			}
+			else
+			{
+				pu8_report[MESSAGE_TYPE_MARKER_INDEX] 	= (twi_u8) JUMBO_CONTINUATION_MARKER;
+			}
+
+			u16_chunk = (twi_u16) (u32_msg_len - u16_sent);
+			u16_chunk = (u16_chunk < (TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN - u16_hdr_len)) ? u16_chunk : (TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN - u16_hdr_len);
+			twi_usb_ll_iov_copy(&pu8_report[DATA_MESSAGE_INDEX + u16_hdr_len], u16_sent, u16_chunk, pstr_iov, u8_iov_num);
+			u16_sent 		+= u16_chunk;
+
+			pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u8_state 		= USB_LL_TX_SLOT_STAGED;
+			pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u8_type 		= USB_LL_TX_SLOT_DATA;
+			pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].b_is_last 		= TWI_FALSE;
+			pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].pv_user_arg 	= NULL;
+			pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u16_len 		= (twi_u16) (u16_hdr_len + u16_chunk + DATA_MESSAGE_MARKER_SIZE);
+#if defined (TWI_USE_USB_AS_HID)
+			pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx][0] 			= (twi_u8) pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u16_len;
+#endif
+			pstr_ctx->str_global.u8_tx_cnt++;
+			pstr_ctx->str_global.u16_batch_reports_num++;
+		}
+	}
+	return s32_retval;
+}
+
+/**
+ *	@brief			            	This function reassembles the reports of a jumbo data message. The reports of one message are sent back to back,
+ *									so a new message start drops any incomplete one.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+ *	@param[out] pstr_evt: 			The event to propagate once the message is complete.
+ *	@return : ::TWI_TRUE if the jumbo data message is complete.
+*/
+static twi_bool twi_usb_ll_rcv_jumbo(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len, tstr_twi_ll_evt* pstr_evt)
+{
+	twi_bool 	b_retval 		= TWI_FALSE;
+	twi_u8* 	pu8_data 		= NULL;
+	twi_u16 	u16_data_len 	= 0;
+	twi_u16 	u16_msg_len;
+
+	if(pstr_ctx->str_global.u8_jumbo_reports <= 1)
+	{
+		USB_LINK_LAYER_LOG_ERR("Jumbo Data Message Is Not Agreed In The Stack Specs!\r\n");
+	}
+	else if(pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == JUMBO_MESSAGE_MARKER)
+	{
+		u16_msg_len = TWO_BYTE_CONCAT(pu8_rcv_buff[DATA_MESSAGE_INDEX + 1], pu8_rcv_buff[DATA_MESSAGE_INDEX]);
+		if((u32_rcv_len > (DATA_MESSAGE_MARKER_SIZE + JUMBO_MESSAGE_LENGTH_SIZE)) && (u16_msg_len <= sizeof(pstr_ctx->str_global.au8_jumbo_rcv_buf)))
+		{
+			pstr_ctx->str_global.u16_jumbo_rcv_len 	= u16_msg_len;
+			pstr_ctx->str_global.u16_jumbo_rcv_idx 	= 0;
+			pu8_data 								= &(pu8_rcv_buff[DATA_MESSAGE_INDEX + JUMBO_MESSAGE_LENGTH_SIZE]);
+			u16_data_len 							= (twi_u16) (u32_rcv_len - (DATA_MESSAGE_MARKER_SIZE + JUMBO_MESSAGE_LENGTH_SIZE));
+		}
+		else
+		{
+			USB_LINK_LAYER_LOG_ERR("Invalid Jumbo Data Message Length = %d\r\n", u16_msg_len);
+			pstr_ctx->str_global.u16_jumbo_rcv_len 	= 0;
+		}
+	}
+	else if((pstr_ctx->str_global.u16_jumbo_rcv_len != 0) && (u32_rcv_len > DATA_MESSAGE_MARKER_SIZE))
+	{
+		pu8_data 		= &(pu8_rcv_buff[DATA_MESSAGE_INDEX]);
+		u16_data_len 	= (twi_u16) (u32_rcv_len - DATA_MESSAGE_MARKER_SIZE);
+	}
+	else
+	{
+		USB_LINK_LAYER_LOG_ERR("Jumbo Continuation Without A Message Start!\r\n");
+	}
+
+	if(NULL != pu8_data)
+	{
+		if((pstr_ctx->str_global.u16_jumbo_rcv_idx + u16_data_len) <= pstr_ctx->str_global.u16_jumbo_rcv_len)
+		{
+			TWI_MEMCPY(&(pstr_ctx->str_global.au8_jumbo_rcv_buf[pstr_ctx->str_global.u16_jumbo_rcv_idx]), pu8_data, u16_data_len);
+			pstr_ctx->str_global.u16_jumbo_rcv_idx += u16_data_len;
+
+			if(pstr_ctx->str_global.u16_jumbo_rcv_idx == pstr_ctx->str_global.u16_jumbo_rcv_len)
+			{
+				USB_LINK_LAYER_LOG("Jumbo Data Message Received With Length = %d\r\n", pstr_ctx->str_global.u16_jumbo_rcv_len);
+				pstr_evt->enu_event								= TWI_LL_RCV_DATA_EVT;
+				pstr_evt->uni_data.str_rcv_data_evt.pu8_data	= pstr_ctx->str_global.au8_jumbo_rcv_buf;
+				pstr_evt->uni_data.str_rcv_data_evt.u16_data_len= pstr_ctx->str_global.u16_jumbo_rcv_len;
+				pstr_ctx->str_global.u16_jumbo_rcv_len 			= 0;
+				b_retval 										= TWI_TRUE;
+			}
+		}
+		else
+		{
+			USB_LINK_LAYER_LOG_ERR("Jumbo Data Message Overflow!\r\n");
+			pstr_ctx->str_global.u16_jumbo_rcv_len 	= 0;
+		}
+	}
+	return b_retval;
+}
+
+/**
+ *	@brief			            	This function handles one link layer message received after the stack specs exchange and raises its event.
+ *									The message data is handed on in place, it shall stay untouched till this function returns.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+*/
+static void twi_usb_ll_rcv_msg(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len)
+{
+	twi_bool		b_is_need_to_propagate_evt 	= TWI_FALSE;
+	tstr_twi_ll_evt str_notify_ll_evt;
+
+	TWI_MEMSET(&str_notify_ll_evt, 0, sizeof(tstr_twi_ll_evt));
+
+	if (pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == CONTROL_MESSAGE_MARKER)
+	{
+		USB_LINK_LAYER_LOG("Control Message Received!\r\n");
+		if (pu8_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX] == TWI_STACK_SPECS_CMD_ERR_CODE)
+		{
+			USB_LINK_LAYER_LOG_ERR("Can't Parse The Stack Specs Command Twice! Need to Disconnect Now!!\r\n");
+			pstr_ctx->str_global.b_need_to_disconnect = TWI_TRUE;
+		}
+		else
+		{
+			USB_LINK_LAYER_LOG("Received Error Data With Error Code = %d, Buffer Length = %d, Overhead Size = %d!\r\n", (tenu_stack_err_code)(pu8_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]), (u32_rcv_len), (DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE));
+			str_notify_ll_evt.enu_event										= TWI_LL_RCV_ERROR_EVT;
+			str_notify_ll_evt.uni_data.str_rcv_error_evt.enu_err_code		= (tenu_stack_err_code)(pu8_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]);
+			str_notify_ll_evt.uni_data.str_rcv_error_evt.pu8_err_data		= &(pu8_rcv_buff[DATA_MESSAGE_ERR_DATA_INDEX]);
+			str_notify_ll_evt.uni_data.str_rcv_error_evt.u16_err_data_len	= (u32_rcv_len)-(DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE);
+			b_is_need_to_propagate_evt 										= TWI_TRUE;
+		}
+	}
+	else if (pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == DATA_MESSAGE_MARKER)
+	{
+		USB_LINK_LAYER_LOG("Data Message Received!\r\n");
+		str_notify_ll_evt.enu_event									= TWI_LL_RCV_DATA_EVT;
+		str_notify_ll_evt.uni_data.str_rcv_data_evt.pu8_data		= &(pu8_rcv_buff[DATA_MESSAGE_INDEX]);
+		str_notify_ll_evt.uni_data.str_rcv_data_evt.u16_data_len	= (u32_rcv_len)-(DATA_MESSAGE_MARKER_SIZE);
+		b_is_need_to_propagate_evt 									= TWI_TRUE;
+	}
+	else if ((pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == JUMBO_MESSAGE_MARKER) || (pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == JUMBO_CONTINUATION_MARKER))
+	{
+		b_is_need_to_propagate_evt = twi_usb_ll_rcv_jumbo(pstr_ctx, pu8_rcv_buff, u32_rcv_len, &str_notify_ll_evt);
+	}
+	else
+	{
+		/*Log inidicates unhandled*/
+		USB_LINK_LAYER_LOG_ERR("Invalid Message Marker = %d\r\n", pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX]);
+		pstr_ctx->str_global.str_stats.u32_rx_dropped_cnt++;
+	}
+
+	if(b_is_need_to_propagate_evt == TWI_TRUE)
+	{
+		str_notify_ll_evt.pv_args = (void*) pstr_ctx->str_global.pv_args;
+
+		TWI_ASSERT(pstr_ctx->str_global.pf_ll_cb != NULL);
+		
+		pstr_ctx->str_global.pf_ll_cb(&str_notify_ll_evt);
+	}
+}
+
+/**
+ *	@brief			            	This function unpacks the messages of a coalesced report in one pass, each one is handled as a report of its own.
+ *									Only whole data and control messages can be packed, a record that doesn't fit drops the rest of the report.
+ *	@param[in]  pstr_ctx: 			a pointer to the usb context.
+ *	@param[in]  pu8_rcv_buff: 		The received link layer message.
+ *	@param[in]  u32_rcv_len: 		The received link layer message length.
+*/
+static void twi_usb_ll_rcv_coalesced(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_rcv_buff, twi_u32 u32_rcv_len)
+{
+	twi_u32 u32_idx 	= DATA_MESSAGE_MARKER_SIZE;
+	twi_u8	u8_rec_len;
+
+	if(0 == (pstr_ctx->str_global.u8_capabilities & TWI_LL_CAP_COALESCING))
+	{
+		USB_LINK_LAYER_LOG_ERR("Coalesced Message Is Not Agreed In The Stack Specs!\r\n");
+		pstr_ctx->str_global.str_stats.u32_rx_dropped_cnt++;
+	}
+	else
+	{
+		while((u32_idx + COALESCED_RECORD_LENGTH_SIZE) < u32_rcv_len)
+		{
+			u8_rec_len 	= pu8_rcv_buff[u32_idx];
+			u32_idx 	+= COALESCED_RECORD_LENGTH_SIZE;
+			if(0 == u8_rec_len)
+			{
+				/*Padding*/
+				break;
+			}
+			else if((u8_rec_len <= DATA_MESSAGE_MARKER_SIZE) || ((u32_idx + u8_rec_len) > u32_rcv_len) ||
+					((pu8_rcv_buff[u32_idx + MESSAGE_TYPE_MARKER_INDEX] != DATA_MESSAGE_MARKER) && (pu8_rcv_buff[u32_idx + MESSAGE_TYPE_MARKER_INDEX] != CONTROL_MESSAGE_MARKER)))
+			{
+				USB_LINK_LAYER_LOG_ERR("Invalid Coalesced Record With Length = %d At %d\r\n", u8_rec_len, u32_idx);
+				pstr_ctx->str_global.str_stats.u32_rx_dropped_cnt++;
+				break;
+			}
+			else
+			{
+				pstr_ctx->str_global.str_stats.u32_rx_coalesced_msgs_cnt++;
+				twi_usb_ll_rcv_msg(pstr_ctx, &(pu8_rcv_buff[u32_idx]), u8_rec_len);
+				u32_idx += u8_rec_len;
+			}
+		}
+	}
+}
+
+/**
+ *	@brief			            	This function empties the transmit slots without raising any event.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_reset(tstr_usb_ll_ctx * pstr_ctx)
+{
+	pstr_ctx->str_global.u8_tx_head 			= 0;
+	pstr_ctx->str_global.u8_tx_cnt 				= 0;
+	pstr_ctx->str_global.u8_tx_inflight_num 	= 0;
+	pstr_ctx->str_global.u16_batch_reports_num 	= 0;
+	TWI_MEMSET(pstr_ctx->str_global.astr_tx_slots, 0, sizeof(pstr_ctx->str_global.astr_tx_slots));
+	/*The host drops its sends with the port, their ids are not awaited anymore*/
+	pstr_ctx->str_global.u8_tx_ids_head 		= 0;
+	pstr_ctx->str_global.u8_tx_ids_num 			= 0;
+}
+
+/**
+ *	@brief			            	This function frees the staged transmit slots of a batch that is not sent. They are always the last used slots.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_drop_staged(tstr_usb_ll_ctx * pstr_ctx)
+{
+	for(; pstr_ctx->str_global.u16_batch_reports_num > 0; pstr_ctx->str_global.u16_batch_reports_num--)
+	{
+		pstr_ctx->str_global.u8_tx_cnt--;
+		pstr_ctx->str_global.astr_tx_slots[TX_SLOT_IDX(pstr_ctx, pstr_ctx->str_global.u8_tx_cnt)].u8_state = USB_LL_TX_SLOT_FREE;
+	}
+}
+
+/**
+ *	@brief			            	This function queues the staged transmit slots, the last one raises the TWI_LL_SEND_STATUS_EVT.
+ *									If nothing is ahead of them they are handed to the host at once, so a send the host refuses right away
+ *									is reported to the caller. A busy host only delays them till the next TWI_USBD_TX_DONE or dispatcher run.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	pv_arg: 			User argument of the TWI_LL_SEND_STATUS_EVT.
+*/
+static twi_s32 twi_usb_ll_tx_commit(tstr_usb_ll_ctx * pstr_ctx, void* pv_arg)
+{
+	twi_s32 s32_retval 	= TWI_SUCCESS;
+	twi_bool b_is_alone = (pstr_ctx->str_global.u8_tx_cnt == pstr_ctx->str_global.u16_batch_reports_num) ? TWI_TRUE : TWI_FALSE;
+	twi_u8	u8_slot_idx = 0;
+	twi_u16 u16_idx;
+
+	for(u16_idx = pstr_ctx->str_global.u8_tx_cnt - pstr_ctx->str_global.u16_batch_reports_num; u16_idx < pstr_ctx->str_global.u8_tx_cnt; u16_idx++)
+	{
+		u8_slot_idx = TX_SLOT_IDX(pstr_ctx, u16_idx);
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u8_state = USB_LL_TX_SLOT_QUEUED;
+	}
+	pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].b_is_last 	= TWI_TRUE;
+	pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].pv_user_arg = pv_arg;
+	USB_LINK_LAYER_LOG("Queued %d Reports, Used Slots = %d\r\n", pstr_ctx->str_global.u16_batch_reports_num, pstr_ctx->str_global.u8_tx_cnt);
+	pstr_ctx->str_global.u16_batch_reports_num = 0;
+
+	if(TWI_TRUE == b_is_alone)
+	{
+		s32_retval = twi_usb_ll_tx_drain(pstr_ctx);
+		if(TWI_ERROR_USBD_SEND_BUSY == s32_retval)
+		{
+			s32_retval = TWI_SUCCESS;
+		}
+		else if(TWI_SUCCESS != s32_retval)
+		{
+			/*Only this message was in the slots*/
+			twi_usb_ll_tx_reset(pstr_ctx);
+		}
+	}
+	return s32_retval;
+}
+
+/**
+ *	@brief			            	This function queues one control message in a transmit slot, any free slot can take it.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	enu_err_code: 		Error code of the control message.
+ *	@param[in]	pu8_error_data: 	Pointer to the error data.
+ *	@param[in]	u16_error_len: 		Error data length.
+*/
+static twi_s32 twi_usb_ll_tx_queue_ctrl(tstr_usb_ll_ctx * pstr_ctx, tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len)
+{
+	twi_s32 s32_retval 	= TWI_SUCCESS;
+	twi_u8	u8_slot_idx = TX_SLOT_IDX(pstr_ctx, pstr_ctx->str_global.u8_tx_cnt);
+	twi_u8* pu8_report	= &(pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx][TX_REPORT_MSG_IDX]);
+
+	if(u16_error_len > (TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN - DATA_MESSAGE_ERR_CODE_SIZE))
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	else if(pstr_ctx->str_global.u8_tx_cnt >= TWI_LL_USB_TX_SLOTS_NUM)
+	{
+		USB_LINK_LAYER_LOG_ERR("No Room For The Control Message, Used Slots = %d\r\n", pstr_ctx->str_global.u8_tx_cnt);
+		s32_retval = TWI_ERROR_USBD_SEND_BUSY;
+	}
+	else
+	{
+		TWI_MEMSET(pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx], 0, TWI_LL_USB_MAX_BUFF_SIZE);
+		pu8_report[MESSAGE_TYPE_MARKER_INDEX] 	= (twi_u8) CONTROL_MESSAGE_MARKER;
+		pu8_report[DATA_MESSAGE_ERR_CODE_INDEX] = (twi_u8) enu_err_code;
+		TWI_MEMCPY(&pu8_report[DATA_MESSAGE_ERR_DATA_INDEX], pu8_error_data, u16_error_len);
+
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u8_state 		= USB_LL_TX_SLOT_QUEUED;
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u8_type 		= (TWI_STACK_SPECS_CMD_ERR_CODE == enu_err_code) ? USB_LL_TX_SLOT_STACK_SPECS : USB_LL_TX_SLOT_CTRL;
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].b_is_last 		= TWI_FALSE;
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].pv_user_arg 	= NULL;
+		pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u16_len 		= (u16_error_len + DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE);	/*1 Byte for the Message Marker & 1 Byte for the Error Code.*/
+#if defined (TWI_USE_USB_AS_HID)
+		pstr_ctx->str_global.aau8_tx_reports[u8_slot_idx][0] 			= (twi_u8) pstr_ctx->str_global.astr_tx_slots[u8_slot_idx].u16_len;
+#endif
+		pstr_ctx->str_global.u8_tx_cnt++;
+
+		if(1 == pstr_ctx->str_global.u8_tx_cnt)
+		{
+			s32_retval = twi_usb_ll_tx_drain(pstr_ctx);
+			if(TWI_ERROR_USBD_SEND_BUSY == s32_retval)
+			{
+				s32_retval = TWI_SUCCESS;
+			}
+			else if(TWI_SUCCESS != s32_retval)
+			{
+				USB_LINK_LAYER_LOG_ERR("Failed To Write on CC With Error = %d\r\n", s32_retval);
+				twi_usb_ll_tx_reset(pstr_ctx);
+			}
+		}
+	}
+	return s32_retval;
+}
+
+/**
+ *	@brief			            	This function checks if a queued transmit slot can be packed in a coalesced report. Only the data messages of one
+ *									report and the control messages other than the stack specs can, and only if their record fits in the report.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u8_pos: 			Position of the slot from the ring head.
+ *	@param[in]	u16_used_len: 		Length of the records already packed in the report.
+*/
+static twi_bool twi_usb_ll_tx_is_packable(tstr_usb_ll_ctx * pstr_ctx, twi_u8 u8_pos, twi_u16 u16_used_len)
+{
+	twi_bool 			 b_retval 	= TWI_FALSE;
+	twi_u8 				 u8_idx 	= TX_SLOT_IDX(pstr_ctx, u8_pos);
+	tstr_usb_ll_tx_slot* pstr_slot 	= &(pstr_ctx->str_global.astr_tx_slots[u8_idx]);
+
+	if((u8_pos < pstr_ctx->str_global.u8_tx_cnt) && (USB_LL_TX_SLOT_QUEUED == pstr_slot->u8_state) &&
+	   ((u16_used_len + COALESCED_RECORD_LENGTH_SIZE + pstr_slot->u16_len) <= TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN))
+	{
+		if(USB_LL_TX_SLOT_CTRL == pstr_slot->u8_type)
+		{
+			b_retval = TWI_TRUE;
+		}
+		else if((USB_LL_TX_SLOT_DATA == pstr_slot->u8_type) && (DATA_MESSAGE_MARKER == pstr_ctx->str_global.aau8_tx_reports[u8_idx][TX_REPORT_MSG_IDX + MESSAGE_TYPE_MARKER_INDEX]))
+		{
+			b_retval = TWI_TRUE;
+		}
+	}
+	return b_retval;
+}
+
+/**
+ *	@brief			            	This function lays the queued transmit slots at the ring head out in the packed reports, the neighbour messages
+ *									that fit together go in one coalesced report and the others are copied as they are. The slots keep their content,
+ *									so they can be packed again if the host is busy. Nothing is copied if no two neighbour messages fit together.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[out]	pu8_reports_num: 	Number of packed reports, one unless the host provided the batch send helper.
+ *	@param[out]	pu16_len: 			Length of the first packed report, the one sent without the batch send helper.
+ *	@return : ::The number of slots the packed reports carry, 0 if nothing could be packed.
+*/
+static twi_u8 twi_usb_ll_tx_pack(tstr_usb_ll_ctx * pstr_ctx, twi_u8* pu8_reports_num, twi_u16* pu16_len)
+{
+	twi_bool b_is_packable 	= TWI_FALSE;
+	twi_u8 	u8_max_reports 	= 1;
+	twi_u8 	u8_slots_num 	= 0;
+	twi_u8 	u8_reports_num 	= 0;
+	twi_u8 	u8_pos;
+	twi_u8 	u8_idx;
+	twi_u8* pu8_report;
+	twi_u16 u16_len;
+
+#if defined (TWI_USE_USB_AS_HID)
+	if(NULL != pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch)
+	{
+		u8_max_reports = TWI_LL_USB_MAX_BATCH_REPORTS;
+	}
+#endif
+	/*Look for two neighbour messages that fit together first, most sends have none*/
+	for(u8_pos = 0; (u8_pos < u8_max_reports) && (u8_pos < pstr_ctx->str_global.u8_tx_cnt) && (TWI_FALSE == b_is_packable); u8_pos++)
+	{
+		if((TWI_TRUE == twi_usb_ll_tx_is_packable(pstr_ctx, u8_pos, 0)) &&
+		   (TWI_TRUE == twi_usb_ll_tx_is_packable(pstr_ctx, u8_pos + 1, COALESCED_RECORD_LENGTH_SIZE + pstr_ctx->str_global.astr_tx_slots[TX_SLOT_IDX(pstr_ctx, u8_pos)].u16_len)))
+		{
+			b_is_packable = TWI_TRUE;
+		}
+	}
+
+	if(TWI_TRUE == b_is_packable)
+	{
+		while((u8_reports_num < u8_max_reports) && (u8_slots_num < pstr_ctx->str_global.u8_tx_cnt) &&
+			  (USB_LL_TX_SLOT_QUEUED == pstr_ctx->str_global.astr_tx_slots[TX_SLOT_IDX(pstr_ctx, u8_slots_num)].u8_state))
+		{
+			u8_idx 		= TX_SLOT_IDX(pstr_ctx, u8_slots_num);
+			pu8_report 	= &(pstr_ctx->str_global.aau8_tx_packed[u8_reports_num][TX_REPORT_MSG_IDX]);
+
+			if((TWI_TRUE == twi_usb_ll_tx_is_packable(pstr_ctx, u8_slots_num, 0)) &&
+			   (TWI_TRUE == twi_usb_ll_tx_is_packable(pstr_ctx, u8_slots_num + 1, COALESCED_RECORD_LENGTH_SIZE + pstr_ctx->str_global.astr_tx_slots[u8_idx].u16_len)))
+			{
+				TWI_MEMSET(pstr_ctx->str_global.aau8_tx_packed[u8_reports_num], 0, TWI_LL_USB_MAX_BUFF_SIZE);
+				pu8_report[MESSAGE_TYPE_MARKER_INDEX] 	= (twi_u8) COALESCED_MESSAGE_MARKER;
+				u16_len 								= DATA_MESSAGE_MARKER_SIZE;
+				while(TWI_TRUE == twi_usb_ll_tx_is_packable(pstr_ctx, u8_slots_num, u16_len - DATA_MESSAGE_MARKER_SIZE))
+				{
+					u8_idx 				= TX_SLOT_IDX(pstr_ctx, u8_slots_num);
+					pu8_report[u16_len] = (twi_u8) pstr_ctx->str_global.astr_tx_slots[u8_idx].u16_len;
+					u16_len 			+= COALESCED_RECORD_LENGTH_SIZE;
+					TWI_MEMCPY(&pu8_report[u16_len], &(pstr_ctx->str_global.aau8_tx_reports[u8_idx][TX_REPORT_MSG_IDX]), pstr_ctx->str_global.astr_tx_slots[u8_idx].u16_len);
+					u16_len 			+= pstr_ctx->str_global.astr_tx_slots[u8_idx].u16_len;
+					u8_slots_num++;
+				}
+			}
+			else
+			{
+				u16_len = pstr_ctx->str_global.astr_tx_slots[u8_idx].u16_len;
+				TWI_MEMCPY(pstr_ctx->str_global.aau8_tx_packed[u8_reports_num], pstr_ctx->str_global.aau8_tx_reports[u8_idx], TWI_LL_USB_MAX_BUFF_SIZE);
+				u8_slots_num++;
+			}
+#if defined (TWI_USE_USB_AS_HID)
+			pstr_ctx->str_global.aau8_tx_packed[u8_reports_num][0] = (twi_u8) u16_len;
+#endif
+			if(0 == u8_reports_num)
+			{
+				*pu16_len = u16_len;
+			}
+			u8_reports_num++;
+		}
+	}
+	*pu8_reports_num = u8_reports_num;
+	return u8_slots_num;
+}
+
+/**
+ *	@brief			            	This function hands the queued transmit slots at the ring head to the host, if it took the previous ones.
+ *									With the batch send helper all the queued slots up to the ring end go at once, they are contiguous.
+ *									Once coalescing is agreed the queued messages that fit together are handed as packed reports instead.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@return : ::TWI_SUCCESS or the host send error, the slots stay queued on TWI_ERROR_USBD_SEND_BUSY and in flight otherwise.
+*/
+static twi_s32 twi_usb_ll_tx_drain(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_s32 s32_retval 		= TWI_SUCCESS;
+	twi_u8	u8_head 		= pstr_ctx->str_global.u8_tx_head;
+	twi_u8	u8_num 			= 0;
+	twi_u8	u8_reports_num 	= 1;
+	twi_u8*	pu8_reports 	= pstr_ctx->str_global.aau8_tx_reports[u8_head];
+	twi_u16 u16_len 		= pstr_ctx->str_global.astr_tx_slots[u8_head].u16_len;
+	twi_u8	u8_idx;
+
+	if((0 == pstr_ctx->str_global.u8_tx_inflight_num) && (0 != pstr_ctx->str_global.u8_tx_cnt) && (USB_LL_TX_SLOT_QUEUED == pstr_ctx->str_global.astr_tx_slots[u8_head].u8_state))
+	{
+		if(0 != (pstr_ctx->str_global.u8_capabilities & TWI_LL_CAP_COALESCING))
+		{
+			u8_num = twi_usb_ll_tx_pack(pstr_ctx, &u8_reports_num, &u16_len);
+		}
+
+		if(0 != u8_num)
+		{
+			pu8_reports = pstr_ctx->str_global.aau8_tx_packed[0];
+		}
+		else
+		{
+			u8_num = 1;
+#if defined (TWI_USE_USB_AS_HID)
+			if(NULL != pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch)
+			{
+				while((u8_num < pstr_ctx->str_global.u8_tx_cnt) && ((u8_head + u8_num) < TWI_LL_USB_TX_SLOTS_NUM) && (USB_LL_TX_SLOT_QUEUED == pstr_ctx->str_global.astr_tx_slots[u8_head + u8_num].u8_state))
+				{
+					u8_num++;
+				}
+			}
+#endif
+			u8_reports_num = u8_num;
+		}
+
+		for(u8_idx = 0; u8_idx < u8_num; u8_idx++)
+		{
+			pstr_ctx->str_global.astr_tx_slots[TX_SLOT_IDX(pstr_ctx, u8_idx)].u8_state = USB_LL_TX_SLOT_IN_FLIGHT;
+		}
+		pstr_ctx->str_global.u8_tx_inflight_num = u8_num;
+		twi_usb_ll_tx_timing_start(pstr_ctx, u8_reports_num);
+		/*The id is taken before the send, a host may complete it before returning*/
+		twi_usb_ll_tx_id_push(pstr_ctx);
+
+#if defined (TWI_USE_USB_AS_HID)
+		if(NULL != pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch)
+		{
+			USB_LINK_LAYER_LOG("Send Batch Of %d Reports Carrying %d Slots\r\n", u8_reports_num, u8_num);
+			s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch((void*) pstr_ctx->pv_stack_helpers, (const void*) pu8_reports, (twi_u32) u8_reports_num);
+		}
+		else
+#endif
+		{
+			s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send((void*) pstr_ctx->pv_stack_helpers, (const void*) (&(pu8_reports[TX_REPORT_MSG_IDX])), (twi_u32) u16_len);
+		}
+
+		if(TWI_SUCCESS == s32_retval)
+		{
+			pstr_ctx->str_global.str_stats.u32_tx_reports_cnt 			+= u8_reports_num;
+			pstr_ctx->str_global.str_stats.u32_tx_saved_reports_cnt 	+= (u8_num - u8_reports_num);
+		}
+		else
+		{
+			USB_LINK_LAYER_LOG("Failed to write %d Reports On USB With Error = %d\r\n", u8_reports_num, s32_retval);
+			pstr_ctx->str_global.b_is_tx_timed = TWI_FALSE;
+			/*No TX done follows a refused send*/
+			if(0 != pstr_ctx->str_global.u8_tx_ids_num)
+			{
+				pstr_ctx->str_global.u8_tx_ids_num--;
+			}
+			if(TWI_ERROR_USBD_SEND_BUSY == s32_retval)
+			{
+				/*The slots are packed again on the next try*/
+				for(u8_idx = 0; u8_idx < u8_num; u8_idx++)
+				{
+					pstr_ctx->str_global.astr_tx_slots[TX_SLOT_IDX(pstr_ctx, u8_idx)].u8_state = USB_LL_TX_SLOT_QUEUED;
+				}
+				pstr_ctx->str_global.u8_tx_inflight_num = 0;
+			}
+			else
+			{
+				pstr_ctx->str_global.str_stats.u32_tx_fails_cnt++;
+			}
+		}
+	}
+	return s32_retval;
+}
+
+/**
+ *	@brief			            	This function frees the transmit slots in flight once the host is done with them.
+ *									A failed report fails the rest of its data message or batch too, the queued reports of it are dropped.
+ *									The in flight count is only cleared at the end, so the sends the events trigger wait for this flight to be freed.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		TWI_TRUE if the host sent them.
+*/
+static void twi_usb_ll_tx_complete(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success)
+{
+	twi_u8 		u8_done 		= pstr_ctx->str_global.u8_tx_inflight_num;
+	twi_bool 	b_is_purging 	= TWI_FALSE;
+	tstr_usb_ll_tx_slot str_slot;
+
+	while(((u8_done > 0) || (TWI_TRUE == b_is_purging)) && (0 != pstr_ctx->str_global.u8_tx_cnt))
+	{
+		str_slot = pstr_ctx->str_global.astr_tx_slots[pstr_ctx->str_global.u8_tx_head];
+		pstr_ctx->str_global.astr_tx_slots[pstr_ctx->str_global.u8_tx_head].u8_state = USB_LL_TX_SLOT_FREE;
+		pstr_ctx->str_global.u8_tx_head = TX_SLOT_IDX(pstr_ctx, 1);
+		pstr_ctx->str_global.u8_tx_cnt--;
+		if(USB_LL_TX_SLOT_IN_FLIGHT == str_slot.u8_state)
+		{
+			u8_done--;
+		}
+
+		if(USB_LL_TX_SLOT_DATA != str_slot.u8_type)
+		{
+			twi_usb_ll_tx_ctrl_done(pstr_ctx, str_slot.u8_type, b_is_success);
+		}
+		else if(TWI_TRUE == str_slot.b_is_last)
+		{
+			b_is_purging = TWI_FALSE;
+			twi_usb_ll_tx_notify(pstr_ctx, b_is_success, str_slot.pv_user_arg);
+		}
+		else if(TWI_FALSE == b_is_success)
+		{
+			/*Free the next reports of the failed message till its last one, whether they are in flight or queued*/
+			b_is_purging = TWI_TRUE;
+		}
+	}
+	pstr_ctx->str_global.u8_tx_inflight_num = 0;
+}
+
+/**
+ *	@brief			            	This function keeps the host fed from the transmit slots, the sends the host refuses are failed.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_service(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_s32 s32_retval = twi_usb_ll_tx_drain(pstr_ctx);
+
+	while((TWI_SUCCESS != s32_retval) && (TWI_ERROR_USBD_SEND_BUSY != s32_retval))
+	{
+		twi_usb_ll_tx_complete(pstr_ctx, TWI_FALSE);
+		s32_retval = twi_usb_ll_tx_drain(pstr_ctx);
+	}
+}
+
+/**
+ *	@brief			            	This function raises the TWI_LL_SEND_STATUS_EVT.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		The send status.
+ *	@param[in]	pv_user_arg: 		User argument of the send.
+*/
+static void twi_usb_ll_tx_notify(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success, void* pv_user_arg)
+{
+	tstr_twi_ll_evt str_notify_ll_evt;
+
+	TWI_MEMSET(&str_notify_ll_evt, 0, sizeof(tstr_twi_ll_evt));
+	str_notify_ll_evt.enu_event									= TWI_LL_SEND_STATUS_EVT;
+	str_notify_ll_evt.uni_data.str_send_stts_evt.b_is_success	= b_is_success;
+	str_notify_ll_evt.uni_data.str_send_stts_evt.pv_user_arg	= pv_user_arg;
+	str_notify_ll_evt.pv_args 									= (void*) pstr_ctx->str_global.pv_args;
+
+	TWI_ASSERT(pstr_ctx->str_global.pf_ll_cb != NULL);
+	pstr_ctx->str_global.pf_ll_cb(&str_notify_ll_evt);
+}
+
+/**
+ *	@brief			            	This function handles the end of a control message send, it moves the stack specs exchange on.
+ *									The other control messages don't raise any event.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u8_type: 			@ref tenu_usb_ll_tx_slot_type of the control message.
+ *	@param[in]	b_is_success: 		TWI_TRUE if the host sent it.
+*/
+static void twi_usb_ll_tx_ctrl_done(tstr_usb_ll_ctx * pstr_ctx, twi_u8 u8_type, twi_bool b_is_success)
+{
+	if(USB_LL_TX_SLOT_STACK_SPECS != u8_type)
+	{
+		if(TWI_FALSE == b_is_success)
+		{
+			USB_LINK_LAYER_LOG_ERR("Failed To Send A Control Message\r\n");
+		}
+	}
+	else if(TWI_TRUE == b_is_success)
+	{
+		USB_LINK_LAYER_LOG("Stack specs is sent\r\n");
+		pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
+#if defined (TWI_USB_HOST)
+		if (pstr_ctx->str_global.b_is_stack_specs_received == TWI_FALSE)
+		{
+			USB_LINK_LAYER_LOG("Waiting for stack specs response\r\n");
+			/*Start the STACK_SPECS Command Timer.*/
+			TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pstr_stack_helpers->pf_start_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_stack_event_timeout), (twi_s8*)"Stack Specs Exchange", TWI_TIMER_TYPE_ONE_SHOT, TWI_STACK_SPECS_COMMANDS_TIMEOUT_MS, twi_stack_specs_timer_timeout_cb, (void*) pstr_ctx));
+		}
+#elif defined (TWI_USB_DEVICE)
+		pstr_ctx->str_global.enu_link_layer_state		= USB_LINK_LAYER_STATE_READY;
+#endif
+	}
+	else
+	{
+		USB_LINK_LAYER_LOG_ERR("Failed To Send The Stack Specs! Need to Disconnect Now!!\r\n");
+		pstr_ctx->pstr_stack_helpers->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
+#if defined (TWI_USB_DEVICE)
+		pstr_ctx->str_global.enu_link_layer_state		= USB_LINK_LAYER_STATE_CONNECTED;
+#endif
+		pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
+		pstr_ctx->str_global.b_need_to_disconnect		= TWI_TRUE;
+	}
+}
+/*---------------------------------------------------------*/
+/*- APIs IMPLEMENTATION -----------------------------------*/
+/*---------------------------------------------------------*/
 
-	/*Input Parameters Validation*/
-	if ((pu8_data != NULL) && (u16_data_length != 0)) 
+/**
+ *	@brief			            	This function is used to start timing a data send handed to the host, if the host provided a clock.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	u16_reports_num: 	Number of reports of the send.
+*/
+static void twi_usb_ll_tx_timing_start(tstr_usb_ll_ctx * pstr_ctx, twi_u16 u16_reports_num)
+{
+	if(NULL != pstr_ctx->pstr_stack_helpers->pf_get_time_ms)
 	{
-		/*this is the parsing section. This means that we received a STACK SPECS command from the other side.*/
-		if ((pu8_data[0] == MY_STACK_SPECS_MAJOR_VER) && (pu8_data[1] == MY_STACK_SPECS_MINOR_VER))
-		{
-			u16_least_significant_ctu_peer = TWO_BYTE_CONCAT(pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(1)], pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(0)]);
-			u16_most_significant_ctu_peer = TWO_BYTE_CONCAT(pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(3)], pu8_data[FIND_CURRENT_STACK_SEPCS_BUFF_IDX(2)]);
-			u32_ctu_for_peer = TWO_16BITS_CONCAT(u16_most_significant_ctu_peer, u16_least_significant_ctu_peer);
-			u32_ctu_for_mine = MAX_PKT_SZ;
-
-			USB_LINK_LAYER_LOG("STACK_SPECS COMMAND DATA: Major = %d, Minor = %d, CTU Mine = %d, CTU Peer = %d\r\n", pu8_data[0], pu8_data[1], u32_ctu_for_mine, u32_ctu_for_peer);
+		pstr_ctx->str_global.b_is_tx_timed 		= TWI_TRUE;
+		pstr_ctx->str_global.u16_tx_reports_num = u16_reports_num;
+		pstr_ctx->str_global.u32_tx_start_ms 	= pstr_ctx->pstr_stack_helpers->pf_get_time_ms(pstr_ctx->pv_stack_helpers);
+	}
+}
 
-			/*Getting the Minimum of Both CTU Values for Mobile and FW Side*/
-			u32_min_ctu_from_both_ctu_values = (u32_ctu_for_mine < u32_ctu_for_peer) ? (u32_ctu_for_mine) : (u32_ctu_for_peer);
-		}
-		else
+/**
+ *	@brief			            	This function is used to check the TWI_USBD_TX_DONE/TWI_USBD_TX_FAIL of a timed data send.
+ *									A successful send gives a round trip time sample per report.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@param[in]	b_is_success: 		TWI_TRUE for the TWI_USBD_TX_DONE.
+ *	@return : ::TWI_TRUE if the event belongs to a send already reported as timed out, so it shall be ignored.
+*/
+static void twi_usb_ll_tx_timing_stop(tstr_usb_ll_ctx * pstr_ctx, twi_bool b_is_success)
+{
+	if(TWI_TRUE == pstr_ctx->str_global.b_is_tx_timed)
+	{
+		pstr_ctx->str_global.b_is_tx_timed = TWI_FALSE;
+		if(TWI_TRUE == b_is_success)
 		{
-			/*Invalid Data Length!*/
-			USB_LINK_LAYER_LOG_ERR("Invalid Major Or Minor Versions! Major = %d, Minor = %d\r\n", pu8_data[0], pu8_data[1]);
-			b_retval = TWI_FALSE;
+			twi_u32 u32_rtt_ms = pstr_ctx->pstr_stack_helpers->pf_get_time_ms(pstr_ctx->pv_stack_helpers) - pstr_ctx->str_global.u32_tx_start_ms;
+
+			twi_rtt_sample(&(pstr_ctx->str_global.str_tx_rtt), u32_rtt_ms / pstr_ctx->str_global.u16_tx_reports_num);
+			twi_hist_add(&(pstr_ctx->str_global.str_stats.str_tx_hist), u32_rtt_ms);
+			USB_LINK_LAYER_LOG("Send RTT = %d ms For %d Reports, RTO = %d ms\r\n", u32_rtt_ms, pstr_ctx->str_global.u16_tx_reports_num, twi_rtt_get_rto(&(pstr_ctx->str_global.str_tx_rtt)));
 		}
 	}
-	else 
+}
+
+/**
+ *	@brief			            	This function gives the next send handed to the host its id, the id of the flight in the transmit slots.
+ *									If the host never completed the oldest awaited sends, they are taken as lost to make room.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+*/
+static void twi_usb_ll_tx_id_push(tstr_usb_ll_ctx * pstr_ctx)
+{
+	if(TWI_LL_USB_TX_IDS_NUM == pstr_ctx->str_global.u8_tx_ids_num)
 	{
-		/*this is the composing section. This means that we send a STACK SPECS command to the other side.*/
-		USB_LINK_LAYER_LOG("Composing Stack Specs Command!\r\n");
-		u32_min_ctu_from_both_ctu_values = MAX_PKT_SZ;
+		USB_LINK_LAYER_LOG_ERR("TX Done Of Send %d Is Taken As Lost\r\n", pstr_ctx->str_global.au8_tx_ids[pstr_ctx->str_global.u8_tx_ids_head]);
+		pstr_ctx->str_global.u8_tx_ids_head = (pstr_ctx->str_global.u8_tx_ids_head + 1) % TWI_LL_USB_TX_IDS_NUM;
+		pstr_ctx->str_global.u8_tx_ids_num--;
 	}
+	pstr_ctx->str_global.u8_tx_inflight_id 	= pstr_ctx->str_global.u8_tx_next_id++;
+	pstr_ctx->str_global.au8_tx_ids[(pstr_ctx->str_global.u8_tx_ids_head + pstr_ctx->str_global.u8_tx_ids_num) % TWI_LL_USB_TX_IDS_NUM] = pstr_ctx->str_global.u8_tx_inflight_id;
+	pstr_ctx->str_global.u8_tx_ids_num++;
+}
 
-	if ((pu8_formatted_data != NULL) && (pu16_formatted_data_length != NULL))
-	{
-		twi_u16 u16_max_buff_length = *pu16_formatted_data_length;
+/**
+ *	@brief			            	This function takes the id of the send a TWI_USBD_TX_DONE/TWI_USBD_TX_FAIL belongs to, the oldest one handed to the host.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
+ *	@return : ::TWI_TRUE if the event belongs to the flight in the transmit slots, TWI_FALSE if it belongs to a send already
+ *				failed by its timeout or to none, so it shall be ignored.
+*/
+static twi_bool twi_usb_ll_tx_id_pop(tstr_usb_ll_ctx * pstr_ctx)
+{
+	twi_bool b_is_match = TWI_FALSE;
+	twi_u8 u8_id;
 
-		if (u16_max_buff_length >= FW_STACK_SPECS_DATA_SIZE)
+	if(0 != pstr_ctx->str_global.u8_tx_ids_num)
+	{
+		u8_id = pstr_ctx->str_global.au8_tx_ids[pstr_ctx->str_global.u8_tx_ids_head];
+		pstr_ctx->str_global.u8_tx_ids_head = (pstr_ctx->str_global.u8_tx_ids_head + 1) % TWI_LL_USB_TX_IDS_NUM;
+		pstr_ctx->str_global.u8_tx_ids_num--;
+		b_is_match = ((0 != pstr_ctx->str_global.u8_tx_inflight_num) && (u8_id == pstr_ctx->str_global.u8_tx_inflight_id)) ? TWI_TRUE : TWI_FALSE;
+		if(TWI_FALSE == b_is_match)
 		{
-			/*Format Both Major and Minor Versions.*/
-			pu8_formatted_data[u16_current_data_index++] = MY_STACK_SPECS_MAJOR_VER;
-			pu8_formatted_data[u16_current_data_index++] = MY_STACK_SPECS_MINOR_VER;
-
-			for (u8_looping_index = 0; u8_looping_index < FW_STACK_SPECS_MAX_CTU_SIZE; u8_looping_index++)
-			{
-				/*Copy The Minimum of both Firmware & Mobile CTU Size. With taking into consideration of bytes flipping over BLE*/
-				pu8_formatted_data[u8_looping_index + u16_current_data_index] = GET_BYTE_STATUS(u32_min_ctu_from_both_ctu_values, u8_looping_index);
-			}
-			/*Updating The Current Data Index to be equal to the total data length. And Store its value inside the pointer passed to the function*/
-			u16_current_data_index += sizeof(u32_min_ctu_from_both_ctu_values);
-			*pu16_formatted_data_length = u16_current_data_index;
+			USB_LINK_LAYER_LOG("TX Status Of Send %d Is Ignored, Awaited Send Is %d\r\n", u8_id, pstr_ctx->str_global.u8_tx_inflight_id);
 		}
 	}
-	
-	return b_retval;
+	else
+	{
+		USB_LINK_LAYER_LOG_ERR("TX Status Without A Send Is Ignored\r\n");
+	}
+	return b_is_match;
 }
 
 /**
- *	@brief			            	This function is used as the timer callback for the @ref: gstr_stack_event_timeout.
- *	@param[in]  pv: 				a pointer to the needed user data. This is reserved for future development needs
+ *	@brief			            	This function is used to fail the reports in flight that are not done within their timeout.
+ *									The timeout is the send timeout of one report times the reports of the send, it's doubled on every expiry.
+ *	@param[in]	pstr_ctx: 			Pointer to the usb link layer context.
 */
-static void twi_stack_specs_timer_timeout_cb (void* pv)
+static void twi_usb_ll_tx_timing_check(tstr_usb_ll_ctx * pstr_ctx)
 {
-	tstr_usb_ll_ctx * pstr_ctx = (tstr_usb_ll_ctx*) pv;
-	USB_LINK_LAYER_LOG_ERR("Stack Specs Timeout Fired!\r\n");
-	pstr_ctx->pstr_stack_helpers->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
-	/*pstr_ctx->str_global.b_need_to_disconnect = TWI_TRUE;*/
+	if((TWI_TRUE == pstr_ctx->str_global.b_is_tx_timed) && (0 != pstr_ctx->str_global.u8_tx_inflight_num))
+	{
+		twi_u32 u32_elapsed_ms = pstr_ctx->pstr_stack_helpers->pf_get_time_ms(pstr_ctx->pv_stack_helpers) - pstr_ctx->str_global.u32_tx_start_ms;
+		twi_u32 u32_timeout_ms = twi_rtt_get_rto(&(pstr_ctx->str_global.str_tx_rtt)) * pstr_ctx->str_global.u16_tx_reports_num;
+
+		if(u32_elapsed_ms > u32_timeout_ms)
+		{
+			USB_LINK_LAYER_LOG_ERR("Send Timeout After %d ms For %d Reports\r\n", u32_elapsed_ms, pstr_ctx->str_global.u16_tx_reports_num);
+			twi_rtt_backoff(&(pstr_ctx->str_global.str_tx_rtt));
+			/*Its id stays awaited , the TX done the host may still raise for it is ignored*/
+			pstr_ctx->str_global.b_is_tx_timed 			= TWI_FALSE;
+			pstr_ctx->str_global.str_stats.u32_tx_timeouts_cnt++;
+			twi_usb_ll_tx_complete(pstr_ctx, TWI_FALSE);
+		}
+	}
 }
-/*---------------------------------------------------------*/
-/*- APIs IMPLEMENTATION -----------------------------------*/
-/*---------------------------------------------------------*/
 
 /**
 *	@brief		This is the init function. It shall be called before any other API.
@@ -324,47 +1607,87 @@ twi_s32 twi_usb_ll_init(tstr_usb_ll_ctx * pstr_ctx, void * pv_args, tpf_ll_cb pf
 /**
 *	@brief		This is a function that called to pass the different USB events to the link layer.
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
-*	@param [in]	enu_usbd_evt		Enumeration of the Current USB Event.
+*	@param [in]	pstr_usb_evt		Pointer to Structure holds the USB event data.
+*				For ::TWI_USBD_RX_DONE, if pu8_data is set the report is parsed in place and it shall stay untouched till this function returns,
+*				otherwise the report is pulled through the pf_twi_usbd_receive helper.
 */
-void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_usbd_evt)
+void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, tstr_twi_usb_evt* pstr_usb_evt)
 {
 	twi_s32 			s32_retval 					= TWI_SUCCESS;
-	twi_bool			b_is_need_to_propagate_evt 	= TWI_FALSE;
 	twi_u32				u32_receive_buff_length		= sizeof(pstr_ctx->str_global.au8_data_rcv_buff);
-	tstr_twi_ll_evt str_notify_ll_evt;
-
-	TWI_MEMSET(&str_notify_ll_evt, 0, sizeof(tstr_twi_ll_evt));
+	twi_u8*				pu8_rcv_buff				= pstr_ctx->str_global.au8_data_rcv_buff;
+	twi_usbd_events_t	enu_usbd_evt				= pstr_usb_evt->enu_usbd_evt;
 
     switch(enu_usbd_evt)
 	{
 		case TWI_USBD_RX_DONE:
 		{
 			USB_LINK_LAYER_LOG("TWI_USBD_RX_DONE\r\n");
-			s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_receive(pstr_ctx->pv_stack_helpers, pstr_ctx->str_global.au8_data_rcv_buff, &u32_receive_buff_length);
+			if(NULL != pstr_usb_evt->pu8_data)
+			{
+#if defined (TWI_USE_USB_AS_HID)
+				/*HID Report: 1 Byte for the Data Length followed by the Link Layer Message.*/
+				u32_receive_buff_length = pstr_usb_evt->pu8_data[0];
+				pu8_rcv_buff			= &(pstr_usb_evt->pu8_data[DATA_LENGTH_ELEMENT_SIZE]);
+				if((pstr_usb_evt->u16_len < DATA_LENGTH_ELEMENT_SIZE) || (u32_receive_buff_length > (pstr_usb_evt->u16_len - DATA_LENGTH_ELEMENT_SIZE)))
+				{
+					s32_retval = TWI_ERROR_INVALID_LEN;
+				}
+#elif defined (TWI_USE_USB_AS_CDC)
+				u32_receive_buff_length = pstr_usb_evt->u16_len;
+				pu8_rcv_buff			= pstr_usb_evt->pu8_data;
+#endif
+			}
+			else
+			{
+				s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_receive(pstr_ctx->pv_stack_helpers, pu8_rcv_buff, &u32_receive_buff_length);
+			}
 			USB_LINK_LAYER_LOG("u32_receive_buff_length = %d, s32_retval = %d \r\n", u32_receive_buff_length, s32_retval);
 			if ((u32_receive_buff_length > 0) && (s32_retval == TWI_SUCCESS))
 			{
+				pstr_ctx->str_global.str_stats.u32_rx_reports_cnt++;
 				if (pstr_ctx->str_global.b_is_stack_specs_received == TWI_FALSE)
 				{
 					USB_LINK_LAYER_LOG("Stack Specs Not Received!\r\n");
 					twi_bool b_retval = TWI_FALSE;
+#if defined (TWI_USB_HOST)
+					/*The specs the link went ready with, when they came from the saved record*/
+					twi_u32 u32_used_ctu 			= pstr_ctx->str_global.u32_ctu;
+					twi_u8	u8_used_jumbo_reports 	= pstr_ctx->str_global.u8_jumbo_reports;
+#endif
 #if defined (TWI_USB_DEVICE)
-					twi_u8 	au8_formatted_data[FW_STACK_SPECS_DATA_SIZE]; /*1 Byte For Major Version, 1 Byte For Minor Version, 4 Bytes For The Max CTU*/
+					twi_u8 	au8_formatted_data[FW_STACK_SPECS_EXT_DATA_SIZE]; /*1 Byte For Major Version, 1 Byte For Minor Version, 4 Bytes For The Max CTU, 1 Byte For The Max Reports, 1 Byte For The Capabilities*/
 					twi_u16 u16_formatted_data_length = sizeof(au8_formatted_data);
 #endif			
-					if ((CONTROL_MESSAGE_MARKER == pstr_ctx->str_global.au8_data_rcv_buff[MESSAGE_TYPE_MARKER_INDEX]) && (TWI_STACK_SPECS_CMD_ERR_CODE == pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]))
+					if ((CONTROL_MESSAGE_MARKER == pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX]) && (TWI_STACK_SPECS_CMD_ERR_CODE == pu8_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]))
 					{
 						USB_LINK_LAYER_LOG("Start Parse/ Compose Stack Specs!\r\n");
 #if defined (TWI_USB_DEVICE)
-						b_retval = parse_compose_stack_specs(pstr_ctx->str_global.pv_args, &(pstr_ctx->str_global.au8_data_rcv_buff[2]), (u32_receive_buff_length - 2), au8_formatted_data, &u16_formatted_data_length);
+						b_retval = parse_compose_stack_specs((void*) pstr_ctx, &(pu8_rcv_buff[2]), (u32_receive_buff_length - 2), au8_formatted_data, &u16_formatted_data_length);
 #elif defined(TWI_USB_HOST)
-						b_retval = parse_compose_stack_specs(pstr_ctx->str_global.pv_args, &(pstr_ctx->str_global.au8_data_rcv_buff[2]), (u32_receive_buff_length - 2), NULL, NULL);
+						b_retval = parse_compose_stack_specs((void*) pstr_ctx, &(pu8_rcv_buff[2]), (u32_receive_buff_length - 2), NULL, NULL);
 #endif
 						if (b_retval == TWI_TRUE)
 						{
 							TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pstr_stack_helpers->pf_stop_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_stack_event_timeout)));
 #if defined (TWI_USB_HOST)
-							pstr_ctx->str_global.enu_link_layer_state = USB_LINK_LAYER_STATE_READY;
+							if (pstr_ctx->str_global.b_is_specs_optimistic == TWI_FALSE)
+							{
+								pstr_ctx->str_global.enu_link_layer_state = USB_LINK_LAYER_STATE_READY;
+								twi_usb_ll_specs_save(pstr_ctx);
+							}
+							else
+							{
+								/*The confirmed capabilities apply from now on, they may differ from the saved ones*/
+								twi_usb_ll_specs_save(pstr_ctx);
+								if ((u32_used_ctu != pstr_ctx->str_global.u32_ctu) || (u8_used_jumbo_reports != pstr_ctx->str_global.u8_jumbo_reports))
+								{
+									/*The device changed since the specs were saved, what was sent meanwhile may not be understood*/
+									USB_LINK_LAYER_LOG_ERR("Saved Stack Specs Are Outdated! Need to Disconnect Now!!\r\n");
+									pstr_ctx->str_global.b_need_to_disconnect = TWI_TRUE;
+								}
+							}
+							pstr_ctx->str_global.b_is_specs_optimistic = TWI_FALSE;
 #elif defined (TWI_USB_DEVICE)
 							USB_LINK_LAYER_LOG_HEX("FORMATTED ARRAY: ", au8_formatted_data, u16_formatted_data_length);
 							pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_TRUE;
@@ -372,46 +1695,36 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 #endif
 							pstr_ctx->str_global.b_is_stack_specs_received = TWI_TRUE;
 						}
-					}
-				}
-				else
-				{
-					if (pstr_ctx->str_global.au8_data_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == CONTROL_MESSAGE_MARKER)
-					{
-						USB_LINK_LAYER_LOG("Control Message Received!\r\n");
-						if (pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX] == TWI_STACK_SPECS_CMD_ERR_CODE)
-						{
-							USB_LINK_LAYER_LOG_ERR("Can't Parse The Stack Specs Command Twice! Need to Disconnect Now!!\r\n");
-							pstr_ctx->str_global.b_need_to_disconnect = TWI_TRUE;
-						}
-						else
+#if defined (TWI_USB_HOST)
+						else if (pstr_ctx->str_global.b_is_specs_optimistic == TWI_TRUE)
 						{
-							USB_LINK_LAYER_LOG("Received Error Data With Error Code = %d, Buffer Length = %d, Overhead Size = %d!\r\n", (tenu_stack_err_code)(pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]), (u32_receive_buff_length), (DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE));
-							str_notify_ll_evt.enu_event										= TWI_LL_RCV_ERROR_EVT;
-							str_notify_ll_evt.uni_data.str_rcv_error_evt.enu_err_code		= (tenu_stack_err_code)(pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_ERR_CODE_INDEX]);
-							str_notify_ll_evt.uni_data.str_rcv_error_evt.pu8_err_data		= &(pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_ERR_DATA_INDEX]);
-							str_notify_ll_evt.uni_data.str_rcv_error_evt.u16_err_data_len	= (u32_receive_buff_length)-(DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE);
-							b_is_need_to_propagate_evt 										= TWI_TRUE;
+							/*The link went ready with specs the device no longer speaks*/
+							USB_LINK_LAYER_LOG_ERR("Saved Stack Specs Are Not Confirmed! Need to Disconnect Now!!\r\n");
+							twi_usb_ll_specs_forget(pstr_ctx);
+							pstr_ctx->str_global.b_is_specs_optimistic 	= TWI_FALSE;
+							pstr_ctx->str_global.b_need_to_disconnect 	= TWI_TRUE;
 						}
-					}
-					else if (pstr_ctx->str_global.au8_data_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == DATA_MESSAGE_MARKER)
-					{
-						USB_LINK_LAYER_LOG("Data Message Received!\r\n");
-						str_notify_ll_evt.enu_event									= TWI_LL_RCV_DATA_EVT;
-						str_notify_ll_evt.uni_data.str_rcv_data_evt.pu8_data		= &(pstr_ctx->str_global.au8_data_rcv_buff[DATA_MESSAGE_INDEX]);
-						str_notify_ll_evt.uni_data.str_rcv_data_evt.u16_data_len	= (u32_receive_buff_length)-(DATA_MESSAGE_MARKER_SIZE);
-						b_is_need_to_propagate_evt 									= TWI_TRUE;
+#endif
 					}
 					else
 					{
-						/*Log inidicates unhandled*/
-						USB_LINK_LAYER_LOG_ERR("Invalid Message Marker = %d\r\n", pstr_ctx->str_global.au8_data_rcv_buff[MESSAGE_TYPE_MARKER_INDEX]);
+						/*Nothing but the stack specs is understood before the exchange*/
+						pstr_ctx->str_global.str_stats.u32_rx_dropped_cnt++;
 					}
 				}
+				else if (pu8_rcv_buff[MESSAGE_TYPE_MARKER_INDEX] == COALESCED_MESSAGE_MARKER)
+				{
+					twi_usb_ll_rcv_coalesced(pstr_ctx, pu8_rcv_buff, u32_receive_buff_length);
+				}
+				else
+				{
+					twi_usb_ll_rcv_msg(pstr_ctx, pu8_rcv_buff, u32_receive_buff_length);
+				}
 			}
 			else
 			{
 				USB_LINK_LAYER_LOG_ERR("Failed To Receive Data Over USB! Error Code = %d, Data Length = %d\r\n", s32_retval, u32_receive_buff_length);
+				pstr_ctx->str_global.str_stats.u32_rx_dropped_cnt++;
 			}
 
 			break;
@@ -420,74 +1733,25 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 		case TWI_USBD_TX_DONE:
 		{
 			USB_LINK_LAYER_LOG("TWI_USBD_TX_DONE\r\n");
-
-#if defined(TWI_USB_HOST)
-			if (pstr_ctx->str_global.b_is_stack_specs_received == TWI_FALSE)
-			{
-				USB_LINK_LAYER_LOG("Stack specs is sent 1\r\n");
-				pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
-				pstr_ctx->str_global.enu_link_layer_state 		= USB_LINK_LAYER_STATE_CONNECTED;
-				USB_LINK_LAYER_LOG("Waiting for stack specs response\r\n");
-				/*Start the STACK_SPECS Command Timer.*/
-				TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pstr_stack_helpers->pf_start_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_stack_event_timeout), (twi_s8*)"Stack Specs Exchange", TWI_TIMER_TYPE_ONE_SHOT, TWI_STACK_SPECS_COMMANDS_TIMEOUT_MS, twi_stack_specs_timer_timeout_cb, (void*) pstr_ctx));
-			}
-			else 
-#endif
+			if(TWI_TRUE == twi_usb_ll_tx_id_pop(pstr_ctx))
 			{
-				if(pstr_ctx->str_global.b_is_sending_stack_specs == TWI_FALSE)
-				{
-					USB_LINK_LAYER_LOG("Sending for stack specs response\r\n");
-
-					pstr_ctx->str_global.enu_link_layer_state					= USB_LINK_LAYER_STATE_READY;
-
-					str_notify_ll_evt.enu_event									= TWI_LL_SEND_STATUS_EVT;
-					str_notify_ll_evt.uni_data.str_send_stts_evt.b_is_success	= TWI_TRUE;
-					str_notify_ll_evt.uni_data.str_send_stts_evt.pv_user_arg	= pstr_ctx->str_global.pv_user_arg;
-					b_is_need_to_propagate_evt									= TWI_TRUE;
-				}
-				else
-				{
-					USB_LINK_LAYER_LOG("Stack specs is sent 2\r\n");
-					pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
-#if defined (TWI_USB_DEVICE)
-					pstr_ctx->str_global.enu_link_layer_state		= USB_LINK_LAYER_STATE_READY;
-#endif
-				}
+				twi_usb_ll_tx_timing_stop(pstr_ctx, TWI_TRUE);
+				twi_usb_ll_tx_complete(pstr_ctx, TWI_TRUE);
 			}
+			twi_usb_ll_tx_service(pstr_ctx);
 			break;
 		}
 
 		case TWI_USBD_TX_FAIL:
 		{
 			USB_LINK_LAYER_LOG("TWI_USBD_TX_FAIL\r\n");
-#if defined(TWI_USB_HOST)
-			if (pstr_ctx->str_global.b_is_stack_specs_received == TWI_FALSE)
-			{
-				pstr_ctx->pstr_stack_helpers->pf_twi_system_sleep_mode_forbiden(pstr_ctx->pv_stack_helpers, TWI_TRUE);
-				pstr_ctx->str_global.b_need_to_disconnect 		= TWI_TRUE;
-				pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
-			}
-			else
-#endif
+			if(TWI_TRUE == twi_usb_ll_tx_id_pop(pstr_ctx))
 			{
-				if(pstr_ctx->str_global.b_is_sending_stack_specs == TWI_FALSE)
-				{
-					pstr_ctx->str_global.enu_link_layer_state					= USB_LINK_LAYER_STATE_READY;
-
-					str_notify_ll_evt.enu_event									= TWI_LL_SEND_STATUS_EVT;
-					str_notify_ll_evt.uni_data.str_send_stts_evt.b_is_success	= TWI_FALSE;
-					str_notify_ll_evt.uni_data.str_send_stts_evt.pv_user_arg	= pstr_ctx->str_global.pv_user_arg;
-					b_is_need_to_propagate_evt									= TWI_TRUE;
-				}
-				else
-				{
-#if defined (TWI_USB_DEVICE)
-					pstr_ctx->str_global.enu_link_layer_state		= USB_LINK_LAYER_STATE_CONNECTED;
-#endif
-					pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
-					pstr_ctx->str_global.b_need_to_disconnect		= TWI_TRUE;
-				}
+				twi_usb_ll_tx_timing_stop(pstr_ctx, TWI_FALSE);
+				pstr_ctx->str_global.str_stats.u32_tx_fails_cnt++;
+				twi_usb_ll_tx_complete(pstr_ctx, TWI_FALSE);
 			}
+			twi_usb_ll_tx_service(pstr_ctx);
 			break;
 		}
 		
@@ -496,16 +1760,36 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 			USB_LINK_LAYER_LOG("TWI_USBD_PORT_OPEN\r\n");
 			pstr_ctx->str_global.b_is_stack_specs_received 	= TWI_FALSE;
 			pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_FALSE;
+			pstr_ctx->str_global.b_is_specs_optimistic 		= TWI_FALSE;
 			pstr_ctx->str_global.enu_link_layer_state 		= USB_LINK_LAYER_STATE_CONNECTED;
+			/*One report per data message till the stack specs say otherwise*/
+			pstr_ctx->str_global.u32_ctu 					= MAX_PKT_SZ;
+			pstr_ctx->str_global.u8_jumbo_reports 			= 1;
+			pstr_ctx->str_global.u8_capabilities 			= 0;
+			pstr_ctx->str_global.u16_jumbo_rcv_len 			= 0;
+			pstr_ctx->str_global.u16_jumbo_rcv_idx 			= 0;
+			/*The round trip time estimate is kept, it's the same device*/
+			pstr_ctx->str_global.b_is_tx_timed 				= TWI_FALSE;
+			twi_usb_ll_tx_reset(pstr_ctx);
 
 #if defined (TWI_USB_DEVICE)
 			/*Start the STACK_SPECS Command Timer.*/
 			TWI_ASSERT(TWI_SUCCESS == pstr_ctx->pstr_stack_helpers->pf_start_timer(pstr_ctx->pv_stack_helpers, &(pstr_ctx->str_global.str_stack_event_timeout), (twi_s8*)"Stack Specs Exchange", TWI_TIMER_TYPE_ONE_SHOT, TWI_STACK_SPECS_COMMANDS_TIMEOUT_MS, twi_stack_specs_timer_timeout_cb, (void*) pstr_ctx));
 #elif defined (TWI_USB_HOST)
-			twi_u8 	au8_formatted_data[FW_STACK_SPECS_DATA_SIZE]; /*1 For Major Version, 1 For Minor Version, 4 For The Max CTU*/
+			twi_u8 	au8_formatted_data[FW_STACK_SPECS_EXT_DATA_SIZE]; /*1 For Major Version, 1 For Minor Version, 4 For The Max CTU, 1 For The Max Reports, 1 For The Capabilities*/
 			twi_u16 u16_formatted_data_length 	= sizeof(au8_formatted_data);
 
-			TWI_ASSERT(TWI_TRUE == parse_compose_stack_specs(pstr_ctx->str_global.pv_args, NULL, 0, au8_formatted_data, &u16_formatted_data_length));
+			/*A device seen before is used with its saved CTU and reports per data message right away, its answer to the stack specs below confirms them
+			  and turns the agreed capabilities on.
+			  The stack specs go first in the transmit slots, so the device gets them before any data*/
+			if (TWI_TRUE == twi_usb_ll_specs_load(pstr_ctx))
+			{
+				USB_LINK_LAYER_LOG("Ready With The Saved Stack Specs, CTU = %d, Reports Per Data Message = %d, Capabilities = 0x%x\r\n", pstr_ctx->str_global.u32_ctu, pstr_ctx->str_global.u8_jumbo_reports, pstr_ctx->str_global.u8_capabilities);
+				pstr_ctx->str_global.b_is_specs_optimistic 	= TWI_TRUE;
+				pstr_ctx->str_global.enu_link_layer_state 	= USB_LINK_LAYER_STATE_READY;
+			}
+
+			TWI_ASSERT(TWI_TRUE == parse_compose_stack_specs((void*) pstr_ctx, NULL, 0, au8_formatted_data, &u16_formatted_data_length));
 			pstr_ctx->str_global.b_is_sending_stack_specs 	= TWI_TRUE;
 			USB_LINK_LAYER_LOG("STACK SPECS BUFFER FORMATTEED!\r\n");
 			for(int index = 0; index < u16_formatted_data_length; index++)
@@ -522,6 +1806,9 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 		{
 			USB_LINK_LAYER_LOG("TWI_USBD_PORT_CLOSE\r\n");
 			pstr_ctx->str_global.enu_link_layer_state = USB_LINK_LAYER_STATE_WAITING_TO_CONNECT;
+			pstr_ctx->str_global.b_is_specs_optimistic 	= TWI_FALSE;
+			pstr_ctx->str_global.b_is_tx_timed 		= TWI_FALSE;
+			twi_usb_ll_tx_reset(pstr_ctx);
 			break;
 		}
 
@@ -531,15 +1818,6 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 			break;
 		}	
 	}
-	
-	if(b_is_need_to_propagate_evt == TWI_TRUE)
-	{
-		str_notify_ll_evt.pv_args = (void*) pstr_ctx->str_global.pv_args;
-
-		TWI_ASSERT(pstr_ctx->str_global.pf_ll_cb != NULL);
-		
-		pstr_ctx->str_global.pf_ll_cb(&str_notify_ll_evt);
-	}
 }
 /**
 *	@brief		This is the Link Layer send data function
@@ -551,35 +1829,39 @@ void twi_usb_ll_handle_usb_evt(tstr_usb_ll_ctx *pstr_ctx, twi_usbd_events_t enu_
 */
 twi_s32 twi_usb_ll_send_data(tstr_usb_ll_ctx * pstr_ctx , twi_u8* pu8_data, twi_u16 u16_data_len, void* pv_arg)
 {
-	USB_LINK_LAYER_LOG("***** twi_usb_ll_send_data ***** With Length = %d\r\n", u16_data_len);
+	tstr_twi_ll_iovec str_iov;
+
+	str_iov.pu8_data 	= pu8_data;
+	str_iov.u16_len 	= u16_data_len;
+	return twi_usb_ll_send_data_iov(pstr_ctx, &str_iov, 1, pv_arg);
+}
+
+/**
+*	@brief		This is the Link Layer scatter-gather send data function. The segments are gathered straight into the transmit slots,
+*				as one report or as a jumbo data message, and the message is queued behind the reports that are not sent yet.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pstr_iov		Pointer to the array of segments to be sent in order. They are copied before the call returns.
+*	@param [in]	u8_iov_num    	Number of segments.
+*	@param [in]	pv_arg    		User argument.
+*/
+twi_s32 twi_usb_ll_send_data_iov(tstr_usb_ll_ctx * pstr_ctx , const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num, void* pv_arg)
+{
 	twi_s32 s32_retval = TWI_SUCCESS;
-	twi_u16 u16_idx;
-	if((pstr_ctx != NULL) && (pu8_data != NULL) && (u16_data_len > 0)&& (u16_data_len <= TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN))
+	if((pstr_ctx != NULL) && (pstr_iov != NULL) && (u8_iov_num > 0))
 	{
 		if(TWI_TRUE == pstr_ctx->str_global.b_is_initialized)
 		{
 			if(pstr_ctx->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY)
 			{
-				pstr_ctx->str_global.enu_link_layer_state 					= USB_LINK_LAYER_STATE_SEND_IN_PROGRESS;
-				u16_idx 													= MESSAGE_TYPE_MARKER_INDEX;
-				pstr_ctx->str_global.au8_data_send_buf[u16_idx++] 			= (twi_u8) DATA_MESSAGE_MARKER;					
-				pstr_ctx->str_global.u16_data_buf_length					= (u16_data_len + DATA_MESSAGE_MARKER_SIZE);
-				pstr_ctx->str_global.pv_user_arg							= pv_arg;
-
-				TWI_MEMCPY(&(pstr_ctx->str_global.au8_data_send_buf[u16_idx]), pu8_data, u16_data_len);
-#if defined (TWI_USB_HOST)
-				USB_LINK_LAYER_LOG("Dump Buffer To Send in Link Layer With Size = %d\r\n", u16_data_len);
-				for(int index = 0; index < u16_data_len; index++)
+				USB_LINK_LAYER_LOG("***** twi_usb_ll_send_data ***** With Length = %d\r\n", twi_usb_ll_iov_len(pstr_iov, u8_iov_num));
+				s32_retval = twi_usb_ll_stage_reports(pstr_ctx, pstr_iov, u8_iov_num);
+				if(TWI_SUCCESS == s32_retval)
 				{
-					USB_LINK_LAYER_LOG("%d ", pu8_data[index]);
+					s32_retval = twi_usb_ll_tx_commit(pstr_ctx, pv_arg);
 				}
-				USB_LINK_LAYER_LOG("\r\n");
-#endif
-				s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send((void*) pstr_ctx->pv_stack_helpers, (const void*) (pstr_ctx->str_global.au8_data_send_buf), (twi_u32) (pstr_ctx->str_global.u16_data_buf_length));		/*1 Byte for the Message Marker*/
-				if(TWI_SUCCESS != s32_retval)
+				else
 				{
-					pstr_ctx->str_global.enu_link_layer_state 	= USB_LINK_LAYER_STATE_READY;
-					USB_LINK_LAYER_LOG("Failed to write Data On USB With Error = %d\r\n", s32_retval);
+					twi_usb_ll_tx_drop_staged(pstr_ctx);
 				}
 			}
 			else
@@ -603,18 +1885,91 @@ twi_s32 twi_usb_ll_send_data(tstr_usb_ll_ctx * pstr_ctx , twi_u8* pu8_data, twi_
 }
 
 /**
-*	@brief		This is the Link Layer send error function
+*	@brief		This is the Link Layer function to stage one data message in the transmit batch.
+*				Each staged message is laid out as complete reports in the transmit slots, so the host batch send helper can take the
+*				contiguous ones as one array of TWI_LL_USB_MAX_BUFF_SIZE reports. A message longer than one report takes several reports
+*				as a jumbo data message. The message data is gathered from the segments straight into its reports, so this is the only
+*				copy of the payload on the way out. If staging fails the batch is dropped.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pstr_iov		Pointer to the array of segments that make the message data.
+*	@param [in]	u8_iov_num    	Number of segments.
+*/
+twi_s32 twi_usb_ll_add_batch_data(tstr_usb_ll_ctx * pstr_ctx , const tstr_twi_ll_iovec* pstr_iov, twi_u8 u8_iov_num)
+{
+	twi_s32 s32_retval = TWI_SUCCESS;
+	if((pstr_ctx != NULL) && (pstr_iov != NULL) && (u8_iov_num > 0))
+	{
+		if(TWI_TRUE == pstr_ctx->str_global.b_is_initialized)
+		{
+			if(pstr_ctx->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY)
+			{
+				s32_retval = twi_usb_ll_stage_reports(pstr_ctx, pstr_iov, u8_iov_num);
+			}
+			else
+			{
+				USB_LINK_LAYER_LOG("Trying To Stage Data In Invalid State = %d, Staged = %d\r\n", pstr_ctx->str_global.enu_link_layer_state, pstr_ctx->str_global.u16_batch_reports_num);
+				s32_retval = TWI_ERROR_INVALID_STATE;
+			}
+		}
+		else
+		{
+			s32_retval = TWI_ERROR_NOT_INITIALIZED;
+		}
+
+		if(TWI_SUCCESS != s32_retval)
+		{
+			twi_usb_ll_tx_drop_staged(pstr_ctx);
+		}
+	}
+	else
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	return s32_retval;
+}
+
+/**
+*	@brief		This is the Link Layer function to queue all the staged data messages behind the reports that are not sent yet.
+*				The last staged report raises a single TWI_LL_SEND_STATUS_EVT for the whole batch once the host is done with it.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [in]	pv_arg    		User argument.
+*/
+twi_s32 twi_usb_ll_send_batch(tstr_usb_ll_ctx * pstr_ctx, void* pv_arg)
+{
+	USB_LINK_LAYER_LOG("***** twi_usb_ll_send_batch *****\r\n");
+	twi_s32 s32_retval = TWI_SUCCESS;
+	if((pstr_ctx != NULL) && (pstr_ctx->str_global.u16_batch_reports_num > 0))
+	{
+		if(pstr_ctx->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY)
+		{
+			s32_retval = twi_usb_ll_tx_commit(pstr_ctx, pv_arg);
+		}
+		else
+		{
+			USB_LINK_LAYER_LOG("Trying To Send Batch In Invalid State = %d\r\n", pstr_ctx->str_global.enu_link_layer_state);
+			twi_usb_ll_tx_drop_staged(pstr_ctx);
+			s32_retval = TWI_ERROR_INVALID_STATE;
+		}
+	}
+	else
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	return s32_retval;
+}
+
+/**
+*	@brief		This is the Link Layer send error function. The control message takes its own transmit slot, so it's queued even
+*				while data messages are in flight, and it doesn't raise any TWI_LL_SEND_STATUS_EVT.
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
 *	@param [in]	enu_err_code	    Error code to be sent.
-*	@param [in]	pu8_error_data		Pointer to error data to be sent.
-*                                   This buffer shall remain untouched by the application till a TWI_LL_SEND_STATUS_EVT is passed from the network layer.
+*	@param [in]	pu8_error_data		Pointer to error data to be sent. It is copied before the call returns.
 *	@param [in]	u16_error_len       Error Data Buffer length.
 */
 twi_s32 twi_usb_ll_send_error(tstr_usb_ll_ctx * pstr_ctx ,tenu_stack_err_code enu_err_code, twi_u8* pu8_error_data, twi_u16 u16_error_len)
 {
 	USB_LINK_LAYER_LOG("***** twi_usb_ll_send_error *****\r\n");
 	twi_s32 s32_retval = TWI_SUCCESS;
-	twi_u16 u16_idx;
 	if((pstr_ctx != NULL) && (enu_err_code < TWI_STACK_INVALID_ERR_CODE) && (pu8_error_data != NULL) && (u16_error_len > 0) )
 	{
 		if(TWI_TRUE == pstr_ctx->str_global.b_is_initialized)
@@ -622,27 +1977,7 @@ twi_s32 twi_usb_ll_send_error(tstr_usb_ll_ctx * pstr_ctx ,tenu_stack_err_code en
 			/*Check that the Current State is Connected and wait to send stack specs || we finalized the stack specs hand shake command and the data flow is going.*/
 			if((pstr_ctx->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_CONNECTED) || (pstr_ctx->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY))
 			{
-				pstr_ctx->str_global.enu_link_layer_state 			= USB_LINK_LAYER_STATE_SEND_IN_PROGRESS;
-				u16_idx 											= MESSAGE_TYPE_MARKER_INDEX;
-				pstr_ctx->str_global.au8_err_send_buff[u16_idx++] 	= (twi_u8) CONTROL_MESSAGE_MARKER;						
-				pstr_ctx->str_global.au8_err_send_buff[u16_idx++] 	= (twi_u8) enu_err_code;		
-				pstr_ctx->str_global.u16_data_to_send_buf_length	= (u16_error_len + DATA_MESSAGE_MARKER_SIZE + DATA_MESSAGE_ERR_CODE_SIZE);
-
-				TWI_MEMCPY(&(pstr_ctx->str_global.au8_err_send_buff[u16_idx]), pu8_error_data, u16_error_len);
-
-				s32_retval = pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send((void*)pstr_ctx->pv_stack_helpers, (const void*) (pstr_ctx->str_global.au8_err_send_buff), (twi_u32) (pstr_ctx->str_global.u16_data_to_send_buf_length));	/*1 Byte for the Message Marker & 1 Byte for the Error Code.*/
-				if(TWI_SUCCESS != s32_retval)
-				{
-					USB_LINK_LAYER_LOG_ERR("Failed To Write on CC With Error = %d\r\n", s32_retval);
-					if(pstr_ctx->str_global.b_is_sending_stack_specs == TWI_TRUE)
-					{
-						pstr_ctx->str_global.enu_link_layer_state = USB_LINK_LAYER_STATE_CONNECTED;
-					}
-					else
-					{
-						pstr_ctx->str_global.enu_link_layer_state = USB_LINK_LAYER_STATE_READY;
-					}
-				}
+				s32_retval = twi_usb_ll_tx_queue_ctrl(pstr_ctx, enu_err_code, pu8_error_data, u16_error_len);
 			}
 			else
 			{
@@ -669,6 +2004,9 @@ twi_s32 twi_usb_ll_send_error(tstr_usb_ll_ctx * pstr_ctx ,tenu_stack_err_code en
 void twi_usb_ll_dispatcher(tstr_usb_ll_ctx * pstr_ctx)
 {
 	pstr_ctx->pstr_stack_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_dispatch(pstr_ctx->pv_stack_helpers);
+	twi_usb_ll_tx_timing_check(pstr_ctx);
+	/*Retry the reports the host was too busy to take*/
+	twi_usb_ll_tx_service(pstr_ctx);
 	if(pstr_ctx->str_global.b_need_to_disconnect == TWI_TRUE)
 	{
 		pstr_ctx->str_global.b_need_to_disconnect = TWI_FALSE;
@@ -679,17 +2017,77 @@ void twi_usb_ll_dispatcher(tstr_usb_ll_ctx * pstr_ctx)
 
 /**
 *	@brief		This is an API to get the MTU size agreed upon in the connection.
+*				It is one report unless both sides agreed on jumbo data messages in the stack specs.
 *	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
 *	@return	    The MTU size.
 */
-twi_u16 twi_usb_ll_get_mtu_size(void)
+twi_u16 twi_usb_ll_get_mtu_size(tstr_usb_ll_ctx* pstr_ctx)
+{
+	twi_u16 u16_retval = TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN;
+
+	if(pstr_ctx->str_global.u8_jumbo_reports > 1)
+	{
+		u16_retval = (pstr_ctx->str_global.u8_jumbo_reports * TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN) - JUMBO_MESSAGE_LENGTH_SIZE;
+	}
+	return u16_retval;
+}
+
+/**
+*	@brief		This is an API to get the CTU size agreed upon in the stack specs, the maximum size of an unfragmented packet.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@return	    The CTU size.
+*/
+twi_u32 twi_usb_ll_get_ctu_size(tstr_usb_ll_ctx* pstr_ctx)
+{
+	return (pstr_ctx->str_global.u32_ctu);
+}
+
+/**
+*	@brief		This is an API to get the capabilities both sides agreed upon in the stack specs.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@return	    Bitmap of the agreed capabilities @ref TWI_LL_CAP_LZ_COMPRESSION, 0 till the stack specs are exchanged.
+*/
+twi_u8 twi_usb_ll_get_capabilities(tstr_usb_ll_ctx* pstr_ctx)
+{
+	return (pstr_ctx->str_global.u8_capabilities);
+}
+
+/**
+*	@brief		This is an API to get the maximum number of data messages that can be sent in one batch.
+*				Each message of the MTU size takes the agreed reports per data message. The batch is queued in the transmit slots,
+*				so it doesn't need the host batch send helper, the helper only lets the host take the reports in fewer calls.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@return	    The batch capacity.
+*/
+twi_u16 twi_usb_ll_get_batch_capacity(tstr_usb_ll_ctx* pstr_ctx)
+{
+	return (TWI_LL_USB_MAX_BATCH_REPORTS / ((pstr_ctx->str_global.u8_jumbo_reports > 1) ? pstr_ctx->str_global.u8_jumbo_reports : 1));
+}
+
+/**
+*	@brief		This is an API to get the current send timeout of one report, derived from the measured round trip times.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@return	    The send timeout in milliseconds.
+*/
+twi_u32 twi_usb_ll_get_send_timeout(tstr_usb_ll_ctx* pstr_ctx)
+{
+	return twi_rtt_get_rto(&(pstr_ctx->str_global.str_tx_rtt));
+}
+
+/**
+*	@brief		This is an API to copy the link layer statistics. They are kept since the init , across the reconnections.
+*	@param [in]	pstr_ctx			Pointer to structure of the whole layer context.
+*	@param [out] pstr_stats			Pointer to the statistics.
+*/
+void twi_usb_ll_get_stats(tstr_usb_ll_ctx* pstr_ctx, tstr_twi_ll_stats* pstr_stats)
 {
-	return (TWI_LL_USB_MAX_TRANSMIT_BUFF_LEN);
+	TWI_MEMCPY(pstr_stats, &(pstr_ctx->str_global.str_stats), sizeof(tstr_twi_ll_stats));
 }
 
 void twi_usb_ll_is_ready_to_send(tstr_usb_ll_ctx* pstr_cntxt, twi_bool* pb_is_ready)
 {
-	if(pstr_cntxt->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY)
+	/*Ready as long as a data message can be queued, the host doesn't need to be idle*/
+	if((pstr_cntxt->str_global.enu_link_layer_state == USB_LINK_LAYER_STATE_READY) && (pstr_cntxt->str_global.u8_tx_cnt < TWI_LL_USB_TX_DATA_SLOTS_NUM))
 	{
 		*pb_is_ready = TWI_TRUE;
 	}
@@ -15,6 +15,7 @@
 #include "twi_usb_wallet_if.h"
 #include "twi_apdu_parser_composer.h"
 #include<stdlib.h>
+#include<string.h>
 
 /*---------------------------------------------------------*/
 /*- LOCAL MACROS ------------------------------------------*/
@@ -100,7 +101,13 @@
 #define DVC_ID_IDX								(3)
 #define DVC_ID_LEN								(4)	
 
-#define USB_WALLET_PUBKEY_MAX_LEN				(255)
+#define USB_WALLET_XPUB_BATCH_RESULTS_MAX_SZ	(USB_WALLET_XPUB_BATCH_MAX_PATHS * (1 + USB_WALLET_PUBKEY_MAX_LEN))
+
+#define USB_WALLET_APDU_RTO_INIT_MS				(2000)		/* APDU response timeout till the first response time is measured */
+#define USB_WALLET_APDU_RTO_MIN_MS				(50)
+#define USB_WALLET_APDU_RTO_MAX_MS				(30000)
+#define USB_WALLET_APDU_TIMEOUT_RTOS			(4)			/* the awaited response fails the operation after this many APDU response timeouts */
+#define USB_WALLET_APDU_TIMEOUT_MIN_MS			(2000)
 
 #define TWI_ETHEREUM_SIGNATURE_TOTAL_LEN		(TWI_USB_ETHEREUM_SIGNATURE_V_LEN + TWI_USB_ETHEREUM_SIGNATURE_R_LEN + TWI_USB_ETHEREUM_SIGNATURE_S_LEN)
 /*---------------------------------------------------------*/
@@ -131,6 +138,17 @@ typedef struct
 
 }tstr_usb_get_extended_pubkey_info;
 
+typedef struct 
+{
+	tstr_usb_get_extended_pubkey_info str_cur_pubkey;		/* must be the first member, the GET_EXTENDED_PUBKEY APDU is composed from the current path */
+	tstr_usb_crypto_path astr_paths[USB_WALLET_XPUB_BATCH_MAX_PATHS];
+	twi_u8 u8_paths_num;
+	twi_u8 u8_cur_path_idx;
+	twi_u32 u32_results_len;
+	twi_u8 au8_results[USB_WALLET_XPUB_BATCH_RESULTS_MAX_SZ];	/* [pubkey length][pubkey] for every path, in the request order */
+
+}tstr_usb_get_extended_pubkeys_info;
+
 typedef struct 
 {
     union sign_tx_info
@@ -188,15 +206,35 @@ typedef struct
 
 typedef enum
 {
-	USB_WALLET_OP_STATE_CONNECTION_EVENT = 0,
-	USB_WALLET_OP_STATE_CONNECTION_FAILED_EVENT,
-	USB_WALLET_OP_STATE_DISCONNECTION_EVENT,
-	USB_WALLET_OP_STATE_DATA_RCVD_EVENT,
-	USB_WALLET_OP_STATE_SEND_FAILED_EVENT,
-	USB_WALLET_OP_STATE_TIMER_FIRED_EVENT,
-	USB_WALLET_OP_STATE_USER_CONFIRMATION_EVENT,
+	USB_WALLET_OP_PRIORITY_LOW = 0,		/* background work, e.g. xpub prefetch */
+	USB_WALLET_OP_PRIORITY_NORMAL,
+	USB_WALLET_OP_PRIORITY_HIGH,		/* interactive signing */
+
+}tenu_usb_op_priority;
+
+typedef struct 
+{
+	twi_u32 u32_op;
+	tenu_twi_usb_coin_type enu_coin_type;
+	void* pv;
+	twi_u8 au8_verify_id[USB_WALLET_ID_LEN];
+	twi_u8 u8_verify_id_len;
+	twi_bool b_skip_disconnection;
+	tenu_usb_op_priority enu_priority;
+	twi_u32 u32_enqueue_time_ms;
+
+}tstr_usb_pending_op;
+
+typedef struct 
+{
+	tstr_usb_pending_op astr_ops[USB_WALLET_OP_QUEUE_LEN];	/* kept in submission order */
+	twi_u8 u8_ops_num;
+	twi_u8 u8_max_ops_num;
+	twi_u32 u32_last_wait_ms;
+	twi_u32 u32_max_wait_ms;
+	usb_get_time_ms __get_time_ms;
 
-}tenu_usb_op_state_event;
+}tstr_usb_op_queue;
 
 
 /*---------------------------------------------------------*/
@@ -205,16 +243,36 @@ typedef enum
 static void usb_stack_cb(tstr_twi_stack_evt* pstr_evt, void* pv);
 static void current_operation_finalize(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_data_buf, twi_u32 u32_data_len, twi_s32 s32_err, twi_bool b_disconnected);
 static twi_s32 signed_tx_parse(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_sign_buf, twi_u16 u16_sign_len, void* pstr_signed_tx);
+static void app_session_invalidate(tstr_usb_if_context* pstr_cntxt);
+static void app_session_open(tstr_usb_if_context* pstr_cntxt);
+static void app_session_wallet_id_update(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_wallet_id);
+static void operation_first_apdu_send(tstr_usb_if_context* pstr_cntxt);
+static twi_bool app_session_replay(tstr_usb_if_context* pstr_cntxt, tstr_usb_rx_info* pstr_rx);
+static void operation_app_open(tstr_usb_if_context* pstr_cntxt);
+static void operation_run(tstr_usb_if_context* pstr_cntxt);
+static twi_s32 operation_submit(tstr_usb_if_context* pstr_cntxt, twi_u32 u32_op, tenu_twi_usb_coin_type enu_coin_type, void* pv, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect);
+static void operation_queue_kick(tstr_usb_if_context* pstr_cntxt);
+static void crypto_path_complete(tenu_twi_usb_coin_type enu_coin_type, tstr_usb_crypto_path* pstr_path);
+static twi_u32 sign_tx_start_cmd_len(tenu_twi_usb_coin_type enu_coin_type, void* const pv_tx);
+static twi_bool sign_tx_fits(tenu_twi_usb_coin_type enu_coin_type, void* const pv_tx);
 static void wait_to_connect_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event);
 static void get_wallet_id_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void confirm_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void get_extended_pubkey_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
+static void get_extended_pubkeys_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void sign_tx_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void sign_msg_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static void get_wallet_id_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv);
 static twi_s32 apdu_cmd_send(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_apdu_cmds enu_apdu_cmd);
+static void apdu_rtt_start(tstr_usb_if_context* pstr_cntxt);
+static void apdu_rtt_sample(tstr_usb_if_context* pstr_cntxt);
+static void apdu_rtt_cancel(tstr_usb_if_context* pstr_cntxt);
+static void apdu_rtt_await_user(tstr_usb_if_context* pstr_cntxt);
+static void apdu_timeout_cb(void* pv);
+static twi_u32 usb_stack_get_time_ms(void* pv);
+static void usb_timers_run(tstr_usb_if_context* pstr_cntxt);
 
 /*---------------------------------------------------------*/
 /*- GLOBAL STATIC VARIABLES -------------------------------*/
@@ -250,8 +308,11 @@ static void usb_stack_cb(tstr_twi_stack_evt* pstr_evt, void* pv)
 			TWI_MEMSET(&str_rx_info, 0x0, sizeof(tstr_usb_rx_info));
 			str_rx_info.pu8_rx_buf = pstr_evt->uni_data.str_rcv_data_evt.pu8_data;
 			str_rx_info.u16_rx_buf_len = pstr_evt->uni_data.str_rcv_data_evt.u16_data_len;
-			twi_stack_unlock_rcv_buf(pstr_evt->uni_data.str_rcv_data_evt.pv_user_arg , pstr_evt->uni_data.str_rcv_data_evt.pu8_data);
+			pstr_cntxt->str_stats.u32_responses_cnt++;
+			apdu_rtt_sample(pstr_cntxt);
 			op_state_update(pstr_cntxt, USB_WALLET_OP_STATE_DATA_RCVD_EVENT , &str_rx_info);
+			/* The buffer is parsed in place, release it only after the response is handled */
+			twi_stack_unlock_rcv_buf(pstr_evt->uni_data.str_rcv_data_evt.pv_user_arg , pstr_evt->uni_data.str_rcv_data_evt.pu8_data);
 			break;
 		}
 
@@ -265,7 +326,16 @@ static void usb_stack_cb(tstr_twi_stack_evt* pstr_evt, void* pv)
 static void current_operation_finalize(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_data_buf, twi_u32 u32_data_len, twi_s32 s32_err, twi_bool b_disconnected)
 {
 	TWI_LOGGER_ERR("pstr_cntxt->str_cur_op.b_skip_disconnection:%d:s32_err:%d:b_disconnected:%d\r\n", pstr_cntxt->str_cur_op.b_skip_disconnection, s32_err, b_disconnected);
+
+	/* no response is awaited anymore */
+	apdu_rtt_cancel(pstr_cntxt);
 		
+	/* a failed operation may mean the wallet switched to another app, reopen the app on the next operation */
+	if((s32_err != USB_IF_NO_ERR) || (b_disconnected == TWI_TRUE))
+	{
+		app_session_invalidate(pstr_cntxt);
+	}
+
 	if(((TWI_TRUE == pstr_cntxt->str_cur_op.b_skip_disconnection) && (s32_err == USB_IF_NO_ERR)) || (b_disconnected == TWI_TRUE))
 	{
 		pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_FALSE;
@@ -279,6 +349,14 @@ static void current_operation_finalize(tstr_usb_if_context* pstr_cntxt, twi_u8*
 				break;
 			}	
 
+			case USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP:
+			{
+				tstr_usb_get_extended_pubkeys_info* pstr_info = (tstr_usb_get_extended_pubkeys_info*)pstr_cntxt->str_cur_op.pv;
+				TWI_ASSERT((NULL != pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult) && (NULL != pstr_info));
+				pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult(pstr_cntxt->pv_device_info, pu8_data_buf, u32_data_len, pstr_info->u8_cur_path_idx, s32_err);				
+				break;
+			}	
+
 			case USB_WALLET_APP_SIGN_TX_OP:
 			{
 				TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onSignTransactionResult);
@@ -307,9 +385,13 @@ static void current_operation_finalize(tstr_usb_if_context* pstr_cntxt, twi_u8*
 		}
 
 		free(pstr_cntxt->str_cur_op.pv);
+		pstr_cntxt->str_cur_op.pv = NULL;
 		
 		pstr_cntxt->str_cur_op.enu_cur_op = USB_WALLET_APP_IDLE_OP;							
 		pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_INVALID;				
+
+		/* start the next pending operation, if any */
+		operation_queue_kick(pstr_cntxt);
 	}
 	else
 	{						
@@ -413,173 +495,519 @@ static twi_s32 signed_tx_parse(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_sign
 	return s32_retval;
 }
 
-static void wait_to_connect_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event)
+/**
+ *	@brief: Forgets the coin app that the session remembers as open, so the next operation walks the open app states again.
+ */
+static void app_session_invalidate(tstr_usb_if_context* pstr_cntxt)
 {
-	switch(enu_event)
+	pstr_cntxt->str_app_session.b_is_app_opened = TWI_FALSE;
+	pstr_cntxt->str_app_session.b_is_wallet_id_known = TWI_FALSE;
+	pstr_cntxt->str_app_session.b_is_first_apdu_replayable = TWI_FALSE;
+}
+
+/**
+ *	@brief: Records that the coin app of the current operation is open on the wallet, if the session mode is enabled.
+ */
+static void app_session_open(tstr_usb_if_context* pstr_cntxt)
+{
+	if(TWI_TRUE == pstr_cntxt->str_app_session.b_is_enabled)
 	{
-		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
-		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
-			break;
-		}
+		pstr_cntxt->str_app_session.b_is_app_opened = TWI_TRUE;
+		pstr_cntxt->str_app_session.enu_coin_type = pstr_cntxt->str_cur_op.enu_coin_type;
+	}
+}
 
-		case USB_WALLET_OP_STATE_CONNECTION_FAILED_EVENT:
+/**
+ *	@brief: Tracks the wallet id read from the wallet. A different id means another wallet answers, so the session is dropped.
+ */
+static void app_session_wallet_id_update(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_wallet_id)
+{
+	if((TWI_TRUE == pstr_cntxt->str_app_session.b_is_wallet_id_known) && (0 != TWI_MEMCMP(pstr_cntxt->str_app_session.au8_wallet_id, pu8_wallet_id, USB_WALLET_ID_LEN)))
+	{
+		app_session_invalidate(pstr_cntxt);
+	}
+
+	if(TWI_TRUE == pstr_cntxt->str_app_session.b_is_enabled)
+	{
+		TWI_MEMCPY(pstr_cntxt->str_app_session.au8_wallet_id, pu8_wallet_id, USB_WALLET_ID_LEN);
+		pstr_cntxt->str_app_session.b_is_wallet_id_known = TWI_TRUE;
+	}
+}
+
+/**
+ *	@brief: Sends the first APDU of the current operation once its coin app is open.
+ */
+static void operation_first_apdu_send(tstr_usb_if_context* pstr_cntxt)
+{
+	switch(pstr_cntxt->str_cur_op.enu_cur_op)
+	{
+		case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
+		case USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP:
 		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_CON_FAILED, TWI_TRUE);	
+			tstr_usb_get_extended_pubkey_info* pstr_info = (tstr_usb_get_extended_pubkey_info*)pstr_cntxt->str_cur_op.pv;
+			TWI_ASSERT(NULL != pstr_info);
+			
+			pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_EXTENDED_PUBKEY;
+			
+			if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_EXTENDED_PUBKEY_CMD))
+			{
+				current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+			}
+
 			break;
 		}
 
-		case USB_WALLET_OP_STATE_CONNECTION_EVENT:
+		case USB_WALLET_APP_SIGN_TX_OP:
 		{
-			if(pstr_cntxt->str_cur_op.u8_verify_id_len != 0)
+			switch (pstr_cntxt->str_cur_op.enu_coin_type)
 			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
-				if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
+				case USB_WALLET_COIN_BITCOIN:
+				case USB_WALLET_COIN_TEST_BITCOIN:
 				{
-					current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_TX;
+					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_TX_CMD))		
+					{
+						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+					}								
+														
+					break;
 				}
-			}
-			else
+
+				case USB_WALLET_COIN_ETHEREUM:
+				case USB_WALLET_COIN_TEST_ETHEREUM:
+				{
+					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_SIGN_TX;
+					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_SIGN_TX_CMD))		
+					{
+						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+					}	
+
+					break;
+				}
+
+				default:
+					break;
+			}									
+
+			break;
+		}	
+
+		case USB_WALLET_APP_SIGN_MSG_OP:
+		{
+			switch (pstr_cntxt->str_cur_op.enu_coin_type)
 			{
-				//skip wallet ID verification
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
-				if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
+				case USB_WALLET_COIN_BITCOIN:
+				case USB_WALLET_COIN_TEST_BITCOIN:
+				case USB_WALLET_COIN_ETHEREUM:
+				case USB_WALLET_COIN_TEST_ETHEREUM:									
 				{
-					current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_MSG;
+					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_MSG_CMD))		
+					{
+						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+					}								
+														
+					break;
 				}
-			}							
-			
+
+				default:
+					break;
+			}									
+
 			break;
-		}
+		}	
 
 		default:
 		{
 			break;
 		}
-	}	
+	}
 }
 
-static void get_wallet_id_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+/**
+ *	@brief: Reopens the app and replays the first APDU of the operation, once, when the wallet answered it as if the session app were gone.
+ *	@return	TWI_TRUE if the response is consumed by the replay.
+ */
+static twi_bool app_session_replay(tstr_usb_if_context* pstr_cntxt, tstr_usb_rx_info* pstr_rx)
 {
-	switch(enu_event)
+	twi_bool b_is_replayed = TWI_FALSE;
+	tstr_twi_apdu_response str_apdu_resp;
+
+	if(TWI_TRUE == pstr_cntxt->str_app_session.b_is_first_apdu_replayable)
 	{
-		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+		pstr_cntxt->str_app_session.b_is_first_apdu_replayable = TWI_FALSE;
+		TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));
+
+		/* the wallet switched apps behind the session, or closed the app */
+		if((TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp)) &&
+		   ((APDU_RESP_CLA_NOT_SUPPORTED == str_apdu_resp.u16_sw) || (APDU_RESP_INS_NOT_SUPPORTED == str_apdu_resp.u16_sw)))
 		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
-			break;
+			TWI_LOGGER_ERR("session app is gone, sw = 0x%04X, reopening it\r\n", str_apdu_resp.u16_sw);
+			pstr_cntxt->str_stats.u32_app_reopens_cnt++;
+			app_session_invalidate(pstr_cntxt);
+			operation_app_open(pstr_cntxt);
+			b_is_replayed = TWI_TRUE;
 		}
+	}
 
-		case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
+	return b_is_replayed;
+}
+
+/**
+ *	@brief: Opens the coin app of the current operation, or goes straight to the operation if the session already has it open.
+ */
+static void operation_app_open(tstr_usb_if_context* pstr_cntxt)
+{
+	if((TWI_TRUE == pstr_cntxt->str_app_session.b_is_app_opened) && (pstr_cntxt->str_app_session.enu_coin_type == pstr_cntxt->str_cur_op.enu_coin_type))
+	{
+		pstr_cntxt->str_app_session.b_is_first_apdu_replayable = TWI_TRUE;
+		operation_first_apdu_send(pstr_cntxt);
+	}
+	else
+	{
+		/* opening another coin app closes the one the session remembers */
+		pstr_cntxt->str_app_session.b_is_app_opened = TWI_FALSE;
+		pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
+		if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
 		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
-			break;
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
 		}
+	}
+}
 
-		case USB_WALLET_OP_STATE_DATA_RCVD_EVENT:
+/**
+ *	@brief: Starts the current operation on a ready stack, reading the wallet id first when it has to be verified (or is the operation itself).
+ */
+static void operation_run(tstr_usb_if_context* pstr_cntxt)
+{
+	if((USB_WALLET_APP_GET_ID_OP == pstr_cntxt->str_cur_op.enu_cur_op) || (0 != pstr_cntxt->str_cur_op.u8_verify_id_len))
+	{
+		pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
+		if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
 		{
-			tstr_usb_rx_info* pstr_rx = (tstr_usb_rx_info*)pv;
-			TWI_ASSERT(pstr_rx != NULL);
-			tstr_twi_apdu_response str_apdu_resp;
-			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));	
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+		}
+	}
+	else
+	{
+		//skip wallet ID verification
+		operation_app_open(pstr_cntxt);
+	}
+}
 
-			if(TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp))
-			{
-				switch (str_apdu_resp.u16_sw)
-				{
-					case APDU_RESP_SUCCESS:
-					{	
-						/* wallet id is successfully received */
-						if(USB_WALLET_ID_LEN >= str_apdu_resp.u32_rsp_data_len)
-						{
-							switch(pstr_cntxt->str_cur_op.enu_cur_op)
-							{
-								case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
-								case USB_WALLET_APP_SIGN_TX_OP:
-								case USB_WALLET_APP_SIGN_MSG_OP:
-								{
-									static twi_u8 au8_wallet_id[USB_WALLET_ID_LEN];
-									TWI_MEMSET(au8_wallet_id, 0x0, (USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len));
-									TWI_MEMCPY(&au8_wallet_id[USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len], str_apdu_resp.pu8_rsp_data, str_apdu_resp.u32_rsp_data_len);
+/**
+ *	@brief: Queues an operation prepared by one of the APIs and starts it if the context is idle.
+ *			The operation info (pv) is owned by the queue once TWI_SUCCESS is returned.
+ */
+static twi_s32 operation_submit(tstr_usb_if_context* pstr_cntxt, twi_u32 u32_op, tenu_twi_usb_coin_type enu_coin_type, void* pv, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect)
+{
+	twi_s32 s32_retval = TWI_SUCCESS;
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
 
-									if(0 == TWI_MEMCMP(au8_wallet_id, pstr_cntxt->str_cur_op.au8_verify_id, USB_WALLET_ID_LEN))
-									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
+	TWI_ASSERT(NULL != pstr_queue);
 
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}
-									}
-									else
-									{
-										current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_UNMATCHED_WALLET_ID, TWI_FALSE);	
-									}
+	if((USB_WALLET_OP_QUEUE_LEN <= pstr_queue->u8_ops_num) || (USB_WALLET_ID_LEN < u8_wallet_id_len) || ((NULL == pu8_wallet_id) && (0 != u8_wallet_id_len)))
+	{
+		s32_retval = TWI_ERROR;
+	}
+	else
+	{
+		tstr_usb_pending_op* pstr_op = &pstr_queue->astr_ops[pstr_queue->u8_ops_num];
 
-									break;
-								}	
-								
-								case USB_WALLET_APP_GET_ID_OP:
-								{
-									tstr_usb_get_wallet_id_info* pstr_info = (tstr_usb_get_wallet_id_info*)pstr_cntxt->str_cur_op.pv;
-									TWI_ASSERT(NULL != pstr_info);
+		TWI_MEMSET(pstr_op, 0, sizeof(tstr_usb_pending_op));
+		pstr_op->u32_op = u32_op;
+		pstr_op->enu_coin_type = enu_coin_type;
+		pstr_op->pv = pv;
+		pstr_op->b_skip_disconnection = (TWI_FALSE == b_disconnect)? TWI_TRUE : TWI_FALSE;
 
-									TWI_MEMSET(pstr_info->au8_wallet_id, 0x0, (USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len));
-									TWI_MEMCPY(&pstr_info->au8_wallet_id[USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len], str_apdu_resp.pu8_rsp_data, str_apdu_resp.u32_rsp_data_len);
-									current_operation_finalize(pstr_cntxt, pstr_info->au8_wallet_id, (twi_u8)sizeof(pstr_info->au8_wallet_id), (twi_s32)USB_IF_NO_ERR, TWI_FALSE);									
-									
-									break;
-								}
+		if(0 != u8_wallet_id_len)
+		{
+			TWI_MEMCPY(pstr_op->au8_verify_id, pu8_wallet_id, u8_wallet_id_len);
+		}
+		pstr_op->u8_verify_id_len = u8_wallet_id_len;
 
-								default:
-								{
-									break;
-								}
-							}		
-						}
-						else
-						{
-							current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_GET_WALLET_ID_FAILED, TWI_FALSE);
-						}
-						
-						break;
-					}
-					
-					default:
-					{
-						/* wallet id is not successfully received */
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_GET_WALLET_ID_FAILED, TWI_FALSE);
-						break;
-					}
-				}
+		switch(u32_op)
+		{
+			case USB_WALLET_APP_SIGN_TX_OP:
+			case USB_WALLET_APP_SIGN_MSG_OP:
+			{
+				pstr_op->enu_priority = USB_WALLET_OP_PRIORITY_HIGH;
+				break;
 			}
-			else
+
+			case USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP:
 			{
-				current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_RESP_PARSING_FAIL, TWI_FALSE);	
+				pstr_op->enu_priority = USB_WALLET_OP_PRIORITY_LOW;
+				break;
 			}
 
-			break;
+			default:
+			{
+				pstr_op->enu_priority = USB_WALLET_OP_PRIORITY_NORMAL;
+				break;
+			}
 		}
 
-		default:
+		if(NULL != pstr_queue->__get_time_ms)
 		{
-			break;
+			pstr_op->u32_enqueue_time_ms = pstr_queue->__get_time_ms(pstr_cntxt->pv_device_info);
 		}
-	}	
+
+		pstr_queue->u8_ops_num++;
+		if(pstr_queue->u8_ops_num > pstr_queue->u8_max_ops_num)
+		{
+			pstr_queue->u8_max_ops_num = pstr_queue->u8_ops_num;
+		}
+
+		TWI_LOGGER("operation_submit:: op = %d, priority = %d, depth = %d\r\n", u32_op, pstr_op->enu_priority, pstr_queue->u8_ops_num);
+
+		operation_queue_kick(pstr_cntxt);
+	}
+
+	return s32_retval;
 }
 
-static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+/**
+ *	@brief: Moves the oldest pending operation of the highest priority to the current operation and starts it.
+ *			Does nothing while another operation is running, the completion of that one kicks the queue again.
+ */
+static void operation_queue_kick(tstr_usb_if_context* pstr_cntxt)
 {
-	switch(enu_event)
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+
+	if((NULL != pstr_queue) && (0 != pstr_queue->u8_ops_num)
+		&& (USB_WALLET_STATE_INVALID == pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_APP_IDLE_OP == pstr_cntxt->str_cur_op.enu_cur_op))
 	{
-		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+		twi_u8 u8_idx;
+		twi_u8 u8_next_idx = 0;
+		tstr_usb_pending_op str_op;
+
+		for(u8_idx = 1; u8_idx < pstr_queue->u8_ops_num; u8_idx++)
 		{
-			current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
-			break;
+			if(pstr_queue->astr_ops[u8_idx].enu_priority > pstr_queue->astr_ops[u8_next_idx].enu_priority)
+			{
+				u8_next_idx = u8_idx;
+			}
 		}
 
-		case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
+		TWI_MEMCPY(&str_op, &pstr_queue->astr_ops[u8_next_idx], sizeof(tstr_usb_pending_op));
+		pstr_queue->u8_ops_num--;
+		memmove(&pstr_queue->astr_ops[u8_next_idx], &pstr_queue->astr_ops[u8_next_idx + 1], (pstr_queue->u8_ops_num - u8_next_idx) * sizeof(tstr_usb_pending_op));
+
+		if(NULL != pstr_queue->__get_time_ms)
 		{
-			current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
+			pstr_cntxt->u32_state_since_ms = pstr_queue->__get_time_ms(pstr_cntxt->pv_device_info);
+			pstr_queue->u32_last_wait_ms = pstr_cntxt->u32_state_since_ms - str_op.u32_enqueue_time_ms;
+			if(pstr_queue->u32_last_wait_ms > pstr_queue->u32_max_wait_ms)
+			{
+				pstr_queue->u32_max_wait_ms = pstr_queue->u32_last_wait_ms;
+			}
+		}
+
+		/* updating cntxt current app operation */
+		pstr_cntxt->str_cur_op.enu_cur_op = str_op.u32_op;
+		pstr_cntxt->str_cur_op.enu_coin_type = str_op.enu_coin_type;
+		pstr_cntxt->str_cur_op.pv = str_op.pv;
+		pstr_cntxt->str_cur_op.b_skip_disconnection = str_op.b_skip_disconnection;
+		if(0 != str_op.u8_verify_id_len)
+		{
+			TWI_MEMCPY(pstr_cntxt->str_cur_op.au8_verify_id, str_op.au8_verify_id, str_op.u8_verify_id_len);
+		}
+		pstr_cntxt->str_cur_op.u8_verify_id_len = str_op.u8_verify_id_len;
+
+		TWI_LOGGER("operation_queue_kick:: op = %d, waited = %d ms, pending = %d\r\n", str_op.u32_op, pstr_queue->u32_last_wait_ms, pstr_queue->u8_ops_num);
+
+		twi_bool b_is_ready = TWI_FALSE;
+		twi_stack_is_ready_to_send(&pstr_cntxt->str_stack_context, &b_is_ready);
+
+		if(TWI_TRUE == b_is_ready)
+		{
+			operation_run(pstr_cntxt);
+		}
+		else
+		{
+			pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_WAITING_TO_CONNECT;
+			/* Start Scanning and connect */	
+			TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_scan_and_connect);
+			pstr_cntxt->str_in_param.__usb_scan_and_connect(pstr_cntxt->pv_device_info, &pstr_cntxt->str_cur_op.au8_verify_id[DVC_ID_IDX], (twi_u8)DVC_ID_LEN, pstr_cntxt->u16_vid, pstr_cntxt->u16_pid, (twi_u32)USB_SCAN_DURATION_MS, 0);
+		}
+	}
+}
+
+/**
+ *	@brief: Completes the short bitcoin paths (empty or account only) to the full BIP44 path, other coins paths are used as is.
+ */
+static void crypto_path_complete(tenu_twi_usb_coin_type enu_coin_type, tstr_usb_crypto_path* pstr_path)
+{
+	if((enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN) || (enu_coin_type == USB_WALLET_COIN_BITCOIN))
+	{
+		if(pstr_path->u8_steps_num == 0)
+		{
+			twi_u32 au32_path[] = {0x8000002C, 0x80000000};
+			
+			if(enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN)
+			{
+				au32_path[1] = 0x80000001;
+			}
+
+			pstr_path->u8_steps_num = sizeof(au32_path)/sizeof(twi_u32);	
+			TWI_MEMCPY(pstr_path->au32_path_steps, au32_path, sizeof(au32_path));
+		}
+		else if(pstr_path->u8_steps_num == 1)
+		{
+			twi_u32 au32_path[] = {0x8000002C, 0x80000000, 0x00000000};
+
+			if(enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN)
+			{
+				au32_path[1] = 0x80000001;
+			}	
+
+			au32_path[2] = pstr_path->au32_path_steps[0];
+			pstr_path->u8_steps_num = sizeof(au32_path)/sizeof(twi_u32);	
+			TWI_MEMCPY(pstr_path->au32_path_steps, au32_path, sizeof(au32_path));
+		}
+		else
+		{
+			/* do nothing */
+		}	
+	}
+	else
+	{
+		/* do nothing */
+	}
+}
+
+/**
+ *	@brief: Length of the START_SIGN_TX command data that carries the transaction, 0 if one of its counts is out of range.
+ */
+static twi_u32 sign_tx_start_cmd_len(tenu_twi_usb_coin_type enu_coin_type, void* const pv_tx)
+{
+	twi_u32 u32_len = 0;
+	twi_u8 u8_idx;
+
+	switch (enu_coin_type)
+	{
+		case USB_WALLET_COIN_BITCOIN:
+		case USB_WALLET_COIN_TEST_BITCOIN:
+		{
+			tstr_usb_bitcoin_tx* pstr_tx = (tstr_usb_bitcoin_tx*)pv_tx;
+
+			if((pstr_tx->u8_internal_inputs_num <= USB_WALLET_INTERNAL_INPUTS_MAX_NUM) && (pstr_tx->u8_internal_outputs_num <= USB_WALLET_INTERNAL_OUTPUTS_MAX_NUM))
+			{
+				u32_len = sizeof(twi_u16) + pstr_tx->u16_signing_tx_len + 1 + 1 + USB_WALLET_SIGHASH_VALUE_LEN;
+
+				for(u8_idx = 0; (0 != u32_len) && (u8_idx < pstr_tx->u8_internal_inputs_num); u8_idx++)
+				{
+					if((pstr_tx->astr_internal_inputs[u8_idx].u16_lock_script_len <= USB_WALLET_LOCK_SCRIPT_MAX_LEN) &&
+					   (pstr_tx->astr_internal_inputs[u8_idx].str_path.u8_steps_num <= USB_WALLET_PATH_MAX_STEPS))
+					{
+						u32_len += 1 + sizeof(twi_u16) + pstr_tx->astr_internal_inputs[u8_idx].u16_lock_script_len + 1 + (pstr_tx->astr_internal_inputs[u8_idx].str_path.u8_steps_num * USB_WALLET_PATH_STEP_SZ);
+					}
+					else
+					{
+						u32_len = 0;
+					}
+				}
+
+				for(u8_idx = 0; (0 != u32_len) && (u8_idx < pstr_tx->u8_internal_outputs_num); u8_idx++)
+				{
+					if(pstr_tx->astr_internal_outputs[u8_idx].str_path.u8_steps_num <= USB_WALLET_PATH_MAX_STEPS)
+					{
+						u32_len += 1 + 1 + (pstr_tx->astr_internal_outputs[u8_idx].str_path.u8_steps_num * USB_WALLET_PATH_STEP_SZ);
+					}
+					else
+					{
+						u32_len = 0;
+					}
+				}
+			}
+			break;
+		}
+
+		case USB_WALLET_COIN_ETHEREUM:
+		case USB_WALLET_COIN_TEST_ETHEREUM:
+		{
+			tstr_usb_ethereum_tx* pstr_tx = (tstr_usb_ethereum_tx*)pv_tx;
+
+			if(pstr_tx->str_signing_key_path.u8_steps_num <= USB_WALLET_PATH_MAX_STEPS)
+			{
+				u32_len = sizeof(twi_u16) + pstr_tx->u16_signing_tx_len + 1 + (pstr_tx->str_signing_key_path.u8_steps_num * USB_WALLET_PATH_STEP_SZ);
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return u32_len;
+}
+
+/**
+ *	@brief: Checks that every command of the sign tx operation fits the command input buffer, the transactions are limited by it rather than by @ref USB_WALLET_SIGNING_TX_MAX_LEN.
+ */
+static twi_bool sign_tx_fits(tenu_twi_usb_coin_type enu_coin_type, void* const pv_tx)
+{
+	twi_u32 u32_len = sign_tx_start_cmd_len(enu_coin_type, pv_tx);
+	twi_bool b_fits = ((0 != u32_len) && (u32_len <= USB_WALLET_CMD_INPUT_MAX_SZ));
+	twi_u16 u16_idx;
+
+	if((TWI_TRUE == b_fits) && ((enu_coin_type == USB_WALLET_COIN_BITCOIN) || (enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN)))
+	{
+		tstr_usb_bitcoin_tx* pstr_tx = (tstr_usb_bitcoin_tx*)pv_tx;
+
+		b_fits = (pstr_tx->u16_total_inputs_num <= USB_WALLET_TX_INPUTS_MAX_NUM);
+		for(u16_idx = 0; (TWI_TRUE == b_fits) && (u16_idx < pstr_tx->u16_total_inputs_num); u16_idx++)
+		{
+			b_fits = ((sizeof(twi_u32) + sizeof(twi_u16) + pstr_tx->astr_inputs_info[u16_idx].u16_tx_len) <= USB_WALLET_CMD_INPUT_MAX_SZ);
+		}
+	}
+
+	return b_fits;
+}
+
+static void wait_to_connect_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event)
+{
+	switch(enu_event)
+	{
+		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
+			break;
+		}
+
+		case USB_WALLET_OP_STATE_CONNECTION_FAILED_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_CON_FAILED, TWI_TRUE);	
+			break;
+		}
+
+		case USB_WALLET_OP_STATE_CONNECTION_EVENT:
+		{
+			operation_run(pstr_cntxt);
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}	
+}
+
+static void get_wallet_id_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+{
+	switch(enu_event)
+	{
+		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
+			break;
+		}
+
+		case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
 			break;
 		}
 
@@ -588,7 +1016,7 @@ static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_
 			tstr_usb_rx_info* pstr_rx = (tstr_usb_rx_info*)pv;
 			TWI_ASSERT(pstr_rx != NULL);
 			tstr_twi_apdu_response str_apdu_resp;
-			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));
+			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));	
 
 			if(TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp))
 			{
@@ -596,115 +1024,64 @@ static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_
 				{
 					case APDU_RESP_SUCCESS:
 					{	
-						/* User confirmation is required */							
-						pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_CONFIRM_OPEN_APP;
-						
-						if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_CONFIRM_OPEN_APP_CMD))
-						{
-							current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-						}
-						else
-						{																			
-							TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationRequested);							
-							pstr_cntxt->str_in_param.__onUserConfirmationRequested(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_APP_OPEN_CONFIRMATION);
-						}
-
-						break;
-					}
-
-					case APDU_RESP_ALREADY_OPENED:
-					{	
-						/* App is already running */
-
-						switch(pstr_cntxt->str_cur_op.enu_cur_op)
+						/* wallet id is successfully received */
+						if(USB_WALLET_ID_LEN >= str_apdu_resp.u32_rsp_data_len)
 						{
-							case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
+							switch(pstr_cntxt->str_cur_op.enu_cur_op)
 							{
-								tstr_usb_get_extended_pubkey_info* pstr_info = (tstr_usb_get_extended_pubkey_info*)pstr_cntxt->str_cur_op.pv;
-								TWI_ASSERT(NULL != pstr_info);
-								
-								pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_EXTENDED_PUBKEY;
-								
-								if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_EXTENDED_PUBKEY_CMD))
+								case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
+								case USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP:
+								case USB_WALLET_APP_SIGN_TX_OP:
+								case USB_WALLET_APP_SIGN_MSG_OP:
 								{
-									current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-								}
-
-								break;
-							}
+									static twi_u8 au8_wallet_id[USB_WALLET_ID_LEN];
+									TWI_MEMSET(au8_wallet_id, 0x0, (USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len));
+									TWI_MEMCPY(&au8_wallet_id[USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len], str_apdu_resp.pu8_rsp_data, str_apdu_resp.u32_rsp_data_len);
+									app_session_wallet_id_update(pstr_cntxt, au8_wallet_id);
 
-							case USB_WALLET_APP_SIGN_TX_OP:
-							{
-								switch (pstr_cntxt->str_cur_op.enu_coin_type)
-								{
-									case USB_WALLET_COIN_BITCOIN:
-									case USB_WALLET_COIN_TEST_BITCOIN:
+									if(0 == TWI_MEMCMP(au8_wallet_id, pstr_cntxt->str_cur_op.au8_verify_id, USB_WALLET_ID_LEN))
 									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_TX;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_TX_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}								
-																			
-										break;
+										operation_app_open(pstr_cntxt);
 									}
-
-									case USB_WALLET_COIN_ETHEREUM:
-									case USB_WALLET_COIN_TEST_ETHEREUM:
+									else
 									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_SIGN_TX;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_SIGN_TX_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}	
-
-										break;
+										current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_UNMATCHED_WALLET_ID, TWI_FALSE);	
 									}
 
-									default:
-										break;
-								}									
-
-								break;
-							}	
-
-							case USB_WALLET_APP_SIGN_MSG_OP:
-							{
-								switch (pstr_cntxt->str_cur_op.enu_coin_type)
+									break;
+								}	
+								
+								case USB_WALLET_APP_GET_ID_OP:
 								{
-									case USB_WALLET_COIN_BITCOIN:
-									case USB_WALLET_COIN_TEST_BITCOIN:
-									case USB_WALLET_COIN_ETHEREUM:
-									case USB_WALLET_COIN_TEST_ETHEREUM:									
-									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_MSG;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_MSG_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}								
-																			
-										break;
-									}
-
-									default:
-										break;
-								}									
-
-								break;
-							}	
+									tstr_usb_get_wallet_id_info* pstr_info = (tstr_usb_get_wallet_id_info*)pstr_cntxt->str_cur_op.pv;
+									TWI_ASSERT(NULL != pstr_info);
 
-							default:
-							{
-								break;
-							}
-						}								
+									TWI_MEMSET(pstr_info->au8_wallet_id, 0x0, (USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len));
+									TWI_MEMCPY(&pstr_info->au8_wallet_id[USB_WALLET_ID_LEN - str_apdu_resp.u32_rsp_data_len], str_apdu_resp.pu8_rsp_data, str_apdu_resp.u32_rsp_data_len);
+									app_session_wallet_id_update(pstr_cntxt, pstr_info->au8_wallet_id);
+									current_operation_finalize(pstr_cntxt, pstr_info->au8_wallet_id, (twi_u8)sizeof(pstr_info->au8_wallet_id), (twi_s32)USB_IF_NO_ERR, TWI_FALSE);									
+									
+									break;
+								}
 
+								default:
+								{
+									break;
+								}
+							}		
+						}
+						else
+						{
+							current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_GET_WALLET_ID_FAILED, TWI_FALSE);
+						}
+						
 						break;
 					}
-
+					
 					default:
 					{
-						current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_OPEN_COIN_APP_FAILED, TWI_FALSE);
+						/* wallet id is not successfully received */
+						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_GET_WALLET_ID_FAILED, TWI_FALSE);
 						break;
 					}
 				}
@@ -724,20 +1101,19 @@ static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_
 	}	
 }
 
-
-static void confirm_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+static void request_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
 {
 	switch(enu_event)
 	{
 		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
 		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
+			current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
 			break;
 		}
 
 		case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
 		{
-			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
+			current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
 			break;
 		}
 
@@ -746,7 +1122,7 @@ static void confirm_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_
 			tstr_usb_rx_info* pstr_rx = (tstr_usb_rx_info*)pv;
 			TWI_ASSERT(pstr_rx != NULL);
 			tstr_twi_apdu_response str_apdu_resp;
-			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));	
+			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));
 
 			if(TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp))
 			{
@@ -754,92 +1130,91 @@ static void confirm_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_
 				{
 					case APDU_RESP_SUCCESS:
 					{	
-						/* User confirmation is optained */
-						TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationObtained);
-						pstr_cntxt->str_in_param.__onUserConfirmationObtained(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_APP_OPEN_CONFIRMATION);
+						/* User confirmation is required */							
+						pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_CONFIRM_OPEN_APP;
 						
-						switch(pstr_cntxt->str_cur_op.enu_cur_op)
+						if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_CONFIRM_OPEN_APP_CMD))
 						{
-							case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
-							{
-								tstr_usb_get_extended_pubkey_info* pstr_info = (tstr_usb_get_extended_pubkey_info*)pstr_cntxt->str_cur_op.pv;
-								TWI_ASSERT(NULL != pstr_info);
-								
-								pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_EXTENDED_PUBKEY;
-								
-								if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_EXTENDED_PUBKEY_CMD))
-								{
-									current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-								}
+							current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+						}
+						else
+						{																			
+							TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationRequested);							
+							pstr_cntxt->str_in_param.__onUserConfirmationRequested(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_APP_OPEN_CONFIRMATION);
+							apdu_rtt_await_user(pstr_cntxt);
+						}
 
-								break;
-							}
+						break;
+					}
 
-							case USB_WALLET_APP_SIGN_TX_OP:
-							{
-								switch (pstr_cntxt->str_cur_op.enu_coin_type)
-								{
-									case USB_WALLET_COIN_BITCOIN:
-									case USB_WALLET_COIN_TEST_BITCOIN:
-									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_TX;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_TX_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}								
-																			
-										break;
-									}
+					case APDU_RESP_ALREADY_OPENED:
+					{	
+						/* App is already running */
 
-									case USB_WALLET_COIN_ETHEREUM:
-									case USB_WALLET_COIN_TEST_ETHEREUM:
-									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_SIGN_TX;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_SIGN_TX_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}	
-																																	
-										break;
-									}
+						app_session_open(pstr_cntxt);
+						operation_first_apdu_send(pstr_cntxt);								
 
-									default:
-										break;
-								}
+						break;
+					}
 
-								break;
-							}	
+					default:
+					{
+						current_operation_finalize(pstr_cntxt, NULL, (twi_u32)0, (twi_s32)USB_IF_ERR_OPEN_COIN_APP_FAILED, TWI_FALSE);
+						break;
+					}
+				}
+			}
+			else
+			{
+				current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_RESP_PARSING_FAIL, TWI_FALSE);	
+			}
 
-							case USB_WALLET_APP_SIGN_MSG_OP:
-							{
-								switch (pstr_cntxt->str_cur_op.enu_coin_type)
-								{
-									case USB_WALLET_COIN_BITCOIN:
-									case USB_WALLET_COIN_TEST_BITCOIN:
-									case USB_WALLET_COIN_ETHEREUM:
-									case USB_WALLET_COIN_TEST_ETHEREUM:									
-									{
-										pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_START_SIGN_MSG;
-										if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_START_SIGN_MSG_CMD))		
-										{
-											current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-										}								
-																			
-										break;
-									}
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}	
+}
+
+
+static void confirm_open_app_state_handle(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+{
+	switch(enu_event)
+	{
+		case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
+			break;
+		}
 
-									default:
-										break;
-								}
+		case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
+		{
+			current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
+			break;
+		}
 
-								break;
-							}
+		case USB_WALLET_OP_STATE_DATA_RCVD_EVENT:
+		{
+			tstr_usb_rx_info* pstr_rx = (tstr_usb_rx_info*)pv;
+			TWI_ASSERT(pstr_rx != NULL);
+			tstr_twi_apdu_response str_apdu_resp;
+			TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));	
 
-							default:
-							{
-								break;
-							}
-						}						
+			if(TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp))
+			{
+				switch (str_apdu_resp.u16_sw)
+				{
+					case APDU_RESP_SUCCESS:
+					{	
+						/* User confirmation is optained */
+						TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationObtained);
+						pstr_cntxt->str_in_param.__onUserConfirmationObtained(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_APP_OPEN_CONFIRMATION);
+						
+						app_session_open(pstr_cntxt);
+						operation_first_apdu_send(pstr_cntxt);						
 
 						break;
 					}
@@ -1002,6 +1377,132 @@ static void get_extended_pubkey_op_state_update(tstr_usb_if_context* pstr_cntxt,
 	}
 }
 
+static void get_extended_pubkeys_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
+{
+	tstr_usb_get_extended_pubkeys_info* pstr_info = (tstr_usb_get_extended_pubkeys_info*)pstr_cntxt->str_cur_op.pv;
+	TWI_ASSERT(NULL != pstr_info);
+
+	switch (pstr_cntxt->str_cur_op.enu_cur_state)
+	{
+		case USB_WALLET_STATE_WAITING_TO_CONNECT:
+		{
+			wait_to_connect_state_handle(pstr_cntxt, enu_event);
+			break;
+		}
+
+		case USB_WALLET_STATE_GET_ID:
+		{
+			get_wallet_id_state_handle(pstr_cntxt, enu_event, pv);
+			break;
+		}	
+
+		case USB_WALLET_STATE_REQUEST_OPEN_APP:
+		{
+			request_open_app_state_handle(pstr_cntxt, enu_event, pv);
+			break;
+		}
+
+		case USB_WALLET_STATE_CONFIRM_OPEN_APP:
+		{
+			confirm_open_app_state_handle(pstr_cntxt, enu_event, pv);
+			break;
+		}
+		
+		case USB_WALLET_STATE_GET_EXTENDED_PUBKEY:
+		{
+			switch(enu_event)
+			{
+				case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+				{
+					current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_ERR_REMOTE_DISCON, TWI_TRUE);	
+					break;
+				}
+
+				case USB_WALLET_OP_STATE_SEND_FAILED_EVENT:
+				{
+					current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);	
+					break;
+				}
+
+				case USB_WALLET_OP_STATE_DATA_RCVD_EVENT:
+				{
+					tstr_usb_rx_info* pstr_rx = (tstr_usb_rx_info*)pv;
+					TWI_ASSERT(pstr_rx != NULL);
+					tstr_twi_apdu_response str_apdu_resp;
+					TWI_MEMSET(&str_apdu_resp, 0x0, sizeof(tstr_twi_apdu_response));
+
+					if(TWI_SUCCESS == twi_apdu_parse_rsp(pstr_rx->pu8_rx_buf, pstr_rx->u16_rx_buf_len, &str_apdu_resp))
+					{
+						if((APDU_RESP_SUCCESS == str_apdu_resp.u16_sw) && (USB_WALLET_PUBKEY_MAX_LEN >= str_apdu_resp.u32_rsp_data_len))
+						{
+							/* Extended Pubkey of the current path is successfully received, it is appended as [length][pubkey] */
+							pstr_info->au8_results[pstr_info->u32_results_len] = (twi_u8)str_apdu_resp.u32_rsp_data_len;
+							TWI_MEMCPY(&pstr_info->au8_results[pstr_info->u32_results_len + 1], str_apdu_resp.pu8_rsp_data, str_apdu_resp.u32_rsp_data_len);
+							pstr_info->u32_results_len += (1 + str_apdu_resp.u32_rsp_data_len);
+							pstr_info->u8_cur_path_idx++;
+
+							if(pstr_info->u8_cur_path_idx < pstr_info->u8_paths_num)
+							{
+								/* the app stays open, the next path is requested right away */
+								TWI_MEMCPY(&pstr_info->str_cur_pubkey.str_path, &pstr_info->astr_paths[pstr_info->u8_cur_path_idx], sizeof(tstr_usb_crypto_path));
+
+								if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_EXTENDED_PUBKEY_CMD))
+								{
+									current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
+								}
+							}
+							else
+							{
+								current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_NO_ERR, TWI_FALSE);
+							}
+						}
+						else
+						{
+							/* Extended Pubkey is not successfully received, the keys of the previous paths are still reported */
+							current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_ERR_GET_EXT_PUBKEY_FAILED, TWI_FALSE);
+						}
+					}
+					else
+					{
+						current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)USB_IF_ERR_RESP_PARSING_FAIL, TWI_FALSE);	
+					}
+
+					break;
+				}
+
+				default:
+				{
+					break;
+				}
+			}
+
+			break;
+		}				
+
+		case USB_WALLET_STATE_WAITING_TO_DISCONNECT:
+		{
+			switch(enu_event)
+			{
+				case USB_WALLET_OP_STATE_DISCONNECTION_EVENT:
+				{
+					current_operation_finalize(pstr_cntxt, pstr_info->au8_results, pstr_info->u32_results_len, (twi_s32)pstr_cntxt->str_cur_op.enu_err_code, TWI_TRUE);
+					break;
+				}
+
+				default:
+				{
+					break;
+				}
+			}
+
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 static void sign_tx_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
 {
 	switch (pstr_cntxt->str_cur_op.enu_cur_state)
@@ -1234,6 +1735,7 @@ static void sign_tx_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op
 										{
 											TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationRequested);							
 											pstr_cntxt->str_in_param.__onUserConfirmationRequested(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_SIGN_TX_CONFIRMATION);
+											apdu_rtt_await_user(pstr_cntxt);
 										}
 									
 										break;
@@ -1322,6 +1824,7 @@ static void sign_tx_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op
 								{
 									TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationRequested);							
 									pstr_cntxt->str_in_param.__onUserConfirmationRequested(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_SIGN_TX_CONFIRMATION);
+									apdu_rtt_await_user(pstr_cntxt);
 								}					
 
 								break;
@@ -1773,6 +2276,7 @@ static void sign_msg_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_o
 										{
 											TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__onUserConfirmationRequested);							
 											pstr_cntxt->str_in_param.__onUserConfirmationRequested(pstr_cntxt->pv_device_info, (twi_u32)USB_WALLET_SIGN_MSG_CONFIRMATION);
+											apdu_rtt_await_user(pstr_cntxt);
 										}
 									
 										break;
@@ -2018,6 +2522,27 @@ static void get_wallet_id_op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_
 
 static void op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_event enu_event, void* pv)
 {
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+
+	/* time the running operation waited in its state for this event */
+	if((NULL != pstr_queue) && (NULL != pstr_queue->__get_time_ms) && (USB_WALLET_APP_IDLE_OP != pstr_cntxt->str_cur_op.enu_cur_op) && (enu_event < USB_IF_STATS_STATE_EVENTS_NUM))
+	{
+		twi_u32 u32_now_ms = pstr_queue->__get_time_ms(pstr_cntxt->pv_device_info);
+
+		twi_hist_add(&pstr_cntxt->str_stats.astr_state_hist[enu_event], u32_now_ms - pstr_cntxt->u32_state_since_ms);
+		pstr_cntxt->u32_state_since_ms = u32_now_ms;
+	}
+
+	/* only the first response of an operation may say the session app is gone */
+	if(USB_WALLET_OP_STATE_DATA_RCVD_EVENT == enu_event)
+	{
+		TWI_ASSERT(NULL != pv);
+		if(TWI_TRUE == app_session_replay(pstr_cntxt, (tstr_usb_rx_info*)pv))
+		{
+			return;
+		}
+	}
+
 	switch (pstr_cntxt->str_cur_op.enu_cur_op)
 	{
 		case USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP:
@@ -2026,6 +2551,12 @@ static void op_state_update(tstr_usb_if_context* pstr_cntxt, tenu_usb_op_state_e
 			break;
 		}
 
+		case USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP:
+		{
+			get_extended_pubkeys_op_state_update(pstr_cntxt, enu_event, pv);
+			break;
+		}
+
 		case USB_WALLET_APP_SIGN_TX_OP:
 		{
 			sign_tx_op_state_update(pstr_cntxt, enu_event, pv);
@@ -2275,7 +2806,9 @@ static twi_s32 apdu_cmd_send(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_apdu_
 
 							do
 							{						
-								if(pstr_tx->u16_signing_tx_len > USB_WALLET_SIGNING_TX_MAX_LEN)
+								/* the whole command must fit the input buffer, not only the transaction */
+								twi_u32 u32_cmd_len = sign_tx_start_cmd_len(pstr_cntxt->str_cur_op.enu_coin_type, (void*)pstr_tx);
+								if((0 == u32_cmd_len) || (u32_cmd_len > sizeof(au8_cmd_input)))
 								{
 									s32_retval = TWI_ERROR_INVALID_LEN;
 									break;
@@ -2401,7 +2934,8 @@ static twi_s32 apdu_cmd_send(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_apdu_
 							tstr_usb_bitcoin_tx* pstr_tx = (tstr_usb_bitcoin_tx*)&((tstr_usb_sign_tx_info*)pstr_cntxt->str_cur_op.pv)->uni_sign_tx_info.str_bitcoin_sign_tx.str_tx_info;	
 							twi_u16 u16_bytes_count = 0;
 							
-							if(pstr_tx->astr_inputs_info[pstr_tx->u16_delivered_inputs_count].u16_tx_len <= USB_WALLET_SIGNING_TX_MAX_LEN)
+							if((pstr_tx->u16_delivered_inputs_count < USB_WALLET_TX_INPUTS_MAX_NUM) &&
+							   ((sizeof(twi_u32) + sizeof(twi_u16) + pstr_tx->astr_inputs_info[pstr_tx->u16_delivered_inputs_count].u16_tx_len) <= sizeof(au8_cmd_input)))
 							{
 								SETU32B(au8_cmd_input, u16_bytes_count, pstr_tx->astr_inputs_info[pstr_tx->u16_delivered_inputs_count].u32_idx);
 								u16_bytes_count += sizeof(twi_u32);
@@ -2464,7 +2998,9 @@ static twi_s32 apdu_cmd_send(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_apdu_
 							
 							do
 							{						
-								if(pstr_tx->u16_signing_tx_len > USB_WALLET_SIGNING_TX_MAX_LEN)
+								/* the whole command must fit the input buffer, not only the transaction */
+								twi_u32 u32_cmd_len = sign_tx_start_cmd_len(pstr_cntxt->str_cur_op.enu_coin_type, (void*)pstr_tx);
+								if((0 == u32_cmd_len) || (u32_cmd_len > sizeof(au8_cmd_input)))
 								{
 									s32_retval = TWI_ERROR_INVALID_LEN;
 									break;
@@ -2852,6 +3388,11 @@ static twi_s32 apdu_cmd_send(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_apdu_
 		{
 			/* sending the composed APDU buffer to HW Wallet through USB */
 			s32_retval = twi_stack_send_data(&pstr_cntxt->str_stack_context, TWI_STACK_CLR_MSG, au8_apdu_buf, u32_apdu_sz, (void*)pstr_cntxt);
+			if(TWI_SUCCESS == s32_retval)
+			{
+				pstr_cntxt->str_stats.u32_apdus_cnt++;
+				apdu_rtt_start(pstr_cntxt);
+			}
 		}
 		else
 		{
@@ -2880,6 +3421,24 @@ static twi_s32 usb_stack_twi_usbd_send(void* pv_cntxt, const void *p_tx_buf,twi_
 	return s32_retval;
 }
 
+/**
+ * 	@fn: 						usb_stack_twi_usbd_send_batch
+ * 	@brief      				This function is used to send a batch of HID reports with one call to the host.
+ * 	@param[in,out] 	pv_cntxt: 	Void Pointer to the Stack Context.
+ * 	@param[in] 		p_reports: 	Pointer to the contiguous reports array, each report is TWI_LL_USB_MAX_BUFF_SIZE bytes.
+ * 	@param[in] 		u32_reports_num: The number of reports to send.
+ * 	@return:		@val: 		TWI_SUCCESS in case of successful execution. Otherwise, kindly refer to @file: twi_retval.h
+ */
+static twi_s32 usb_stack_twi_usbd_send_batch(void* pv_cntxt, const void *p_reports, twi_u32 u32_reports_num)
+{
+	twi_s32 s32_retval = TWI_SUCCESS;
+	tstr_usb_if_context* pstr_cntxt = (tstr_usb_if_context*)pv_cntxt;
+	TWI_ASSERT(NULL != pstr_cntxt);
+	TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_send_batch);	
+	pstr_cntxt->str_in_param.__usb_send_batch(pstr_cntxt->pv_device_info, (twi_u8*)p_reports, u32_reports_num);
+	return s32_retval;
+}
+
 /**
  * @fn: 							usb_stack_twi_usbd_receive
  * @brief: 							This function is used to receive data from CDC ACM serial port.
@@ -2926,9 +3485,63 @@ static void usb_stack_twi_usbd_dispatch(void* pv_cntxt)
 	pstr_cntxt->str_in_param.__usb_dispatch(pstr_cntxt->pv_device_info);
 }
 
+/**
+ *	@brief: Saves a stack record of the connected device through the host save callback, an empty record drops it.
+ */
+static void usb_stack_save_data(void* pv, twi_u16 u16_id, twi_u8* pu8_data, twi_u32 u32_data_sz)
+{
+	tstr_usb_if_context* pstr_cntxt	= pv;
+
+	if((NULL != pstr_cntxt) && (NULL != pstr_cntxt->str_in_param.__save))
+	{
+		pstr_cntxt->str_in_param.__save(pstr_cntxt->pv_device_info, u16_id, pu8_data, u32_data_sz);
+	}
+}
+
+/**
+ *	@brief: Loads a stack record of the connected device through the host load callback.
+ *			The host sets the record length, it leaves 0 when it has none.
+ */
+static twi_s32 usb_stack_load_data(void* pv, twi_u16 u16_id, twi_u8* pu8_data, twi_u32* pu32_data_sz)
+{
+	tstr_usb_if_context* pstr_cntxt	= pv;
+	twi_u32 u32_capacity;
+	twi_s32 s32_retval = TWI_SUCCESS;
+
+	if((NULL == pstr_cntxt) || (NULL == pstr_cntxt->str_in_param.__load) || (NULL == pu8_data) || (NULL == pu32_data_sz))
+	{
+		s32_retval = TWI_ERROR_INVALID_ARGUMENTS;
+	}
+	else
+	{
+		/* the host gets the capacity and checks the record fits before copying it */
+		u32_capacity = *pu32_data_sz;
+		pstr_cntxt->str_in_param.__load(pstr_cntxt->pv_device_info, u16_id, pu8_data, pu32_data_sz);
+		if((0 == *pu32_data_sz) || (*pu32_data_sz > u32_capacity))
+		{
+			s32_retval = TWI_ERROR_INVALID_LEN;
+		}
+	}
+	return s32_retval;
+}
+
 static void usb_stack_sleep_mode_forbiden(void* pv, twi_bool b_forbid)
 {
-	//TODO
+	tstr_usb_if_context* pstr_cntxt	= pv;
+
+	/* The stack forbids sleeping whenever it makes work runnable for its dispatcher, wake the host up to call it */
+	if((TWI_TRUE == b_forbid) && (NULL != pstr_cntxt) && (NULL != pstr_cntxt->str_in_param.__usb_wake))
+	{
+		pstr_cntxt->str_in_param.__usb_wake(pstr_cntxt->pv_device_info);
+	}
+}
+
+/**
+ *	@brief: Brings the stack timers up to the clock and fires the expired ones.
+ */
+static void usb_timers_run(tstr_usb_if_context* pstr_cntxt)
+{
+	twi_timer_wheel_run(&pstr_cntxt->str_timer_wheel, usb_stack_get_time_ms((void*)pstr_cntxt));
 }
 
 static twi_s32 usb_stack_stop_timer(void* pv, tstr_timer_mgmt_timer *pstr_timer)
@@ -2939,10 +3552,9 @@ static twi_s32 usb_stack_stop_timer(void* pv, tstr_timer_mgmt_timer *pstr_timer)
 	{
 		tstr_usb_if_context* pstr_cntxt	= pv;
 
-		if(NULL != pstr_cntxt->str_in_param.__stop_timer)
+		if(NULL != pstr_timer)
 		{
-			pstr_timer->b_is_active = TWI_FALSE;
-			//pstr_cntxt->str_in_param.__stop_timer(); //TODO:?	
+			twi_timer_wheel_stop(&pstr_cntxt->str_timer_wheel, pstr_timer);
 		}
 		else
 		{
@@ -2965,10 +3577,17 @@ static twi_s32 usb_stack_start_timer(void* pv, tstr_timer_mgmt_timer *pstr_timer
 	{
 		tstr_usb_if_context* pstr_cntxt	= pv;
 
-		if(NULL != pstr_cntxt->str_in_param.__start_timer)
+		if((NULL != pstr_timer) && (NULL != pf_timer_cb))
 		{
-			pstr_timer->b_is_active = TWI_TRUE;
-			//pstr_cntxt->str_in_param.__start_timer(); //TODO: ?	
+			s32_retval = twi_timer_wheel_start(&pstr_cntxt->str_timer_wheel, usb_stack_get_time_ms(pv), pstr_timer, enu_mode, u32_msec, pf_timer_cb, pv_user_data);
+			if(TWI_SUCCESS == s32_retval)
+			{
+				TWI_USB_WALLET_IF_DBG("timer %s started for %d ms\r\n", (char*)ps8_name, u32_msec);
+			}
+			else
+			{
+				TWI_USB_WALLET_IF_ERR("no free timer for %s\r\n", (char*)ps8_name);
+			}
 		}
 		else
 		{
@@ -2983,6 +3602,104 @@ static twi_s32 usb_stack_start_timer(void* pv, tstr_timer_mgmt_timer *pstr_timer
 	return s32_retval;
 }
 
+static twi_u32 usb_stack_get_time_ms(void* pv)
+{
+	tstr_usb_if_context* pstr_cntxt	= pv;
+	twi_u32 u32_time_ms = 0;
+
+	if((NULL != pstr_cntxt) && (NULL != pstr_cntxt->pv_op_queue) && (NULL != ((tstr_usb_op_queue*)pstr_cntxt->pv_op_queue)->__get_time_ms))
+	{
+		u32_time_ms = ((tstr_usb_op_queue*)pstr_cntxt->pv_op_queue)->__get_time_ms(pstr_cntxt->pv_device_info);
+	}
+	return u32_time_ms;
+}
+
+/**
+ *	@brief: Starts timing the response of the APDU just sent and arms its response timer, if a clock is set.
+ *			The timer allows a few APDU response timeouts, the APDUs of one operation don't take the same time in the wallet.
+ */
+static void apdu_rtt_start(tstr_usb_if_context* pstr_cntxt)
+{
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+
+	if((NULL != pstr_queue) && (NULL != pstr_queue->__get_time_ms))
+	{
+		twi_u32 u32_timeout_ms = USB_WALLET_APDU_TIMEOUT_RTOS * twi_rtt_get_rto(&pstr_cntxt->str_apdu_rtt);
+
+		pstr_cntxt->b_is_apdu_timed = TWI_TRUE;
+		pstr_cntxt->u32_apdu_sent_ms = pstr_queue->__get_time_ms(pstr_cntxt->pv_device_info);
+		if(USB_WALLET_APDU_TIMEOUT_MIN_MS > u32_timeout_ms)
+		{
+			u32_timeout_ms = USB_WALLET_APDU_TIMEOUT_MIN_MS;
+		}
+		if(TWI_SUCCESS != usb_stack_start_timer((void*)pstr_cntxt, &pstr_cntxt->str_apdu_timer, (twi_s8*)"APDU Response", TWI_TIMER_TYPE_ONE_SHOT, u32_timeout_ms, apdu_timeout_cb, (void*)pstr_cntxt))
+		{
+			TWI_USB_WALLET_IF_ERR("APDU response timer is not armed\r\n");
+		}
+	}
+}
+
+/**
+ *	@brief: Folds the response time of the awaited APDU into the APDU response time estimate.
+ *			The responses that waited for the user confirmation are not a transport round trip, so they are not sampled.
+ */
+static void apdu_rtt_sample(tstr_usb_if_context* pstr_cntxt)
+{
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+
+	if((NULL != pstr_queue) && (TWI_TRUE == pstr_cntxt->b_is_apdu_timed))
+	{
+		twi_u32 u32_rtt_ms = pstr_queue->__get_time_ms(pstr_cntxt->pv_device_info) - pstr_cntxt->u32_apdu_sent_ms;
+
+		pstr_cntxt->b_is_apdu_timed = TWI_FALSE;
+		usb_stack_stop_timer((void*)pstr_cntxt, &pstr_cntxt->str_apdu_timer);
+		twi_rtt_sample(&pstr_cntxt->str_apdu_rtt, u32_rtt_ms);
+		twi_hist_add(&pstr_cntxt->str_stats.str_apdu_hist, u32_rtt_ms);
+	}
+}
+
+/**
+ *	@brief: Stops timing the awaited APDU and disarms its response timer, the operation is over.
+ */
+static void apdu_rtt_cancel(tstr_usb_if_context* pstr_cntxt)
+{
+	if(TWI_TRUE == pstr_cntxt->b_is_apdu_timed)
+	{
+		pstr_cntxt->b_is_apdu_timed = TWI_FALSE;
+		usb_stack_stop_timer((void*)pstr_cntxt, &pstr_cntxt->str_apdu_timer);
+	}
+}
+
+/**
+ *	@brief: Stops timing the APDU just sent, its response waits for the user confirmation so it is counted apart from the timed ones.
+ */
+static void apdu_rtt_await_user(tstr_usb_if_context* pstr_cntxt)
+{
+	if(TWI_TRUE == pstr_cntxt->b_is_apdu_timed)
+	{
+		pstr_cntxt->str_stats.u32_apdu_confirmations_cnt++;
+	}
+	apdu_rtt_cancel(pstr_cntxt);
+}
+
+/**
+ *	@brief: The awaited APDU response didn't come in time, the operation fails and the wallet is disconnected,
+ *			so a late response can't be taken for the response of the next APDU.
+ */
+static void apdu_timeout_cb(void* pv)
+{
+	tstr_usb_if_context* pstr_cntxt = (tstr_usb_if_context*)pv;
+
+	if((TWI_TRUE == pstr_cntxt->b_is_apdu_timed) && (USB_WALLET_STATE_WAITING_TO_DISCONNECT < pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_STATE_INVALID > pstr_cntxt->str_cur_op.enu_cur_state))
+	{
+		TWI_USB_WALLET_IF_ERR("APDU response timeout in state %d\r\n", pstr_cntxt->str_cur_op.enu_cur_state);
+		pstr_cntxt->b_is_apdu_timed = TWI_FALSE;
+		twi_rtt_backoff(&pstr_cntxt->str_apdu_rtt);
+		pstr_cntxt->str_stats.u32_apdu_timeouts_cnt++;
+		current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_TIMEOUT, TWI_FALSE);
+	}
+}
+
 /*---------------------------------------------------------*/
 /*- APIs IMPLEMENTATION -----------------------------------*/
 /*---------------------------------------------------------*/
@@ -3001,6 +3718,10 @@ tstr_usb_if_context* twi_usb_if_new(void)
 	pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_FALSE;
 	pstr_cntxt->u16_pid = 0;
 	pstr_cntxt->u16_vid = 0;
+	pstr_cntxt->pv_op_queue = calloc(1, sizeof(tstr_usb_op_queue));
+	TWI_ASSERT(NULL != pstr_cntxt->pv_op_queue);
+	twi_rtt_init(&pstr_cntxt->str_apdu_rtt, USB_WALLET_APDU_RTO_INIT_MS, USB_WALLET_APDU_RTO_MIN_MS, USB_WALLET_APDU_RTO_MAX_MS);
+	twi_timer_wheel_init(&pstr_cntxt->str_timer_wheel);
 	return pstr_cntxt;	
 }	
 
@@ -3014,18 +3735,22 @@ tstr_usb_if_context* twi_usb_if_new(void)
  *	@param[IN]		__usb_stop:
  *	@param[IN]		__usb_disable:
  *	@param[IN]		__usb_dispach: 
+ *	@param[IN]		__usb_wake: optional, called when the stack has runnable work and @ref twi_usb_if_dispatch shall be called.
  *	@param[IN]		__usb_send:
- *	@param[IN]		__start_timer:
- *	@param[IN]		__stop_timer:
+ *	@param[IN]		__usb_send_batch: optional, NULL keeps sending one report per call.
+ *	@param[IN]		__start_timer: unused, the stack timers run inside this module on the clock , @ref twi_usb_if_set_clock is called before.
+ *	@param[IN]		__stop_timer: unused, likewise.
  *	@param[IN]		__send_to_cloud:
  *	@param[IN]		__onUserConfirmationRequested:
  *	@param[IN]		__onUserConfirmationObtained:
  *	@param[IN]		__onGetExtendedPubKeyResult:
+ *	@param[IN]		__onGetExtendedPubKeysResult: optional, needed by @ref twi_usb_if_get_ext_pub_keys only.
  *	@param[IN]		__onSignTransactionResult:
  *	@param[IN]		__onSignMessageResult:  
  *	@param[IN]		__onGetWalletIDResult: 
- *	@param[IN]		__save:
- *	@param[IN]		__load:		
+ *	@param[IN]		__save: optional, keeps a record of the connected device, e.g. the agreed stack specs. An empty record drops it.
+ *	@param[IN]		__load: optional, reads back a record of the connected device, it sets the length to 0 when it has none.
+ *					With both set, a device seen before is ready right after the port opens and its stack specs are checked meanwhile.
  *	@param[IN]		__onConnectionDone: 					 
  */
 void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
@@ -3036,7 +3761,9 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 								usb_stop                        __usb_stop,
 								usb_disable                     __usb_disable,
 								usb_dispatch                    __usb_dispatch,                                     
+								usb_wake                        __usb_wake,
 								usb_send                        __usb_send,
+								usb_send_batch                  __usb_send_batch,
 
 								//General helpers
 								usb_Start_Timer                 __start_timer,
@@ -3047,6 +3774,7 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 								usb_onUserConfirmationRequested __onUserConfirmationRequested,
 								usb_onUserConfirmationObtained  __onUserConfirmationObtained,
 								usb_onGetExtendedPubKeyResult   __onGetExtendedPubKeyResult,
+								usb_onGetExtendedPubKeysResult  __onGetExtendedPubKeysResult,
 								usb_onSignTransactionResult     __onSignTransactionResult,
 								usb_onSignMessageResult         __onSignMessageResult,										
 								usb_onGetWalletIDResult         __onGetWalletIDResult,                                        
@@ -3054,7 +3782,8 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 								usb_load                        __load,
 								usb_onConnectionDone            __onConnectionDone)										
 {
-	TWI_ASSERT(NULL != pstr_cntxt);
+	/* the stack timers only run on the clock, without it no send or response would ever time out */
+	TWI_ASSERT((NULL != pstr_cntxt) && (NULL != pstr_cntxt->pv_op_queue) && (NULL != ((tstr_usb_op_queue*)pstr_cntxt->pv_op_queue)->__get_time_ms));
 	pstr_cntxt->str_in_param.__usb_scan_and_connect = __usb_scan_and_connect;
 	pstr_cntxt->str_in_param.__usb_disconnect = __usb_disconnect;
 
@@ -3062,13 +3791,16 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 	pstr_cntxt->str_in_param.__usb_stop = __usb_stop;
 	pstr_cntxt->str_in_param.__usb_disable = __usb_disable;
 	pstr_cntxt->str_in_param.__usb_dispatch = __usb_dispatch;			
+	pstr_cntxt->str_in_param.__usb_wake = __usb_wake;
 	pstr_cntxt->str_in_param.__usb_send = __usb_send;
+	pstr_cntxt->str_in_param.__usb_send_batch = __usb_send_batch;
 	pstr_cntxt->str_in_param.__start_timer = __start_timer;
 	pstr_cntxt->str_in_param.__stop_timer = __stop_timer;
 	pstr_cntxt->str_in_param.__send_to_cloud = __send_to_cloud;
 	pstr_cntxt->str_in_param.__onUserConfirmationRequested = __onUserConfirmationRequested;
 	pstr_cntxt->str_in_param.__onUserConfirmationObtained = __onUserConfirmationObtained;
 	pstr_cntxt->str_in_param.__onGetExtendedPubKeyResult = __onGetExtendedPubKeyResult;
+	pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult = __onGetExtendedPubKeysResult;
 	pstr_cntxt->str_in_param.__onSignTransactionResult = __onSignTransactionResult;
 	pstr_cntxt->str_in_param.__onSignMessageResult = __onSignMessageResult;	
 	pstr_cntxt->str_in_param.__onGetWalletIDResult = __onGetWalletIDResult;	
@@ -3080,6 +3812,7 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 
 
 	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send 					= usb_stack_twi_usbd_send,
+	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_send_batch 			= (NULL != __usb_send_batch) ? usb_stack_twi_usbd_send_batch : NULL,
 	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_receive 				= usb_stack_twi_usbd_receive,
 	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_stop 					= usb_stack_twi_usbd_stop,
 	pstr_helpers->uni_ll_helpers.str_usb.pf_twi_usbd_dispatch 				= usb_stack_twi_usbd_dispatch,
@@ -3087,6 +3820,9 @@ void twi_usb_if_set_callbacks(	tstr_usb_if_context*            pstr_cntxt,
 	pstr_helpers->pf_twi_system_sleep_mode_forbiden = usb_stack_sleep_mode_forbiden;
 	pstr_helpers->pf_stop_timer = usb_stack_stop_timer;
 	pstr_helpers->pf_start_timer = usb_stack_start_timer;
+	pstr_helpers->pf_get_time_ms = usb_stack_get_time_ms;
+	pstr_helpers->pf_save_data = (NULL != __save) ? usb_stack_save_data : NULL;
+	pstr_helpers->pf_load_data = (NULL != __load) ? usb_stack_load_data : NULL;
 	pstr_helpers->pf_stack_sign_cb = NULL;
 	pstr_helpers->pf_stack_verify_sig_cb = NULL;
 	pstr_helpers->pf_stack_encrypt_cb = NULL;
@@ -3107,6 +3843,48 @@ void twi_usb_if_set_device_info(tstr_usb_if_context* pstr_cntxt, void* pv_dvc_in
 	pstr_cntxt->pv_device_info = pv_dvc_info;
 }
 
+/*
+ *  @function   	twi_usb_if_set_app_session
+ *	@brief			API to enable or disable the application session mode. While enabled, the coin app opened by an operation is
+ *					remembered and the next operations of the same coin type send their APDUs directly without opening the app again.
+ *					The session is dropped on disconnection, on a failed operation or when another wallet id is read.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context.
+ *	@param[IN]		b_enable: TWI_TRUE to enable the session mode.
+ */
+void twi_usb_if_set_app_session(tstr_usb_if_context* pstr_cntxt, twi_bool b_enable)
+{
+	TWI_ASSERT(NULL != pstr_cntxt);
+	pstr_cntxt->str_app_session.b_is_enabled = b_enable;
+	app_session_invalidate(pstr_cntxt);
+}
+
+/*
+ *  @function   	twi_usb_if_set_send_window
+ *	@brief			API used to set how many fragments of an APDU the stack keeps in flight at once. The window is bounded by
+ *					the batch capacity of the link layer. The fragments are queued in the link layer either way, a __usb_send_batch
+ *					callback only lets the host take them in fewer calls.
+ *	@param[IN/OUT]	pstr_cntxt: pointer to an interface context. 
+ *	@param[IN]		u8_wnd_sz: window size in fragments, 0 uses the whole batch capacity.
+ */
+void twi_usb_if_set_send_window(tstr_usb_if_context* pstr_cntxt, twi_u8 u8_wnd_sz)
+{
+	TWI_ASSERT(NULL != pstr_cntxt);
+	twi_stack_set_snd_window_size(&pstr_cntxt->str_stack_context, u8_wnd_sz);
+}
+
+/*
+ *  @function   	twi_usb_if_set_compression
+ *	@brief			API used to enable or disable compressing the APDUs sent to the device. It only applies to the devices that
+ *					advertise the compression capability in the stack specs, the other devices get the APDUs as before.
+ *	@param[IN/OUT]	pstr_cntxt: pointer to an interface context. 
+ *	@param[IN]		b_enable: TWI_TRUE to compress the APDUs that get shorter, enabled by default.
+ */
+void twi_usb_if_set_compression(tstr_usb_if_context* pstr_cntxt, twi_bool b_enable)
+{
+	TWI_ASSERT(NULL != pstr_cntxt);
+	twi_stack_set_compression(&pstr_cntxt->str_stack_context, b_enable);
+}
+
 /*
  *  @function   	twi_usb_if_set_device_id
  *	@brief			API used to set the connected device id in the passed interface context.
@@ -3121,6 +3899,93 @@ void twi_usb_if_set_device_id(tstr_usb_if_context* pstr_cntxt, twi_u16 u16_vid,
 	pstr_cntxt->u16_vid = u16_vid;
 }
 
+/*
+ *  @function   	twi_usb_if_set_clock
+ *	@brief			API used to set the monotonic millisecond clock. It measures how long operations wait before they start and the APDU response times,
+ *					and it runs the stack timers.
+ *	@param[IN/OUT]	pstr_cntxt: pointer to an interface context. 
+ *					It is mandatory and set before @ref twi_usb_if_set_callbacks.
+ *	@param[IN]		__get_time_ms: clock callback.
+ */
+void twi_usb_if_set_clock(tstr_usb_if_context* pstr_cntxt, usb_get_time_ms __get_time_ms)
+{
+	TWI_ASSERT((NULL != pstr_cntxt) && (NULL != pstr_cntxt->pv_op_queue) && (NULL != __get_time_ms));
+	((tstr_usb_op_queue*)pstr_cntxt->pv_op_queue)->__get_time_ms = __get_time_ms;
+}
+
+/*
+ *  @function   	twi_usb_if_get_next_timeout
+ *	@brief			API used to get when the earliest stack timer expires, so the host can sleep till then instead of polling.
+ *					@ref twi_usb_if_dispatch shall be called once that time has passed, it fires the expired timers.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context. 
+ *	@param[OUT]		pu32_timeout_ms: time left till the earliest expiry, 0 if it is already due.
+ *	@return    		::TWI_TRUE if a timer is armed.
+ */
+twi_bool twi_usb_if_get_next_timeout(tstr_usb_if_context* pstr_cntxt, twi_u32* pu32_timeout_ms)
+{
+	TWI_ASSERT((NULL != pstr_cntxt) && (NULL != pstr_cntxt->pv_op_queue) && (NULL != pu32_timeout_ms));
+	return twi_timer_wheel_get_next_timeout(&pstr_cntxt->str_timer_wheel, usb_stack_get_time_ms((void*)pstr_cntxt), pu32_timeout_ms);
+}
+
+/*
+ *  @function   	twi_usb_if_get_op_queue_stats
+ *	@brief			API used to read the operation queue statistics. Operations submitted while another one is running wait in the queue,
+ *					signing operations start before the xpub ones and batch xpub requests start last.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context. 
+ *	@param[OUT]		pu8_depth: number of operations waiting now.
+ *	@param[OUT]		pu8_max_depth: highest number of waiting operations seen.
+ *	@param[OUT]		pu32_last_wait_ms: time the last started operation spent in the queue.
+ *	@param[OUT]		pu32_max_wait_ms: longest time an operation spent in the queue.
+ */
+void twi_usb_if_get_op_queue_stats(tstr_usb_if_context* pstr_cntxt, twi_u8* pu8_depth, twi_u8* pu8_max_depth, twi_u32* pu32_last_wait_ms, twi_u32* pu32_max_wait_ms)
+{
+	TWI_ASSERT((NULL != pstr_cntxt) && (NULL != pstr_cntxt->pv_op_queue) && (NULL != pu8_depth) && (NULL != pu8_max_depth)
+				&& (NULL != pu32_last_wait_ms) && (NULL != pu32_max_wait_ms));
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+
+	*pu8_depth = pstr_queue->u8_ops_num;
+	*pu8_max_depth = pstr_queue->u8_max_ops_num;
+	*pu32_last_wait_ms = pstr_queue->u32_last_wait_ms;
+	*pu32_max_wait_ms = pstr_queue->u32_max_wait_ms;
+}
+
+/*
+ *  @function   	twi_usb_if_get_apdu_timeout
+ *	@brief			API used to read the APDU response timeout derived from the measured APDU response times of the wallet
+ *					( smoothed response time plus four times its variance ). The awaited response fails the operation with
+ *					USB_IF_ERR_SEND_TIMEOUT after USB_WALLET_APDU_TIMEOUT_RTOS of them, and each expiry doubles it.
+ *					It's not applied while the wallet waits for the user confirmation.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context.
+ *	@param[OUT]		pu32_srtt_ms: smoothed APDU response time, 0 till the first response is timed.
+ *	@return			The APDU response timeout in milliseconds.
+ */
+twi_u32 twi_usb_if_get_apdu_timeout(tstr_usb_if_context* pstr_cntxt, twi_u32* pu32_srtt_ms)
+{
+	TWI_ASSERT(NULL != pstr_cntxt);
+
+	if(NULL != pu32_srtt_ms)
+	{
+		*pu32_srtt_ms = pstr_cntxt->str_apdu_rtt.u32_srtt_x8 >> 3;
+	}
+	return twi_rtt_get_rto(&pstr_cntxt->str_apdu_rtt);
+}
+
+/*
+ *  @function   	twi_usb_if_get_stats
+ *	@brief			API used to copy the statistics of the context in one call: the link layer and network layer counters and send times,
+ *					the APDUs sent and answered with their response times, and per state event the time the running operation waited for it.
+ *					The times are only measured once a clock is set by @ref twi_usb_if_set_clock, every histogram has log2 buckets in milliseconds.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context.
+ *	@param[OUT]		pstr_stats: pointer to the statistics.
+ */
+void twi_usb_if_get_stats(tstr_usb_if_context* pstr_cntxt, tstr_usb_if_stats* pstr_stats)
+{
+	TWI_ASSERT((NULL != pstr_cntxt) && (NULL != pstr_stats));
+
+	TWI_MEMCPY(pstr_stats, &pstr_cntxt->str_stats, sizeof(tstr_usb_if_stats));
+	twi_stack_get_stats(&pstr_cntxt->str_stack_context, &pstr_stats->str_nl, &pstr_stats->str_ll);
+}
+
 /*
  *  @function   	twi_usb_if_free
  *	@brief			API used to free pre-allocated interface context.
@@ -3129,6 +3994,16 @@ void twi_usb_if_set_device_id(tstr_usb_if_context* pstr_cntxt, twi_u16 u16_vid,
 void twi_usb_if_free(tstr_usb_if_context* pstr_cntxt)
 {
 	TWI_ASSERT(NULL != pstr_cntxt);
+	tstr_usb_op_queue* pstr_queue = (tstr_usb_op_queue*)pstr_cntxt->pv_op_queue;
+	twi_u8 u8_idx;
+
+	/* the pending operations are dropped without their callbacks */
+	for(u8_idx = 0; (NULL != pstr_queue) && (u8_idx < pstr_queue->u8_ops_num); u8_idx++)
+	{
+		free(pstr_queue->astr_ops[u8_idx].pv);
+	}
+	free(pstr_queue);
+	free(pstr_cntxt->str_cur_op.pv);
 	free(pstr_cntxt);
 }
 
@@ -3148,104 +4023,82 @@ void twi_usb_if_get_ext_pub_key(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_co
 	if((NULL != pstr_cntxt) && (NULL != pstr_path) && (NULL != pstr_cntxt->str_in_param.__usb_send)
 		&& (USB_WALLET_PATH_MAX_STEPS >= pstr_path->u8_steps_num) && (enu_coin_type < USB_WALLET_COIN_INVALID))
 	{
-		/* cntxt idle operation check */
 		TWI_LOGGER("twi_usb_if_get_ext_pub_key:: pstr_cntxt->str_cur_op.enu_cur_state = %d, pstr_cntxt->str_cur_op.enu_cur_op = %d\r\n", pstr_cntxt->str_cur_op.enu_cur_state, pstr_cntxt->str_cur_op.enu_cur_op);
-		if((USB_WALLET_STATE_INVALID == pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_APP_IDLE_OP == pstr_cntxt->str_cur_op.enu_cur_op))
-		{
-			if(TWI_FALSE == b_disconnect)
-			{
-				pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_TRUE;
-			}
-
-			if((enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN) || (enu_coin_type == USB_WALLET_COIN_BITCOIN))
-			{
-				if(pstr_path->u8_steps_num == 0)
-				{
-					twi_u32 au32_path[] = {0x8000002C, 0x80000000};
-					
-					if(enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN)
-					{
-						au32_path[1] = 0x80000001;
-					}
-
-					pstr_path->u8_steps_num = sizeof(au32_path)/sizeof(twi_u32);	
-					TWI_MEMCPY(pstr_path->au32_path_steps, au32_path, sizeof(au32_path));
-				}
-				else if(pstr_path->u8_steps_num == 1)
-				{
-					twi_u32 au32_path[] = {0x8000002C, 0x80000000, 0x00000000};
-
-					if(enu_coin_type == USB_WALLET_COIN_TEST_BITCOIN)
-					{
-						au32_path[1] = 0x80000001;
-					}	
 
-					au32_path[2] = pstr_path->au32_path_steps[0];
-					pstr_path->u8_steps_num = sizeof(au32_path)/sizeof(twi_u32);	
-					TWI_MEMCPY(pstr_path->au32_path_steps, au32_path, sizeof(au32_path));
-				}
-				else
-				{
-					/* do nothing */
-				}	
-			}
-			else
-			{
-				/* do nothing */
-			}
+		crypto_path_complete(enu_coin_type, pstr_path);
 
+		/* preparing the operation info, the operation starts now or when the running ones are done */
+		tstr_usb_get_extended_pubkey_info* pstr_get_extended_pubkey_info = calloc(1, sizeof(tstr_usb_get_extended_pubkey_info));
+		TWI_ASSERT(NULL != pstr_get_extended_pubkey_info);
+		TWI_MEMCPY(&pstr_get_extended_pubkey_info->str_path, pstr_path, sizeof(tstr_usb_crypto_path));
 
-			/* updating cntxt current app operation */
-			tstr_usb_get_extended_pubkey_info* pstr_get_extended_pubkey_info = calloc(1, sizeof(tstr_usb_get_extended_pubkey_info));
-			TWI_MEMCPY(&pstr_get_extended_pubkey_info->str_path, pstr_path, sizeof(tstr_usb_crypto_path));
+		if(TWI_SUCCESS != operation_submit(pstr_cntxt, (twi_u32)USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP, enu_coin_type, (void*)pstr_get_extended_pubkey_info, pu8_wallet_id, u8_wallet_id_len, b_disconnect))
+		{
+			free(pstr_get_extended_pubkey_info);
+			pstr_cntxt->str_in_param.__onGetExtendedPubKeyResult(pstr_cntxt->pv_device_info, NULL, 0, (twi_s32)USB_IF_ERR_INVALID_STATE);	
+		}
+	}
+	else
+	{
+		pstr_cntxt->str_in_param.__onGetExtendedPubKeyResult(pstr_cntxt->pv_device_info, NULL, 0, (twi_s32)USB_IF_ERR_INVALID_ARGS);
+	}
+}
 
-			pstr_cntxt->str_cur_op.enu_cur_op = USB_WALLET_APP_GET_EXTENDED_PUBKEY_OP;
-			pstr_cntxt->str_cur_op.enu_coin_type = enu_coin_type;
-			pstr_cntxt->str_cur_op.pv = (void*)pstr_get_extended_pubkey_info;
+/*
+ *  @function   	twi_usb_if_get_ext_pub_keys
+ *	@brief			API to get the extended public keys of several paths in one operation. The app is opened once and the
+ *					GET_EXTENDED_PUBKEY APDUs are sent back to back. The keys are reported in one __onGetExtendedPubKeysResult
+ *					callback as consecutive [pubkey length (1 byte)][pubkey] records in the paths order. On failure the records
+ *					of the paths done so far are still reported with the error.
+ *	@param[IN]		pstr_cntxt: pointer to an interface context.
+ *	@param[IN]		enu_coin_type: coin type.  
+ *	@param[IN]		pastr_paths: pointer to the paths array.
+ *	@param[IN]		u8_paths_num: number of paths, up to USB_WALLET_XPUB_BATCH_MAX_PATHS.
+ *	@param[IN]		pu8_wallet_id: pointer to wallet id to verify with.
+ *	@param[IN]		u8_wallet_id_len: lenght of the wallet id to verify with.
+ * 	@param[IN]		b_disconnect: boolen to decide if we gonna disconnect after finishing the operation or not.  
+ */
+void twi_usb_if_get_ext_pub_keys(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, tstr_usb_crypto_path* const pastr_paths, twi_u8 u8_paths_num, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect)
+{
+	twi_u8 u8_path_idx;
+	twi_bool b_paths_valid = ((NULL != pastr_paths) && (0 != u8_paths_num) && (USB_WALLET_XPUB_BATCH_MAX_PATHS >= u8_paths_num));
 
-			TWI_MEMCPY(pstr_cntxt->str_cur_op.au8_verify_id, pu8_wallet_id, u8_wallet_id_len);
-			pstr_cntxt->str_cur_op.u8_verify_id_len = u8_wallet_id_len;
+	for(u8_path_idx = 0; (TWI_TRUE == b_paths_valid) && (u8_path_idx < u8_paths_num); u8_path_idx++)
+	{
+		b_paths_valid = (USB_WALLET_PATH_MAX_STEPS >= pastr_paths[u8_path_idx].u8_steps_num);
+	}
 
-			twi_bool b_is_ready = TWI_FALSE;
-			twi_stack_is_ready_to_send(&pstr_cntxt->str_stack_context, &b_is_ready);
+	/* arguments check */
+	if((NULL != pstr_cntxt) && (TWI_TRUE == b_paths_valid) && (NULL != pstr_cntxt->str_in_param.__usb_send)
+		&& (NULL != pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult) && (enu_coin_type < USB_WALLET_COIN_INVALID))
+	{
+		TWI_LOGGER("twi_usb_if_get_ext_pub_keys:: pstr_cntxt->str_cur_op.enu_cur_state = %d, pstr_cntxt->str_cur_op.enu_cur_op = %d\r\n", pstr_cntxt->str_cur_op.enu_cur_state, pstr_cntxt->str_cur_op.enu_cur_op);
 
-			if(TWI_TRUE == b_is_ready)
-			{
-				if(NULL != pu8_wallet_id)
-				{
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-				else
-				{
-					//skip wallet ID verification
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-			}
-			else
-			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_WAITING_TO_CONNECT;
-				/* Start Scanning and connect */	
-				TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_scan_and_connect);
-				pstr_cntxt->str_in_param.__usb_scan_and_connect(pstr_cntxt->pv_device_info, &pstr_cntxt->str_cur_op.au8_verify_id[DVC_ID_IDX], (twi_u8)DVC_ID_LEN, pstr_cntxt->u16_vid, pstr_cntxt->u16_pid, (twi_u32)USB_SCAN_DURATION_MS, 0);
+		/* preparing the operation info, the operation starts now or when the running ones are done */
+		tstr_usb_get_extended_pubkeys_info* pstr_get_extended_pubkeys_info = calloc(1, sizeof(tstr_usb_get_extended_pubkeys_info));
+		TWI_ASSERT(NULL != pstr_get_extended_pubkeys_info);
 
-			}
+		for(u8_path_idx = 0; u8_path_idx < u8_paths_num; u8_path_idx++)
+		{
+			TWI_MEMCPY(&pstr_get_extended_pubkeys_info->astr_paths[u8_path_idx], &pastr_paths[u8_path_idx], sizeof(tstr_usb_crypto_path));
+			crypto_path_complete(enu_coin_type, &pstr_get_extended_pubkeys_info->astr_paths[u8_path_idx]);
 		}
-		else
+		pstr_get_extended_pubkeys_info->u8_paths_num = u8_paths_num;
+		TWI_MEMCPY(&pstr_get_extended_pubkeys_info->str_cur_pubkey.str_path, &pstr_get_extended_pubkeys_info->astr_paths[0], sizeof(tstr_usb_crypto_path));
+
+		if(TWI_SUCCESS != operation_submit(pstr_cntxt, (twi_u32)USB_WALLET_APP_GET_EXTENDED_PUBKEY_BATCH_OP, enu_coin_type, (void*)pstr_get_extended_pubkeys_info, pu8_wallet_id, u8_wallet_id_len, b_disconnect))
 		{
-			pstr_cntxt->str_in_param.__onGetExtendedPubKeyResult(pstr_cntxt->pv_device_info, NULL, 0, (twi_s32)USB_IF_ERR_INVALID_STATE);	
+			free(pstr_get_extended_pubkeys_info);
+			pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult(pstr_cntxt->pv_device_info, NULL, 0, 0, (twi_s32)USB_IF_ERR_INVALID_STATE);	
 		}
 	}
+	else if((NULL != pstr_cntxt) && (NULL != pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult))
+	{
+		pstr_cntxt->str_in_param.__onGetExtendedPubKeysResult(pstr_cntxt->pv_device_info, NULL, 0, 0, (twi_s32)USB_IF_ERR_INVALID_ARGS);
+	}
 	else
 	{
-		pstr_cntxt->str_in_param.__onGetExtendedPubKeyResult(pstr_cntxt->pv_device_info, NULL, 0, (twi_s32)USB_IF_ERR_INVALID_ARGS);
+		/* no callback to report the error to */
 	}
 }
 
@@ -3261,87 +4114,48 @@ void twi_usb_if_get_ext_pub_key(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_co
  */
 void twi_usb_if_sign_tx(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type enu_coin_type, void* const pstr_tx, twi_u8* pu8_wallet_id, twi_u8 u8_wallet_id_len, twi_bool b_disconnect)
 {
-	/* arguments check */
-	if((NULL != pstr_cntxt) && (NULL != pstr_tx) && (NULL != pstr_cntxt->str_in_param.__usb_send)&& (enu_coin_type < USB_WALLET_COIN_INVALID))
+	/* arguments check, a transaction whose commands overflow the command input buffer can't be sent */
+	if((NULL != pstr_cntxt) && (NULL != pstr_tx) && (NULL != pstr_cntxt->str_in_param.__usb_send)&& (enu_coin_type < USB_WALLET_COIN_INVALID) &&
+	   (TWI_TRUE == sign_tx_fits(enu_coin_type, pstr_tx)))
 	{
-		/* cntxt idle operation check */
-		if((USB_WALLET_STATE_INVALID == pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_APP_IDLE_OP == pstr_cntxt->str_cur_op.enu_cur_op))
+		/* preparing the operation info, the operation starts now or when the running ones are done */
+		tstr_usb_sign_tx_info* pstr_sign_tx_info = calloc(1, sizeof(tstr_usb_sign_tx_info));
+		TWI_ASSERT(NULL != pstr_sign_tx_info);
+
+		switch (enu_coin_type)
 		{
-			if(TWI_FALSE == b_disconnect)
+			case USB_WALLET_COIN_BITCOIN:
+			case USB_WALLET_COIN_TEST_BITCOIN:
 			{
-				pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_TRUE;
+				TWI_MEMCPY(&pstr_sign_tx_info->uni_sign_tx_info.str_bitcoin_sign_tx.str_tx_info, pstr_tx, sizeof(tstr_usb_bitcoin_tx));
+				break;
 			}
-			/* updating cntxt current app operation */
-			pstr_cntxt->str_cur_op.enu_cur_op = USB_WALLET_APP_SIGN_TX_OP;
-			pstr_cntxt->str_cur_op.enu_coin_type = enu_coin_type;
-
-			tstr_usb_sign_tx_info* pstr_sign_tx_info = calloc(1, sizeof(tstr_usb_sign_tx_info));
 
-			switch (pstr_cntxt->str_cur_op.enu_coin_type)
+			case USB_WALLET_COIN_ETHEREUM:
+			case USB_WALLET_COIN_TEST_ETHEREUM:
 			{
-				case USB_WALLET_COIN_BITCOIN:
-				case USB_WALLET_COIN_TEST_BITCOIN:
-				{
-					TWI_MEMCPY(&pstr_sign_tx_info->uni_sign_tx_info.str_bitcoin_sign_tx.str_tx_info, pstr_tx, sizeof(tstr_usb_bitcoin_tx));
-					break;
-				}
-
-				case USB_WALLET_COIN_ETHEREUM:
-				case USB_WALLET_COIN_TEST_ETHEREUM:
-				{
-					TWI_MEMCPY(&pstr_sign_tx_info->uni_sign_tx_info.str_ethereum_sign_tx.str_tx_info, pstr_tx, sizeof(tstr_usb_ethereum_tx));
-					break;
-				}
-
-				default:
-					break;
-			}	
-
-			pstr_cntxt->str_cur_op.pv = (void*)pstr_sign_tx_info;
-
-			TWI_MEMCPY(pstr_cntxt->str_cur_op.au8_verify_id, pu8_wallet_id, u8_wallet_id_len);
-			pstr_cntxt->str_cur_op.u8_verify_id_len = u8_wallet_id_len;
+				TWI_MEMCPY(&pstr_sign_tx_info->uni_sign_tx_info.str_ethereum_sign_tx.str_tx_info, pstr_tx, sizeof(tstr_usb_ethereum_tx));
+				break;
+			}
 
-			twi_bool b_is_ready = TWI_FALSE;
-			twi_stack_is_ready_to_send(&pstr_cntxt->str_stack_context, &b_is_ready);
+			default:
+				break;
+		}	
 
-			if(TWI_TRUE == b_is_ready)
-			{
-				if(NULL != pu8_wallet_id)
-				{
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-				else
-				{
-					//skip wallet ID verification
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-			}
-			else
-			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_WAITING_TO_CONNECT;
-				/* Start Scanning and connect */	
-				TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_scan_and_connect);
-				pstr_cntxt->str_in_param.__usb_scan_and_connect(pstr_cntxt->pv_device_info, &pstr_cntxt->str_cur_op.au8_verify_id[DVC_ID_IDX], (twi_u8)DVC_ID_LEN, pstr_cntxt->u16_vid, pstr_cntxt->u16_pid, (twi_u32)USB_SCAN_DURATION_MS, 0);
-			}
-		}
-		else
+		if(TWI_SUCCESS != operation_submit(pstr_cntxt, (twi_u32)USB_WALLET_APP_SIGN_TX_OP, enu_coin_type, (void*)pstr_sign_tx_info, pu8_wallet_id, u8_wallet_id_len, b_disconnect))
 		{
+			free(pstr_sign_tx_info);
 			pstr_cntxt->str_in_param.__onSignTransactionResult(pstr_cntxt->pv_device_info, NULL, (twi_s32)USB_IF_ERR_INVALID_STATE);	
 		}
 	}
-	else
+	else if((NULL != pstr_cntxt) && (NULL != pstr_cntxt->str_in_param.__onSignTransactionResult))
 	{
 		pstr_cntxt->str_in_param.__onSignTransactionResult(pstr_cntxt->pv_device_info, NULL, (twi_s32)USB_IF_ERR_INVALID_ARGS);
 	}
+	else
+	{
+		/* no callback to report the error to */
+	}
 }
 
 /*
@@ -3360,79 +4174,33 @@ void twi_usb_if_sign_msg(tstr_usb_if_context* pstr_cntxt, tenu_twi_usb_coin_type
 	if((NULL != pstr_cntxt) && (NULL != pstr_msg) && (NULL != pstr_cntxt->str_in_param.__usb_send)
 		 && (enu_coin_type < USB_WALLET_COIN_INVALID))
 	{
-		/* cntxt idle operation check */
-		if((USB_WALLET_STATE_INVALID == pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_APP_IDLE_OP == pstr_cntxt->str_cur_op.enu_cur_op))
+		/* preparing the operation info, the operation starts now or when the running ones are done */
+		tstr_usb_sign_msg_info* pstr_sign_msg_info = calloc(1, sizeof(tstr_usb_sign_msg_info));
+		TWI_ASSERT(NULL != pstr_sign_msg_info);
+
+		switch (enu_coin_type)
 		{
-			if(TWI_FALSE == b_disconnect)
+			case USB_WALLET_COIN_BITCOIN:
+			case USB_WALLET_COIN_TEST_BITCOIN:
 			{
-				pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_TRUE;
+				TWI_MEMCPY(&pstr_sign_msg_info->uni_sign_msg_info.str_bitcoin_sign_msg.str_msg_info, pstr_msg, sizeof(tstr_usb_bitcoin_msg));
+				break;
 			}
-			/* updating cntxt current app operation */
-			pstr_cntxt->str_cur_op.enu_cur_op = USB_WALLET_APP_SIGN_MSG_OP;
-			pstr_cntxt->str_cur_op.enu_coin_type = enu_coin_type;
 
-			tstr_usb_sign_msg_info* pstr_sign_msg_info = calloc(1, sizeof(tstr_usb_sign_msg_info));
-
-			TWI_MEMSET(pstr_sign_msg_info, 0x0, sizeof(tstr_usb_sign_msg_info));
-
-			switch (pstr_cntxt->str_cur_op.enu_coin_type)
+			case USB_WALLET_COIN_ETHEREUM:
+			case USB_WALLET_COIN_TEST_ETHEREUM:
 			{
-				case USB_WALLET_COIN_BITCOIN:
-				case USB_WALLET_COIN_TEST_BITCOIN:
-				{
-					TWI_MEMCPY(&pstr_sign_msg_info->uni_sign_msg_info.str_bitcoin_sign_msg.str_msg_info, pstr_msg, sizeof(tstr_usb_bitcoin_msg));
-					break;
-				}
-
-				case USB_WALLET_COIN_ETHEREUM:
-				case USB_WALLET_COIN_TEST_ETHEREUM:
-				{
-					TWI_MEMCPY(&pstr_sign_msg_info->uni_sign_msg_info.str_ethereum_sign_msg.str_msg_info, pstr_msg, sizeof(tstr_usb_ethereum_msg));
-					break;
-				}
-
-				default:
-					break;
-			}	
-
-			pstr_cntxt->str_cur_op.pv = (void*)pstr_sign_msg_info;
-
-			TWI_MEMCPY(pstr_cntxt->str_cur_op.au8_verify_id, pu8_wallet_id, u8_wallet_id_len);
-			pstr_cntxt->str_cur_op.u8_verify_id_len = u8_wallet_id_len;
+				TWI_MEMCPY(&pstr_sign_msg_info->uni_sign_msg_info.str_ethereum_sign_msg.str_msg_info, pstr_msg, sizeof(tstr_usb_ethereum_msg));
+				break;
+			}
 
-			twi_bool b_is_ready = TWI_FALSE;
-			twi_stack_is_ready_to_send(&pstr_cntxt->str_stack_context, &b_is_ready);
+			default:
+				break;
+		}	
 
-			if(TWI_TRUE == b_is_ready)
-			{
-				if(NULL != pu8_wallet_id)
-				{
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-				else
-				{
-					//skip wallet ID verification
-					pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_REQUEST_OPEN_APP;
-					if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_REQUEST_OPEN_APP_CMD))
-					{
-						current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-					}
-				}
-			}
-			else
-			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_WAITING_TO_CONNECT;
-				/* Start Scanning and connect */	
-				TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_scan_and_connect);
-				pstr_cntxt->str_in_param.__usb_scan_and_connect(pstr_cntxt->pv_device_info, &pstr_cntxt->str_cur_op.au8_verify_id[DVC_ID_IDX], (twi_u8)DVC_ID_LEN, pstr_cntxt->u16_vid, pstr_cntxt->u16_pid, (twi_u32)USB_SCAN_DURATION_MS, 0);
-			}
-		}
-		else
+		if(TWI_SUCCESS != operation_submit(pstr_cntxt, (twi_u32)USB_WALLET_APP_SIGN_MSG_OP, enu_coin_type, (void*)pstr_sign_msg_info, pu8_wallet_id, u8_wallet_id_len, b_disconnect))
 		{
+			free(pstr_sign_msg_info);
 			pstr_cntxt->str_in_param.__onSignMessageResult(pstr_cntxt->pv_device_info, NULL, (twi_s32)USB_IF_ERR_INVALID_STATE);	
 		}
 	}
@@ -3453,40 +4221,13 @@ void twi_usb_if_get_wallet_id(tstr_usb_if_context* pstr_cntxt, twi_bool b_discon
 	/* arguments check */
 	if((NULL != pstr_cntxt) && (NULL != pstr_cntxt->str_in_param.__usb_send))
 	{
-		/* cntxt idle operation check */
-		if((USB_WALLET_STATE_INVALID == pstr_cntxt->str_cur_op.enu_cur_state) && (USB_WALLET_APP_IDLE_OP == pstr_cntxt->str_cur_op.enu_cur_op))
-		{
-			if(TWI_FALSE == b_disconnect)
-			{
-				pstr_cntxt->str_cur_op.b_skip_disconnection = TWI_TRUE;
-			}
-			/* updating cntxt current app operation */
-			pstr_cntxt->str_cur_op.enu_cur_op = USB_WALLET_APP_GET_ID_OP;
-
-			tstr_usb_get_wallet_id_info* pstr_get_wallet_id_info = calloc(1, sizeof(tstr_usb_get_wallet_id_info));
-			pstr_cntxt->str_cur_op.pv = pstr_get_wallet_id_info;
+		/* preparing the operation info, the operation starts now or when the running ones are done */
+		tstr_usb_get_wallet_id_info* pstr_get_wallet_id_info = calloc(1, sizeof(tstr_usb_get_wallet_id_info));
+		TWI_ASSERT(NULL != pstr_get_wallet_id_info);
 
-			twi_bool b_is_ready = TWI_FALSE;
-			twi_stack_is_ready_to_send(&pstr_cntxt->str_stack_context, &b_is_ready);
-
-			if(TWI_TRUE == b_is_ready)
-			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_GET_ID;
-				if(TWI_SUCCESS != apdu_cmd_send(pstr_cntxt, USB_WALLET_APDU_GET_WALLET_ID_CMD))
-				{
-					current_operation_finalize(pstr_cntxt, NULL, 0, (twi_s32)USB_IF_ERR_SEND_FAIL, TWI_FALSE);
-				}
-			}
-			else
-			{
-				pstr_cntxt->str_cur_op.enu_cur_state = USB_WALLET_STATE_WAITING_TO_CONNECT;
-				/* Start Scanning and connect */	
-				TWI_ASSERT(NULL != pstr_cntxt->str_in_param.__usb_scan_and_connect);
-				pstr_cntxt->str_in_param.__usb_scan_and_connect(pstr_cntxt->pv_device_info, &pstr_cntxt->str_cur_op.au8_verify_id[DVC_ID_IDX], (twi_u8)DVC_ID_LEN, pstr_cntxt->u16_vid, pstr_cntxt->u16_pid, (twi_u32)USB_SCAN_DURATION_MS, 0);
-			}
-		}
-		else
+		if(TWI_SUCCESS != operation_submit(pstr_cntxt, (twi_u32)USB_WALLET_APP_GET_ID_OP, USB_WALLET_COIN_INVALID, (void*)pstr_get_wallet_id_info, NULL, 0, b_disconnect))
 		{
+			free(pstr_get_wallet_id_info);
 			pstr_cntxt->str_in_param.__onGetWalletIDResult(pstr_cntxt->pv_device_info, NULL, 0, (twi_s32)USB_IF_ERR_INVALID_STATE);	
 		}
 	}
@@ -3535,6 +4276,7 @@ void twi_usb_if_notify_disconnected(tstr_usb_if_context* pstr_cntxt, twi_u8 u8_r
 	{
 		tstr_twi_usb_evt str_usb_evt;
 		TWI_MEMSET(&str_usb_evt, 0x0, sizeof(tstr_twi_usb_evt));
+		app_session_invalidate(pstr_cntxt);
 		op_state_update(pstr_cntxt, USB_WALLET_OP_STATE_DISCONNECTION_EVENT , NULL);
 		str_usb_evt.enu_usbd_evt = TWI_USBD_PORT_CLOSE;
 		twi_stack_handle_usb_evt(&pstr_cntxt->str_stack_context, &str_usb_evt);
@@ -3625,6 +4367,12 @@ void twi_usb_if_notify_data_received(tstr_usb_if_context* pstr_cntxt, twi_u8* pu
 void* twi_usb_if_dispatch(void* arg)
 {
 	tstr_usb_if_context* pstr_cntxt = (tstr_usb_if_context*)arg;
+
+	/* the stack timers are due whether the stack is idle or not */
+	if(NULL != pstr_cntxt)
+	{
+		usb_timers_run(pstr_cntxt);
+	}
 #if !defined (FIRMWARE_TARGET) && !defined(WIN32)
 	if (TWI_FALSE == twi_stack_is_idle(&pstr_cntxt->str_stack_context))
 #endif	
@@ -3644,7 +4392,8 @@ void* twi_usb_if_dispatch(void* arg)
 			}	
 		}
 
-		if(NULL != pstr_cntxt)
+		/* the port is closing, like the send status the stack sends wait for the disconnection to reset it */
+		if((NULL != pstr_cntxt) && (USB_WALLET_STATE_WAITING_TO_DISCONNECT != pstr_cntxt->str_cur_op.enu_cur_state))
 		{	
 			twi_stack_dispatcher(&pstr_cntxt->str_stack_context);
 		}
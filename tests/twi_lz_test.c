@@ -0,0 +1,197 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_lz_test.c
+@brief		Unit tests of the LZ codec: round trips, incompressible data, output bounds and malformed input.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include <stdio.h>
+#include "twi_common.h"
+#include "twi_lz.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define TEST_BUF_SZ				(4200)
+
+#define TEST_CHECK(COND)		do{																\
+									if(!(COND))													\
+									{															\
+										printf("FAILED %s:%d: %s\r\n", __FUNCTION__, __LINE__, #COND);	\
+										gu32_failures_cnt++;									\
+									}															\
+								}while(0)
+
+//***********************************************************
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+//***********************************************************
+static twi_u32 gu32_failures_cnt = 0;
+static twi_u8 gau8_src[TEST_BUF_SZ];
+static twi_u8 gau8_lz[TEST_BUF_SZ + (TEST_BUF_SZ / 8) + 1];
+static twi_u8 gau8_out[TEST_BUF_SZ];
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+static twi_u32 test_rand(twi_u32* pu32_seed)
+{
+	*pu32_seed = (*pu32_seed * 1103515245UL) + 12345UL;
+	return (*pu32_seed >> 16) & 0x7FFF;
+}
+
+/* Compresses and decompresses pu8_src , returns the compressed length. */
+static twi_u16 test_round_trip(const twi_u8* pu8_src, twi_u16 u16_len)
+{
+	twi_u16 u16_lz_len;
+	twi_u16 u16_out_len;
+
+	u16_lz_len = twi_lz_compress(pu8_src, u16_len, gau8_lz, sizeof(gau8_lz));
+	TEST_CHECK(0 != u16_lz_len);
+	u16_out_len = twi_lz_decompress(gau8_lz, u16_lz_len, gau8_out, sizeof(gau8_out));
+	TEST_CHECK(u16_len == u16_out_len);
+	TEST_CHECK(0 == TWI_MEMCMP(pu8_src, gau8_out, u16_len));
+	return u16_lz_len;
+}
+
+static void test_zero_runs(void)
+{
+	twi_u16 u16_lz_len;
+
+	TWI_MEMSET(gau8_src, 0, sizeof(gau8_src));
+	u16_lz_len = test_round_trip(gau8_src, 1000);
+	/* Long matches use the extension byte , 1000 zeros take a handful of items */
+	TEST_CHECK(u16_lz_len < 40);
+}
+
+static void test_repeated_selectors(void)
+{
+	/* ERC-20 transfer calls back to back , the shape the security layer compresses */
+	static const twi_u8 au8_call[] = {0xA9, 0x05, 0x9C, 0xBB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+										0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+	twi_u16 u16_len = 0;
+	twi_u16 u16_lz_len;
+
+	while((u16_len + sizeof(au8_call)) <= 640)
+	{
+		TWI_MEMCPY(&gau8_src[u16_len], au8_call, sizeof(au8_call));
+		gau8_src[u16_len + sizeof(au8_call) - 1] = (twi_u8)u16_len;
+		u16_len += sizeof(au8_call);
+	}
+	u16_lz_len = test_round_trip(gau8_src, u16_len);
+	TEST_CHECK(u16_lz_len < (u16_len / 4));
+}
+
+static void test_short_inputs(void)
+{
+	twi_u16 u16_len;
+
+	for(u16_len = 1; u16_len <= 16; u16_len++)
+	{
+		TWI_MEMSET(gau8_src, 'a', u16_len);
+		test_round_trip(gau8_src, u16_len);
+	}
+	TEST_CHECK(0 == twi_lz_compress(gau8_src, 0, gau8_lz, sizeof(gau8_lz)));
+}
+
+static void test_random_data(void)
+{
+	twi_u32 u32_seed = 7;
+	twi_u16 u16_idx;
+
+	for(u16_idx = 0; u16_idx < TEST_BUF_SZ; u16_idx++)
+	{
+		gau8_src[u16_idx] = (twi_u8)test_rand(&u32_seed);
+	}
+	/* Incompressible data grows by the flags bytes only */
+	TEST_CHECK(test_round_trip(gau8_src, TEST_BUF_SZ) <= (TEST_BUF_SZ + CEIL(TEST_BUF_SZ, 8)));
+}
+
+static void test_far_matches(void)
+{
+	twi_u32 u32_seed = 99;
+	twi_u16 u16_idx;
+
+	/* The same block again past the window and within it */
+	for(u16_idx = 0; u16_idx < 512; u16_idx++)
+	{
+		gau8_src[u16_idx] = (twi_u8)test_rand(&u32_seed);
+	}
+	TWI_MEMSET(&gau8_src[512], 0x5A, 3584);
+	TWI_MEMCPY(&gau8_src[4096], gau8_src, 104);
+	test_round_trip(gau8_src, 4200);
+}
+
+static void test_dst_bounds(void)
+{
+	twi_u16 u16_lz_len;
+	twi_u16 u16_cap;
+
+	TWI_MEMSET(gau8_src, 0, 300);
+	u16_lz_len = twi_lz_compress(gau8_src, 300, gau8_lz, sizeof(gau8_lz));
+	TEST_CHECK(0 != u16_lz_len);
+
+	/* A compressed buffer too small for the output is refused , never overrun */
+	for(u16_cap = 0; u16_cap < u16_lz_len; u16_cap++)
+	{
+		TWI_MEMSET(gau8_lz, 0xEE, sizeof(gau8_lz));
+		TEST_CHECK(0 == twi_lz_compress(gau8_src, 300, gau8_lz, u16_cap));
+		TEST_CHECK(0xEE == gau8_lz[u16_cap]);
+	}
+
+	/* So is a data buffer too small for the decompressed output */
+	u16_lz_len = twi_lz_compress(gau8_src, 300, gau8_lz, sizeof(gau8_lz));
+	TWI_MEMSET(gau8_out, 0xEE, sizeof(gau8_out));
+	TEST_CHECK(0 == twi_lz_decompress(gau8_lz, u16_lz_len, gau8_out, 299));
+	TEST_CHECK(0xEE == gau8_out[299]);
+}
+
+static void test_malformed_input(void)
+{
+	/* A match before the start of the output */
+	static const twi_u8 au8_far_match[] = {0x01, 0x01, 0x00};
+	/* A match cut after its first byte */
+	static const twi_u8 au8_cut_match[] = {0x02, 'a', 0x00};
+	/* An extended length without its extension byte */
+	static const twi_u8 au8_cut_ext[] = {0x02, 'a', 0x00, 0x0F};
+	twi_u32 u32_seed = 3;
+	twi_u16 u16_iter;
+	twi_u16 u16_idx;
+
+	TEST_CHECK(0 == twi_lz_decompress(au8_far_match, sizeof(au8_far_match), gau8_out, sizeof(gau8_out)));
+	TEST_CHECK(0 == twi_lz_decompress(au8_cut_match, sizeof(au8_cut_match), gau8_out, sizeof(gau8_out)));
+	TEST_CHECK(0 == twi_lz_decompress(au8_cut_ext, sizeof(au8_cut_ext), gau8_out, sizeof(gau8_out)));
+
+	/* Random garbage never writes past the data buffer */
+	for(u16_iter = 0; u16_iter < 2000; u16_iter++)
+	{
+		for(u16_idx = 0; u16_idx < 64; u16_idx++)
+		{
+			gau8_lz[u16_idx] = (twi_u8)test_rand(&u32_seed);
+		}
+		gau8_out[128] = 0xEE;
+		TEST_CHECK(twi_lz_decompress(gau8_lz, 64, gau8_out, 128) <= 128);
+		TEST_CHECK(0xEE == gau8_out[128]);
+	}
+}
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+int main(void)
+{
+	test_zero_runs();
+	test_repeated_selectors();
+	test_short_inputs();
+	test_random_data();
+	test_far_matches();
+	test_dst_bounds();
+	test_malformed_input();
+
+	printf("twi_lz_test: %u failures\r\n", gu32_failures_cnt);
+	return (0 == gu32_failures_cnt) ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_rtt_test.c
+@brief		Unit tests of the round trip time estimator and of the latency histogram in twi_common.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include <stdio.h>
+#include "twi_common.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define TEST_RTO_INIT_MS		(1000)
+#define TEST_RTO_MIN_MS			(20)
+#define TEST_RTO_MAX_MS			(8000)
+
+#define TEST_CHECK(COND)		do{																\
+									if(!(COND))													\
+									{															\
+										printf("FAILED %s:%d: %s\r\n", __FUNCTION__, __LINE__, #COND);	\
+										gu32_failures_cnt++;									\
+									}															\
+								}while(0)
+
+//***********************************************************
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+//***********************************************************
+static twi_u32 gu32_failures_cnt = 0;
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+static void test_rtt_init(void)
+{
+	tstr_twi_rtt str_rtt;
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	TEST_CHECK(TEST_RTO_INIT_MS == twi_rtt_get_rto(&str_rtt));
+	TEST_CHECK(0 == str_rtt.u32_samples_cnt);
+}
+
+static void test_rtt_first_sample(void)
+{
+	tstr_twi_rtt str_rtt;
+
+	/* SRTT = R , RTTVAR = R / 2 , RTO = SRTT + 4 * RTTVAR = 3 R */
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	twi_rtt_sample(&str_rtt, 100);
+	TEST_CHECK(100 == (str_rtt.u32_srtt_x8 >> 3));
+	TEST_CHECK(300 == twi_rtt_get_rto(&str_rtt));
+	TEST_CHECK(1 == str_rtt.u32_samples_cnt);
+}
+
+static void test_rtt_converges(void)
+{
+	tstr_twi_rtt str_rtt;
+	twi_u32 u32_idx;
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	twi_rtt_sample(&str_rtt, 400);
+	for(u32_idx = 0; u32_idx < 100; u32_idx++)
+	{
+		twi_rtt_sample(&str_rtt, 40);
+	}
+	/* A steady RTT drives the variance to nothing and the RTO towards the RTT itself */
+	TEST_CHECK(40 == (str_rtt.u32_srtt_x8 >> 3));
+	TEST_CHECK(twi_rtt_get_rto(&str_rtt) >= 40);
+	TEST_CHECK(twi_rtt_get_rto(&str_rtt) <= 45);
+}
+
+static void test_rtt_jitter(void)
+{
+	tstr_twi_rtt str_rtt;
+	twi_u32 u32_idx;
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	for(u32_idx = 0; u32_idx < 100; u32_idx++)
+	{
+		twi_rtt_sample(&str_rtt, (0 != (u32_idx & 1)) ? 100 : 200);
+	}
+	/* Jitter keeps the RTO above the largest samples */
+	TEST_CHECK(twi_rtt_get_rto(&str_rtt) > 200);
+	TEST_CHECK(twi_rtt_get_rto(&str_rtt) < 600);
+}
+
+static void test_rtt_bounds(void)
+{
+	tstr_twi_rtt str_rtt;
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	twi_rtt_sample(&str_rtt, 0);
+	TEST_CHECK(TEST_RTO_MIN_MS == twi_rtt_get_rto(&str_rtt));
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	twi_rtt_sample(&str_rtt, 5000);
+	TEST_CHECK(TEST_RTO_MAX_MS == twi_rtt_get_rto(&str_rtt));
+}
+
+static void test_rtt_backoff(void)
+{
+	tstr_twi_rtt str_rtt;
+	twi_u32 u32_idx;
+
+	twi_rtt_init(&str_rtt, TEST_RTO_INIT_MS, TEST_RTO_MIN_MS, TEST_RTO_MAX_MS);
+	twi_rtt_backoff(&str_rtt);
+	TEST_CHECK((2 * TEST_RTO_INIT_MS) == twi_rtt_get_rto(&str_rtt));
+	for(u32_idx = 0; u32_idx < 10; u32_idx++)
+	{
+		twi_rtt_backoff(&str_rtt);
+	}
+	TEST_CHECK(TEST_RTO_MAX_MS == twi_rtt_get_rto(&str_rtt));
+
+	/* The next sample clears the backoff */
+	twi_rtt_sample(&str_rtt, 100);
+	TEST_CHECK(300 == twi_rtt_get_rto(&str_rtt));
+}
+
+static void test_hist(void)
+{
+	tstr_twi_hist str_hist;
+
+	twi_hist_reset(&str_hist);
+	twi_hist_add(&str_hist, 0);
+	twi_hist_add(&str_hist, 1);
+	twi_hist_add(&str_hist, 3);
+	twi_hist_add(&str_hist, 4);
+	twi_hist_add(&str_hist, 0xFFFFFFFF);
+
+	/* Bucket N counts [ 2^(N-1) , 2^N ) , the last one everything above */
+	TEST_CHECK(1 == str_hist.au32_buckets[0]);
+	TEST_CHECK(1 == str_hist.au32_buckets[1]);
+	TEST_CHECK(1 == str_hist.au32_buckets[2]);
+	TEST_CHECK(1 == str_hist.au32_buckets[3]);
+	TEST_CHECK(1 == str_hist.au32_buckets[TWI_HIST_BUCKETS_NUM - 1]);
+	TEST_CHECK(5 == str_hist.u32_samples_cnt);
+	TEST_CHECK(0xFFFFFFFF == str_hist.u32_max_ms);
+}
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+int main(void)
+{
+	test_rtt_init();
+	test_rtt_first_sample();
+	test_rtt_converges();
+	test_rtt_jitter();
+	test_rtt_bounds();
+	test_rtt_backoff();
+	test_hist();
+
+	printf("twi_rtt_test: %u failures\r\n", gu32_failures_cnt);
+	return (0 == gu32_failures_cnt) ? 0 : 1;
+}
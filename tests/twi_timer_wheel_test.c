@@ -0,0 +1,289 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_timer_wheel_test.c
+@brief		Unit tests of the timer wheel: expiry bounds, periodic timers, stop and restart, cascades, clock jumps and wrap around.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include <stdio.h>
+#include "twi_common.h"
+#include "twi_timer_wheel.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define TEST_CHECK(COND)		do{																\
+									if(!(COND))													\
+									{															\
+										printf("FAILED %s:%d: %s\r\n", __FUNCTION__, __LINE__, #COND);	\
+										gu32_failures_cnt++;									\
+									}															\
+								}while(0)
+
+//***********************************************************
+/*- TYPEDEFS ----------------------------------------------*/
+//***********************************************************
+typedef struct
+{
+	tstr_twi_timer_wheel* pstr_wheel;
+	tstr_timer_mgmt_timer str_timer;
+	twi_u32 u32_fired_cnt;
+	twi_u32 u32_fired_ms;			/* clock time of the last run that fired it */
+	twi_u32 u32_restart_ms;			/* 0 , or the timeout it restarts itself with */
+}tstr_test_timer;
+
+//***********************************************************
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+//***********************************************************
+static twi_u32 gu32_failures_cnt = 0;
+static twi_u32 gu32_now_ms = 0;
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+static void test_timer_cb(void* pv)
+{
+	tstr_test_timer* pstr_test = (tstr_test_timer*)pv;
+
+	pstr_test->u32_fired_cnt++;
+	pstr_test->u32_fired_ms = gu32_now_ms;
+	if(0 != pstr_test->u32_restart_ms)
+	{
+		TEST_CHECK(TWI_SUCCESS == twi_timer_wheel_start(pstr_test->pstr_wheel, gu32_now_ms, &pstr_test->str_timer, TWI_TIMER_TYPE_ONE_SHOT, pstr_test->u32_restart_ms, test_timer_cb, pstr_test));
+	}
+}
+
+static void test_timer_start(tstr_twi_timer_wheel* pstr_wheel, tstr_test_timer* pstr_test, tenu_mgmt_timer_mode enu_mode, twi_u32 u32_msec)
+{
+	TWI_MEMSET(pstr_test, 0, sizeof(tstr_test_timer));
+	pstr_test->pstr_wheel = pstr_wheel;
+	TEST_CHECK(TWI_SUCCESS == twi_timer_wheel_start(pstr_wheel, gu32_now_ms, &pstr_test->str_timer, enu_mode, u32_msec, test_timer_cb, pstr_test));
+	TEST_CHECK(TWI_TRUE == pstr_test->str_timer.b_is_active);
+}
+
+/* Runs the wheel every millisecond up to u32_end_ms , like a host polling the dispatcher. */
+static void test_run_till(tstr_twi_timer_wheel* pstr_wheel, twi_u32 u32_end_ms)
+{
+	while(gu32_now_ms != u32_end_ms)
+	{
+		gu32_now_ms++;
+		twi_timer_wheel_run(pstr_wheel, gu32_now_ms);
+	}
+}
+
+static void test_one_shot(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_test;
+
+	gu32_now_ms = 1234;
+	twi_timer_wheel_init(&str_wheel);
+	twi_timer_wheel_run(&str_wheel, gu32_now_ms);
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_ONE_SHOT, 95);
+
+	/* Never early , at most a tick late */
+	test_run_till(&str_wheel, 1234 + 94);
+	TEST_CHECK(0 == str_test.u32_fired_cnt);
+	test_run_till(&str_wheel, 1234 + 95 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(1 == str_test.u32_fired_cnt);
+	TEST_CHECK(str_test.u32_fired_ms >= (1234 + 95));
+	TEST_CHECK(TWI_FALSE == str_test.str_timer.b_is_active);
+	TEST_CHECK(0 == str_wheel.u8_timers_num);
+
+	test_run_till(&str_wheel, 2000);
+	TEST_CHECK(1 == str_test.u32_fired_cnt);
+}
+
+static void test_periodic(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_test;
+
+	gu32_now_ms = 0;
+	twi_timer_wheel_init(&str_wheel);
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_PERIODIC, 50);
+
+	test_run_till(&str_wheel, 1000);
+	TEST_CHECK(20 == str_test.u32_fired_cnt);
+	TEST_CHECK(TWI_TRUE == str_test.str_timer.b_is_active);
+
+	twi_timer_wheel_stop(&str_wheel, &str_test.str_timer);
+	test_run_till(&str_wheel, 2000);
+	TEST_CHECK(20 == str_test.u32_fired_cnt);
+	TEST_CHECK(0 == str_wheel.u8_timers_num);
+}
+
+static void test_stop_and_restart(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_test;
+	twi_u32 u32_timeout_ms = 0;
+
+	gu32_now_ms = 0;
+	twi_timer_wheel_init(&str_wheel);
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_ONE_SHOT, 100);
+	twi_timer_wheel_stop(&str_wheel, &str_test.str_timer);
+	TEST_CHECK(TWI_FALSE == str_test.str_timer.b_is_active);
+	TEST_CHECK(TWI_FALSE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	test_run_till(&str_wheel, 300);
+	TEST_CHECK(0 == str_test.u32_fired_cnt);
+
+	/* Starting an armed timer restarts it from now , in the same entry */
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_ONE_SHOT, 100);
+	test_run_till(&str_wheel, 380);
+	TEST_CHECK(TWI_SUCCESS == twi_timer_wheel_start(&str_wheel, gu32_now_ms, &str_test.str_timer, TWI_TIMER_TYPE_ONE_SHOT, 100, test_timer_cb, &str_test));
+	TEST_CHECK(1 == str_wheel.u8_timers_num);
+	test_run_till(&str_wheel, 479);
+	TEST_CHECK(0 == str_test.u32_fired_cnt);
+	test_run_till(&str_wheel, 500);
+	TEST_CHECK(1 == str_test.u32_fired_cnt);
+
+	/* A callback can restart its own timer */
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_ONE_SHOT, 30);
+	str_test.u32_restart_ms = 30;
+	test_run_till(&str_wheel, 500 + 300 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(str_test.u32_fired_cnt >= 9);
+	TEST_CHECK(str_test.u32_fired_cnt <= 10);
+	TEST_CHECK(TWI_TRUE == str_test.str_timer.b_is_active);
+	twi_timer_wheel_stop(&str_wheel, &str_test.str_timer);
+}
+
+static void test_far_timers(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_near;
+	tstr_test_timer str_level2;
+	tstr_test_timer str_parked;
+
+	/* Past a first level turn , and past a second level turn */
+	gu32_now_ms = 7;
+	twi_timer_wheel_init(&str_wheel);
+	twi_timer_wheel_run(&str_wheel, gu32_now_ms);
+	test_timer_start(&str_wheel, &str_near, TWI_TIMER_TYPE_ONE_SHOT, 20);
+	test_timer_start(&str_wheel, &str_level2, TWI_TIMER_TYPE_ONE_SHOT, 5000);
+	test_timer_start(&str_wheel, &str_parked, TWI_TIMER_TYPE_ONE_SHOT, 60000);
+
+	test_run_till(&str_wheel, 7 + 4999);
+	TEST_CHECK(1 == str_near.u32_fired_cnt);
+	TEST_CHECK(0 == str_level2.u32_fired_cnt);
+	test_run_till(&str_wheel, 7 + 5000 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(1 == str_level2.u32_fired_cnt);
+
+	test_run_till(&str_wheel, 7 + 59999);
+	TEST_CHECK(0 == str_parked.u32_fired_cnt);
+	test_run_till(&str_wheel, 7 + 60000 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(1 == str_parked.u32_fired_cnt);
+	TEST_CHECK(str_parked.u32_fired_ms >= (7 + 60000));
+}
+
+static void test_clock_jump(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_due;
+	tstr_test_timer str_later;
+
+	/* A host that slept past the expiry fires it on its next run , the later timer keeps its time */
+	gu32_now_ms = 0;
+	twi_timer_wheel_init(&str_wheel);
+	test_timer_start(&str_wheel, &str_due, TWI_TIMER_TYPE_ONE_SHOT, 100);
+	test_timer_start(&str_wheel, &str_later, TWI_TIMER_TYPE_ONE_SHOT, 3000);
+
+	gu32_now_ms = 2000;
+	twi_timer_wheel_run(&str_wheel, gu32_now_ms);
+	TEST_CHECK(1 == str_due.u32_fired_cnt);
+	TEST_CHECK(0 == str_later.u32_fired_cnt);
+	test_run_till(&str_wheel, 2999);
+	TEST_CHECK(0 == str_later.u32_fired_cnt);
+	test_run_till(&str_wheel, 3000 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(1 == str_later.u32_fired_cnt);
+}
+
+static void test_clock_wrap(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_test;
+
+	gu32_now_ms = 0xFFFFFF00;
+	twi_timer_wheel_init(&str_wheel);
+	twi_timer_wheel_run(&str_wheel, gu32_now_ms);
+	test_timer_start(&str_wheel, &str_test, TWI_TIMER_TYPE_ONE_SHOT, 1000);
+
+	test_run_till(&str_wheel, 0xFFFFFF00 + 999);
+	TEST_CHECK(0 == str_test.u32_fired_cnt);
+	test_run_till(&str_wheel, 0xFFFFFF00 + 1000 + TWI_TIMER_WHEEL_TICK_MS);
+	TEST_CHECK(1 == str_test.u32_fired_cnt);
+}
+
+static void test_next_timeout(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer str_first;
+	tstr_test_timer str_second;
+	twi_u32 u32_timeout_ms = 0;
+
+	gu32_now_ms = 0;
+	twi_timer_wheel_init(&str_wheel);
+	TEST_CHECK(TWI_FALSE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	test_timer_start(&str_wheel, &str_first, TWI_TIMER_TYPE_ONE_SHOT, 200);
+	test_timer_start(&str_wheel, &str_second, TWI_TIMER_TYPE_ONE_SHOT, 50);
+
+	TEST_CHECK(TWI_TRUE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	TEST_CHECK(50 == u32_timeout_ms);
+	gu32_now_ms = 45;
+	TEST_CHECK(TWI_TRUE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	TEST_CHECK(5 == u32_timeout_ms);
+	gu32_now_ms = 60;
+	TEST_CHECK(TWI_TRUE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	TEST_CHECK(0 == u32_timeout_ms);
+	twi_timer_wheel_run(&str_wheel, gu32_now_ms);
+	TEST_CHECK(1 == str_second.u32_fired_cnt);
+	TEST_CHECK(TWI_TRUE == twi_timer_wheel_get_next_timeout(&str_wheel, gu32_now_ms, &u32_timeout_ms));
+	TEST_CHECK(140 == u32_timeout_ms);
+}
+
+static void test_full_wheel(void)
+{
+	tstr_twi_timer_wheel str_wheel;
+	tstr_test_timer astr_tests[TWI_TIMER_WHEEL_TIMERS_NUM + 1];
+	twi_u8 u8_idx;
+
+	gu32_now_ms = 0;
+	twi_timer_wheel_init(&str_wheel);
+	for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+	{
+		test_timer_start(&str_wheel, &astr_tests[u8_idx], TWI_TIMER_TYPE_ONE_SHOT, 100 + (10 * u8_idx));
+	}
+	TWI_MEMSET(&astr_tests[u8_idx], 0, sizeof(tstr_test_timer));
+	TEST_CHECK(TWI_ERROR_INTERNAL_ERROR == twi_timer_wheel_start(&str_wheel, gu32_now_ms, &astr_tests[u8_idx].str_timer, TWI_TIMER_TYPE_ONE_SHOT, 100, test_timer_cb, &astr_tests[u8_idx]));
+	TEST_CHECK(TWI_FALSE == astr_tests[u8_idx].str_timer.b_is_active);
+
+	test_run_till(&str_wheel, 200);
+	for(u8_idx = 0; u8_idx < TWI_TIMER_WHEEL_TIMERS_NUM; u8_idx++)
+	{
+		TEST_CHECK(1 == astr_tests[u8_idx].u32_fired_cnt);
+	}
+	TEST_CHECK(0 == str_wheel.u8_timers_num);
+}
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+int main(void)
+{
+	test_one_shot();
+	test_periodic();
+	test_stop_and_restart();
+	test_far_timers();
+	test_clock_jump();
+	test_clock_wrap();
+	test_next_timeout();
+	test_full_wheel();
+
+	printf("twi_timer_wheel_test: %u failures\r\n", gu32_failures_cnt);
+	return (0 == gu32_failures_cnt) ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+/****************************************************************************/
+/* Copyright (c) 2022 Thirdwayv, Inc. All Rights Reserved. 					*/
+/****************************************************************************/
+
+/**
+@file		twi_transport_test.c
+@brief		Unit tests of the native transport: spec parsing, the loopback peer and the stack USB helpers over a pipe pair.
+*/
+
+//***********************************************************
+/*- INCLUDES ----------------------------------------------*/
+//***********************************************************
+#include <stdio.h>
+#include <unistd.h>
+#include "twi_common.h"
+#include "twi_transport.h"
+
+//***********************************************************
+/*- LOCAL MACROS ------------------------------------------*/
+//***********************************************************
+#define TEST_CHECK(COND)		do{																\
+									if(!(COND))													\
+									{															\
+										printf("FAILED %s:%d: %s\r\n", __FUNCTION__, __LINE__, #COND);	\
+										gu32_failures_cnt++;									\
+									}															\
+								}while(0)
+
+#define TEST_MSG_LEN			(10)
+
+//***********************************************************
+/*- TYPEDEFS ----------------------------------------------*/
+//***********************************************************
+/* Echoes every host report back once. */
+typedef struct
+{
+	twi_u8 au8_report[TWI_TRANSPORT_REPORT_SZ];
+	twi_u32 u32_reports_cnt;
+	twi_bool b_is_queued;
+}tstr_test_peer;
+
+//***********************************************************
+/*- GLOBAL STATIC VARIABLES -------------------------------*/
+//***********************************************************
+static twi_u32 gu32_failures_cnt = 0;
+
+//***********************************************************
+/*- LOCAL FUNCTIONS IMPLEMENTATION ------------------------*/
+//***********************************************************
+static void test_peer_report(void* pv_peer, const twi_u8* pu8_report, twi_u32 u32_report_len)
+{
+	tstr_test_peer* pstr_peer = (tstr_test_peer*)pv_peer;
+
+	TEST_CHECK(TWI_TRANSPORT_REPORT_SZ == u32_report_len);
+	TWI_MEMCPY(pstr_peer->au8_report, pu8_report, TWI_TRANSPORT_REPORT_SZ);
+	pstr_peer->u32_reports_cnt++;
+	pstr_peer->b_is_queued = TWI_TRUE;
+}
+
+static twi_bool test_peer_pop(void* pv_peer, twi_u8* pu8_report)
+{
+	tstr_test_peer* pstr_peer 	= (tstr_test_peer*)pv_peer;
+	twi_bool 		b_is_queued = pstr_peer->b_is_queued;
+
+	if(TWI_TRUE == b_is_queued)
+	{
+		TWI_MEMCPY(pu8_report, pstr_peer->au8_report, TWI_TRANSPORT_REPORT_SZ);
+		pstr_peer->b_is_queued = TWI_FALSE;
+	}
+	return b_is_queued;
+}
+
+/* Opens a pipe transport , *ps_dvc_rd_fd gets what the host writes and *ps_dvc_wr_fd feeds what it reads. */
+static twi_bool test_pipe_open(tstr_twi_transport* pstr_transport, int* ps_dvc_rd_fd, int* ps_dvc_wr_fd)
+{
+	int 	as_to_host[2];
+	int 	as_to_dvc[2];
+	char 	ac_spec[32];
+
+	if((0 != pipe(as_to_host)) || (0 != pipe(as_to_dvc)))
+	{
+		return TWI_FALSE;
+	}
+	snprintf(ac_spec, sizeof(ac_spec), "pipe:%d,%d", as_to_host[0], as_to_dvc[1]);
+	*ps_dvc_rd_fd = as_to_dvc[0];
+	*ps_dvc_wr_fd = as_to_host[1];
+	return (TWI_SUCCESS == twi_transport_open(pstr_transport, ac_spec, NULL)) ? TWI_TRUE : TWI_FALSE;
+}
+
+static void test_specs(void)
+{
+	tstr_twi_transport 	str_transport;
+	tstr_test_peer 		str_peer;
+	tstr_twi_transport_peer str_peer_ops = {test_peer_report, test_peer_pop, &str_peer};
+
+	TEST_CHECK(TWI_ERROR_INVALID_ARGUMENTS == twi_transport_open(&str_transport, "usb:0", &str_peer_ops));
+	TEST_CHECK(TWI_ERROR_INVALID_ARGUMENTS == twi_transport_open(&str_transport, "loop", &str_peer_ops));
+	TEST_CHECK(TWI_ERROR_INVALID_ARGUMENTS == twi_transport_open(&str_transport, "loopback", NULL));
+	TEST_CHECK(TWI_ERROR_INVALID_ARGUMENTS == twi_transport_open(&str_transport, "pipe:x", NULL));
+	TEST_CHECK(TWI_ERROR == twi_transport_open(&str_transport, "unix:/nonexistent/twi.sock", NULL));
+	TEST_CHECK(TWI_ERROR_NOT_SUPPORTED_FEATURE == twi_transport_listen(&str_transport, "loopback"));
+	TEST_CHECK(TWI_SUCCESS == twi_transport_open(&str_transport, "loopback", &str_peer_ops));
+	twi_transport_close(&str_transport);
+}
+
+static void test_loopback(void)
+{
+	tstr_twi_transport 	str_transport;
+	tstr_test_peer 		str_peer;
+	tstr_twi_transport_peer str_peer_ops = {test_peer_report, test_peer_pop, &str_peer};
+	twi_u8 				aau8_reports[2][TWI_TRANSPORT_REPORT_SZ];
+	twi_u8 				au8_report[TWI_TRANSPORT_REPORT_SZ];
+	twi_bool 			b_is_read;
+
+	TWI_MEMSET(&str_peer, 0, sizeof(str_peer));
+	TWI_MEMSET(aau8_reports[0], 0x11, TWI_TRANSPORT_REPORT_SZ);
+	TWI_MEMSET(aau8_reports[1], 0x22, TWI_TRANSPORT_REPORT_SZ);
+	TEST_CHECK(TWI_SUCCESS == twi_transport_open(&str_transport, "loopback", &str_peer_ops));
+
+	TEST_CHECK(TWI_SUCCESS == twi_transport_read(&str_transport, au8_report, 0, &b_is_read));
+	TEST_CHECK(TWI_FALSE == b_is_read);
+
+	/* Each report of a batch reaches the peer on its own. */
+	TEST_CHECK(TWI_SUCCESS == twi_transport_write(&str_transport, aau8_reports[0], 2));
+	TEST_CHECK(2 == str_peer.u32_reports_cnt);
+	TEST_CHECK(TWI_SUCCESS == twi_transport_read(&str_transport, au8_report, 0, &b_is_read));
+	TEST_CHECK((TWI_TRUE == b_is_read) && (0 == TWI_MEMCMP(au8_report, aau8_reports[1], TWI_TRANSPORT_REPORT_SZ)));
+	twi_transport_close(&str_transport);
+}
+
+static void test_stack_helpers(void)
+{
+	tstr_twi_transport 	str_transport;
+	tstr_stack_helpers 	str_helpers;
+	int 				s_dvc_rd_fd;
+	int 				s_dvc_wr_fd;
+	twi_u8 				au8_msg[TEST_MSG_LEN];
+	twi_u8 				aau8_reports[2][TWI_TRANSPORT_REPORT_SZ];
+	twi_u8 				au8_rx[TWI_TRANSPORT_REPORT_SZ * 2];
+	twi_u32 			u32_len;
+	twi_u8 				u8_idx;
+
+	if(TWI_TRUE != test_pipe_open(&str_transport, &s_dvc_rd_fd, &s_dvc_wr_fd))
+	{
+		TEST_CHECK(TWI_FALSE);
+		return;
+	}
+	TWI_MEMSET(&str_helpers, 0, sizeof(str_helpers));
+	twi_transport_bind_stack_helpers(&str_helpers);
+	TEST_CHECK((NULL != str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_send) && (NULL != str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_send_batch) &&
+			   (NULL != str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_receive) && (NULL != str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_stop) &&
+			   (NULL != str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_dispatch));
+	TEST_CHECK(NULL == str_helpers.pf_start_timer);
+
+	/* A single message goes out as one report led by its length , the rest is zeroed. */
+	for(u8_idx = 0; u8_idx < TEST_MSG_LEN; u8_idx++)
+	{
+		au8_msg[u8_idx] = (twi_u8)(u8_idx + 1);
+	}
+	TEST_CHECK(TWI_SUCCESS == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_send(&str_transport, au8_msg, TEST_MSG_LEN));
+	TEST_CHECK(TWI_TRANSPORT_REPORT_SZ == read(s_dvc_rd_fd, au8_rx, sizeof(au8_rx)));
+	TEST_CHECK((TEST_MSG_LEN == au8_rx[0]) && (0 == TWI_MEMCMP(&au8_rx[1], au8_msg, TEST_MSG_LEN)) && (0 == au8_rx[TWI_TRANSPORT_REPORT_SZ - 1]));
+	TEST_CHECK(TWI_ERROR_INVALID_LEN == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_send(&str_transport, aau8_reports, TWI_TRANSPORT_REPORT_SZ));
+
+	/* A batch goes out as laid out by the link layer. */
+	TWI_MEMSET(aau8_reports[0], 0x33, TWI_TRANSPORT_REPORT_SZ);
+	TWI_MEMSET(aau8_reports[1], 0x44, TWI_TRANSPORT_REPORT_SZ);
+	TEST_CHECK(TWI_SUCCESS == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_send_batch(&str_transport, aau8_reports, 2));
+	TEST_CHECK(sizeof(au8_rx) == read(s_dvc_rd_fd, au8_rx, sizeof(au8_rx)));
+	TEST_CHECK(0 == TWI_MEMCMP(au8_rx, aau8_reports, sizeof(au8_rx)));
+
+	/* Nothing waiting: success with nothing pulled. */
+	u32_len = sizeof(au8_rx);
+	TEST_CHECK(TWI_SUCCESS == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_receive(&str_transport, au8_rx, &u32_len));
+	TEST_CHECK(0 == u32_len);
+
+	/* A waiting report is pulled without its length byte. */
+	TWI_MEMSET(aau8_reports[0], 0, TWI_TRANSPORT_REPORT_SZ);
+	aau8_reports[0][0] = TEST_MSG_LEN;
+	TWI_MEMCPY(&aau8_reports[0][1], au8_msg, TEST_MSG_LEN);
+	TEST_CHECK(TWI_TRANSPORT_REPORT_SZ == write(s_dvc_wr_fd, aau8_reports[0], TWI_TRANSPORT_REPORT_SZ));
+	u32_len = sizeof(au8_rx);
+	TEST_CHECK(TWI_SUCCESS == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_receive(&str_transport, au8_rx, &u32_len));
+	TEST_CHECK((TEST_MSG_LEN == u32_len) && (0 == TWI_MEMCMP(au8_rx, au8_msg, TEST_MSG_LEN)));
+
+	/* A length past the report is refused. */
+	aau8_reports[0][0] = TWI_TRANSPORT_REPORT_SZ;
+	TEST_CHECK(TWI_TRANSPORT_REPORT_SZ == write(s_dvc_wr_fd, aau8_reports[0], TWI_TRANSPORT_REPORT_SZ));
+	u32_len = sizeof(au8_rx);
+	TEST_CHECK(TWI_ERROR_INVALID_LEN == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_receive(&str_transport, au8_rx, &u32_len));
+	TEST_CHECK(0 == u32_len);
+
+	/* The device going away fails the pull. */
+	close(s_dvc_wr_fd);
+	u32_len = sizeof(au8_rx);
+	TEST_CHECK(TWI_ERROR == str_helpers.uni_ll_helpers.str_usb.pf_twi_usbd_receive(&str_transport, au8_rx, &u32_len));
+
+	twi_transport_close(&str_transport);
+	close(s_dvc_rd_fd);
+}
+
+//***********************************************************
+/*- APIs IMPLEMENTATION -----------------------------------*/
+//***********************************************************
+int main(void)
+{
+	test_specs();
+	test_loopback();
+	test_stack_helpers();
+
+	printf("twi_transport_test: %u failures\r\n", gu32_failures_cnt);
+	return (0 == gu32_failures_cnt) ? 0 : 1;
+}